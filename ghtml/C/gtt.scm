@@ -42,7 +42,7 @@
 ;
 (define (gtt-linked-or-query-results)
         (if (gtt-did-query) 
-            (gtt-query-results)
+            (gtt-query-projects)
             (gtt-project-subprojects (gtt-linked-project))
         )
 )
@@ -165,6 +165,15 @@
 (define (gtt-interval-elapsed interval)
         (- (gtt-interval-stop interval) (gtt-interval-start interval))
 )
+
+; Total elapsed time of all of the intervals of some projects or
+; tasks.  This uses the gtt-fold-intervals iterator, which visits the
+; intervals one at a time, instead of making a list of them all.
+(define (gtt-intervals-elapsed objs)
+        (gtt-fold-intervals
+            (lambda (ivl total) (+ total (gtt-interval-elapsed ivl)))
+            0 objs)
+)
   
 ;; ---------------------------------------------------------     
 ; The gtt-task-billable-value-str routine will display the value of
@@ -237,6 +246,159 @@
         (if (gtt-is-daily-type? daily-obj)
              (cadr (cddar daily-obj) )))
 
+;; ---------------------------------------------------------     
+; The 'bucket-obj' is the raw form of the above, as returned by
+; gtt-daily-buckets: one per day, in date order, including the days
+; on which nothing was done.  The start and end of the day are in
+; seconds since the epoch, and the total is in seconds.
+
+(define (gtt-is-bucket-type? bucket-obj)  (equal? (cdr bucket-obj) "gtt-bucket") )
+
+(define (gtt-bucket-start bucket-obj)
+        (if (gtt-is-bucket-type? bucket-obj)
+            (list-ref (car bucket-obj) 0) ))
+
+(define (gtt-bucket-end bucket-obj)
+        (if (gtt-is-bucket-type? bucket-obj)
+            (list-ref (car bucket-obj) 1) ))
+
+(define (gtt-bucket-total bucket-obj)
+        (if (gtt-is-bucket-type? bucket-obj)
+            (list-ref (car bucket-obj) 2) ))
+
+(define (gtt-bucket-task-list bucket-obj)
+        (if (gtt-is-bucket-type? bucket-obj)
+            (list-ref (car bucket-obj) 3) ))
+
+(define (gtt-bucket-interval-list bucket-obj)
+        (if (gtt-is-bucket-type? bucket-obj)
+            (list-ref (car bucket-obj) 4) ))
+;; ---------------------------------------------------------     
+; The 'aggregate-obj' is one record returned by gtt-aggregate, e.g.
+;   (gtt-aggregate (gtt-projects) 'month)
+; The key is the start of the week, month or year, the customer id,
+; or the name of the bill status or rate.  The start and end are in
+; seconds since the epoch; the total and billable times are in
+; seconds, and the value is in the project's currency.
+
+(define (gtt-is-aggregate-type? aggregate-obj)
+        (equal? (cdr aggregate-obj) "gtt-aggregate") )
+
+(define (gtt-aggregate-key aggregate-obj)
+        (if (gtt-is-aggregate-type? aggregate-obj)
+            (list-ref (car aggregate-obj) 0) ))
+
+(define (gtt-aggregate-start aggregate-obj)
+        (if (gtt-is-aggregate-type? aggregate-obj)
+            (list-ref (car aggregate-obj) 1) ))
+
+(define (gtt-aggregate-end aggregate-obj)
+        (if (gtt-is-aggregate-type? aggregate-obj)
+            (list-ref (car aggregate-obj) 2) ))
+
+(define (gtt-aggregate-total aggregate-obj)
+        (if (gtt-is-aggregate-type? aggregate-obj)
+            (list-ref (car aggregate-obj) 3) ))
+
+(define (gtt-aggregate-billable aggregate-obj)
+        (if (gtt-is-aggregate-type? aggregate-obj)
+            (list-ref (car aggregate-obj) 4) ))
+
+(define (gtt-aggregate-value aggregate-obj)
+        (if (gtt-is-aggregate-type? aggregate-obj)
+            (list-ref (car aggregate-obj) 5) ))
+
+;; ---------------------------------------------------------     
+; The 'invoice-obj' is returned by gtt-invoice, e.g.
+;   (gtt-invoice (gtt-linked-project))
+; Its items are the tasks on hold, to bill, or paid; the subtotals
+; are by bill status, and the rate totals by bill rate, for the
+; items to bill alone.  Times are in seconds, and amounts in the
+; project's currency; print them with gtt-hours-str and
+; gtt-currency-str.
+
+(define (gtt-is-invoice-type? invoice-obj)
+        (equal? (cdr invoice-obj) "gtt-invoice") )
+
+(define (gtt-invoice-status-index status)
+        (cond ((equal? status 'hold) 0)
+              ((equal? status 'bill) 1)
+              ((equal? status 'paid) 2)
+              (else 1) ))
+
+(define (gtt-invoice-rate-index rate)
+        (cond ((equal? rate 'regular) 0)
+              ((equal? rate 'overtime) 1)
+              ((equal? rate 'overover) 2)
+              ((equal? rate 'flat-fee) 3)
+              (else 0) ))
+
+; (gtt-invoice-items inv 'bill) is the list of items to bill
+(define (gtt-invoice-items invoice-obj status)
+        (if (gtt-is-invoice-type? invoice-obj)
+            (list-ref (list-ref (car invoice-obj) 0)
+                      (gtt-invoice-status-index status)) ))
+
+(define (gtt-invoice-subtotal invoice-obj status)
+        (if (gtt-is-invoice-type? invoice-obj)
+            (list-ref (list-ref (car invoice-obj) 1)
+                      (gtt-invoice-status-index status)) ))
+
+(define (gtt-invoice-rate-total invoice-obj rate)
+        (if (gtt-is-invoice-type? invoice-obj)
+            (list-ref (list-ref (car invoice-obj) 2)
+                      (gtt-invoice-rate-index rate)) ))
+
+(define (gtt-invoice-total invoice-obj)
+        (if (gtt-is-invoice-type? invoice-obj)
+            (list-ref (car invoice-obj) 3) ))
+
+(define (gtt-is-invoice-line-type? line-obj)
+        (equal? (cdr line-obj) "gtt-invoice-line") )
+
+(define (gtt-invoice-line-task line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 0) ))
+
+(define (gtt-invoice-line-billstatus line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 1) ))
+
+(define (gtt-invoice-line-billrate line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 2) ))
+
+(define (gtt-invoice-line-secs line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 3) ))
+
+(define (gtt-invoice-line-billed-secs line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 4) ))
+
+(define (gtt-invoice-line-value line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 5) ))
+
+(define (gtt-invoice-line-billed-value line-obj)
+        (if (gtt-is-invoice-line-type? line-obj)
+            (list-ref (car line-obj) 6) ))
+
+(define (gtt-is-invoice-total-type? total-obj)
+        (equal? (cdr total-obj) "gtt-invoice-total") )
+
+(define (gtt-invoice-total-secs total-obj)
+        (if (gtt-is-invoice-total-type? total-obj)
+            (list-ref (car total-obj) 1) ))
+
+(define (gtt-invoice-total-billed-secs total-obj)
+        (if (gtt-is-invoice-total-type? total-obj)
+            (list-ref (car total-obj) 2) ))
+
+(define (gtt-invoice-total-amount total-obj)
+        (if (gtt-is-invoice-total-type? total-obj)
+            (list-ref (car total-obj) 3) ))
+
 ;; ---------------------------------------------------------     
 ; Syntactic sugar that allows various task attributes to 
 ; be extracted next to each other ... see daily report for usage
@@ -56,6 +56,12 @@ void save_projects (void);
 void read_data (gboolean);
 
 void unlock_gtt (void);
+
+/* The gtt_is_running() routine returns TRUE if the pid-file says
+ * that another GnoTime, of this user, is running; it then owns the
+ * data file, and will overwrite it when it next saves.
+ */
+gboolean gtt_is_running (void);
 const char *gtt_gettext (const char *s);
 
 #endif // GTT_H
@@ -166,6 +166,7 @@ setup_menus (GttActiveDialog *dlg)
       gtk_menu_shell_append (menushell, item);
       gtk_widget_show (item);
     }
+  g_list_free (prjlist);
   gtk_option_menu_set_menu (dlg->project_menu, GTK_WIDGET (menushell));
 }
 
@@ -0,0 +1,692 @@
+/*   Render reports without the GUI, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_batch_report.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gnome.h>
+#include <glib/gstdio.h>
+#include <libguile.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <qof.h>
+
+#include "gtt.h"
+#include "gtt_columnar.h"
+#include "gtt_columns.h"
+#include "gtt_ical.h"
+#include "gtt_import.h"
+#include "gtt_merge.h"
+#include "gtt_current_project.h"
+#include "gtt_err_throw.h"
+#include "gtt_ghtml.h"
+#include "gtt_gsettings_io.h"
+#include "gtt_invoice.h"
+#include "gtt_preferences.h"
+#include "gtt_project.h"
+#include "gtt_report_pool.h"
+#include "gtt_xml.h"
+
+typedef struct
+{
+  char *report;  /* template file name */
+  char *project; /* project title, or NULL */
+  char *output;  /* output file name */
+} BatchJob;
+
+static gchar **opt_reports = NULL;
+static gchar **opt_projects = NULL;
+static gchar **opt_invoices = NULL;
+static gchar **opt_exports = NULL;
+static gchar *opt_columns = NULL;
+static gchar *opt_columnar = NULL;
+static gchar **opt_imports = NULL;
+static gchar **opt_merges = NULL;
+static gchar *opt_ical = NULL;
+static gchar *opt_ical_dir = NULL;
+static gchar *opt_output = NULL;
+static gchar *opt_batch = NULL;
+static gchar *opt_data = NULL;
+static gint opt_jobs = 0;
+
+static const GOptionEntry batch_options[]
+    = { { "report", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_reports,
+          N_ ("Render the report TEMPLATE to a file"), N_ ("TEMPLATE") },
+        { "project", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_projects,
+          N_ ("Render the reports for the project TITLE"), N_ ("TITLE") },
+        { "invoice", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_invoices,
+          N_ ("Write the invoice for the project TITLE, as text"),
+          N_ ("TITLE") },
+        { "export", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_exports,
+          N_ ("Export the project TITLE as CSV or tab-separated text"),
+          N_ ("TITLE") },
+        { "columns", 0, 0, G_OPTION_ARG_STRING, &opt_columns,
+          N_ ("Export the columns in SPEC"), N_ ("SPEC") },
+        { "columnar", 0, 0, G_OPTION_ARG_FILENAME, &opt_columnar,
+          N_ ("Export all of the data to FILE, in columns, for analysis"),
+          N_ ("FILE") },
+        { "ical", 0, 0, G_OPTION_ARG_FILENAME, &opt_ical,
+          N_ ("Export the intervals and to-dos to FILE, as iCalendar"),
+          N_ ("FILE") },
+        { "ical-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_ical_dir,
+          N_ ("Sync the intervals and to-dos into the calendar DIR"),
+          N_ ("DIR") },
+        { "merge", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_merges,
+          N_ ("Merge in the data FILE of another machine, and save it"),
+          N_ ("FILE") },
+        { "import", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_imports,
+          N_ ("Import time data from a CSV or JSON FILE, and save it"),
+          N_ ("FILE") },
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &opt_output,
+          N_ ("Name the output files after PATTERN (default %r-%p.html)"),
+          N_ ("PATTERN") },
+        { "batch", 0, 0, G_OPTION_ARG_FILENAME, &opt_batch,
+          N_ ("Render the reports listed in FILE"), N_ ("FILE") },
+        { "data", 0, 0, G_OPTION_ARG_FILENAME, &opt_data,
+          N_ ("Read the project data from FILE"), N_ ("FILE") },
+        { "jobs", 'j', 0, G_OPTION_ARG_INT, &opt_jobs,
+          N_ ("Render N reports at a time (default: one per CPU)"),
+          N_ ("N") },
+        { NULL } };
+
+/* ============================================================== */
+
+gboolean
+gtt_batch_report_wanted (int argc, char **argv)
+{
+  int i;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (!strncmp (argv[i], "--report", 8))
+        return TRUE;
+      if (!strncmp (argv[i], "--batch", 7))
+        return TRUE;
+      if (!strncmp (argv[i], "--invoice", 9))
+        return TRUE;
+      if (!strncmp (argv[i], "--export", 8))
+        return TRUE;
+      if (!strncmp (argv[i], "--columnar", 10))
+        return TRUE;
+      if (!strncmp (argv[i], "--import", 8))
+        return TRUE;
+      if (!strncmp (argv[i], "--merge", 7))
+        return TRUE;
+      if (!strncmp (argv[i], "--ical", 6))
+        return TRUE;
+    }
+  return FALSE;
+}
+
+/* ============================================================== */
+
+static void
+batch_job_free (BatchJob *job)
+{
+  g_free (job->report);
+  g_free (job->project);
+  g_free (job->output);
+  g_free (job);
+}
+
+/* Expand %r, %p and %% in the output file name pattern */
+static char *
+expand_output_pattern (const char *pattern, const char *report,
+                       const char *project)
+{
+  GString *str = g_string_new (NULL);
+  char *name, *dot;
+  const char *p;
+
+  name = g_path_get_basename (report);
+  dot = strrchr (name, '.');
+  if (dot && dot != name)
+    *dot = 0;
+
+  for (p = pattern; *p; p++)
+    {
+      if ('%' != p[0] || 0 == p[1])
+        {
+          g_string_append_c (str, *p);
+          continue;
+        }
+      p++;
+      if ('r' == *p)
+        g_string_append (str, name);
+      else if ('p' == *p)
+        {
+          const char *q = project ? project : "all";
+          for (; *q; q++)
+            g_string_append_c (str, ('/' == *q) ? '_' : *q);
+        }
+      else
+        g_string_append_c (str, *p);
+    }
+  g_free (name);
+  return g_string_free (str, FALSE);
+}
+
+static void
+add_job (GPtrArray *jobs, const char *report, const char *project,
+         const char *output)
+{
+  BatchJob *job = g_new0 (BatchJob, 1);
+
+  job->report = g_strdup (report);
+  job->project = (project && *project) ? g_strdup (project) : NULL;
+  job->output = g_strdup (output);
+  g_ptr_array_add (jobs, job);
+}
+
+static void
+add_jobs_from_args (GPtrArray *jobs)
+{
+  const char *pattern = opt_output ? opt_output : "%r-%p.html";
+  char *output;
+  int i, j;
+
+  for (i = 0; opt_reports && opt_reports[i]; i++)
+    {
+      if (!opt_projects)
+        {
+          output = expand_output_pattern (pattern, opt_reports[i], NULL);
+          add_job (jobs, opt_reports[i], NULL, output);
+          g_free (output);
+          continue;
+        }
+      for (j = 0; opt_projects[j]; j++)
+        {
+          output = expand_output_pattern (pattern, opt_reports[i],
+                                          opt_projects[j]);
+          add_job (jobs, opt_reports[i], opt_projects[j], output);
+          g_free (output);
+        }
+    }
+}
+
+static gboolean
+add_jobs_from_file (GPtrArray *jobs, const char *filename)
+{
+  GError *error = NULL;
+  char *contents;
+  char **lines;
+  int i;
+
+  if (!g_file_get_contents (filename, &contents, NULL, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i]; i++)
+    {
+      char **fields;
+
+      g_strstrip (lines[i]);
+      if (0 == lines[i][0] || '#' == lines[i][0])
+        continue;
+
+      fields = g_strsplit (lines[i], "\t", 3);
+      if (!fields[0] || !fields[1] || !fields[2])
+        {
+          fprintf (stderr, _ ("%s:%d: expected report, project and output "
+                              "separated by tabs\n"),
+                   filename, i + 1);
+          g_strfreev (fields);
+          continue;
+        }
+      add_job (jobs, g_strstrip (fields[0]), g_strstrip (fields[1]),
+               g_strstrip (fields[2]));
+      g_strfreev (fields);
+    }
+  g_strfreev (lines);
+  g_free (contents);
+  return TRUE;
+}
+
+/* ============================================================== */
+
+static GttProject *
+find_project (GList *prjs, const char *title)
+{
+  GList *node;
+
+  for (node = prjs; node; node = node->next)
+    {
+      GttProject *prj = node->data;
+      GttProject *found;
+
+      if (!g_strcmp0 (gtt_project_get_title (prj), title))
+        return prj;
+      found = find_project (gtt_project_get_children (prj), title);
+      if (found)
+        return found;
+    }
+  return NULL;
+}
+
+/* Look up the template and the project, and queue the render */
+static gboolean
+batch_queue (GttReportPool *pool, BatchJob *job)
+{
+  GttProject *prj = NULL;
+  char *path;
+
+  if (g_file_test (job->report, G_FILE_TEST_IS_REGULAR))
+    path = g_strdup (job->report);
+  else
+    path = gtt_ghtml_resolve_path (job->report, NULL);
+  if (!path)
+    {
+      fprintf (stderr, _ ("Report template not found: %s\n"), job->report);
+      return FALSE;
+    }
+
+  if (job->project)
+    {
+      prj = find_project (gtt_project_list_get_list (master_list),
+                          job->project);
+      if (!prj)
+        {
+          fprintf (stderr, _ ("No such project: %s\n"), job->project);
+          g_free (path);
+          return FALSE;
+        }
+    }
+
+  gtt_report_pool_add (pool, path, prj, job->output);
+  g_free (path);
+  return TRUE;
+}
+
+static void *
+batch_render_all (void *data)
+{
+  GPtrArray *jobs = data;
+  GttReportPool *pool;
+  int *failures = g_new0 (int, 1);
+  guint i;
+
+  pool = gtt_report_pool_new (master_list, opt_jobs);
+  for (i = 0; i < jobs->len; i++)
+    {
+      if (!batch_queue (pool, g_ptr_array_index (jobs, i)))
+        (*failures)++;
+    }
+  *failures += gtt_report_pool_wait (pool);
+  return failures;
+}
+
+/* ============================================================== */
+/* Invoices are written straight from the data, with no template */
+
+static gboolean
+write_invoice (const char *title)
+{
+  const char *pattern = opt_output ? opt_output : "%r-%p.tsv";
+  GttInvoice *inv;
+  GttProject *prj;
+  GList *prjs;
+  char *output;
+  gboolean ok;
+  FILE *fh;
+
+  prj = find_project (gtt_project_list_get_list (master_list), title);
+  if (!prj)
+    {
+      fprintf (stderr, _ ("No such project: %s\n"), title);
+      return FALSE;
+    }
+
+  output = expand_output_pattern (pattern, "invoice", title);
+  fh = fopen (output, "w");
+  if (!fh)
+    {
+      perror (output);
+      g_free (output);
+      return FALSE;
+    }
+
+  prjs = g_list_prepend (NULL, prj);
+  inv = gtt_invoice_new (prjs, TRUE, 0, 0);
+  g_list_free (prjs);
+  ok = gtt_invoice_write (inv, fh);
+  gtt_invoice_free (inv);
+
+  if (fclose (fh))
+    ok = FALSE;
+  if (!ok)
+    fprintf (stderr, _ ("Failed to write %s\n"), output);
+  g_free (output);
+  return ok;
+}
+
+/* The default for --columns: one row per interval */
+#define DEFAULT_EXPORT_COLUMNS                                                \
+  "$title $memo $billstatus $billable $billrate $start_datime "              \
+  "$stop_datime $elapsed"
+
+static gboolean
+write_export (GttColumns *cols, const char *title)
+{
+  const char *pattern = opt_output ? opt_output : "%r-%p.tsv";
+  GttProject *prj;
+  GList *prjs;
+  char *output;
+  gboolean ok;
+  int fd;
+
+  prj = find_project (gtt_project_list_get_list (master_list), title);
+  if (!prj)
+    {
+      fprintf (stderr, _ ("No such project: %s\n"), title);
+      return FALSE;
+    }
+
+  output = expand_output_pattern (pattern, "export", title);
+  fd = g_open (output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (0 > fd)
+    {
+      perror (output);
+      g_free (output);
+      return FALSE;
+    }
+
+  prjs = g_list_prepend (NULL, prj);
+  ok = gtt_columns_export (cols, prjs, TRUE,
+                           gtt_columns_format_for_file (output), fd);
+  g_list_free (prjs);
+  if (!ok)
+    perror (output);
+  if (close (fd))
+    ok = FALSE;
+  if (!ok)
+    fprintf (stderr, _ ("Failed to write %s\n"), output);
+  g_free (output);
+  return ok;
+}
+
+static gboolean
+write_exports (void)
+{
+  GttColumns *cols;
+  char *errmsg = NULL;
+  gboolean ok = TRUE;
+  int i;
+
+  cols = gtt_columns_parse (opt_columns ? opt_columns
+                                        : DEFAULT_EXPORT_COLUMNS,
+                            &errmsg);
+  if (!cols)
+    {
+      fprintf (stderr, "%s\n", errmsg);
+      g_free (errmsg);
+      return FALSE;
+    }
+  for (i = 0; opt_exports[i]; i++)
+    {
+      if (!write_export (cols, opt_exports[i]))
+        ok = FALSE;
+    }
+  gtt_columns_free (cols);
+  return ok;
+}
+
+static gboolean
+write_columnar (const char *filename)
+{
+  gboolean ok;
+  FILE *fh;
+
+  fh = fopen (filename, "wb");
+  if (!fh)
+    {
+      perror (filename);
+      return FALSE;
+    }
+  ok = gtt_columnar_write (gtt_project_list_get_list (master_list), TRUE,
+                           fh);
+  if (fclose (fh))
+    ok = FALSE;
+  if (!ok)
+    fprintf (stderr, _ ("Failed to write %s\n"), filename);
+  return ok;
+}
+
+static gboolean
+write_ical (const char *filename)
+{
+  gboolean ok;
+  FILE *fh;
+
+  fh = fopen (filename, "wb");
+  if (!fh)
+    {
+      perror (filename);
+      return FALSE;
+    }
+  ok = gtt_ical_write (gtt_project_list_get_list (master_list), TRUE, fh);
+  if (fclose (fh))
+    ok = FALSE;
+  if (!ok)
+    fprintf (stderr, _ ("Failed to write %s\n"), filename);
+  return ok;
+}
+
+static gboolean
+sync_ical (const char *dir)
+{
+  GttIcalSync *sync = gtt_ical_sync_new (dir);
+  char *errmsg = NULL;
+  int n;
+
+  n = gtt_ical_sync (sync, gtt_project_list_get_list (master_list),
+                     &errmsg);
+  gtt_ical_sync_free (sync);
+  if (0 > n)
+    {
+      fprintf (stderr, "%s\n", errmsg);
+      g_free (errmsg);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* ============================================================== */
+
+static char *
+data_path (void)
+{
+  if (opt_data)
+    return g_strdup (opt_data);
+  if (('~' != config_data_url[0]) && ('/' != config_data_url[0]))
+    return gnome_config_get_real_path (config_data_url);
+  return g_strdup (config_data_url);
+}
+
+static gboolean
+load_data (void)
+{
+  GttErrCode errcode;
+  char *path = data_path ();
+
+  gtt_err_set_code (GTT_NO_ERR);
+  gtt_xml_read_file (path);
+  errcode = gtt_err_get_code ();
+  if (GTT_NO_ERR != errcode)
+    {
+      char *msg = gtt_err_to_string (errcode, path);
+      fprintf (stderr, "%s\n", msg);
+      g_free (msg);
+      g_free (path);
+      return FALSE;
+    }
+  g_free (path);
+  return TRUE;
+}
+
+/* Merge and import the files, and then save the lot, so that the
+ * reports and exports see the new data too.  Nothing is saved if any
+ * of them failed, or if GnoTime is running: it would write its own
+ * copy over ours when it next saved. */
+static gboolean
+update_data (void)
+{
+  GttErrCode errcode;
+  gboolean ok = TRUE;
+  char *path;
+  int i;
+
+  if (gtt_is_running ())
+    {
+      fprintf (stderr, "%s\n",
+               _ ("GnoTime is running; quit it before merging or "
+                  "importing."));
+      return FALSE;
+    }
+
+  for (i = 0; opt_merges && opt_merges[i]; i++)
+    {
+      char *errmsg = NULL;
+
+      if (!gtt_merge_file (opt_merges[i], NULL, &errmsg))
+        {
+          fprintf (stderr, "%s\n", errmsg);
+          g_free (errmsg);
+          ok = FALSE;
+        }
+    }
+
+  for (i = 0; opt_imports && opt_imports[i]; i++)
+    {
+      char *errmsg = NULL;
+      int n = gtt_import_file (opt_imports[i], &errmsg);
+
+      if (0 > n)
+        {
+          fprintf (stderr, "%s: %s\n", opt_imports[i], errmsg);
+          g_free (errmsg);
+          ok = FALSE;
+        }
+    }
+  if (!ok)
+    return FALSE;
+
+  path = data_path ();
+  gtt_err_set_code (GTT_NO_ERR);
+  gtt_xml_write_file (path);
+  errcode = gtt_err_get_code ();
+  if (GTT_NO_ERR != errcode)
+    {
+      char *msg = gtt_err_to_string (errcode, path);
+      fprintf (stderr, "%s\n", msg);
+      g_free (msg);
+      ok = FALSE;
+    }
+  g_free (path);
+  return ok;
+}
+
+int
+gtt_batch_report_main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GPtrArray *jobs;
+  char *gnome_argv[] = { argv[0], NULL };
+  int *failures;
+  int i, rc;
+
+  bindtextdomain (GETTEXT_PACKAGE, GNOMELOCALEDIR);
+  bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+  textdomain (GETTEXT_PACKAGE);
+
+  context = g_option_context_new (_ ("- render GnoTime reports"));
+  g_option_context_add_main_entries (context, batch_options, GETTEXT_PACKAGE);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+  g_option_context_free (context);
+  if (0 >= opt_jobs)
+    opt_jobs = MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+
+  jobs = g_ptr_array_new_with_free_func ((GDestroyNotify)batch_job_free);
+  add_jobs_from_args (jobs);
+  if (opt_batch && !add_jobs_from_file (jobs, opt_batch))
+    {
+      g_ptr_array_free (jobs, TRUE);
+      return 1;
+    }
+
+  /* libgnome, but not libgnomeui: we need it to find the report
+   * templates and the data file, but we don't want a display. */
+  gnome_program_init (PACKAGE, VERSION, LIBGNOME_MODULE, 1, gnome_argv,
+                      GNOME_PROGRAM_STANDARD_PROPERTIES, NULL);
+
+  qof_init ();
+  gtt_project_obj_register ();
+  master_list = gtt_project_list_new ();
+
+  gtt_gsettings_load_report_config ();
+  if (!load_data ())
+    {
+      g_ptr_array_free (jobs, TRUE);
+      return 1;
+    }
+
+  rc = 0;
+  if ((opt_merges || opt_imports) && !update_data ())
+    rc = 1;
+  for (i = 0; opt_invoices && opt_invoices[i]; i++)
+    {
+      if (!write_invoice (opt_invoices[i]))
+        rc = 1;
+    }
+  if (opt_exports && !write_exports ())
+    rc = 1;
+  if (opt_columnar && !write_columnar (opt_columnar))
+    rc = 1;
+  if (opt_ical && !write_ical (opt_ical))
+    rc = 1;
+  if (opt_ical_dir && !sync_ical (opt_ical_dir))
+    rc = 1;
+
+  if (0 < jobs->len)
+    {
+      failures = scm_with_guile (batch_render_all, jobs);
+      if (0 != *failures)
+        rc = 1;
+      g_free (failures);
+    }
+
+  g_ptr_array_free (jobs, TRUE);
+  return rc;
+}
+
+/* ======================= END OF FILE =================== */
@@ -0,0 +1,95 @@
+/*   Render reports without the GUI, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_BATCH_REPORT_H
+#define GTT_BATCH_REPORT_H
+
+#include <glib.h>
+
+/* Batch mode renders ghtml reports straight to files, without opening
+ * any windows; it doesn't need a display, and so can be run from cron.
+ * The data file is loaded once, and then any number of reports are
+ * rendered from it:
+ *
+ *   gnotime --report=invoice.ghtml --project=Acme --project=Initech \
+ *           --output=%p-%r.html
+ *
+ *   gnotime --batch=month-end.txt
+ *
+ * Each --report is rendered once for each --project (or once, with no
+ * linked project, if there are none).  In the --output pattern, %r
+ * stands for the report name, %p for the project title, and %% for a
+ * percent sign.  A --batch file lists one render per line, as
+ *
+ *   report <TAB> project <TAB> output file
+ *
+ * where the project may be empty; blank lines and lines starting
+ * with # are ignored.
+ *
+ * Each --invoice writes the invoice for the project with that title,
+ * and its subprojects, as tab-separated text (see gtt_invoice_write());
+ * no template is needed.  The file is named after the --output pattern
+ * too, with "invoice" for %r; by default, it's invoice-TITLE.tsv.
+ *
+ * Each --export does the same with the project's tasks or intervals,
+ * with the columns given by --columns (see gtt_columns.h), as in
+ *
+ *   gnotime --export=Acme --columns='$memo $start_datime $elapsed' \
+ *           --output=acme.csv
+ *
+ * The file is named as for an invoice, with "export" for %r; it's
+ * comma-separated if its name ends in .csv, and tab-separated if not.
+ * By default there's a row per interval, with the project title, the
+ * task's memo and billing, and the interval's start, stop and length.
+ *
+ * The --columnar option writes all of the projects, tasks and
+ * intervals to the one file given, in the binary columnar layout of
+ * gtt_columnar.h, for analysis tools to load.
+ *
+ * The --ical option writes the intervals, as events, and the projects
+ * with an estimated start or due date, as to-dos, to the one file
+ * given; --ical-dir writes them to the directory given, a file per
+ * project, and removes the files of projects that are gone, as for a
+ * local calendar collection.  See gtt_ical.h.
+ *
+ * Each --merge reads the data file of another machine, and merges it
+ * in by GUID, as described in gtt_merge.h; run from cron, on both
+ * machines in turn, that keeps their data files in step.
+ *
+ * Each --import reads time data from a CSV, JSON or iCalendar file,
+ * as described in gtt_import.h, into the projects; once they're all
+ * read, the data file is saved.  The merges and imports are done before
+ * anything else, so that the invoices, exports and reports include
+ * them.  If any of them fails, the data file is left as it was; and
+ * neither is done while GnoTime itself is running (going by its
+ * pid-file), as it owns the data file and would save over them.
+ *
+ * The --data option reads the given data file instead of the usual
+ * one.  The reports are rendered --jobs at a time (by default, as many
+ * as there are CPUs); see gtt_report_pool.h.
+ *
+ * The gtt_batch_report_wanted() routine returns TRUE if the command
+ * line asks for batch mode.  The gtt_batch_report_main() routine
+ * does the work, and returns the exit status for the program.  It
+ * must be called instead of, not after, the GUI startup.
+ */
+
+gboolean gtt_batch_report_wanted (int argc, char **argv);
+int gtt_batch_report_main (int argc, char **argv);
+
+#endif // GTT_BATCH_REPORT_H
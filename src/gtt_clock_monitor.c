@@ -0,0 +1,180 @@
+/*   Notice suspend/resume and wall-clock changes for GTimeTracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_clock_monitor.h"
+
+#include <glib.h>
+#include <time.h>
+
+/* Clock disagreements smaller than this many seconds are ignored;
+ * they're just the jitter of the timer callbacks. */
+#define CLOCK_SLOP 5
+
+/* The wall clock is only read this often, in seconds; in between, it
+ * is worked out from the boot-time clock.  So a clock that was set is
+ * noticed this late, at the most. */
+#define WALL_CLOCK_SECS 60
+
+typedef struct
+{
+  time_t realtime;
+  gint64 monotonic;
+  gint64 boottime;
+} ClockSample;
+
+static void system_clock_source (time_t *, gint64 *, gint64 *);
+
+static GttClockSource clock_source = system_clock_source;
+static ClockSample last = { 0, 0, 0 };
+static gboolean have_last = FALSE;
+
+/* The wall clock less the boot-time clock, and the boot-time clock,
+ * when the wall clock was last read */
+static gint64 wall_offset = 0;
+static gint64 wall_read_at = 0;
+
+/* Times reported by the sleep notifications, zero if none */
+static time_t sleep_start = 0;
+static time_t sleep_end = 0;
+
+/* ============================================================= */
+
+static void
+system_clock_source (time_t *realtime, gint64 *monotonic, gint64 *boottime)
+{
+  struct timespec ts;
+
+  if (realtime)
+    *realtime = time (0);
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  *monotonic = ts.tv_sec;
+
+#ifdef CLOCK_BOOTTIME
+  clock_gettime (CLOCK_BOOTTIME, &ts);
+  *boottime = ts.tv_sec;
+#else
+  /* Can't see suspends; the sleep notifications are our only hope */
+  *boottime = *monotonic;
+#endif
+}
+
+void
+gtt_clock_monitor_set_source (GttClockSource src)
+{
+  clock_source = src ? src : system_clock_source;
+  have_last = FALSE;
+}
+
+void
+gtt_clock_monitor_reset (void)
+{
+  have_last = FALSE;
+  sleep_start = 0;
+  sleep_end = 0;
+}
+
+void
+gtt_clock_monitor_prepare_for_sleep (gboolean start)
+{
+  ClockSample now;
+
+  (clock_source) (&now.realtime, &now.monotonic, &now.boottime);
+  if (start)
+    {
+      sleep_start = now.realtime;
+      sleep_end = 0;
+    }
+  else if (sleep_start)
+    {
+      sleep_end = now.realtime;
+    }
+}
+
+/* ============================================================= */
+
+gboolean
+gtt_clock_monitor_check (time_t *when, time_t *gap_start, time_t *gap_end)
+{
+  ClockSample now;
+  gint64 awake, asleep, wall;
+  gboolean found = FALSE;
+  gboolean read_wall;
+
+  read_wall = !have_last || WALL_CLOCK_SECS <= last.boottime - wall_read_at;
+  (clock_source) (read_wall ? &now.realtime : NULL, &now.monotonic,
+                  &now.boottime);
+  if (read_wall)
+    {
+      wall_offset = now.realtime - now.boottime;
+      wall_read_at = now.boottime;
+    }
+  else
+    now.realtime = now.boottime + wall_offset;
+  *when = now.realtime;
+
+  if (!have_last)
+    {
+      last = now;
+      have_last = TRUE;
+      return FALSE;
+    }
+
+  /* The monotonic clock stops while the system is suspended,
+   * the boot-time clock doesn't. */
+  awake = now.monotonic - last.monotonic;
+  asleep = (now.boottime - last.boottime) - awake;
+  wall = now.realtime - last.realtime;
+
+  if (sleep_start && sleep_end)
+    {
+      /* We were told exactly when we went to sleep */
+      *gap_start = sleep_start;
+      *gap_end = sleep_end;
+      found = TRUE;
+    }
+  else if (CLOCK_SLOP < asleep)
+    {
+      /* The timers fire right after resume, so the gap ends now */
+      *gap_start = now.realtime - asleep;
+      *gap_end = now.realtime;
+      found = TRUE;
+    }
+  else if (CLOCK_SLOP < ABS (wall - awake - asleep))
+    {
+      /* The wall clock was set; this is only seen when it's read,
+       * as in between it keeps pace with boot time.  Whatever time
+       * truly went by, went by on the old clock; the new clock
+       * starts now. */
+      *gap_start = last.realtime + awake + asleep;
+      *gap_end = now.realtime;
+      found = TRUE;
+    }
+
+  if (sleep_end)
+    {
+      sleep_start = 0;
+      sleep_end = 0;
+    }
+  last = now;
+  return found;
+}
+
+/* =========================== END OF FILE ========================= */
@@ -0,0 +1,67 @@
+/*   Notice suspend/resume and wall-clock changes for GTimeTracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_CLOCK_MONITOR_H
+#define GTT_CLOCK_MONITOR_H
+
+#include <glib.h>
+#include <time.h>
+
+/* The clock monitor notices when wall-clock time went by that the
+ * user could not have spent working: the laptop lid was closed, or
+ * the system clock was set.  It does this by comparing the progress
+ * of the monotonic clock (which stops during suspend) with that of the
+ * boot-time clock (which doesn't) and with that of the wall clock.
+ * Each check costs two clock reads, the monotonic and boot-time
+ * clocks; the wall clock is worked out from the boot-time clock, and
+ * only read once a minute, to notice it being set.
+ *
+ * The gtt_clock_monitor_reset() routine forgets the previous sample.
+ *    Call it whenever a timer starts, so that a suspend that happened
+ *    while no timer was running isn't reported later.
+ *
+ * The gtt_clock_monitor_check() routine takes a new sample, sets
+ *    *now to the wall-clock time, and compares it with the previous
+ *    sample.  If a gap was found, it
+ *    returns TRUE, and sets *gap_start to the wall-clock time at
+ *    which the gap started, and *gap_end to the time at which it
+ *    ended.  If the wall clock was set backwards, *gap_end may be
+ *    earlier than *gap_start.
+ *
+ * The gtt_clock_monitor_prepare_for_sleep() routine is called with
+ *    TRUE just before the system suspends, and with FALSE when it
+ *    resumes (e.g. from the logind PrepareForSleep signal).  If these
+ *    are available, they are used in preference to the clock deltas.
+ *
+ * The gtt_clock_monitor_set_source() routine installs a different
+ *    clock source, for testing.  The source must return the wall
+ *    clock, monotonic and boot-time clocks, in seconds; the wall
+ *    clock only if 'realtime' isn't NULL.  Pass NULL to go back to
+ *    the system clocks.
+ */
+
+typedef void (*GttClockSource) (time_t *realtime, gint64 *monotonic,
+                                gint64 *boottime);
+
+void gtt_clock_monitor_reset (void);
+gboolean gtt_clock_monitor_check (time_t *now, time_t *gap_start,
+                                  time_t *gap_end);
+void gtt_clock_monitor_prepare_for_sleep (gboolean start);
+void gtt_clock_monitor_set_source (GttClockSource src);
+
+#endif // GTT_CLOCK_MONITOR_H
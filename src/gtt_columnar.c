@@ -0,0 +1,531 @@
+/*   Columnar binary export, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_columnar.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <qof.h>
+
+#include "gtt_project.h"
+
+#define COLUMNAR_MAGIC "GTTCOL\0\0"
+#define COLUMNAR_VERSION 1
+#define COLUMNAR_ALIGN 64
+
+typedef enum
+{
+  TYPE_INT32 = 1,
+  TYPE_INT64,
+  TYPE_FLOAT64,
+  TYPE_DICT,
+  TYPE_GUID
+} ColumnType;
+
+typedef struct
+{
+  const char *name;
+  ColumnType type;
+} ColumnDef;
+
+/* The columns, in the order of the defs below */
+enum
+{
+  PRJ_ID,
+  PRJ_PARENT,
+  PRJ_GUID,
+  PRJ_TITLE,
+  PRJ_CUSTID,
+  PRJ_STATUS,
+  PRJ_IMPORTANCE,
+  PRJ_URGENCY,
+  PRJ_BILLRATE,
+  PRJ_NCOLS
+};
+
+enum
+{
+  TSK_ID,
+  TSK_PROJECT,
+  TSK_GUID,
+  TSK_MEMO,
+  TSK_BILLSTATUS,
+  TSK_BILLABLE,
+  TSK_BILLRATE,
+  TSK_BILL_UNIT,
+  TSK_NCOLS
+};
+
+enum
+{
+  IVL_START,
+  IVL_STOP,
+  IVL_FUZZ,
+  IVL_TASK,
+  IVL_PROJECT,
+  IVL_NCOLS
+};
+
+static const ColumnDef project_defs[PRJ_NCOLS]
+    = { { "id", TYPE_INT32 },         { "parent", TYPE_INT32 },
+        { "guid", TYPE_GUID },        { "title", TYPE_DICT },
+        { "custid", TYPE_DICT },      { "status", TYPE_INT32 },
+        { "importance", TYPE_INT32 }, { "urgency", TYPE_INT32 },
+        { "billrate", TYPE_FLOAT64 } };
+
+static const ColumnDef task_defs[TSK_NCOLS]
+    = { { "id", TYPE_INT32 },         { "project", TYPE_INT32 },
+        { "guid", TYPE_GUID },        { "memo", TYPE_DICT },
+        { "billstatus", TYPE_INT32 }, { "billable", TYPE_INT32 },
+        { "billrate", TYPE_INT32 },   { "bill_unit", TYPE_INT32 } };
+
+static const ColumnDef interval_defs[IVL_NCOLS]
+    = { { "start", TYPE_INT64 },
+        { "stop", TYPE_INT64 },
+        { "fuzz", TYPE_INT32 },
+        { "task", TYPE_INT32 },
+        { "project", TYPE_INT32 } };
+
+typedef struct
+{
+  GHashTable *index; /* its own copy of each string -> index + 1 */
+  GArray *offsets;   /* of gint32, little-endian */
+  GString *data;
+} Dict;
+
+typedef struct
+{
+  const ColumnDef *def;
+  GArray *values; /* little-endian */
+  Dict *dict;
+} Column;
+
+typedef struct
+{
+  const char *name;
+  Column *cols;
+  int ncols;
+  guint64 nrows;
+} Table;
+
+/* ============================================================== */
+
+static guint
+type_width (ColumnType type)
+{
+  switch (type)
+    {
+    case TYPE_INT32:
+    case TYPE_DICT:
+      return 4;
+    case TYPE_INT64:
+    case TYPE_FLOAT64:
+      return 8;
+    case TYPE_GUID:
+      return 16;
+    }
+  return 0;
+}
+
+static Dict *
+dict_new (void)
+{
+  Dict *dict = g_new0 (Dict, 1);
+  gint32 zero = 0;
+
+  dict->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  dict->offsets = g_array_new (FALSE, FALSE, sizeof (gint32));
+  g_array_append_val (dict->offsets, zero);
+  dict->data = g_string_new (NULL);
+  return dict;
+}
+
+static void
+dict_free (Dict *dict)
+{
+  g_hash_table_destroy (dict->index);
+  g_array_free (dict->offsets, TRUE);
+  g_string_free (dict->data, TRUE);
+  g_free (dict);
+}
+
+static guint
+dict_count (Dict *dict)
+{
+  return dict->offsets->len - 1;
+}
+
+static gint32
+dict_lookup (Dict *dict, const char *str)
+{
+  gpointer found;
+  gint32 idx, end;
+
+  if (!str)
+    str = "";
+  found = g_hash_table_lookup (dict->index, str);
+  if (found)
+    return GPOINTER_TO_INT (found) - 1;
+
+  idx = dict_count (dict);
+  g_string_append (dict->data, str);
+  end = GINT32_TO_LE ((gint32)dict->data->len);
+  g_array_append_val (dict->offsets, end);
+
+  g_hash_table_insert (dict->index, g_strdup (str),
+                       GINT_TO_POINTER (idx + 1));
+  return idx;
+}
+
+static void
+table_init (Table *tbl, const char *name, const ColumnDef *defs, int ncols)
+{
+  int i;
+
+  tbl->name = name;
+  tbl->ncols = ncols;
+  tbl->nrows = 0;
+  tbl->cols = g_new0 (Column, ncols);
+  for (i = 0; i < ncols; i++)
+    {
+      tbl->cols[i].def = &defs[i];
+      tbl->cols[i].values
+          = g_array_new (FALSE, FALSE, type_width (defs[i].type));
+      if (TYPE_DICT == defs[i].type)
+        tbl->cols[i].dict = dict_new ();
+    }
+}
+
+static void
+table_clear (Table *tbl)
+{
+  int i;
+
+  for (i = 0; i < tbl->ncols; i++)
+    {
+      g_array_free (tbl->cols[i].values, TRUE);
+      if (tbl->cols[i].dict)
+        dict_free (tbl->cols[i].dict);
+    }
+  g_free (tbl->cols);
+}
+
+static void
+put_int32 (Table *tbl, int col, gint32 val)
+{
+  val = GINT32_TO_LE (val);
+  g_array_append_val (tbl->cols[col].values, val);
+}
+
+static void
+put_int64 (Table *tbl, int col, gint64 val)
+{
+  val = GINT64_TO_LE (val);
+  g_array_append_val (tbl->cols[col].values, val);
+}
+
+static void
+put_float64 (Table *tbl, int col, double val)
+{
+  union
+  {
+    double d;
+    guint64 u;
+  } bits;
+
+  bits.d = val;
+  bits.u = GUINT64_TO_LE (bits.u);
+  g_array_append_val (tbl->cols[col].values, bits.u);
+}
+
+static void
+put_str (Table *tbl, int col, const char *str)
+{
+  put_int32 (tbl, col, dict_lookup (tbl->cols[col].dict, str));
+}
+
+static void
+put_guid (Table *tbl, int col, const GUID *guid)
+{
+  static const GUID none;
+
+  g_array_append_vals (tbl->cols[col].values, guid ? guid : &none, 1);
+}
+
+/* ============================================================== */
+/* The one pass over the projects */
+
+typedef struct
+{
+  Table projects;
+  Table tasks;
+  Table intervals;
+  time_t now;
+} Columnar;
+
+static void
+collect_project (Columnar *cx, GttProject *prj, gint32 parent,
+                 gboolean subprojects)
+{
+  Table *tbl = &cx->projects;
+  gint32 id = tbl->nrows++;
+  GList *node, *in;
+
+  put_int32 (tbl, PRJ_ID, id);
+  put_int32 (tbl, PRJ_PARENT, parent);
+  put_guid (tbl, PRJ_GUID, gtt_project_get_guid (prj));
+  put_str (tbl, PRJ_TITLE, gtt_project_get_title (prj));
+  put_str (tbl, PRJ_CUSTID, gtt_project_get_custid (prj));
+  put_int32 (tbl, PRJ_STATUS, gtt_project_get_status (prj));
+  put_int32 (tbl, PRJ_IMPORTANCE, gtt_project_get_importance (prj));
+  put_int32 (tbl, PRJ_URGENCY, gtt_project_get_urgency (prj));
+  put_float64 (tbl, PRJ_BILLRATE, gtt_project_get_billrate (prj));
+
+  for (node = gtt_project_get_tasks (prj); node; node = node->next)
+    {
+      GttTask *tsk = node->data;
+      gint32 tid = cx->tasks.nrows++;
+
+      tbl = &cx->tasks;
+      put_int32 (tbl, TSK_ID, tid);
+      put_int32 (tbl, TSK_PROJECT, id);
+      put_guid (tbl, TSK_GUID, gtt_task_get_guid (tsk));
+      put_str (tbl, TSK_MEMO, gtt_task_get_memo (tsk));
+      put_int32 (tbl, TSK_BILLSTATUS, gtt_task_get_billstatus (tsk));
+      put_int32 (tbl, TSK_BILLABLE, gtt_task_get_billable (tsk));
+      put_int32 (tbl, TSK_BILLRATE, gtt_task_get_billrate (tsk));
+      put_int32 (tbl, TSK_BILL_UNIT, gtt_task_get_bill_unit (tsk));
+
+      tbl = &cx->intervals;
+      for (in = gtt_task_get_intervals (tsk); in; in = in->next)
+        {
+          GttInterval *ivl = in->data;
+          time_t stop = gtt_interval_get_stop (ivl);
+
+          if (gtt_interval_is_running (ivl))
+            stop = MAX (stop, cx->now);
+          tbl->nrows++;
+          put_int64 (tbl, IVL_START, gtt_interval_get_start (ivl));
+          put_int64 (tbl, IVL_STOP, stop);
+          put_int32 (tbl, IVL_FUZZ, gtt_interval_get_fuzz (ivl));
+          put_int32 (tbl, IVL_TASK, tid);
+          put_int32 (tbl, IVL_PROJECT, id);
+        }
+    }
+
+  if (!subprojects)
+    return;
+  for (node = gtt_project_get_children (prj); node; node = node->next)
+    collect_project (cx, node->data, id, TRUE);
+}
+
+/* ============================================================== */
+/* Writing it out */
+
+typedef struct
+{
+  FILE *fh;
+  guint64 pos;
+  gboolean failed;
+} Writer;
+
+static void
+write_bytes (Writer *wr, const void *buf, size_t len)
+{
+  if (0 == len || wr->failed)
+    return;
+  if (len != fwrite (buf, 1, len, wr->fh))
+    wr->failed = TRUE;
+  wr->pos += len;
+}
+
+static void
+write_uint32 (Writer *wr, guint32 val)
+{
+  val = GUINT32_TO_LE (val);
+  write_bytes (wr, &val, 4);
+}
+
+static void
+write_uint64 (Writer *wr, guint64 val)
+{
+  val = GUINT64_TO_LE (val);
+  write_bytes (wr, &val, 8);
+}
+
+static void
+write_name (Writer *wr, const char *name, size_t len)
+{
+  char buf[32];
+
+  memset (buf, 0, sizeof (buf));
+  strncpy (buf, name, len - 1);
+  write_bytes (wr, buf, len);
+}
+
+static guint64
+align_up (guint64 pos)
+{
+  return (pos + COLUMNAR_ALIGN - 1) & ~(guint64)(COLUMNAR_ALIGN - 1);
+}
+
+static void
+write_padding (Writer *wr)
+{
+  static const char zeros[COLUMNAR_ALIGN];
+
+  write_bytes (wr, zeros, align_up (wr->pos) - wr->pos);
+}
+
+/* Where each buffer will go, worked out before anything is written */
+typedef struct
+{
+  guint64 offset;
+  guint64 dict_offset;
+  guint64 dict_data;
+} Placement;
+
+static guint64
+place_table (Table *tbl, Placement *place, guint64 pos)
+{
+  int i;
+
+  for (i = 0; i < tbl->ncols; i++)
+    {
+      Column *col = &tbl->cols[i];
+
+      pos = align_up (pos);
+      place[i].offset = pos;
+      pos += (guint64)col->values->len * type_width (col->def->type);
+      place[i].dict_offset = 0;
+      place[i].dict_data = 0;
+      if (col->dict)
+        {
+          pos = align_up (pos);
+          place[i].dict_offset = pos;
+          pos += col->dict->offsets->len * sizeof (gint32);
+          pos = align_up (pos);
+          place[i].dict_data = pos;
+          pos += col->dict->data->len;
+        }
+    }
+  return pos;
+}
+
+static void
+write_table_buffers (Writer *wr, Table *tbl)
+{
+  int i;
+
+  for (i = 0; i < tbl->ncols; i++)
+    {
+      Column *col = &tbl->cols[i];
+
+      write_padding (wr);
+      write_bytes (wr, col->values->data,
+                   (size_t)col->values->len * type_width (col->def->type));
+      if (col->dict)
+        {
+          write_padding (wr);
+          write_bytes (wr, col->dict->offsets->data,
+                       col->dict->offsets->len * sizeof (gint32));
+          write_padding (wr);
+          write_bytes (wr, col->dict->data->str, col->dict->data->len);
+        }
+    }
+}
+
+gboolean
+gtt_columnar_write (GList *prjs, gboolean include_subprojects, FILE *fh)
+{
+  Columnar cx;
+  Table *tables[3];
+  Placement *place[3];
+  Writer wr;
+  GList *node;
+  guint64 pos;
+  int i, j, first;
+
+  g_return_val_if_fail (fh, FALSE);
+
+  table_init (&cx.projects, "projects", project_defs, PRJ_NCOLS);
+  table_init (&cx.tasks, "tasks", task_defs, TSK_NCOLS);
+  table_init (&cx.intervals, "intervals", interval_defs, IVL_NCOLS);
+  cx.now = time (NULL);
+  for (node = prjs; node; node = node->next)
+    collect_project (&cx, node->data, -1, include_subprojects);
+
+  tables[0] = &cx.projects;
+  tables[1] = &cx.tasks;
+  tables[2] = &cx.intervals;
+
+  pos = 16 + 3 * 32 + 64 * (PRJ_NCOLS + TSK_NCOLS + IVL_NCOLS);
+  for (i = 0; i < 3; i++)
+    {
+      place[i] = g_new0 (Placement, tables[i]->ncols);
+      pos = place_table (tables[i], place[i], pos);
+    }
+
+  wr.fh = fh;
+  wr.pos = 0;
+  wr.failed = FALSE;
+
+  write_bytes (&wr, COLUMNAR_MAGIC, 8);
+  write_uint32 (&wr, COLUMNAR_VERSION);
+  write_uint32 (&wr, 3);
+
+  first = 0;
+  for (i = 0; i < 3; i++)
+    {
+      write_name (&wr, tables[i]->name, 16);
+      write_uint64 (&wr, tables[i]->nrows);
+      write_uint32 (&wr, tables[i]->ncols);
+      write_uint32 (&wr, first);
+      first += tables[i]->ncols;
+    }
+
+  for (i = 0; i < 3; i++)
+    {
+      for (j = 0; j < tables[i]->ncols; j++)
+        {
+          Column *col = &tables[i]->cols[j];
+
+          write_name (&wr, col->def->name, 24);
+          write_uint32 (&wr, col->def->type);
+          write_uint32 (&wr, type_width (col->def->type));
+          write_uint64 (&wr, place[i][j].offset);
+          write_uint64 (&wr, col->dict ? dict_count (col->dict) : 0);
+          write_uint64 (&wr, place[i][j].dict_offset);
+          write_uint64 (&wr, place[i][j].dict_data);
+        }
+    }
+
+  for (i = 0; i < 3; i++)
+    {
+      write_table_buffers (&wr, tables[i]);
+      table_clear (tables[i]);
+      g_free (place[i]);
+    }
+
+  return !wr.failed;
+}
+
+/* ======================= END OF FILE =================== */
@@ -0,0 +1,117 @@
+/*   Columnar binary export, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_COLUMNAR_H
+#define GTT_COLUMNAR_H
+
+#include <glib.h>
+#include <stdio.h>
+
+/* The columnar export writes the projects, tasks and intervals out
+ * as three tables, stored column by column in one binary file, so
+ * that analysis tools can memory-map it and scan a column without
+ * parsing anything.  It is written in one pass over the projects.
+ *
+ * All numbers are little-endian.  All offsets are from the start of
+ * the file, and every column starts on a 64-byte boundary.  The file
+ * starts with a 16-byte header,
+ *
+ *   char     magic[8]     "GTTCOL\0\0"
+ *   uint32   version      1
+ *   uint32   ntables      3
+ *
+ * followed by a 32-byte entry for each table, in the order projects,
+ * tasks, intervals:
+ *
+ *   char     name[16]     NUL-padded
+ *   uint64   nrows
+ *   uint32   ncols
+ *   uint32   first        index of its first column entry
+ *
+ * and then a 64-byte entry for each column, all of the tables' in
+ * turn:
+ *
+ *   char     name[24]     NUL-padded
+ *   uint32   type         see below
+ *   uint32   width        bytes per row: 4, 8 or 16
+ *   uint64   offset       of the values; nrows * width bytes
+ *   uint64   dict_count   number of dictionary entries, for DICT
+ *   uint64   dict_offset  of the dictionary offsets, for DICT
+ *   uint64   dict_data    of the dictionary bytes, for DICT
+ *
+ * The types are
+ *
+ *   1  INT32     signed 32-bit integers
+ *   2  INT64     signed 64-bit integers
+ *   3  FLOAT64   IEEE doubles
+ *   4  DICT      int32 indexes into the column's dictionary, of UTF-8
+ *                strings: dict_count + 1 int32 offsets into the bytes
+ *                at dict_data, string i running from offset i to
+ *                offset i + 1.  Missing strings are empty ones.
+ *   5  GUID      the 16 bytes of a GUID, as in the data file
+ *
+ * These are laid out as Apache Arrow lays out the same columns (an
+ * int32 dictionary-encoded utf8 column, and fixed-size binary for the
+ * GUIDs), so each can be wrapped as an Arrow array without copying.
+ *
+ * The projects table has the columns
+ *
+ *   id          INT32    the row number
+ *   parent      INT32    the parent's row number, or -1
+ *   guid        GUID
+ *   title       DICT
+ *   custid      DICT
+ *   status      INT32    as GttProjectStatus
+ *   importance  INT32    as GttRank
+ *   urgency     INT32    as GttRank
+ *   billrate    FLOAT64  the regular rate, per hour
+ *
+ * the tasks table
+ *
+ *   id          INT32    the row number
+ *   project     INT32    the project's row number
+ *   guid        GUID
+ *   memo        DICT
+ *   billstatus  INT32    as GttBillStatus
+ *   billable    INT32    as GttBillable
+ *   billrate    INT32    as GttBillRate
+ *   bill_unit   INT32    in seconds
+ *
+ * and the intervals table
+ *
+ *   start       INT64    seconds since the epoch, UTC
+ *   stop        INT64    the same; for a running timer, the time it
+ *                        was exported
+ *   fuzz        INT32    in seconds
+ *   task        INT32    the task's row number
+ *   project     INT32    the project's row number
+ *
+ * Projects come before their subprojects, and each task and interval
+ * in the order the project keeps them.  New columns may be added at
+ * the end of a table without changing the version; readers should
+ * find columns by name.
+ *
+ * The gtt_columnar_write() routine writes the projects on the list
+ *    'prjs', and their subprojects, if 'include_subprojects' is TRUE.
+ *    It returns FALSE if the writing failed.
+ */
+
+gboolean gtt_columnar_write (GList *prjs, gboolean include_subprojects,
+                             FILE *fh);
+
+#endif // GTT_COLUMNAR_H
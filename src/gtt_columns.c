@@ -0,0 +1,572 @@
+/*   Delimited text export, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_columns.h"
+
+#include <errno.h>
+#include <glib/gi18n.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gtt_date_cache.h"
+#include "gtt_invoice.h"
+
+typedef enum
+{
+  COL_TITLE,
+  COL_DESC,
+  COL_CUSTID,
+  COL_STATUS,
+  COL_IMPORTANCE,
+  COL_URGENCY,
+
+  COL_MEMO,
+  COL_NOTES,
+  COL_TASK_TIME,
+  COL_BILLSTATUS,
+  COL_BILLABLE,
+  COL_BILLRATE,
+  COL_VALUE,
+  COL_BILL_VALUE,
+
+  COL_START,
+  COL_STOP,
+  COL_ELAPSED,
+  COL_FUZZ
+} ColumnKind;
+
+typedef struct
+{
+  const char *word;
+  ColumnKind kind;
+  GttColumnsRow row;
+  const char *title; /* untranslated */
+} ColumnDef;
+
+static const ColumnDef column_defs[] = {
+  { "$title", COL_TITLE, GTT_ROW_PROJECT, N_ ("Title") },
+  { "$desc", COL_DESC, GTT_ROW_PROJECT, N_ ("Description") },
+  { "$custid", COL_CUSTID, GTT_ROW_PROJECT, N_ ("Customer ID") },
+  { "$status", COL_STATUS, GTT_ROW_PROJECT, N_ ("Status") },
+  { "$importance", COL_IMPORTANCE, GTT_ROW_PROJECT, N_ ("Importance") },
+  { "$urgency", COL_URGENCY, GTT_ROW_PROJECT, N_ ("Urgency") },
+  { "$memo", COL_MEMO, GTT_ROW_TASK, N_ ("Diary Entry") },
+  { "$notes", COL_NOTES, GTT_ROW_TASK, N_ ("Notes") },
+  { "$task_time", COL_TASK_TIME, GTT_ROW_TASK, N_ ("Task Time") },
+  { "$billstatus", COL_BILLSTATUS, GTT_ROW_TASK, N_ ("Bill Status") },
+  { "$billable", COL_BILLABLE, GTT_ROW_TASK, N_ ("Billable") },
+  { "$billrate", COL_BILLRATE, GTT_ROW_TASK, N_ ("Bill Rate") },
+  { "$value", COL_VALUE, GTT_ROW_TASK, N_ ("Value") },
+  { "$bill_value", COL_BILL_VALUE, GTT_ROW_TASK, N_ ("Billable Value") },
+  { "$start_datime", COL_START, GTT_ROW_INTERVAL, N_ ("Start") },
+  { "$stop_datime", COL_STOP, GTT_ROW_INTERVAL, N_ ("Stop") },
+  { "$elapsed", COL_ELAPSED, GTT_ROW_INTERVAL, N_ ("Elapsed") },
+  { "$fuzz", COL_FUZZ, GTT_ROW_INTERVAL, N_ ("Start Time Fuzziness") },
+};
+
+typedef struct
+{
+  ColumnKind kind;
+  char *title; /* NULL for the usual one */
+} Column;
+
+struct gtt_columns_s
+{
+  GArray *cols; /* of Column */
+  GttColumnsRow row;
+  gboolean need_line; /* some column needs the invoice line */
+};
+
+/* The same names as the query language and the invoice use */
+static const char *status_names[]
+    = { "NO_STATUS", "NOT_STARTED", "IN_PROGRESS",
+        "ON_HOLD",   "CANCELLED",   "COMPLETED" };
+static const char *rank_names[] = { "UNDEFINED", "LOW", "MEDIUM", "HIGH" };
+static const char *billstatus_names[] = { "HOLD", "BILL", "PAID" };
+static const char *billable_names[]
+    = { "", "BILLABLE", "NOT_BILLABLE", "NO_CHARGE" };
+static const char *billrate_names[]
+    = { "REGULAR", "OVERTIME", "OVEROVER", "FLAT_FEE" };
+
+#define NAME(names, i)                                                        \
+  (((guint)(i) < G_N_ELEMENTS (names)) ? names[i] : "")
+
+/* ============================================================== */
+
+GttColumns *
+gtt_columns_compile (char **words, char **errmsg)
+{
+  GttColumns *cols;
+  Column *last = NULL;
+  int i;
+
+  g_return_val_if_fail (words, NULL);
+
+  cols = g_new0 (GttColumns, 1);
+  cols->cols = g_array_new (FALSE, TRUE, sizeof (Column));
+  cols->row = GTT_ROW_PROJECT;
+
+  for (i = 0; words[i]; i++)
+    {
+      const ColumnDef *def = NULL;
+      Column col;
+      guint j;
+
+      if ('$' != words[i][0])
+        {
+          /* A title for the column before */
+          if (last)
+            {
+              g_free (last->title);
+              last->title = g_strdup (words[i]);
+            }
+          continue;
+        }
+
+      for (j = 0; j < G_N_ELEMENTS (column_defs); j++)
+        {
+          if (!strcmp (words[i], column_defs[j].word))
+            {
+              def = &column_defs[j];
+              break;
+            }
+        }
+      if (!def)
+        {
+          if (errmsg)
+            *errmsg = g_strdup_printf (_ ("Unknown column: %s"), words[i]);
+          gtt_columns_free (cols);
+          return NULL;
+        }
+
+      col.kind = def->kind;
+      col.title = NULL;
+      g_array_append_val (cols->cols, col);
+      last = &g_array_index (cols->cols, Column, cols->cols->len - 1);
+
+      cols->row = MAX (cols->row, def->row);
+      if (COL_VALUE == def->kind || COL_BILL_VALUE == def->kind)
+        cols->need_line = TRUE;
+    }
+  return cols;
+}
+
+GttColumns *
+gtt_columns_parse (const char *spec, char **errmsg)
+{
+  GttColumns *cols;
+  GError *error = NULL;
+  char **words;
+  int nwords;
+
+  g_return_val_if_fail (spec, NULL);
+
+  /* g_shell_parse_argv() won't take an empty string */
+  if (!spec[strspn (spec, " \t\n")])
+    {
+      char *none[] = { NULL };
+      return gtt_columns_compile (none, errmsg);
+    }
+  if (!g_shell_parse_argv (spec, &nwords, &words, &error))
+    {
+      if (errmsg)
+        *errmsg = g_strdup (error->message);
+      g_error_free (error);
+      return NULL;
+    }
+  cols = gtt_columns_compile (words, errmsg);
+  g_strfreev (words);
+  return cols;
+}
+
+void
+gtt_columns_free (GttColumns *cols)
+{
+  guint i;
+
+  if (!cols)
+    return;
+  for (i = 0; i < cols->cols->len; i++)
+    g_free (g_array_index (cols->cols, Column, i).title);
+  g_array_free (cols->cols, TRUE);
+  g_free (cols);
+}
+
+GttColumnsRow
+gtt_columns_get_row (GttColumns *cols)
+{
+  g_return_val_if_fail (cols, GTT_ROW_PROJECT);
+  return cols->row;
+}
+
+GttExportFormat
+gtt_columns_format_for_file (const char *filename)
+{
+  const char *dot;
+
+  if (!filename)
+    return GTT_EXPORT_TSV;
+  dot = strrchr (filename, '.');
+  if (dot && !g_ascii_strcasecmp (dot, ".csv"))
+    return GTT_EXPORT_CSV;
+  return GTT_EXPORT_TSV;
+}
+
+/* ============================================================== */
+/* The output buffer */
+
+#define OUT_BUFSIZE 65536
+
+typedef struct
+{
+  int fd;
+  gboolean failed;
+  GttExportFormat format;
+  size_t len;
+  char buff[OUT_BUFSIZE];
+} Output;
+
+static void
+out_flush (Output *out)
+{
+  size_t off = 0;
+
+  while (off < out->len && !out->failed)
+    {
+      ssize_t n = write (out->fd, out->buff + off, out->len - off);
+      if (0 > n)
+        {
+          if (EINTR != errno)
+            out->failed = TRUE;
+          continue;
+        }
+      off += n;
+    }
+  out->len = 0;
+}
+
+static inline void
+out_char (Output *out, char c)
+{
+  if (OUT_BUFSIZE == out->len)
+    out_flush (out);
+  out->buff[out->len++] = c;
+}
+
+static void
+out_chars (Output *out, const char *str, size_t len)
+{
+  while (len)
+    {
+      size_t n;
+
+      if (OUT_BUFSIZE == out->len)
+        out_flush (out);
+      n = MIN (len, OUT_BUFSIZE - out->len);
+      memcpy (out->buff + out->len, str, n);
+      out->len += n;
+      str += n;
+      len -= n;
+    }
+}
+
+/* Start each field but the first with the separator */
+static void
+out_sep (Output *out, gboolean first)
+{
+  if (!first)
+    out_char (out, (GTT_EXPORT_CSV == out->format) ? ',' : '\t');
+}
+
+static void
+out_end_row (Output *out)
+{
+  if (GTT_EXPORT_CSV == out->format)
+    out_char (out, '\r');
+  out_char (out, '\n');
+}
+
+/* Text that came from the user, and might hold anything */
+static void
+out_text (Output *out, const char *text)
+{
+  const char *p;
+
+  if (!text)
+    return;
+
+  if (GTT_EXPORT_TSV == out->format)
+    {
+      for (p = text; *p; p++)
+        {
+          if ('\t' == *p || '\n' == *p || '\r' == *p)
+            out_char (out, ' ');
+          else
+            out_char (out, *p);
+        }
+      return;
+    }
+
+  if (!text[strcspn (text, ",\"\r\n")])
+    {
+      out_chars (out, text, strlen (text));
+      return;
+    }
+  out_char (out, '"');
+  for (p = text; *p; p++)
+    {
+      if ('"' == *p)
+        out_char (out, '"');
+      out_char (out, *p);
+    }
+  out_char (out, '"');
+}
+
+/* Text we made, that needs no quoting */
+static void
+out_plain (Output *out, const char *str)
+{
+  out_chars (out, str, strlen (str));
+}
+
+static void
+out_secs (Output *out, long secs)
+{
+  char buff[40];
+  int len;
+
+  if (0 > secs)
+    {
+      out_char (out, '-');
+      secs = -secs;
+    }
+  len = g_snprintf (buff, sizeof (buff), "%ld:%02ld:%02ld", secs / 3600,
+                    (secs / 60) % 60, secs % 60);
+  out_chars (out, buff, len);
+}
+
+static void
+out_money (Output *out, double value)
+{
+  char buff[G_ASCII_DTOSTR_BUF_SIZE];
+
+  out_plain (out, g_ascii_formatd (buff, sizeof (buff), "%.2f", value));
+}
+
+static void
+out_time (Output *out, GttDateCache *dates, time_t t)
+{
+  struct tm tm;
+  char buff[40];
+  int len;
+
+  gtt_date_cache_localtime (dates, t, &tm);
+  len = g_snprintf (buff, sizeof (buff), "%04d-%02d-%02d %02d:%02d:%02d",
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                    tm.tm_min, tm.tm_sec);
+  out_chars (out, buff, len);
+}
+
+/* ============================================================== */
+
+typedef struct
+{
+  GttColumns *cols;
+  Output *out;
+  GttDateCache *dates;
+} Export;
+
+static void
+write_header (Export *xp)
+{
+  guint i;
+
+  for (i = 0; i < xp->cols->cols->len; i++)
+    {
+      Column *col = &g_array_index (xp->cols->cols, Column, i);
+      guint j;
+
+      out_sep (xp->out, 0 == i);
+      if (col->title)
+        {
+          out_text (xp->out, col->title);
+          continue;
+        }
+      for (j = 0; j < G_N_ELEMENTS (column_defs); j++)
+        {
+          if (column_defs[j].kind == col->kind)
+            {
+              out_text (xp->out, _ (column_defs[j].title));
+              break;
+            }
+        }
+    }
+  out_end_row (xp->out);
+}
+
+static void
+write_row (Export *xp, GttProject *prj, GttTask *tsk,
+           const GttInvoiceLine *line, GttInterval *ivl)
+{
+  Output *out = xp->out;
+  guint i;
+
+  for (i = 0; i < xp->cols->cols->len; i++)
+    {
+      Column *col = &g_array_index (xp->cols->cols, Column, i);
+
+      out_sep (out, 0 == i);
+      switch (col->kind)
+        {
+        case COL_TITLE:
+          out_text (out, gtt_project_get_title (prj));
+          break;
+        case COL_DESC:
+          out_text (out, gtt_project_get_desc (prj));
+          break;
+        case COL_CUSTID:
+          out_text (out, gtt_project_get_custid (prj));
+          break;
+        case COL_STATUS:
+          out_plain (out, NAME (status_names, gtt_project_get_status (prj)));
+          break;
+        case COL_IMPORTANCE:
+          out_plain (out,
+                     NAME (rank_names, gtt_project_get_importance (prj)));
+          break;
+        case COL_URGENCY:
+          out_plain (out, NAME (rank_names, gtt_project_get_urgency (prj)));
+          break;
+
+        case COL_MEMO:
+          out_text (out, gtt_task_get_memo (tsk));
+          break;
+        case COL_NOTES:
+          out_text (out, gtt_task_get_notes (tsk));
+          break;
+        case COL_TASK_TIME:
+          out_secs (out, gtt_task_get_secs_ever (tsk));
+          break;
+        case COL_BILLSTATUS:
+          out_plain (out,
+                     NAME (billstatus_names, gtt_task_get_billstatus (tsk)));
+          break;
+        case COL_BILLABLE:
+          out_plain (out,
+                     NAME (billable_names, gtt_task_get_billable (tsk)));
+          break;
+        case COL_BILLRATE:
+          out_plain (out,
+                     NAME (billrate_names, gtt_task_get_billrate (tsk)));
+          break;
+        case COL_VALUE:
+          out_money (out, line->value);
+          break;
+        case COL_BILL_VALUE:
+          out_money (out, (GTT_BILLABLE == line->billable)
+                              ? line->billed_value
+                              : 0.0);
+          break;
+
+        case COL_START:
+          out_time (out, xp->dates, gtt_interval_get_start (ivl));
+          break;
+        case COL_STOP:
+          out_time (out, xp->dates, gtt_interval_get_stop (ivl));
+          break;
+        case COL_ELAPSED:
+          out_secs (out, gtt_interval_get_stop (ivl)
+                             - gtt_interval_get_start (ivl));
+          break;
+        case COL_FUZZ:
+          out_secs (out, gtt_interval_get_fuzz (ivl));
+          break;
+        }
+    }
+  out_end_row (out);
+}
+
+static void
+export_project (Export *xp, GttProject *prj, gboolean subprojects)
+{
+  GList *node, *in;
+
+  if (GTT_ROW_PROJECT == xp->cols->row)
+    write_row (xp, prj, NULL, NULL, NULL);
+  else
+    {
+      for (node = gtt_project_get_tasks (prj); node; node = node->next)
+        {
+          GttTask *tsk = node->data;
+          GttInvoiceLine line;
+
+          if (xp->cols->need_line)
+            gtt_invoice_task_line (tsk, &line);
+
+          if (GTT_ROW_TASK == xp->cols->row)
+            {
+              write_row (xp, prj, tsk, &line, NULL);
+              continue;
+            }
+          for (in = gtt_task_get_intervals (tsk); in; in = in->next)
+            write_row (xp, prj, tsk, &line, in->data);
+        }
+    }
+
+  if (!subprojects || xp->out->failed)
+    return;
+  for (node = gtt_project_get_children (prj); node; node = node->next)
+    export_project (xp, node->data, TRUE);
+}
+
+gboolean
+gtt_columns_export (GttColumns *cols, GList *prjs,
+                    gboolean include_subprojects, GttExportFormat format,
+                    int fd)
+{
+  Export xp;
+  Output *out;
+  GList *node;
+  gboolean ok;
+
+  g_return_val_if_fail (cols && 0 <= fd, FALSE);
+
+  out = g_new (Output, 1);
+  out->fd = fd;
+  out->failed = FALSE;
+  out->format = format;
+  out->len = 0;
+
+  xp.cols = cols;
+  xp.out = out;
+  xp.dates = gtt_date_cache_new ();
+
+  write_header (&xp);
+  for (node = prjs; node && !out->failed; node = node->next)
+    export_project (&xp, node->data, include_subprojects);
+  out_flush (out);
+
+  ok = !out->failed;
+  gtt_date_cache_destroy (xp.dates);
+  g_free (out);
+  return ok;
+}
+
+/* ======================= END OF FILE =================== */
@@ -0,0 +1,107 @@
+/*   Delimited text export, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_COLUMNS_H
+#define GTT_COLUMNS_H
+
+#include <glib.h>
+
+#include "gtt_project.h"
+
+/* The column exporter writes projects, tasks or intervals out as rows
+ * of comma- or tab-separated text, straight from the data, without
+ * going through a report template.  What goes in the rows is given
+ * by a column spec, in the same words as the old gtt-show-export:
+ *
+ *   $title $desc $custid       the project's, as text
+ *   $status                    NO_STATUS, NOT_STARTED, IN_PROGRESS,
+ *                              ON_HOLD, CANCELLED or COMPLETED
+ *   $importance $urgency       UNDEFINED, LOW, MEDIUM or HIGH
+ *   $memo $notes               the task's, as text
+ *   $task_time                 the time worked on the task
+ *   $billstatus                HOLD, BILL or PAID
+ *   $billable                  BILLABLE, NOT_BILLABLE or NO_CHARGE
+ *   $billrate                  REGULAR, OVERTIME, OVEROVER or FLAT_FEE
+ *   $value                     what the task's time is worth
+ *   $bill_value                what is owed for it: its time, rounded
+ *                              to the bill unit, if it is billable,
+ *                              and zero otherwise (see gtt_invoice.h)
+ *   $start_datime $stop_datime when the interval started and stopped
+ *   $elapsed $fuzz             the interval's length, and fuzz
+ *
+ * Any other word is the title of the column before it, in the header
+ * row, in place of the usual one.  The spec decides what a row is:
+ * one per interval if there are any interval columns, one per task
+ * if there are task columns, and one per project otherwise.  The
+ * project and task columns are repeated on each of their rows.
+ *
+ * The names of the enums are the ones the data file and the query
+ * language use, and not translated.  Times of day are written as
+ * 'YYYY-MM-DD HH:MM:SS', in local time; lengths of time as H:MM:SS;
+ * amounts of money as plain numbers, with two decimals.  In CSV,
+ * fields are quoted as RFC 4180 says, and rows end in CR LF; in TSV,
+ * any tabs or newlines in the text are turned into spaces.
+ *
+ * The gtt_columns_compile() routine compiles the column spec 'words'
+ *    (NULL-terminated).  It returns the compiled spec, or NULL and an
+ *    error message (to be g_free()'d) if a $word is unknown.
+ *
+ * The gtt_columns_parse() routine does the same for a spec in one
+ *    string, with the words separated by spaces; titles with spaces
+ *    in them may be quoted, as in the shell.
+ *
+ * The gtt_columns_get_row() routine says what the rows are.
+ *
+ * The gtt_columns_export() routine writes the header row, and then a
+ *    row for each of the projects 'prjs' (and their subprojects, if
+ *    'include_subprojects' is TRUE), or for each of their tasks or
+ *    intervals, to the file descriptor 'fd', through a buffer of its
+ *    own.  It returns FALSE if the writing failed; 'errno' then says
+ *    why.  The descriptor is left open.
+ *
+ * The gtt_columns_format_for_file() routine picks CSV for file names
+ *    ending in .csv, and TSV for any other.
+ */
+
+typedef enum
+{
+  GTT_EXPORT_TSV = 0,
+  GTT_EXPORT_CSV
+} GttExportFormat;
+
+typedef enum
+{
+  GTT_ROW_PROJECT = 0,
+  GTT_ROW_TASK,
+  GTT_ROW_INTERVAL
+} GttColumnsRow;
+
+typedef struct gtt_columns_s GttColumns;
+
+GttColumns *gtt_columns_compile (char **words, char **errmsg);
+GttColumns *gtt_columns_parse (const char *spec, char **errmsg);
+void gtt_columns_free (GttColumns *);
+
+GttColumnsRow gtt_columns_get_row (GttColumns *);
+gboolean gtt_columns_export (GttColumns *, GList *prjs,
+                             gboolean include_subprojects,
+                             GttExportFormat format, int fd);
+
+GttExportFormat gtt_columns_format_for_file (const char *filename);
+
+#endif // GTT_COLUMNS_H
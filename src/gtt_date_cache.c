@@ -0,0 +1,298 @@
+/*   Cached date and time formatting for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_date_cache.h"
+
+#include <glib.h>
+#include <qof.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gtt_preferences.h"
+#include "gtt_util.h"
+
+typedef struct
+{
+  time_t start, end;  /* from midnight to the next midnight */
+  struct tm midnight; /* the local time at start */
+  gboolean uniform;   /* no change of UTC offset during the day */
+  char date[64];      /* the date string, or empty if not made yet */
+} DayEntry;
+
+typedef struct
+{
+  gint64 minute; /* minutes since the epoch; the hash key */
+  struct tm tm;  /* the local time at the start of the minute */
+} MinuteEntry;
+
+struct gtt_date_cache_s
+{
+  GPtrArray *days;     /* holds DayEntry, sorted by start */
+  DayEntry *last;      /* the day found last time */
+  GHashTable *minutes; /* the minutes looked up on non-uniform days */
+  QofDateFormat format; /* the format that the date strings are in */
+};
+
+/* ============================================================== */
+
+GttDateCache *
+gtt_date_cache_new (void)
+{
+  GttDateCache *cache = g_new0 (GttDateCache, 1);
+
+  cache->days = g_ptr_array_new_with_free_func (g_free);
+  cache->minutes
+      = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, g_free);
+  cache->format = qof_date_format_get_current ();
+  return cache;
+}
+
+void
+gtt_date_cache_destroy (GttDateCache *cache)
+{
+  if (!cache)
+    return;
+  g_ptr_array_free (cache->days, TRUE);
+  g_hash_table_destroy (cache->minutes);
+  g_free (cache);
+}
+
+void
+gtt_date_cache_clear (GttDateCache *cache)
+{
+  g_return_if_fail (cache);
+
+  g_ptr_array_set_size (cache->days, 0);
+  g_hash_table_remove_all (cache->minutes);
+  cache->last = NULL;
+  cache->format = qof_date_format_get_current ();
+}
+
+/* ============================================================== */
+
+static DayEntry *
+day_new (time_t t)
+{
+  DayEntry *day = g_new0 (DayEntry, 1);
+  struct tm tm;
+
+  localtime_r (&t, &tm);
+  tm.tm_sec = 0;
+  tm.tm_min = 0;
+  tm.tm_hour = 0;
+  tm.tm_isdst = -1;
+  day->start = mktime (&tm);
+  day->midnight = tm;
+
+  tm.tm_mday++;
+  tm.tm_isdst = -1;
+  day->end = mktime (&tm);
+
+  /* Where the clocks change at midnight, the day starts at whatever
+   * midnight became; it's not worth being clever about. */
+  if (day->start > t)
+    day->start = t;
+  if (day->end <= t)
+    day->end = t + 1;
+
+  day->uniform = ((day->end - day->start) == 24 * 3600)
+                 && (0 == day->midnight.tm_hour);
+  return day;
+}
+
+static DayEntry *
+find_day (GttDateCache *cache, time_t t)
+{
+  DayEntry *day;
+  guint lo, hi;
+
+  day = cache->last;
+  if (day && (day->start <= t) && (t < day->end))
+    return day;
+
+  /* Find the first day that starts after t */
+  lo = 0;
+  hi = cache->days->len;
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+      day = g_ptr_array_index (cache->days, mid);
+      if (day->start <= t)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  if (0 < lo)
+    {
+      day = g_ptr_array_index (cache->days, lo - 1);
+      if (t < day->end)
+        {
+          cache->last = day;
+          return day;
+        }
+    }
+
+  day = day_new (t);
+  g_ptr_array_add (cache->days, NULL);
+  memmove (&cache->days->pdata[lo + 1], &cache->days->pdata[lo],
+           (cache->days->len - 1 - lo) * sizeof (gpointer));
+  cache->days->pdata[lo] = day;
+  cache->last = day;
+  return day;
+}
+
+void
+gtt_date_cache_localtime (GttDateCache *cache, time_t t, struct tm *tm)
+{
+  DayEntry *day;
+  MinuteEntry *ment;
+  gint64 minute;
+  time_t secs;
+
+  g_return_if_fail (cache && tm);
+
+  day = find_day (cache, t);
+  if (day->uniform)
+    {
+      secs = t - day->start;
+      *tm = day->midnight;
+      tm->tm_hour = secs / 3600;
+      tm->tm_min = (secs % 3600) / 60;
+      tm->tm_sec = secs % 60;
+      return;
+    }
+
+  /* The UTC offset changes today, but only ever on the minute */
+  minute = t / 60;
+  if (t < minute * 60)
+    minute--;
+  ment = g_hash_table_lookup (cache->minutes, &minute);
+  if (!ment)
+    {
+      time_t mt = minute * 60;
+      ment = g_new (MinuteEntry, 1);
+      ment->minute = minute;
+      localtime_r (&mt, &ment->tm);
+      g_hash_table_insert (cache->minutes, &ment->minute, ment);
+    }
+  *tm = ment->tm;
+  tm->tm_sec = t - minute * 60;
+}
+
+/* ============================================================== */
+
+static void
+check_format (GttDateCache *cache)
+{
+  QofDateFormat format = qof_date_format_get_current ();
+  guint i;
+
+  if (format == cache->format)
+    return;
+  cache->format = format;
+  for (i = 0; i < cache->days->len; i++)
+    {
+      DayEntry *day = g_ptr_array_index (cache->days, i);
+      day->date[0] = 0;
+    }
+}
+
+const char *
+gtt_date_cache_date_str (GttDateCache *cache, time_t t)
+{
+  DayEntry *day;
+
+  g_return_val_if_fail (cache, "");
+
+  check_format (cache);
+  day = find_day (cache, t);
+  if (0 == day->date[0])
+    {
+      xxxqof_print_date_dmy_buff (day->date, sizeof (day->date),
+                                  day->midnight.tm_mday,
+                                  day->midnight.tm_mon + 1,
+                                  day->midnight.tm_year + 1900);
+    }
+  return day->date;
+}
+
+size_t
+gtt_date_cache_time_buff (GttDateCache *cache, char *buff, size_t len,
+                          time_t t)
+{
+  struct tm tm;
+
+  g_return_val_if_fail (cache && buff, 0);
+
+  gtt_date_cache_localtime (cache, t, &tm);
+  switch (config_time_format)
+    {
+    case TIME_FORMAT_AM_PM:
+      return strftime (buff, len, "%r", &tm);
+    case TIME_FORMAT_24_HS:
+      /* Same as "%T" */
+      return g_snprintf (buff, len, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min,
+                         tm.tm_sec);
+    case TIME_FORMAT_LOCALE:
+    default:
+      return xxxqof_print_time_tm_buff (buff, len, t, &tm);
+    }
+}
+
+size_t
+gtt_date_cache_date_time_buff (GttDateCache *cache, char *buff, size_t len,
+                               time_t t)
+{
+  struct tm tm;
+
+  g_return_val_if_fail (cache && buff, 0);
+
+  gtt_date_cache_localtime (cache, t, &tm);
+  return xxxqof_print_date_time_tm_buff (buff, len, t, &tm);
+}
+
+size_t
+gtt_date_cache_clock_buff (GttDateCache *cache, char *buff, size_t len,
+                           time_t t)
+{
+  struct tm tm;
+
+  g_return_val_if_fail (cache && buff, 0);
+
+  gtt_date_cache_localtime (cache, t, &tm);
+  return xxxqof_print_time_tm_buff (buff, len, t, &tm);
+}
+
+gboolean
+gtt_date_cache_same_day (GttDateCache *cache, time_t a, time_t b)
+{
+  DayEntry *da, *db;
+
+  g_return_val_if_fail (cache, FALSE);
+
+  da = find_day (cache, a);
+  db = find_day (cache, b);
+  return (da->midnight.tm_year == db->midnight.tm_year)
+         && (da->midnight.tm_yday == db->midnight.tm_yday);
+}
+
+/* ======================= END OF FILE =================== */
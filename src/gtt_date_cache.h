@@ -0,0 +1,77 @@
+/*   Cached date and time formatting for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_DATE_CACHE_H
+#define GTT_DATE_CACHE_H
+
+#include <glib.h>
+#include <time.h>
+
+/* A date cache remembers what it has worked out about the days and
+ * minutes it has been asked about, so that printing thousands of
+ * interval start and stop times, most of them on a handful of days,
+ * doesn't cost a localtime() and a strftime() for every one.  Days
+ * are found by their real start and end, as mktime() sees them, so
+ * the days on which daylight saving time starts or ends are 23 or 25
+ * hours long, as they should be.  On ordinary days, the time of day
+ * is plain arithmetic from midnight; on the others, the broken-down
+ * time is kept per minute.  The strings are the same as the
+ * xxxqof_print_*() routines in gtt_util.h would give.
+ *
+ * A cache is meant to last for one report, or one redraw: if the
+ * time zone changes while it's alive, it won't notice.  A change of
+ * date format is noticed.  It isn't thread-safe; each report has its
+ * own.
+ *
+ * The gtt_date_cache_clear() routine forgets everything.
+ *
+ * The gtt_date_cache_localtime() routine does what localtime_r()
+ *    does.
+ *
+ * The gtt_date_cache_date_str() routine returns the date of 't',
+ *    as xxxqof_print_date_buff() prints it.  The string belongs to
+ *    the cache, and lasts until it is cleared.
+ *
+ * The gtt_date_cache_time_buff() routine prints the time of day of
+ *    't' in the format picked in the preferences (config_time_format).
+ *
+ * The gtt_date_cache_date_time_buff() and gtt_date_cache_clock_buff()
+ *    routines print the same as xxxqof_print_date_time_buff() and
+ *    xxxqof_print_time_buff().
+ *
+ * The gtt_date_cache_same_day() routine returns TRUE if the two times
+ *    fall on the same calendar day.
+ */
+
+typedef struct gtt_date_cache_s GttDateCache;
+
+GttDateCache *gtt_date_cache_new (void);
+void gtt_date_cache_destroy (GttDateCache *);
+void gtt_date_cache_clear (GttDateCache *);
+
+void gtt_date_cache_localtime (GttDateCache *, time_t t, struct tm *tm);
+const char *gtt_date_cache_date_str (GttDateCache *, time_t t);
+size_t gtt_date_cache_time_buff (GttDateCache *, char *buff, size_t len,
+                                 time_t t);
+size_t gtt_date_cache_date_time_buff (GttDateCache *, char *buff,
+                                      size_t len, time_t t);
+size_t gtt_date_cache_clock_buff (GttDateCache *, char *buff, size_t len,
+                                  time_t t);
+gboolean gtt_date_cache_same_day (GttDateCache *, time_t a, time_t b);
+
+#endif // GTT_DATE_CACHE_H
@@ -36,8 +36,13 @@
 #include <string.h>
 
 #include <dbus/dbus-glib.h>
+#include <qof.h>
 
 #include "gtt.h"
+#include "gtt_clock_monitor.h"
+#include "gtt_current_project.h"
+#include "gtt_query.h"
+#include "gtt_text_index.h"
 #include "gtt_timer.h"
 
 typedef struct GnotimeDbus GnotimeDbus;
@@ -73,6 +78,8 @@ gboolean gnotime_dbus_timer (GnotimeDbus *obj, char *action, guint32 *ret,
                              GError **error);
 gboolean gnotime_dbus_file (GnotimeDbus *obj, char *action, guint32 *ret,
                             GError **error);
+gboolean gnotime_dbus_search (GnotimeDbus *obj, char *query, char ***matches,
+                              GError **error);
 
 #include "dbus-glue.h"
 
@@ -142,6 +149,116 @@ gnotime_dbus_file (GnotimeDbus *obj, char *action, guint32 *ret,
   return TRUE;
 }
 
+/* Run a text search query, and add a line for each match */
+static void
+search_add (GPtrArray *lines, const char *text, KvpFrame *kvp)
+{
+  char guid[GUID_ENCODING_LENGTH + 1];
+  GttQuery *q;
+  GList *found, *node;
+
+  q = gtt_query_compile (text, NULL);
+  g_return_if_fail (q);
+  found = gtt_query_run (q, gtt_project_list_get_list (master_list), kvp);
+  for (node = found; node; node = node->next)
+    {
+      GttProject *prj = node->data;
+      const char *title, *memo = "";
+
+      if (GTT_QUERY_TASKS == gtt_query_get_target (q))
+        {
+          GttTask *tsk = node->data;
+          prj = gtt_task_get_parent (tsk);
+          memo = gtt_task_get_memo (tsk);
+          guid_to_string_buff (gtt_task_get_guid (tsk), guid);
+        }
+      else
+        guid_to_string_buff (gtt_project_get_guid (prj), guid);
+
+      title = gtt_project_get_title (prj);
+      g_ptr_array_add (lines, g_strdup_printf ("%s\t%s\t%s", guid,
+                                               title ? title : "",
+                                               memo ? memo : ""));
+    }
+  g_list_free (found);
+  gtt_query_unref (q);
+}
+
+/* Search the task memos and notes, and the project notes, for words;
+ * see gtt_text_search_new() for the syntax.  Each match comes back as
+ * the task's (or project's) GUID, the project title, and the task
+ * memo (empty for a project), separated by tabs. */
+gboolean
+gnotime_dbus_search (GnotimeDbus *obj, char *query, char ***matches,
+                     GError **error)
+{
+  GPtrArray *lines;
+  GttTextSearch *ts;
+  KvpFrame *kvp;
+
+  /* No words at all would match everything */
+  ts = gtt_text_search_new (query);
+  if (!ts)
+    {
+      *matches = g_new0 (char *, 1);
+      return TRUE;
+    }
+  gtt_text_search_free (ts);
+
+  lines = g_ptr_array_new ();
+  kvp = kvp_frame_new ();
+  kvp_frame_set_string (kvp, "search", query);
+  search_add (lines, "SELECT * FROM tasks WHERE text MATCH 'kvp://search'",
+              kvp);
+  search_add (lines,
+              "SELECT * FROM projects "
+              "WHERE project_notes MATCH 'kvp://search'",
+              kvp);
+  kvp_frame_delete (kvp);
+
+  g_ptr_array_add (lines, NULL);
+  *matches = (char **)g_ptr_array_free (lines, FALSE);
+  return TRUE;
+}
+
+/* logind tells us just before the system goes to sleep, and again
+ * when it wakes up.  Book the running interval up to the last moment,
+ * so that the clock monitor can split it at the exact suspend point. */
+static void
+prepare_for_sleep_cb (DBusGProxy *proxy, gboolean start, gpointer data)
+{
+  if (start && cur_proj)
+    {
+      gtt_project_timer_update (cur_proj);
+    }
+  gtt_clock_monitor_prepare_for_sleep (start);
+}
+
+static void
+gnotime_dbus_watch_sleep (void)
+{
+  DBusGConnection *bus;
+  GError *error = NULL;
+  DBusGProxy *login_proxy;
+
+  bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
+  if (!bus)
+    {
+      /* Not fatal; the clock monitor will notice suspends anyway */
+      g_message ("Couldn't connect to system bus: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  login_proxy = dbus_g_proxy_new_for_name (bus, "org.freedesktop.login1",
+                                           "/org/freedesktop/login1",
+                                           "org.freedesktop.login1.Manager");
+  dbus_g_proxy_add_signal (login_proxy, "PrepareForSleep", G_TYPE_BOOLEAN,
+                           G_TYPE_INVALID);
+  dbus_g_proxy_connect_signal (login_proxy, "PrepareForSleep",
+                               G_CALLBACK (prepare_for_sleep_cb), NULL, NULL);
+}
+
 void
 gnotime_dbus_setup (void)
 {
@@ -151,6 +268,8 @@ gnotime_dbus_setup (void)
   GnotimeDbus *obj;
   guint request_name_result;
 
+  gnotime_dbus_watch_sleep ();
+
   dbus_g_object_type_install_info (GNOTIME_TYPE_DBUS,
                                    &dbus_glib_gnotime_dbus_object_info);
 
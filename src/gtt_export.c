@@ -25,15 +25,19 @@
 #include <string.h>
 
 #include "gtt_application_window.h"
-#include "gtt_ghtml.h"
+#include "gtt_columns.h"
+#include "gtt_ical.h"
+#include "gtt_import.h"
+#include "gtt_merge.h"
 #include "gtt_project.h"
 
-#include <gio/gio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 /* Project data export */
 
-#define gtt_sure_string(x) ((x) ? (x) : "")
-
 /* ======================================================= */
 
 typedef struct export_format_s export_format_t;
@@ -41,11 +45,9 @@ typedef struct export_format_s export_format_t;
 struct export_format_s
 {
   GtkFileChooser *picker; /* URI picker (file selection) */
-  const char *uri;        /* aka filename */
-  GFile *ofile;
-  GFileOutputStream *ostream;
-  GttGhtml *ghtml;      /* output device */
-  const char *template; /* output template */
+  char *uri;              /* aka filename */
+  int fd;
+  const char *columns; /* column spec */
 };
 
 static export_format_t *
@@ -55,8 +57,8 @@ export_format_new (void)
   rc = g_new0 (export_format_t, 1);
   rc->picker = NULL;
   rc->uri = NULL;
-  rc->ghtml = NULL;
-  rc->template = NULL;
+  rc->fd = -1;
+  rc->columns = NULL;
   return rc;
 }
 
@@ -78,66 +80,55 @@ export_show_error_message (GtkWindow *parent, char *msg)
 
 /* ======================================================= */
 /*
- * Print out the projects using the standard guile-based
- * printing infrastructure.
+ * Write out the projects, tasks or intervals as delimited text,
+ * straight from the data; see gtt_columns.h.
  */
 
-static void
-export_write (GttGhtml *gxp, const char *str, size_t len, export_format_t *xp)
+static gint
+export_projects (export_format_t *xp)
 {
-  gsize buflen = len;
-  gsize off = 0;
+  GttColumns *cols;
+  GList *prjs;
+  char *errmsg = NULL;
+  gboolean ok;
 
-  while (buflen > 0)
+  cols = gtt_columns_parse (xp->columns, &errmsg);
+  if (!cols)
     {
-      GError *error = NULL;
-      const gssize bytes_written = g_output_stream_write (
-          G_OUTPUT_STREAM (xp->ostream), &str[off], buflen, NULL, &error);
-      if (0 > bytes_written)
-        {
-          g_warning ("Failed to write to export file: %s", error->message);
-
-          g_error_free (error);
-          error = NULL;
+      char *message = g_strdup_printf (_ ("Error exporting data: %s"),
+                                       errmsg);
+      export_show_error_message (GTK_WINDOW (xp->picker), message);
+      g_free (message);
+      g_free (errmsg);
+      return 0;
+    }
 
-          break;
+  if (GTT_ROW_PROJECT == gtt_columns_get_row (cols))
+    {
+      prjs = g_list_copy (gtt_project_list_get_list (global_plist));
+    }
+  else
+    {
+      /* Get the currently selected project */
+      GttProject *prj = gtt_projects_tree_get_selected_project (projects_tree);
+      if (!prj)
+        {
+          gtt_columns_free (cols);
+          return 0;
         }
-
-      off += bytes_written;
-      buflen -= bytes_written;
+      prjs = g_list_prepend (NULL, prj);
     }
-}
-
-static void
-export_err (GttGhtml *gxp, int errcode, const char *msg, export_format_t *xp)
-{
-  char *message = g_strdup_printf (_ ("Error exporting data: %s"), msg);
-  export_show_error_message (GTK_WINDOW (xp->picker), message);
-  g_free (message);
-}
-
-static gint
-export_projects (export_format_t *xp)
-{
-  GttProject *prj;
-
-  /* Get the currently selected project */
-  prj = gtt_projects_tree_get_selected_project (projects_tree);
-  if (!prj)
-    return 0;
-
-  xp->ghtml = gtt_ghtml_new ();
-  gtt_ghtml_set_stream (xp->ghtml, xp, NULL, (GttGhtmlWriteStream)export_write,
-                        NULL, (GttGhtmlError)export_err);
 
-  gtt_ghtml_display (xp->ghtml, xp->template, prj);
-
-  gtt_ghtml_destroy (xp->ghtml);
-  xp->ghtml = NULL;
-
-  g_free ((char *)xp->template);
-  xp->template = NULL;
+  ok = gtt_columns_export (cols, prjs, FALSE,
+                           gtt_columns_format_for_file (xp->uri), xp->fd);
+  g_list_free (prjs);
+  gtt_columns_free (cols);
 
+  if (!ok)
+    {
+      g_warning ("Failed to write to export file: %s", g_strerror (errno));
+      return 1;
+    }
   return 0;
 }
 
@@ -146,28 +137,18 @@ export_projects (export_format_t *xp)
 static void
 export_really (GtkWidget *widget, export_format_t *xp)
 {
-  gboolean rc;
+  gint rc;
 
   xp->uri = gtk_file_chooser_get_filename (xp->picker);
 
-  xp->ofile = g_file_new_for_path (xp->uri);
-
-  GError *error = NULL;
-  xp->ostream = g_file_replace (xp->ofile, NULL, FALSE, G_FILE_CREATE_NONE,
-                                NULL, &error);
-  if (NULL == xp->ostream)
+  xp->fd = g_open (xp->uri, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (0 > xp->fd)
     {
       char *msg = g_strdup_printf (
           _ ("File \"%s\" could not be opened for export: %s"), xp->uri,
-          error->message);
+          g_strerror (errno));
       export_show_error_message (GTK_WINDOW (xp->picker), msg);
       g_free (msg);
-
-      g_error_free (error);
-      error = NULL;
-
-      g_clear_object (&xp->ofile);
-
       return;
     }
 
@@ -176,20 +157,14 @@ export_really (GtkWidget *widget, export_format_t *xp)
     {
       export_show_error_message (GTK_WINDOW (xp->picker),
                                  _ ("Error occured during export"));
-      return;
     }
 
-  if (FALSE
-      == g_output_stream_close (G_OUTPUT_STREAM (xp->ostream), NULL, &error))
+  if (close (xp->fd))
     {
-      g_warning ("Failed to close file after export: %s", error->message);
-
-      g_error_free (error);
-      error = NULL;
+      g_warning ("Failed to close file after export: %s",
+                 g_strerror (errno));
     }
-
-  g_clear_object (&xp->ostream);
-  g_clear_object (&xp->ofile);
+  xp->fd = -1;
 }
 
 /* ======================================================= */
@@ -199,10 +174,10 @@ export_file_picker (GtkWidget *widget, gpointer data)
 {
   export_format_t *xp;
   GtkWidget *dialog;
-  const char *template_filename = data;
+  const char *columns = data;
 
   dialog = gtk_file_chooser_dialog_new (
-      _ ("Tab-Delimited Export"), GTK_WINDOW (app_window),
+      _ ("Tab-Delimited or CSV Export"), GTK_WINDOW (app_window),
       GTK_FILE_CHOOSER_ACTION_SAVE, GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
       GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
 
@@ -213,11 +188,135 @@ export_file_picker (GtkWidget *widget, gpointer data)
     {
       xp = export_format_new ();
       xp->picker = GTK_FILE_CHOOSER (dialog);
-      xp->template = gtt_ghtml_resolve_path (template_filename, NULL);
+      xp->columns = columns;
       export_really (dialog, xp);
+      g_free (xp->uri);
       g_free (xp);
     }
   gtk_widget_destroy (GTK_WIDGET (dialog));
 }
 
+/* ======================================================= */
+/* Import CSV, JSON or iCalendar time data; see gtt_import.h */
+
+void
+import_file_picker (GtkWidget *widget, gpointer data)
+{
+  GtkWidget *dialog;
+
+  dialog = gtk_file_chooser_dialog_new (
+      _ ("CSV, JSON or iCalendar Import"), GTK_WINDOW (app_window),
+      GTK_FILE_CHOOSER_ACTION_OPEN, GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+      GTK_STOCK_OPEN, GTK_RESPONSE_ACCEPT, NULL);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT)
+    {
+      char *filename = gtk_file_chooser_get_filename (
+          GTK_FILE_CHOOSER (dialog));
+      char *errmsg = NULL;
+      gchar *expander_state;
+
+      expander_state = gtt_projects_tree_get_expander_state (projects_tree);
+      if (0 > gtt_import_file (filename, &errmsg))
+        {
+          char *msg = g_strdup_printf (
+              _ ("File \"%s\" could not be imported: %s"), filename,
+              errmsg);
+          export_show_error_message (GTK_WINDOW (dialog), msg);
+          g_free (msg);
+          g_free (errmsg);
+        }
+
+      /* Some may have been imported, even so */
+      gtt_projects_tree_populate (
+          projects_tree, gtt_project_list_get_list (global_plist), TRUE);
+      gtt_projects_tree_set_expander_state (projects_tree, expander_state);
+      g_free (filename);
+    }
+  gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
+/* ======================================================= */
+/* Merge in the data file of another machine; see gtt_merge.h */
+
+void
+merge_file_picker (GtkWidget *widget, gpointer data)
+{
+  GtkWidget *dialog;
+
+  dialog = gtk_file_chooser_dialog_new (
+      _ ("Merge a GnoTime Data File"), GTK_WINDOW (app_window),
+      GTK_FILE_CHOOSER_ACTION_OPEN, GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+      GTK_STOCK_OPEN, GTK_RESPONSE_ACCEPT, NULL);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT)
+    {
+      char *filename = gtk_file_chooser_get_filename (
+          GTK_FILE_CHOOSER (dialog));
+      char *errmsg = NULL;
+      gchar *expander_state;
+
+      expander_state = gtt_projects_tree_get_expander_state (projects_tree);
+      if (gtt_merge_file (filename, NULL, &errmsg))
+        {
+          gtt_projects_tree_populate (
+              projects_tree, gtt_project_list_get_list (global_plist), TRUE);
+          gtt_projects_tree_set_expander_state (projects_tree,
+                                                expander_state);
+        }
+      else
+        {
+          export_show_error_message (GTK_WINDOW (dialog), errmsg);
+          g_free (errmsg);
+        }
+      g_free (filename);
+    }
+  gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
+/* ======================================================= */
+/* Keep a calendar directory up to date; see gtt_ical.h.  The sync
+ * is kept for the session, so that choosing the same directory again
+ * only writes out the projects that have changed since. */
+
+static GttIcalSync *ical_sync = NULL;
+static char *ical_sync_dir = NULL;
+
+void
+ical_sync_picker (GtkWidget *widget, gpointer data)
+{
+  GtkWidget *dialog;
+
+  dialog = gtk_file_chooser_dialog_new (
+      _ ("Sync to a Calendar Directory"), GTK_WINDOW (app_window),
+      GTK_FILE_CHOOSER_ACTION_SELECT_FOLDER, GTK_STOCK_CANCEL,
+      GTK_RESPONSE_CANCEL, GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
+  if (ical_sync_dir)
+    gtk_file_chooser_set_filename (GTK_FILE_CHOOSER (dialog),
+                                   ical_sync_dir);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT)
+    {
+      char *dir = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+      char *errmsg = NULL;
+
+      if (!ical_sync_dir || strcmp (dir, ical_sync_dir))
+        {
+          gtt_ical_sync_free (ical_sync);
+          g_free (ical_sync_dir);
+          ical_sync = gtt_ical_sync_new (dir);
+          ical_sync_dir = g_strdup (dir);
+        }
+      if (0 > gtt_ical_sync (ical_sync,
+                             gtt_project_list_get_list (global_plist),
+                             &errmsg))
+        {
+          export_show_error_message (GTK_WINDOW (dialog), errmsg);
+          g_free (errmsg);
+        }
+      g_free (dir);
+    }
+  gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
 /* ======================= END OF FILE ======================= */
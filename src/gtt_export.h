@@ -22,7 +22,24 @@
 
 #include <gtk/gtk.h>
 
-/* bring up dialog for picking the export format, file, etc. */
+/* Bring up the dialog for picking the file to export to, and export.
+ * The 'data' is the column spec (see gtt_columns.h).  If it makes one
+ * row per project, all of the projects are exported; otherwise, the
+ * tasks or intervals of the selected project are.  File names ending
+ * in .csv get comma-separated values; any others, tab-separated. */
 void export_file_picker (GtkWidget *widget, gpointer data);
 
+/* Bring up the dialog for picking a CSV, JSON or iCalendar file of
+ * time data, and import it into the projects; see gtt_import.h. */
+void import_file_picker (GtkWidget *widget, gpointer data);
+
+/* Bring up the dialog for picking the data file of another machine,
+ * and merge it into the projects; see gtt_merge.h. */
+void merge_file_picker (GtkWidget *widget, gpointer data);
+
+/* Bring up the dialog for picking a calendar directory, and write the
+ * projects' intervals and to-dos into it, a file per project; see
+ * gtt_ical.h.  Picking the same one again only writes what changed. */
+void ical_sync_picker (GtkWidget *widget, gpointer data);
+
 #endif // GTT_EXPORT_H
@@ -23,12 +23,16 @@
 
 #define _GNU_SOURCE
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <libguile.h>
 #include <libguile/backtrace.h>
 #include <limits.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #include <qof.h>
 
@@ -38,35 +42,48 @@
 #include "gtt.h"
 #include "gtt_application_window.h"
 #include "gtt_current_project.h"
+#include "gtt_date_cache.h"
 #include "gtt_ghtml_deprecated.h"
+#include "gtt_invoice.h"
 #include "gtt_preferences.h"
 #include "gtt_project.h"
+#include "gtt_project_queries.h"
 #include "gtt_queries.h"
+#include "gtt_query.h"
+#include "gtt_report_cache.h"
+#include "gtt_text_index.h"
+#include "gtt_timer.h"
 #include "gtt_util.h"
 
-#include <gio/gio.h>
-
 /* Design problems:
- * The way this is currently defined, there is no type safety, and
- * we could easily be slipping the wrong addresses to the wrong places.
- * We really should add a type identifier to the the project,
- * task and interval objects.  This type should be in the cdr
- * part of the object, so that it will stop recursion and list-walking.
- * (The utility routines in gtt.scm walk lists and trees; thus,
- * putting a non-pointer in the cdr is an effective way to stop the
- * recursion.)  The 'daily-totals' object already follows this
- * convention.
+ * Projects, tasks and intervals are handed to scheme as handles that
+ * know their own type (see below), so the wrong addresses no longer
+ * get slipped to the wrong places.  Lists of them still carry a type
+ * label in the cdr, which stops the recursion and list-walking in
+ * the utility routines in gtt.scm.  The 'daily-totals' object
+ * follows the same convention.  The handles are not checked against
+ * the objects that still exist, though; a report that holds on to
+ * one after its project is deleted will crash.
  *
- * Another major design problem is that formatting for date/time
+ * A major design problem is that formatting for date/time
  * strings is totally not user-settable.  Most of the formatting
  * needs to be moved over to scheme code, and we just need to let
  * the functions below return plain-old time_t seconds.
  */
 
 /* ============================================================== */
-/* Seems to me like guile screwed the pooch; we need a global! */
+/* The scheme procs below have no way of being handed the GttGhtml
+ * they are rendering for, so gtt_ghtml_display() leaves it where
+ * they can find it.  Each thread has its own, so that reports can be
+ * rendered on several threads at once. */
+
+static GPrivate current_ghtml = G_PRIVATE_INIT (NULL);
 
-GttGhtml *ghtml_guile_global_hack = NULL;
+GttGhtml *
+gtt_ghtml_current (void)
+{
+  return g_private_get (&current_ghtml);
+}
 
 static SCM
 do_ret_did_query (GttGhtml *ghtml)
@@ -77,7 +94,7 @@ do_ret_did_query (GttGhtml *ghtml)
 static SCM
 ret_did_query (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_ret_did_query (ghtml);
 }
 
@@ -111,6 +128,117 @@ typedef enum
   GTT_IVL
 } PtrType;
 
+/* The type labels for lists of each type, and the names the handles
+ * print with. */
+static const char *list_labels[]
+    = { NULL, "gtt-project-list", "gtt-task-list", "gtt-interval-list" };
+static const char *handle_names[]
+    = { "gtt-none", "gtt-project", "gtt-task", "gtt-interval" };
+
+/* ============================================================== */
+/* A handle is a smob holding the pointer, with the PtrType in the
+ * smob flags.  It holds no scheme objects, so it needs no marking,
+ * and the C object is not freed when the handle is collected. */
+
+static scm_t_bits handle_tag;
+
+#define IS_HANDLE(node) SCM_SMOB_PREDICATE (handle_tag, node)
+#define HANDLE_TYPE(node) ((PtrType)SCM_SMOB_FLAGS (node))
+#define HANDLE_PTR(node) ((gpointer)SCM_SMOB_DATA (node))
+
+static SCM
+handle_new (PtrType type, gpointer ptr)
+{
+  SCM handle;
+
+  SCM_NEWSMOB (handle, handle_tag, ptr);
+  SCM_SET_SMOB_FLAGS (handle, type);
+  return handle;
+}
+
+static int
+handle_print (SCM handle, SCM port, scm_print_state *pstate)
+{
+  char buff[100];
+
+  g_snprintf (buff, sizeof (buff), "#<%s %p>",
+              handle_names[HANDLE_TYPE (handle)], HANDLE_PTR (handle));
+  scm_puts (buff, port);
+  return 1;
+}
+
+/* Two handles for the same object are equal?, though not eq? */
+static SCM
+handle_equalp (SCM a, SCM b)
+{
+  return scm_from_bool ((HANDLE_TYPE (a) == HANDLE_TYPE (b))
+                        && (HANDLE_PTR (a) == HANDLE_PTR (b)));
+}
+
+static void
+register_handle_type (void)
+{
+  handle_tag = scm_make_smob_type ("gtt-handle", 0);
+  scm_set_smob_print (handle_tag, handle_print);
+  scm_set_smob_equalp (handle_tag, handle_equalp);
+}
+
+/* Return the type of the objects in a list with the given type
+ * label, or GTT_NONE if it's not one of ours. */
+static PtrType
+label_type (SCM label)
+{
+  PtrType type = GTT_NONE;
+  char *buff = scm_to_locale_string (label);
+
+  if ((!strncmp (buff, "gtt-project-ptr", 15))
+      || (!strncmp (buff, "gtt-project-list", 16)))
+    {
+      type = GTT_PRJ;
+    }
+  else if (!strncmp (buff, "gtt-task-list", 13))
+    {
+      type = GTT_TASK;
+    }
+  else if (!strncmp (buff, "gtt-interval-list", 17))
+    {
+      type = GTT_IVL;
+    }
+  free (buff);
+  return type;
+}
+
+/* ============================================================== */
+
+static SCM
+apply_on_ptr (GttGhtml *ghtml, PtrType type, gpointer ptr,
+              SCM (*prj_func) (GttGhtml *, GttProject *),
+              SCM (*tsk_func) (GttGhtml *, GttTask *),
+              SCM (*ivl_func) (GttGhtml *, GttInterval *))
+{
+  SCM rc = SCM_EOL;
+
+  switch (type)
+    {
+    case GTT_PRJ:
+      if (prj_func)
+        rc = prj_func (ghtml, ptr);
+      break;
+    case GTT_TASK:
+      if (tsk_func)
+        rc = tsk_func (ghtml, ptr);
+      break;
+    case GTT_IVL:
+      if (ivl_func)
+        rc = ivl_func (ghtml, ptr);
+      break;
+    case GTT_NONE:
+      rc = SCM_EOL;
+      break;
+    }
+  return rc;
+}
+
 static SCM
 do_apply_based_on_type (GttGhtml *ghtml, SCM node, PtrType cur_type,
                         SCM (*str_func) (GttGhtml *, const char *),
@@ -129,38 +257,19 @@ do_apply_based_on_type (GttGhtml *ghtml, SCM node, PtrType cur_type,
       return rc;
     }
 
-  /* If its a number, its in fact a pointer to the C struct. */
+  /* A handle knows what it points at */
+  if (IS_HANDLE (node))
+    {
+      return apply_on_ptr (ghtml, HANDLE_TYPE (node), HANDLE_PTR (node),
+                           prj_func, tsk_func, ivl_func);
+    }
+
+  /* If its a number, its in fact a pointer to the C struct.  Old
+   * reports may still have these. */
   if (scm_is_number (node))
     {
-      SCM rc = SCM_EOL;
-      switch (cur_type)
-        {
-        case GTT_PRJ:
-          {
-            GttProject *prj = (GttProject *)scm_to_ulong (node);
-            if (prj_func)
-              rc = prj_func (ghtml, prj);
-            break;
-          }
-        case GTT_TASK:
-          {
-            GttTask *tsk = (GttTask *)scm_to_ulong (node);
-            if (tsk_func)
-              rc = tsk_func (ghtml, tsk);
-            break;
-          }
-        case GTT_IVL:
-          {
-            GttInterval *ivl = (GttInterval *)scm_to_ulong (node);
-            if (ivl_func)
-              rc = ivl_func (ghtml, ivl);
-            break;
-          }
-        case GTT_NONE:
-          rc = SCM_EOL;
-          break;
-        }
-      return rc;
+      return apply_on_ptr (ghtml, cur_type, (gpointer)scm_to_ulong (node),
+                           prj_func, tsk_func, ivl_func);
     }
 
   /* If its a list, then process the list */
@@ -179,23 +288,8 @@ do_apply_based_on_type (GttGhtml *ghtml, SCM node, PtrType cur_type,
           type = SCM_CDR (node);
           if (scm_is_symbol (type) || scm_is_string (type))
             {
-              cur_type = GTT_NONE;
-              char *buff = scm_to_locale_string (type);
-
-              if ((!strncmp (buff, "gtt-project-ptr", 15))
-                  || (!strncmp (buff, "gtt-project-list", 16)))
-                {
-                  cur_type = GTT_PRJ;
-                }
-              else if (!strncmp (buff, "gtt-task-list", 13))
-                {
-                  cur_type = GTT_TASK;
-                }
-              else if (!strncmp (buff, "gtt-interval-list", 17))
-                {
-                  cur_type = GTT_IVL;
-                }
-              else
+              cur_type = label_type (type);
+              if (GTT_NONE == cur_type)
                 {
                   g_warning ("Unknown GTT list type\n");
                   return SCM_EOL;
@@ -297,7 +391,7 @@ kvp_cb (GttGhtml *ghtml, const char *key)
 static SCM
 ret_kvp_str (SCM key)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_string (ghtml, key, kvp_cb);
 }
 
@@ -338,7 +432,7 @@ do_show_scm (GttGhtml *ghtml, SCM node)
         {
           sprintf (buf, "%26.18g", x);
         }
-      (ghtml->write_stream) (ghtml, buf, strlen (buf), ghtml->user_data);
+      gtt_ghtml_write (ghtml, buf, strlen (buf));
     }
   else
       /* either a 'symbol or a "quoted string" */
@@ -347,7 +441,7 @@ do_show_scm (GttGhtml *ghtml, SCM node)
       str = scm_to_locale_string (node);
       len = strlen (str);
       if (0 < len)
-        (ghtml->write_stream) (ghtml, str, len, ghtml->user_data);
+        gtt_ghtml_write (ghtml, str, len);
     }
   else if (scm_is_pair (node))
     {
@@ -368,7 +462,7 @@ do_show_scm (GttGhtml *ghtml, SCM node)
         str = _ ("False");
       else
         str = _ ("True");
-      (ghtml->write_stream) (ghtml, str, strlen (str), ghtml->user_data);
+      gtt_ghtml_write (ghtml, str, strlen (str));
     }
   else if (scm_is_null (node))
     {
@@ -386,27 +480,20 @@ do_show_scm (GttGhtml *ghtml, SCM node)
 static SCM
 show_scm (SCM node_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_show_scm (ghtml, node_list);
 }
 
 /* ============================================================== */
-/* Cheesy hack, this returns a pointer to the currently
- * selected project as a ulong.  Its baaaad,  but acheives its
- * purpose for now.   Its baad because the C pointer is not
- * currently checked before use.  This could lead to core dumps
- * if the scheme code was bad.  It sure would be nice to be
- * able to check that the pointer is a valid pointer to a gtt
- * project.  For example, maybe projects and tasks should be
- * GObjects, and then would could check the cast.  Later.
- * --linas
- */
+/* Return a handle to a project, labelled with its type.  The
+ * handle is not checked against the projects that still exist;
+ * see the design problems above. */
 
 static SCM
 do_ret_project (GttGhtml *ghtml, GttProject *prj)
 {
   SCM node, rc;
-  rc = scm_from_ulong ((unsigned long)prj);
+  rc = handle_new (GTT_PRJ, prj);
 
   /* Label the pointer with a type identifier */
   node = scm_from_locale_string ("gtt-project-ptr");
@@ -416,20 +503,31 @@ do_ret_project (GttGhtml *ghtml, GttProject *prj)
 }
 
 /* The 'selected project' is the project highlighted by the
- * focus row in the main window.
+ * focus row in the main window.  When there is no main window
+ * (batch reports), or the report is on a snapshot of the projects,
+ * it's the linked project.
  */
 
 static SCM
 do_ret_selected_project (GttGhtml *ghtml)
 {
-  GttProject *prj = gtt_projects_tree_get_selected_project (projects_tree);
+  GttProject *prj;
+
+  if (projects_tree && !ghtml->plist)
+    {
+      /* Changing the selection doesn't change any generation */
+      ghtml->uncacheable = TRUE;
+      prj = gtt_projects_tree_get_selected_project (projects_tree);
+    }
+  else
+    prj = ghtml->prj;
   return do_ret_project (ghtml, prj);
 }
 
 static SCM
 ret_selected_project (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_ret_selected_project (ghtml);
 }
 
@@ -442,7 +540,7 @@ do_ret_linked_project (GttGhtml *ghtml)
 static SCM
 ret_linked_project (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_ret_linked_project (ghtml);
 }
 
@@ -462,7 +560,7 @@ do_set_links_on (GttGhtml *ghtml)
 static SCM
 set_links_on (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_set_links_on (ghtml);
 }
 
@@ -476,7 +574,7 @@ do_set_links_off (GttGhtml *ghtml)
 static SCM
 set_links_off (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_set_links_off (ghtml);
 }
 
@@ -520,45 +618,44 @@ do_include_file_scm (GttGhtml *ghtml, SCM node)
 static SCM
 include_file_scm (SCM node_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_include_file_scm (ghtml, node_list);
 }
 
 /* ============================================================== */
-/** Converts a g_list of pointers into a typed SCM list.  This is
- *  a generic utility.  It returns rc, where (car rc) is a list of
- *  pointers, and (cdr rc) is the type-string that identifies the
- *  type of the pointers. */
+/** Converts a g_list of pointers into a scheme list of handles of
+ *  the given type, in one pass, front to back. */
 
 static SCM
-g_list_to_scm (GList *gplist, const char *type)
+g_list_to_handles (GList *gplist, PtrType type)
 {
-  SCM rc, node;
+  SCM rc, tail, cell;
   GList *n;
 
-  /* Get a pointer to null */
   rc = SCM_EOL;
-  if (gplist)
+  tail = SCM_EOL;
+  for (n = gplist; n; n = n->next)
     {
-      /* Get tail of g_list */
-      for (n = gplist; n->next; n = n->next)
-        {
-        }
-      gplist = n;
-
-      /* Walk backwards, creating a scheme list */
-      for (n = gplist; n; n = n->prev)
-        {
-          node = scm_from_ulong ((unsigned long)n->data);
-          rc = scm_cons (node, rc);
-        }
+      cell = scm_cons (handle_new (type, n->data), SCM_EOL);
+      if (scm_is_null (tail))
+        rc = cell;
+      else
+        SCM_SETCDR (tail, cell);
+      tail = cell;
     }
+  return rc;
+}
 
-  /* Prepend type label */
-  node = scm_from_locale_string (type);
-  rc = scm_cons (rc, node);
+/** Converts a g_list of pointers into a typed SCM list.  This is
+ *  a generic utility.  It returns rc, where (car rc) is a list of
+ *  handles, and (cdr rc) is the type-string that identifies the
+ *  type of the handles. */
 
-  return rc;
+static SCM
+g_list_to_scm (GList *gplist, PtrType type)
+{
+  return scm_cons (g_list_to_handles (gplist, type),
+                   scm_from_locale_string (list_labels[type]));
 }
 
 /* ============================================================== */
@@ -567,60 +664,236 @@ g_list_to_scm (GList *gplist, const char *type)
 static SCM
 do_ret_project_list (GttGhtml *ghtml, GList *proj_list)
 {
-  SCM rc;
-  GList *n;
+  return g_list_to_handles (proj_list, GTT_PRJ);
+}
 
-  /* Get a pointer to null */
-  rc = SCM_EOL;
-  if (!proj_list)
-    return rc;
+static SCM
+ret_projects (void)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+
+  /* Get list of all top-level projects */
+  GList *proj_list = gtt_project_list_get_list (
+      ghtml->plist ? ghtml->plist : master_list);
+  ghtml->deps.wide = TRUE;
+  return do_ret_project_list (ghtml, proj_list);
+}
+
+/* ============================================================== */
+/* Return the results of the query that the report was asked for by */
+
+/* The query is run once for each display, the first time that the
+ * report asks for its results. */
+static GList *
+query_results (GttGhtml *ghtml)
+{
+  GList *prjs;
+
+  ghtml->deps.wide = TRUE;
+  if (!ghtml->query || ghtml->query_done)
+    return ghtml->query_result;
+
+  prjs = gtt_project_list_get_list (ghtml->plist ? ghtml->plist
+                                                 : master_list);
+  g_list_free (ghtml->query_result);
+  ghtml->query_result = gtt_query_run (ghtml->query, prjs, ghtml->kvp);
+  ghtml->query_done = TRUE;
+  return ghtml->query_result;
+}
 
-  /* XXX should use g_list_to_scm() here */
-  /* XXX should use type identifier gtt-project-list */
-  /* Find the tail */
-  for (n = proj_list; n->next; n = n->next)
+static PtrType
+query_result_type (GttGhtml *ghtml)
+{
+  if (!ghtml->query)
+    return GTT_PRJ;
+  return GTT_PRJ + gtt_query_get_target (ghtml->query);
+}
+
+/* Add what 'ptr' (of type 'have') is, or has, of type 'want': its
+ * project or task, without repeats, or its tasks or intervals. */
+static void
+query_results_as (gpointer ptr, PtrType have, PtrType want,
+                  GHashTable *seen, GList **list)
+{
+  GList *node;
+
+  if (have == want)
     {
+      if (g_hash_table_lookup (seen, ptr))
+        return;
+      g_hash_table_insert (seen, ptr, ptr);
+      *list = g_list_prepend (*list, ptr);
+      return;
     }
-  proj_list = n;
-
-  /* Walk backwards, creating a scheme list */
-  for (n = proj_list; n; n = n->prev)
+  if (have > want)
     {
-      GttProject *prj = n->data;
-      SCM node;
-#if 0
-		GList *subprjs;
-
-		/* Handle sub-projects, if any, before the project itself */
-		subprjs = gtt_project_get_children (prj);
-		if (subprjs)
-		{
-			node = do_ret_project_list (ghtml, subprjs);
-			rc = scm_cons (node, rc);
-		}
-#endif
-      node = scm_from_ulong ((unsigned long)prj);
-      rc = scm_cons (node, rc);
+      if (GTT_IVL == have)
+        ptr = gtt_interval_get_parent (ptr);
+      else
+        ptr = gtt_task_get_parent (ptr);
+      if (ptr)
+        query_results_as (ptr, have - 1, want, seen, list);
+      return;
     }
+
+  if (GTT_PRJ == have)
+    node = gtt_project_get_tasks (ptr);
+  else
+    node = gtt_task_get_intervals (ptr);
+  for (; node; node = node->next)
+    query_results_as (node->data, have + 1, want, seen, list);
+}
+
+static SCM
+do_ret_query_as (GttGhtml *ghtml, PtrType want)
+{
+  GList *results = query_results (ghtml);
+  PtrType have = query_result_type (ghtml);
+  GHashTable *seen;
+  GList *node, *list = NULL;
+  SCM rc;
+
+  if (have == want)
+    return g_list_to_handles (results, want);
+
+  seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (node = results; node; node = node->next)
+    query_results_as (node->data, have, want, seen, &list);
+  g_hash_table_destroy (seen);
+
+  list = g_list_reverse (list);
+  rc = g_list_to_handles (list, want);
+  g_list_free (list);
   return rc;
 }
 
 static SCM
-ret_projects (void)
+ret_query_results (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  GList *results = query_results (ghtml);
 
-  /* Get list of all top-level projects */
-  GList *proj_list = gtt_project_list_get_list (master_list);
-  return do_ret_project_list (ghtml, proj_list);
+  return g_list_to_handles (results, query_result_type (ghtml));
 }
 
 static SCM
 ret_query_projects (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  return do_ret_query_as (ghtml, GTT_PRJ);
+}
+
+static SCM
+ret_query_tasks (void)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  return do_ret_query_as (ghtml, GTT_TASK);
+}
+
+static SCM
+ret_query_intervals (void)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  return do_ret_query_as (ghtml, GTT_IVL);
+}
+
+/* ============================================================== */
+/* Search the task memos and notes, or the project notes, for words */
+
+static void
+search_projects (GttTextSearch *ts, guint fields, GList *prjs, GList **list)
+{
+  GList *node, *tn;
+
+  for (node = prjs; node; node = node->next)
+    {
+      GttProject *prj = node->data;
+
+      if (GTT_TEXT_PROJECT_NOTES & fields)
+        {
+          if (gtt_text_search_match (ts, gtt_project_get_notes (prj)))
+            *list = g_list_prepend (*list, prj);
+        }
+      else
+        {
+          for (tn = gtt_project_get_tasks (prj); tn; tn = tn->next)
+            {
+              if (gtt_text_search_match (ts, gtt_task_get_memo (tn->data))
+                  || gtt_text_search_match (ts,
+                                            gtt_task_get_notes (tn->data)))
+                *list = g_list_prepend (*list, tn->data);
+            }
+        }
+      search_projects (ts, fields, gtt_project_get_children (prj), list);
+    }
+}
+
+/* The index also knows about projects that have been cut, but not
+ * yet pasted; leave those out. */
+static GList *
+search_index (GttTextSearch *ts, guint fields)
+{
+  GList *found, *node, *list = NULL;
+
+  found = gtt_text_index_find (ts, fields);
+  for (node = found; node; node = node->next)
+    {
+      GttProject *prj = node->data;
+
+      if (!(GTT_TEXT_PROJECT_NOTES & fields))
+        prj = gtt_task_get_parent (node->data);
+      while (prj && gtt_project_get_parent (prj))
+        prj = gtt_project_get_parent (prj);
+      if (prj && g_list_find (gtt_project_list_get_list (master_list), prj))
+        list = g_list_prepend (list, node->data);
+    }
+  g_list_free (found);
+  return list;
+}
+
+static SCM
+do_search (SCM text, guint fields, PtrType type)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  GttTextSearch *ts;
+  GList *list = NULL;
+  char *str;
+  SCM rc;
+
+  if (!scm_is_string (text))
+    return SCM_EOL;
+  str = scm_to_locale_string (text);
+  ts = gtt_text_search_new (str);
+  free (str);
+  ghtml->deps.wide = TRUE;
+  if (!ts)
+    return SCM_EOL;
+
+  /* The snapshots that reports are rendered from on other threads
+   * aren't in the index; they get searched the slow way. */
+  if (ghtml->plist)
+    search_projects (ts, fields, gtt_project_list_get_list (ghtml->plist),
+                     &list);
+  else
+    list = search_index (ts, fields);
+  gtt_text_search_free (ts);
+
+  list = g_list_reverse (list);
+  rc = g_list_to_handles (list, type);
+  g_list_free (list);
+  return rc;
+}
+
+static SCM
+ret_search (SCM text)
+{
+  return do_search (text, GTT_TEXT_MEMO | GTT_TEXT_NOTES, GTT_TASK);
+}
 
-  return do_ret_project_list (ghtml, ghtml->query_result);
+static SCM
+ret_search_projects (SCM text)
+{
+  return do_search (text, GTT_TEXT_PROJECT_NOTES, GTT_PRJ);
 }
 
 /* ============================================================== */
@@ -641,7 +914,7 @@ do_ret_subprjs (GttGhtml *ghtml, GttProject *prj)
 static SCM
 ret_project_subprjs (SCM proj_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_project (ghtml, proj_list, do_ret_subprjs);
 }
 
@@ -651,13 +924,16 @@ static SCM
 get_proj_parent_scm (GttGhtml *ghtml, GttProject *prj)
 {
   GttProject *parent = gtt_project_get_parent (prj);
+
+  /* The parent is outside of the linked project's subtree */
+  ghtml->deps.wide = TRUE;
   return do_ret_project (ghtml, parent);
 }
 
 static SCM
 ret_project_parent (SCM proj_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_project (ghtml, proj_list, get_proj_parent_scm);
 }
 
@@ -667,41 +943,16 @@ ret_project_parent (SCM proj_list)
 static SCM
 do_ret_tasks (GttGhtml *ghtml, GttProject *prj)
 {
-  SCM rc;
-  GList *n, *task_list;
-
-  /* Get a pointer to null */
-  rc = SCM_EOL;
   if (!prj)
-    return rc;
-
-  /* Get list of tasks, then get tail */
-  task_list = gtt_project_get_tasks (prj);
-  if (!task_list)
-    return rc;
-
-  /* XXX should use g_list_to_scm() here */
-  for (n = task_list; n->next; n = n->next)
-    {
-    }
-  task_list = n;
-
-  /* Walk backwards, creating a scheme list */
-  for (n = task_list; n; n = n->prev)
-    {
-      GttTask *tsk = n->data;
-      SCM node;
+    return SCM_EOL;
 
-      node = scm_from_ulong ((unsigned long)tsk);
-      rc = scm_cons (node, rc);
-    }
-  return rc;
+  return g_list_to_handles (gtt_project_get_tasks (prj), GTT_TASK);
 }
 
 static SCM
 ret_tasks (SCM proj_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_project (ghtml, proj_list, do_ret_tasks);
 }
 
@@ -711,84 +962,220 @@ ret_tasks (SCM proj_list)
 static SCM
 do_ret_intervals (GttGhtml *ghtml, GttTask *tsk)
 {
-  SCM rc;
-  GList *n, *ivl_list;
-
   /* Oddball hack to make interval datestamp printing work nicely */
   ghtml->last_ivl_time = 0;
 
-  /* Get a pointer to null */
-  rc = SCM_EOL;
   if (!tsk)
-    return rc;
-
-  /* XXX should use g_list_to_scm() here */
-  /* Get list of intervals, then get tail */
-  ivl_list = gtt_task_get_intervals (tsk);
-  if (!ivl_list)
-    return rc;
-
-  for (n = ivl_list; n->next; n = n->next)
-    {
-    }
-  ivl_list = n;
-
-  /* Walk backwards, creating a scheme list */
-  for (n = ivl_list; n; n = n->prev)
-    {
-      GttInterval *ivl = n->data;
-      SCM node;
+    return SCM_EOL;
 
-      node = scm_from_ulong ((unsigned long)ivl);
-      rc = scm_cons (node, rc);
-    }
-  return rc;
+  return g_list_to_handles (gtt_task_get_intervals (tsk), GTT_IVL);
 }
 
 static SCM
 ret_intervals (SCM task_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_task (ghtml, task_list, do_ret_intervals);
 }
 
 /* ============================================================== */
-/* Return a list of date handles for accessing daily totals */
+/* Iterators.  The lists above are fine for a page of projects, but a
+ * report over every interval ever recorded shouldn't have to build a
+ * list of them all first.  These walk the projects, tasks and
+ * intervals in C, and hand them to a scheme proc one at a time:
+ *
+ *    (gtt-fold-intervals proc init objs)
+ *    (gtt-for-each-interval proc objs)
+ *
+ * and likewise gtt-fold-tasks, gtt-for-each-task, gtt-fold-projects
+ * and gtt-for-each-project.  The objs are projects, tasks or lists
+ * of them, as taken by gtt-tasks and gtt-intervals; the intervals of
+ * a project are those of its tasks.  Fold calls (proc obj acc) and
+ * returns the last acc; for-each calls (proc obj).  Only the handle
+ * being visited is allocated, so the scheme heap stays small however
+ * long the history is.
+ */
 
-static SCM
-do_ret_daily_totals (GttGhtml *ghtml, GttProject *prj)
+typedef struct
 {
-  SCM rc, rpt;
-  int i;
-  GArray *arr;
-  time_t earliest;
-  struct tm tday;
-
-  /* Get a pointer to null */
-  rc = SCM_EOL;
-  if (!prj)
-    return rc;
-
-  /* Get the project data */
-  arr = gtt_project_get_daily_buckets (prj, TRUE);
-  if (!arr)
-    return rc;
-  earliest = gtt_project_get_earliest_start (prj, TRUE);
+  GttGhtml *ghtml;
+  PtrType want; /* the type of the objects that proc gets */
+  SCM proc;
+  SCM acc;
+  gboolean fold; /* FALSE for for-each */
+} FoldState;
 
-  /* Format the start date */
-  localtime_r (&earliest, &tday);
-  tday.tm_mday--;
+static void
+fold_ptr (FoldState *st, PtrType type, gpointer ptr)
+{
+  GList *n;
 
-  for (i = 0; i < arr->len; i++)
+  if (type == st->want)
     {
-      GttBucket *bu;
-      char buff[100];
-      SCM node;
-      time_t rptdate, secs;
-
-      tday.tm_mday++;
-      bu = &g_array_index (arr, GttBucket, i);
-      secs = bu->total;
+      SCM handle = handle_new (type, ptr);
+      if (st->fold)
+        st->acc = scm_call_2 (st->proc, handle, st->acc);
+      else
+        scm_call_1 (st->proc, handle);
+      return;
+    }
+  if (!ptr)
+    return;
+
+  switch (type)
+    {
+    case GTT_PRJ:
+      if ((GTT_TASK != st->want) && (GTT_IVL != st->want))
+        break;
+      for (n = gtt_project_get_tasks (ptr); n; n = n->next)
+        fold_ptr (st, GTT_TASK, n->data);
+      break;
+    case GTT_TASK:
+      if (GTT_IVL != st->want)
+        break;
+      /* Same as gtt-intervals, for the datestamp printing */
+      st->ghtml->last_ivl_time = 0;
+      for (n = gtt_task_get_intervals (ptr); n; n = n->next)
+        fold_ptr (st, GTT_IVL, n->data);
+      break;
+    default:
+      break;
+    }
+}
+
+static void
+fold_walk (FoldState *st, SCM node, PtrType cur_type)
+{
+  if (IS_HANDLE (node))
+    {
+      fold_ptr (st, HANDLE_TYPE (node), HANDLE_PTR (node));
+      return;
+    }
+  if (scm_is_number (node))
+    {
+      fold_ptr (st, cur_type, (gpointer)scm_to_ulong (node));
+      return;
+    }
+  if (!scm_is_pair (node))
+    return;
+
+  /* A type-labelled list */
+  if (scm_is_symbol (SCM_CDR (node)) || scm_is_string (SCM_CDR (node)))
+    {
+      cur_type = label_type (SCM_CDR (node));
+      if (GTT_NONE != cur_type)
+        fold_walk (st, SCM_CAR (node), cur_type);
+      return;
+    }
+
+  for (; scm_is_pair (node); node = SCM_CDR (node))
+    fold_walk (st, SCM_CAR (node), cur_type);
+}
+
+static SCM
+do_fold (PtrType want, SCM proc, SCM init, SCM objs, gboolean fold)
+{
+  FoldState st;
+
+  if (scm_is_false (scm_procedure_p (proc)))
+    {
+      g_warning ("expecting a procedure to iterate with\n");
+      return fold ? init : SCM_UNSPECIFIED;
+    }
+
+  st.ghtml = gtt_ghtml_current ();
+  st.want = want;
+  st.proc = proc;
+  st.acc = init;
+  st.fold = fold;
+  fold_walk (&st, objs, GTT_PRJ);
+  return fold ? st.acc : SCM_UNSPECIFIED;
+}
+
+static SCM
+fold_projects (SCM proc, SCM init, SCM objs)
+{
+  return do_fold (GTT_PRJ, proc, init, objs, TRUE);
+}
+
+static SCM
+fold_tasks (SCM proc, SCM init, SCM objs)
+{
+  return do_fold (GTT_TASK, proc, init, objs, TRUE);
+}
+
+static SCM
+fold_intervals (SCM proc, SCM init, SCM objs)
+{
+  return do_fold (GTT_IVL, proc, init, objs, TRUE);
+}
+
+static SCM
+for_each_project (SCM proc, SCM objs)
+{
+  return do_fold (GTT_PRJ, proc, SCM_UNSPECIFIED, objs, FALSE);
+}
+
+static SCM
+for_each_task (SCM proc, SCM objs)
+{
+  return do_fold (GTT_TASK, proc, SCM_UNSPECIFIED, objs, FALSE);
+}
+
+static SCM
+for_each_interval (SCM proc, SCM objs)
+{
+  return do_fold (GTT_IVL, proc, SCM_UNSPECIFIED, objs, FALSE);
+}
+
+/* Type predicates for the handles */
+static SCM
+is_project_scm (SCM obj)
+{
+  return scm_from_bool (IS_HANDLE (obj) && (GTT_PRJ == HANDLE_TYPE (obj)));
+}
+
+static SCM
+is_task_scm (SCM obj)
+{
+  return scm_from_bool (IS_HANDLE (obj) && (GTT_TASK == HANDLE_TYPE (obj)));
+}
+
+static SCM
+is_interval_scm (SCM obj)
+{
+  return scm_from_bool (IS_HANDLE (obj) && (GTT_IVL == HANDLE_TYPE (obj)));
+}
+
+/* ============================================================== */
+/* Return a list of date handles for accessing daily totals */
+
+static SCM
+do_ret_daily_totals (GttGhtml *ghtml, GttProject *prj)
+{
+  SCM rc, rpt;
+  int i;
+  GArray *arr;
+
+  /* Get a pointer to null */
+  rc = SCM_EOL;
+  if (!prj)
+    return rc;
+
+  /* Get the project data */
+  arr = gtt_project_get_daily_buckets (prj, TRUE);
+  if (!arr)
+    return rc;
+
+  for (i = 0; i < arr->len; i++)
+    {
+      GttBucket *bu;
+      char buff[100];
+      SCM node;
+      time_t secs;
+
+      bu = &g_array_index (arr, GttBucket, i);
+      secs = bu->total;
 
       /* Skip days for which no time has been spent */
       if (0 == secs)
@@ -796,9 +1183,9 @@ do_ret_daily_totals (GttGhtml *ghtml, GttProject *prj)
 
       rpt = SCM_EOL;
       /* Append the list of tasks and intervals for this day */
-      node = g_list_to_scm (bu->intervals, "gtt-interval-list");
+      node = g_list_to_scm (bu->intervals, GTT_IVL);
       rpt = scm_cons (node, rpt);
-      node = g_list_to_scm (bu->tasks, "gtt-task-list");
+      node = g_list_to_scm (bu->tasks, GTT_TASK);
       rpt = scm_cons (node, rpt);
 
       /* XXX should use time_t, and srfi-19 to print, and have a type label */
@@ -807,11 +1194,10 @@ do_ret_daily_totals (GttGhtml *ghtml, GttProject *prj)
       node = scm_from_locale_string (buff);
       rpt = scm_cons (node, rpt);
 
-      /* XXX report date should be time_t in the middle of the interval */
-      /* Print date */
-      rptdate = mktime (&tday);
-      xxxqof_print_date_buff (buff, 100, rptdate);
-      node = scm_from_locale_string (buff);
+      /* Print date; the bucket starts on its day, even when the
+       * day starts a few hours after midnight. */
+      node = scm_from_locale_string (
+          gtt_date_cache_date_str (ghtml->dates, bu->start));
       rpt = scm_cons (node, rpt);
 
       /* Put a data type in the cdr slot */
@@ -820,7 +1206,7 @@ do_ret_daily_totals (GttGhtml *ghtml, GttProject *prj)
 
       rc = scm_cons (rpt, rc);
     }
-  g_array_free (arr, TRUE);
+  gtt_bucket_array_free (arr);
 
   return rc;
 }
@@ -828,114 +1214,518 @@ do_ret_daily_totals (GttGhtml *ghtml, GttProject *prj)
 static SCM
 ret_daily_totals (SCM proj_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_project (ghtml, proj_list, do_ret_daily_totals);
 }
 
+/* The same buckets, but with times as plain numbers, and all of the
+ * days, in order. */
+static SCM
+do_ret_daily_buckets (GttGhtml *ghtml, GttProject *prj)
+{
+  SCM rc, rpt, node;
+  GArray *arr;
+  int i;
+
+  rc = SCM_EOL;
+  if (!prj)
+    return rc;
+
+  arr = gtt_project_get_daily_buckets (prj, TRUE);
+  if (!arr)
+    return rc;
+
+  for (i = arr->len - 1; i >= 0; i--)
+    {
+      GttBucket *bu = &g_array_index (arr, GttBucket, i);
+
+      rpt = scm_list_5 (scm_from_long (bu->start), scm_from_long (bu->end),
+                        scm_from_long (bu->total),
+                        g_list_to_scm (bu->tasks, GTT_TASK),
+                        g_list_to_scm (bu->intervals, GTT_IVL));
+      node = scm_from_locale_string ("gtt-bucket");
+      rc = scm_cons (scm_cons (rpt, node), rc);
+    }
+  gtt_bucket_array_free (arr);
+
+  return rc;
+}
+
+static SCM
+ret_daily_buckets (SCM proj_list)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  return do_apply_on_project (ghtml, proj_list, do_ret_daily_buckets);
+}
+
 /* ============================================================== */
-/* Define a set of subroutines that accept a scheme list of projects,
- * applies the gtt_project function on each, and then returns a
- * scheme list containing the results.
+/* Totals and values for a set of projects, grouped by period, by
+ * customer or by billing status or rate; see gtt_queries.h.  From
+ * scheme, this is
  *
- * For example, ret_project_title() takes a scheme list of gtt
- * projects, gets the project title for each, and then returns
- * a scheme list of the project titles.
+ *    (gtt-aggregate projects 'month start end include-subprojects)
+ *
+ * where the start, end and flag are optional; the subprojects are
+ * included unless the flag is #f.  Each record is
+ *
+ *    ((key start end total billable value) . "gtt-aggregate")
+ *
+ * The key is the start of the period, the customer id, or the
+ * translated name of the bill status or rate.
  */
 
-#define RET_PROJECT_SIMPLE(RET_FUNC, DO_SIMPLE)                               \
-  static SCM RET_FUNC (SCM proj_list)                                         \
-  {                                                                           \
-    GttGhtml *ghtml = ghtml_guile_global_hack;                                \
-    return do_apply_on_project (ghtml, proj_list, DO_SIMPLE);                 \
-  }
+static const char *billstatus_str (GttBillStatus);
+static const char *billrate_str (GttBillRate);
 
-#define RET_PROJECT_STR(RET_FUNC, GTT_GETTER)                                 \
-  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttProject *prj)              \
-  {                                                                           \
-    const char *str = GTT_GETTER (prj);                                       \
-    if (NULL == str)                                                          \
-      return SCM_EOL;                                                         \
-    return scm_from_locale_string (str);                                      \
-  }                                                                           \
-  RET_PROJECT_SIMPLE (RET_FUNC, GTT_GETTER##_scm)
+static SCM
+get_project_handle_scm (GttGhtml *ghtml, GttProject *prj)
+{
+  return handle_new (GTT_PRJ, prj);
+}
 
-#define RET_PROJECT_LONG(RET_FUNC, GTT_GETTER)                                \
-  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttProject *prj)              \
-  {                                                                           \
-    long i = GTT_GETTER (prj);                                                \
-    return scm_from_long (i);                                                 \
-  }                                                                           \
-  RET_PROJECT_SIMPLE (RET_FUNC, GTT_GETTER##_scm)
+static GList *
+collect_projects (SCM node, GList *prjs)
+{
+  if (IS_HANDLE (node))
+    return g_list_prepend (prjs, HANDLE_PTR (node));
 
-#define RET_PROJECT_ULONG(RET_FUNC, GTT_GETTER)                               \
-  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttProject *prj)              \
-  {                                                                           \
-    unsigned long i = GTT_GETTER (prj);                                       \
-    return scm_from_ulong (i);                                                \
-  }                                                                           \
-  RET_PROJECT_SIMPLE (RET_FUNC, GTT_GETTER##_scm)
+  for (; scm_is_pair (node); node = SCM_CDR (node))
+    prjs = collect_projects (SCM_CAR (node), prjs);
+  return prjs;
+}
 
-RET_PROJECT_STR (ret_project_title, gtt_project_get_title)
-RET_PROJECT_STR (ret_project_desc, gtt_project_get_desc)
-RET_PROJECT_STR (ret_project_notes, gtt_project_get_notes)
-RET_PROJECT_ULONG (ret_project_est_start, gtt_project_get_estimated_start)
-RET_PROJECT_ULONG (ret_project_est_end, gtt_project_get_estimated_end)
-RET_PROJECT_ULONG (ret_project_due_date, gtt_project_get_due_date)
+static gboolean
+parse_group_by (SCM group, GttGroupBy *by)
+{
+  static const struct
+  {
+    const char *name;
+    GttGroupBy by;
+  } groups[] = {
+    { "total", GTT_GROUP_TOTAL },   { "week", GTT_GROUP_WEEK },
+    { "month", GTT_GROUP_MONTH },   { "year", GTT_GROUP_YEAR },
+    { "custid", GTT_GROUP_CUSTID }, { "billstatus", GTT_GROUP_BILLSTATUS },
+    { "billrate", GTT_GROUP_BILLRATE },
+  };
+  char *name;
+  guint i;
 
-RET_PROJECT_LONG (ret_project_sizing, gtt_project_get_sizing)
-RET_PROJECT_LONG (ret_project_percent, gtt_project_get_percent_complete)
+  if (scm_is_symbol (group))
+    group = scm_symbol_to_string (group);
+  if (!scm_is_string (group))
+    return FALSE;
+
+  name = scm_to_locale_string (group);
+  for (i = 0; i < G_N_ELEMENTS (groups); i++)
+    {
+      if (!strcmp (name, groups[i].name))
+        {
+          *by = groups[i].by;
+          free (name);
+          return TRUE;
+        }
+    }
+  free (name);
+  return FALSE;
+}
 
-/* ============================================================== */
-/* Handle ret_project_title_link in the almost-standard way,
- * i.e. as
- * RET_PROJECT_STR (ret_project_title, gtt_project_get_title)
- * except that we need to handle url links as well.
- */
 static SCM
-get_project_title_link_scm (GttGhtml *ghtml, GttProject *prj)
+ret_aggregate (SCM proj_list, SCM group, SCM start, SCM end, SCM subprjs)
 {
-  if (ghtml->show_links)
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  GttGroupBy by;
+  GList *prjs;
+  GArray *arr;
+  SCM rc, key, rpt;
+  int i;
+
+  if (!parse_group_by (group, &by))
     {
-      GString *str;
-      str = g_string_new (NULL);
-      g_string_append_printf (str, "<a href=\"gtt:proj:0x%lx\">", (long)prj);
-      g_string_append (str, gtt_project_get_title (prj));
-      g_string_append (str, "</a>");
-      return scm_from_locale_string (str->str);
+      g_warning ("gtt-aggregate: unknown grouping\n");
+      return SCM_EOL;
     }
-  else
+
+  prjs = collect_projects (
+      do_apply_on_project (ghtml, proj_list, get_project_handle_scm), NULL);
+  prjs = g_list_reverse (prjs);
+
+  arr = gtt_projects_aggregate (
+      prjs, SCM_UNBNDP (subprjs) || scm_is_true (subprjs), by,
+      (SCM_UNBNDP (start) || !scm_is_number (start)) ? 0 : scm_to_long (start),
+      (SCM_UNBNDP (end) || !scm_is_number (end)) ? 0 : scm_to_long (end));
+  g_list_free (prjs);
+
+  rc = SCM_EOL;
+  for (i = arr->len - 1; i >= 0; i--)
     {
-      const char *str = gtt_project_get_title (prj);
-      return scm_from_locale_string (str);
+      GttAggregate *ag = &g_array_index (arr, GttAggregate, i);
+
+      switch (by)
+        {
+        case GTT_GROUP_CUSTID:
+          key = scm_from_locale_string (ag->custid ? ag->custid : "");
+          break;
+        case GTT_GROUP_BILLSTATUS:
+          key = scm_from_locale_string (billstatus_str (ag->key));
+          break;
+        case GTT_GROUP_BILLRATE:
+          key = scm_from_locale_string (billrate_str (ag->key));
+          break;
+        case GTT_GROUP_TOTAL:
+          key = SCM_BOOL_F;
+          break;
+        default:
+          key = scm_from_long (ag->start);
+          break;
+        }
+      rpt = scm_list_n (key, scm_from_long (ag->start),
+                        scm_from_long (ag->end), scm_from_long (ag->total),
+                        scm_from_long (ag->billable),
+                        scm_from_double (ag->value), SCM_UNDEFINED);
+      rc = scm_cons (scm_cons (rpt, scm_from_locale_string ("gtt-aggregate")),
+                     rc);
     }
+  g_array_free (arr, TRUE);
+  return rc;
 }
 
-RET_PROJECT_SIMPLE (ret_project_title_link, get_project_title_link_scm)
-
 /* ============================================================== */
+/* The invoice for a set of projects; see gtt_invoice.h.  From scheme,
+ *
+ *    (gtt-invoice projects start end include-subprojects)
+ *
+ * where the start, end and flag are optional, as for gtt-aggregate.
+ * The result is
+ *
+ *    ((lines subtotals rate-totals total) . "gtt-invoice")
+ *
+ * The lines are three lists, of the line items on hold, to bill and
+ * paid, each item being
+ *
+ *    ((task billstatus billrate secs billed-secs value billed-value)
+ *     . "gtt-invoice-line")
+ *
+ * The subtotals are by bill status (hold, bill, paid), and the rate
+ * totals by bill rate (regular, overtime, overover, flat fee), each
+ *
+ *    ((key secs billed-secs amount) . "gtt-invoice-total")
+ *
+ * The gtt-currency-str and gtt-hours-str routines print the amounts
+ * and times the same way the task getters do.
+ */
 
-static const char *
-get_urgency (GttProject *prj)
+static SCM
+invoice_total_scm (const char *key, GttInvoiceTotal *tot)
 {
-  GttRank rank = gtt_project_get_urgency (prj);
-  switch (rank)
+  SCM rpt = scm_list_4 (scm_from_locale_string (key),
+                        scm_from_long (tot->secs),
+                        scm_from_long (tot->billed_secs),
+                        scm_from_double (tot->amount));
+  return scm_cons (rpt, scm_from_locale_string ("gtt-invoice-total"));
+}
+
+static SCM
+invoice_line_scm (GttInvoiceLine *line)
+{
+  SCM rpt = scm_list_n (handle_new (GTT_TASK, line->task),
+                        scm_from_locale_string (
+                            billstatus_str (line->billstatus)),
+                        scm_from_locale_string (billrate_str (line->billrate)),
+                        scm_from_long (line->secs),
+                        scm_from_long (line->billed_secs),
+                        scm_from_double (line->value),
+                        scm_from_double (line->billed_value), SCM_UNDEFINED);
+  return scm_cons (rpt, scm_from_locale_string ("gtt-invoice-line"));
+}
+
+static SCM
+ret_invoice (SCM proj_list, SCM start, SCM end, SCM subprjs)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  GttInvoice *inv;
+  GList *prjs;
+  SCM lines[GTT_PAID + 1], subtotals, rate_totals, rpt;
+  int i;
+
+  prjs = collect_projects (
+      do_apply_on_project (ghtml, proj_list, get_project_handle_scm), NULL);
+  prjs = g_list_reverse (prjs);
+
+  inv = gtt_invoice_new (
+      prjs, SCM_UNBNDP (subprjs) || scm_is_true (subprjs),
+      (SCM_UNBNDP (start) || !scm_is_number (start)) ? 0 : scm_to_long (start),
+      (SCM_UNBNDP (end) || !scm_is_number (end)) ? 0 : scm_to_long (end));
+  g_list_free (prjs);
+
+  for (i = 0; i <= GTT_PAID; i++)
+    lines[i] = SCM_EOL;
+  for (i = inv->lines->len - 1; i >= 0; i--)
     {
-    case GTT_LOW:
-      return _ ("Low");
-    case GTT_MEDIUM:
-      return _ ("Normal");
-    case GTT_HIGH:
-      return _ ("Urgent");
-    case GTT_UNDEFINED:
-      return _ ("Undefined");
+      GttInvoiceLine *line = &g_array_index (inv->lines, GttInvoiceLine, i);
+      if (line->billstatus <= GTT_PAID)
+        lines[line->billstatus]
+            = scm_cons (invoice_line_scm (line), lines[line->billstatus]);
     }
-  return _ ("Undefined");
+
+  subtotals = SCM_EOL;
+  for (i = GTT_PAID; i >= 0; i--)
+    subtotals = scm_cons (invoice_total_scm (billstatus_str (i),
+                                             &inv->subtotal[i]),
+                          subtotals);
+  rate_totals = SCM_EOL;
+  for (i = GTT_FLAT_FEE; i >= 0; i--)
+    rate_totals = scm_cons (invoice_total_scm (billrate_str (i),
+                                               &inv->rate_total[i]),
+                            rate_totals);
+
+  rpt = scm_list_4 (scm_list_3 (lines[GTT_HOLD], lines[GTT_BILL],
+                                lines[GTT_PAID]),
+                    subtotals, rate_totals,
+                    invoice_total_scm ("", &inv->total));
+  gtt_invoice_free (inv);
+  return scm_cons (rpt, scm_from_locale_string ("gtt-invoice"));
 }
 
-static const char *
-get_importance (GttProject *prj)
+static SCM
+ret_currency_str (SCM value)
 {
-  GttRank rank = gtt_project_get_importance (prj);
+  if (!scm_is_number (value))
+    return SCM_EOL;
+  return currency_scm (scm_to_double (value));
+}
+
+static SCM
+ret_hours_str (SCM secs)
+{
+  char buff[100];
+
+  if (!scm_is_number (secs))
+    return SCM_EOL;
+  xxxqof_print_hours_elapsed_buff (buff, 100, scm_to_long (secs), TRUE);
+  return scm_from_locale_string (buff);
+}
+
+/* ============================================================== */
+/* Return the open work, sorted */
+
+static gboolean
+parse_order (SCM order, GttProjectOrder *out)
+{
+  static const char *orders[] = { "due", "importance", "urgency", "status" };
+  char *name;
+  guint i;
+
+  if (scm_is_symbol (order))
+    order = scm_symbol_to_string (order);
+  if (!scm_is_string (order))
+    return FALSE;
+
+  name = scm_to_locale_string (order);
+  for (i = 0; i < G_N_ELEMENTS (orders); i++)
+    {
+      if (!strcmp (name, orders[i]))
+        {
+          *out = i;
+          free (name);
+          return TRUE;
+        }
+    }
+  free (name);
+  return FALSE;
+}
+
+static SCM
+ret_unfinished_projects (SCM order, SCM proj_list)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  GttProjectList *plist = ghtml->plist ? ghtml->plist : master_list;
+  GttProjectOrder by;
+  GList *prjs, *node, *list = NULL;
+  SCM rc;
+
+  if (!parse_order (order, &by))
+    {
+      g_warning ("gtt-unfinished-projects: unknown order\n");
+      return SCM_EOL;
+    }
+
+  /* Everything, unless some projects are asked for */
+  if (SCM_UNBNDP (proj_list))
+    {
+      ghtml->deps.wide = TRUE;
+      list = gtt_project_list_get_unfinished (plist, NULL, by);
+    }
+  else
+    {
+      prjs = collect_projects (
+          do_apply_on_project (ghtml, proj_list, get_project_handle_scm),
+          NULL);
+      prjs = g_list_reverse (prjs);
+      for (node = prjs; node; node = node->next)
+        list = g_list_concat (
+            list, gtt_project_list_get_unfinished (plist, node->data, by));
+      g_list_free (prjs);
+    }
+
+  rc = g_list_to_handles (list, GTT_PRJ);
+  g_list_free (list);
+  return rc;
+}
+
+/* ============================================================== */
+/* Return the intervals that overlap a range of time */
+
+static int
+collect_interval (GttInterval *ivl, gpointer data)
+{
+  GList **list = data;
+  *list = g_list_prepend (*list, ivl);
+  return 1;
+}
+
+static SCM
+ret_intervals_between (SCM start, SCM end, SCM proj_list)
+{
+  GttGhtml *ghtml = gtt_ghtml_current ();
+  GList *prjs, *node, *list = NULL;
+  time_t from, to;
+  SCM rc;
+
+  if (!scm_is_number (start) || !scm_is_number (end))
+    return SCM_EOL;
+  from = scm_to_long (start);
+  to = scm_to_long (end);
+
+  /* All of the projects, unless some are asked for */
+  if (SCM_UNBNDP (proj_list))
+    {
+      ghtml->deps.wide = TRUE;
+      gtt_project_list_foreach_interval_in_range (
+          ghtml->plist ? ghtml->plist : master_list, from, to,
+          collect_interval, &list);
+    }
+  else
+    {
+      prjs = collect_projects (
+          do_apply_on_project (ghtml, proj_list, get_project_handle_scm),
+          NULL);
+      prjs = g_list_reverse (prjs);
+      for (node = prjs; node; node = node->next)
+        gtt_project_foreach_subproject_interval_in_range (
+            node->data, from, to, collect_interval, &list);
+      g_list_free (prjs);
+    }
+
+  list = g_list_reverse (list);
+  rc = g_list_to_handles (list, GTT_IVL);
+  g_list_free (list);
+  return rc;
+}
+
+/* ============================================================== */
+/* Define a set of subroutines that accept a scheme list of projects,
+ * applies the gtt_project function on each, and then returns a
+ * scheme list containing the results.
+ *
+ * For example, ret_project_title() takes a scheme list of gtt
+ * projects, gets the project title for each, and then returns
+ * a scheme list of the project titles.
+ */
+
+#define RET_PROJECT_SIMPLE(RET_FUNC, DO_SIMPLE)                               \
+  static SCM RET_FUNC (SCM proj_list)                                         \
+  {                                                                           \
+    GttGhtml *ghtml = gtt_ghtml_current ();                                   \
+    return do_apply_on_project (ghtml, proj_list, DO_SIMPLE);                 \
+  }
+
+#define RET_PROJECT_STR(RET_FUNC, GTT_GETTER)                                 \
+  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttProject *prj)              \
+  {                                                                           \
+    const char *str = GTT_GETTER (prj);                                       \
+    if (NULL == str)                                                          \
+      return SCM_EOL;                                                         \
+    return scm_from_locale_string (str);                                      \
+  }                                                                           \
+  RET_PROJECT_SIMPLE (RET_FUNC, GTT_GETTER##_scm)
+
+#define RET_PROJECT_LONG(RET_FUNC, GTT_GETTER)                                \
+  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttProject *prj)              \
+  {                                                                           \
+    long i = GTT_GETTER (prj);                                                \
+    return scm_from_long (i);                                                 \
+  }                                                                           \
+  RET_PROJECT_SIMPLE (RET_FUNC, GTT_GETTER##_scm)
+
+#define RET_PROJECT_ULONG(RET_FUNC, GTT_GETTER)                               \
+  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttProject *prj)              \
+  {                                                                           \
+    unsigned long i = GTT_GETTER (prj);                                       \
+    return scm_from_ulong (i);                                                \
+  }                                                                           \
+  RET_PROJECT_SIMPLE (RET_FUNC, GTT_GETTER##_scm)
+
+RET_PROJECT_STR (ret_project_title, gtt_project_get_title)
+RET_PROJECT_STR (ret_project_desc, gtt_project_get_desc)
+RET_PROJECT_STR (ret_project_notes, gtt_project_get_notes)
+RET_PROJECT_ULONG (ret_project_est_start, gtt_project_get_estimated_start)
+RET_PROJECT_ULONG (ret_project_est_end, gtt_project_get_estimated_end)
+RET_PROJECT_ULONG (ret_project_due_date, gtt_project_get_due_date)
+
+RET_PROJECT_LONG (ret_project_sizing, gtt_project_get_sizing)
+RET_PROJECT_LONG (ret_project_percent, gtt_project_get_percent_complete)
+
+/* ============================================================== */
+/* Handle ret_project_title_link in the almost-standard way,
+ * i.e. as
+ * RET_PROJECT_STR (ret_project_title, gtt_project_get_title)
+ * except that we need to handle url links as well.
+ */
+static SCM
+get_project_title_link_scm (GttGhtml *ghtml, GttProject *prj)
+{
+  if (ghtml->show_links)
+    {
+      GString *str;
+      str = g_string_new (NULL);
+      g_string_append_printf (str, "<a href=\"gtt:proj:0x%lx\">", (long)prj);
+      g_string_append (str, gtt_project_get_title (prj));
+      g_string_append (str, "</a>");
+      return scm_from_locale_string (str->str);
+    }
+  else
+    {
+      const char *str = gtt_project_get_title (prj);
+      return scm_from_locale_string (str);
+    }
+}
+
+RET_PROJECT_SIMPLE (ret_project_title_link, get_project_title_link_scm)
+
+/* ============================================================== */
+
+static const char *
+get_urgency (GttProject *prj)
+{
+  GttRank rank = gtt_project_get_urgency (prj);
+  switch (rank)
+    {
+    case GTT_LOW:
+      return _ ("Low");
+    case GTT_MEDIUM:
+      return _ ("Normal");
+    case GTT_HIGH:
+      return _ ("Urgent");
+    case GTT_UNDEFINED:
+      return _ ("Undefined");
+    }
+  return _ ("Undefined");
+}
+
+static const char *
+get_importance (GttProject *prj)
+{
+  GttRank rank = gtt_project_get_importance (prj);
   switch (rank)
     {
     case GTT_LOW:
@@ -989,7 +1779,7 @@ RET_PROJECT_STR (ret_project_status, get_status)
 #define RET_TASK_SIMPLE(RET_FUNC, GTT_GETTER)                                 \
   static SCM RET_FUNC (SCM task_list)                                         \
   {                                                                           \
-    GttGhtml *ghtml = ghtml_guile_global_hack;                                \
+    GttGhtml *ghtml = gtt_ghtml_current ();                                   \
     return do_apply_on_task (ghtml, task_list, GTT_GETTER##_scm);             \
   }
 
@@ -1002,7 +1792,7 @@ RET_PROJECT_STR (ret_project_status, get_status)
                                                                               \
   static SCM RET_FUNC (SCM task_list)                                         \
   {                                                                           \
-    GttGhtml *ghtml = ghtml_guile_global_hack;                                \
+    GttGhtml *ghtml = gtt_ghtml_current ();                                   \
     return do_apply_on_task (ghtml, task_list, GTT_GETTER##_scm);             \
   }
 
@@ -1036,7 +1826,7 @@ get_task_memo_scm (GttGhtml *ghtml, GttTask *tsk)
 static SCM
 ret_task_memo (SCM task_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_task (ghtml, task_list, get_task_memo_scm);
 }
 
@@ -1054,16 +1844,16 @@ get_task_parent_scm (GttGhtml *ghtml, GttTask *tsk)
 static SCM
 ret_task_parent (SCM task_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   return do_apply_on_task (ghtml, task_list, get_task_parent_scm);
 }
 
 /* ============================================================== */
 
 static const char *
-task_get_billstatus (GttTask *tsk)
+billstatus_str (GttBillStatus status)
 {
-  switch (gtt_task_get_billstatus (tsk))
+  switch (status)
     {
     case GTT_HOLD:
       return _ ("Hold");
@@ -1095,9 +1885,9 @@ task_get_billable (GttTask *tsk)
 };
 
 static const char *
-task_get_billrate (GttTask *tsk)
+billrate_str (GttBillRate rate)
 {
-  switch (gtt_task_get_billrate (tsk))
+  switch (rate)
     {
     case GTT_REGULAR:
       return _ ("Regular");
@@ -1113,6 +1903,18 @@ task_get_billrate (GttTask *tsk)
   return "";
 };
 
+static const char *
+task_get_billstatus (GttTask *tsk)
+{
+  return billstatus_str (gtt_task_get_billstatus (tsk));
+}
+
+static const char *
+task_get_billrate (GttTask *tsk)
+{
+  return billrate_str (gtt_task_get_billrate (tsk));
+}
+
 static SCM
 task_get_time_str_scm (GttGhtml *ghtml, GttTask *tsk)
 {
@@ -1127,470 +1929,908 @@ task_get_time_str_scm (GttGhtml *ghtml, GttTask *tsk)
 static SCM
 task_get_blocktime_str_scm (GttGhtml *ghtml, GttTask *tsk)
 {
-  time_t task_secs;
+  GttInvoiceLine line;
+  char buff[100];
+
+  gtt_invoice_task_line (tsk, &line);
+  xxxqof_print_hours_elapsed_buff (buff, 100, line.billed_secs, TRUE);
+  return scm_from_locale_string (buff);
+}
+
+static SCM
+task_get_earliest_str_scm (GttGhtml *ghtml, GttTask *tsk)
+{
+  char buff[100];
+
+  time_t task_date = gtt_task_get_secs_earliest (tsk);
+  // size_t len;
+
+  if (task_date > 0)
+    {
+      gtt_date_cache_date_time_buff (ghtml->dates, buff, 100, task_date);
+    }
+  else
+    {
+      // len = g_snprintf(buff, 100, "%s", _("No activity"));
+      g_snprintf (buff, 100, "%s", _ ("No activity"));
+    }
+  return scm_from_locale_string (buff);
+}
+
+static SCM
+task_get_latest_str_scm (GttGhtml *ghtml, GttTask *tsk)
+{
+  char buff[100];
+
+  time_t task_date = gtt_task_get_secs_latest (tsk);
+  // size_t len;
+
+  if (task_date > 0)
+    {
+      gtt_date_cache_date_time_buff (ghtml->dates, buff, 100, task_date);
+    }
+  else
+    {
+      // len = g_snprintf(buff, 100, "%s", _("No activity"));
+      g_snprintf (buff, 100, "%s", _ ("No activity"));
+    }
+  return scm_from_locale_string (buff);
+}
+
+/* Print an amount of money, as the preferences say to */
+static void
+currency_buff (char *buff, size_t len, double value)
+{
+  if (!config_currency_use_locale)
+    {
+      setlocale (LC_MONETARY, "C");
+      setlocale (LC_NUMERIC, "C");
+      snprintf (buff, len, "%s %.2f", config_currency_symbol, value + 0.0049);
+    }
+  else
+    {
+      setlocale (LC_ALL, "");
+      strfmon (buff, len, "%n", value);
+    }
+}
+
+static SCM
+currency_scm (double value)
+{
   char buff[100];
-  int bill_unit;
-  time_t value;
 
-  task_secs = gtt_task_get_secs_ever (tsk);
-  bill_unit = gtt_task_get_bill_unit (tsk);
+  currency_buff (buff, 100, value);
+  return scm_from_locale_string (buff);
+}
+
+static SCM
+task_get_value_str_scm (GttGhtml *ghtml, GttTask *tsk)
+{
+  GttInvoiceLine line;
+
+  gtt_invoice_task_line (tsk, &line);
+  return currency_scm (line.value);
+}
+
+static SCM
+task_get_blockvalue_str_scm (GttGhtml *ghtml, GttTask *tsk)
+{
+  GttInvoiceLine line;
+
+  gtt_invoice_task_line (tsk, &line);
+  return currency_scm (line.billed_value);
+}
+
+RET_TASK_STR (ret_task_billstatus, task_get_billstatus)
+RET_TASK_STR (ret_task_billable, task_get_billable)
+RET_TASK_STR (ret_task_billrate, task_get_billrate)
+RET_TASK_SIMPLE (ret_task_time_str, task_get_time_str)
+RET_TASK_SIMPLE (ret_task_blocktime_str, task_get_blocktime_str)
+RET_TASK_SIMPLE (ret_task_earliest_str, task_get_earliest_str)
+RET_TASK_SIMPLE (ret_task_latest_str, task_get_latest_str)
+RET_TASK_SIMPLE (ret_task_value_str, task_get_value_str)
+RET_TASK_SIMPLE (ret_task_blockvalue_str, task_get_blockvalue_str)
+
+/* ============================================================== */
+
+#define RET_IVL_SIMPLE(RET_FUNC, GTT_GETTER)                                  \
+  static SCM RET_FUNC (SCM ivl_list)                                          \
+  {                                                                           \
+    GttGhtml *ghtml = gtt_ghtml_current ();                                   \
+    return do_apply_on_interval (ghtml, ivl_list, GTT_GETTER##_scm);          \
+  }
+
+#define RET_IVL_STR(RET_FUNC, GTT_GETTER)                                     \
+  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttInterval *ivl)             \
+  {                                                                           \
+    const char *str = GTT_GETTER (ivl);                                       \
+    return scm_from_locale_string (str);                                      \
+  }                                                                           \
+  RET_IVL_SIMPLE (RET_FUNC, GTT_GETTER)
+
+#define RET_IVL_ULONG(RET_FUNC, GTT_GETTER)                                   \
+  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttInterval *ivl)             \
+  {                                                                           \
+    unsigned long i = GTT_GETTER (ivl);                                       \
+    return scm_from_ulong (i);                                                \
+  }                                                                           \
+  RET_IVL_SIMPLE (RET_FUNC, GTT_GETTER)
+
+RET_IVL_ULONG (ret_ivl_start, gtt_interval_get_start)
+RET_IVL_ULONG (ret_ivl_stop, gtt_interval_get_stop)
+RET_IVL_ULONG (ret_ivl_fuzz, gtt_interval_get_fuzz)
+
+static SCM
+get_ivl_elapsed_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  char buff[100];
+  time_t elapsed;
+  elapsed = gtt_interval_get_stop (ivl);
+  elapsed -= gtt_interval_get_start (ivl);
+  xxxqof_print_hours_elapsed_buff (buff, 100, elapsed, TRUE);
+  return scm_from_locale_string (buff);
+}
+
+RET_IVL_SIMPLE (ret_ivl_elapsed_str, get_ivl_elapsed_str);
+
+/* The dates and times come out of the render's date cache, so a
+ * journal with thousands of intervals on a few dozen days does a few
+ * dozen localtime()s, not thousands. */
+static SCM
+get_ivl_start_stop_common_str_scm (GttGhtml *ghtml, GttInterval *ivl,
+                                   time_t starp, gboolean prt_date)
+{
+  char buff[100], link[200];
+  const char *str;
+
+  if (prt_date)
+    {
+      str = gtt_date_cache_date_str (ghtml->dates, starp);
+    }
+  else
+    {
+      gtt_date_cache_time_buff (ghtml->dates, buff, 100, starp);
+      str = buff;
+    }
+
+  if (!ghtml->show_links)
+    return scm_from_locale_string (str);
+
+  g_snprintf (link, sizeof (link), "<a href=\"gtt:interval:0x%lx\">%s</a>",
+              (long)ivl, str);
+  return scm_from_locale_string (link);
+}
+
+static SCM
+get_ivl_same_day_start_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  gboolean prt_date = TRUE;
+  time_t start, prev_stop;
+
+  /* Caution! use of the last_ivl_time thing makes this
+   * stateful in a way that may be surprising !
+   */
+  start = gtt_interval_get_start (ivl);
+  prev_stop = ghtml->last_ivl_time;
+  ghtml->last_ivl_time = start;
+
+  if (0 != prev_stop)
+    {
+      prt_date = !gtt_date_cache_same_day (ghtml->dates, start, prev_stop);
+    }
+  return scm_from_bool (prt_date);
+}
+RET_IVL_SIMPLE (ret_ivl_same_day_start, get_ivl_same_day_start);
+
+static SCM
+get_ivl_same_day_stop_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  gboolean prt_date = TRUE;
+  time_t stop, prev_start;
+
+  /* Caution! use of the last_ivl_time thing makes this
+   * stateful in a way that may be surprising !
+   */
+  stop = gtt_interval_get_stop (ivl);
+  prev_start = ghtml->last_ivl_time;
+  ghtml->last_ivl_time = stop;
+  if (0 != prev_start)
+    {
+      prt_date = !gtt_date_cache_same_day (ghtml->dates, prev_start, stop);
+    }
+  return scm_from_bool (prt_date);
+}
+RET_IVL_SIMPLE (ret_ivl_same_day_stop, get_ivl_same_day_stop);
+
+static SCM
+get_ivl_start_date_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  time_t start = gtt_interval_get_start (ivl);
+  return get_ivl_start_stop_common_str_scm (ghtml, ivl, start, 1);
+}
+RET_IVL_SIMPLE (ret_ivl_start_date_str, get_ivl_start_date_str);
+
+static SCM
+get_ivl_start_time_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  time_t start = gtt_interval_get_start (ivl);
+  return get_ivl_start_stop_common_str_scm (ghtml, ivl, start, 0);
+}
+RET_IVL_SIMPLE (ret_ivl_start_time_str, get_ivl_start_time_str);
+
+static SCM
+get_ivl_stop_date_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  time_t stop = gtt_interval_get_stop (ivl);
+  return get_ivl_start_stop_common_str_scm (ghtml, ivl, stop, 1);
+}
+RET_IVL_SIMPLE (ret_ivl_stop_date_str, get_ivl_stop_date_str);
+
+static SCM
+get_ivl_stop_time_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  time_t stop = gtt_interval_get_stop (ivl);
+  return get_ivl_start_stop_common_str_scm (ghtml, ivl, stop, 0);
+}
+RET_IVL_SIMPLE (ret_ivl_stop_time_str, get_ivl_stop_time_str);
+
+static SCM
+get_ivl_fuzz_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+{
+  char buff[100];
+
+  xxxqof_print_hours_elapsed_buff (buff, 100, gtt_interval_get_fuzz (ivl),
+                                   TRUE);
+  return scm_from_locale_string (buff);
+}
+RET_IVL_SIMPLE (ret_ivl_fuzz_str, get_ivl_fuzz_str);
+
+/* ============================================================== */
+
+/* Both handlers are handed a pointer to the caller's SCM, which
+ * holds the stack between the two.  It lives on the caller's C stack,
+ * where the garbage collector will see it. */
+
+static SCM
+my_preunwind_handler (void *data, SCM tag, SCM throw_args)
+{
+  // We can only record the stack before it is unwound.
+  // The normal catch handler body runs only *after* the stack
+  // has been unwound.
+  *(SCM *)data = scm_make_stack (SCM_BOOL_T, SCM_EOL);
+  return SCM_EOL;
+}
+
+static SCM
+my_catch_handler (void *data, SCM tag, SCM throw_args)
+{
+  SCM captured_stack = *(SCM *)data;
+
+  printf ("Error: GnoTime caught an error during scheme parse\n");
+
+  /* create string port into which we write the error message and
+     stack. */
+  SCM port = scm_current_output_port ();
+  /* throw args seem to be: (FN FORMAT ARGS #f). split the pieces into
+     local vars. */
+  if (scm_is_true (scm_list_p (throw_args)) && (scm_ilength (throw_args) >= 1))
+    {
+      long nargs = scm_ilength (throw_args);
+      SCM fn = scm_car (throw_args);
+      SCM format = SCM_EOL;
+      if (nargs >= 2)
+        format = scm_cadr (throw_args);
+
+      SCM parts = SCM_EOL;
+      if (nargs >= 3)
+        parts = scm_caddr (throw_args);
+
+      SCM rest = SCM_EOL;
+      if (nargs >= 4)
+        rest = scm_car (scm_cdddr (throw_args));
+
+#if OLD_GUILE_18_STUFF
+      /* This is some old code that mostly(?) worked under guile-1.8,
+       * but uses a deprecated API's.  The new guile code below is
+       * better, and it works with guile-2.0 */
+      if (fn != SCM_BOOL_F)
+        { /* display the function name and tag */
+          scm_puts ("Function: ", port);
+          scm_display (fn, port);
+          scm_puts (", ", port);
+          scm_display (tag, port);
+          scm_newline (port);
+        }
+
+      if (scm_string_p (format))
+        { /* conditionally display the error message using format */
+          scm_puts ("Error: ", port);
+          scm_display_error_message (format, parts, port);
+        }
+      if (rest != SCM_EOL)
+        {
+          scm_puts ("Other Data: ", port);
+          scm_display (rest, port);
+          scm_newline (port);
+          scm_newline (port);
+        }
+    }
+
+  /* find the stack, and conditionally display it */
+  SCM the_stack = scm_fluid_ref (SCM_CDR (scm_the_last_stack_fluid_var));
+  if (the_stack != SCM_BOOL_F)
+    {
+      scm_display_backtrace (the_stack, port, SCM_UNDEFINED, SCM_UNDEFINED);
+    }
+
+  return SCM_EOL;
+#else /* OLD_GUILE_18_STUFF */
+      if (scm_is_true (captured_stack))
+        {
+          SCM highlights;
+
+          if (scm_is_eq (tag, scm_arg_type_key)
+              || scm_is_eq (tag, scm_out_of_range_key))
+            highlights = rest;
+          else
+            highlights = SCM_EOL;
+
+          scm_puts ("Backtrace:\n", port);
+          scm_display_backtrace_with_highlights (
+              captured_stack, port, SCM_BOOL_F, SCM_BOOL_F, highlights);
+          scm_newline (port);
+        }
+      scm_display_error (captured_stack, port, fn, format, parts, rest);
+    }
+  else
+    {
+      scm_puts ("ERROR: throw args are unexpectedly short!\n", port);
+    }
+  scm_puts ("ABORT: ", port);
+  SCM re = scm_symbol_to_string (tag);
+  char *restr = scm_to_locale_string (re);
+  scm_puts (restr, port);
+  free (restr);
+
+  return SCM_BOOL_F;
+#endif
+}
+
+/* ============================================================== */
+/* Templates are parsed once, into a list of segments: spans of
+ * literal text to be copied to the output, and blocks of scheme code
+ * to be evaluated.  The scheme code is read in at the same time.
+ * Blocks that only compute and show things are wrapped up into a
+ * thunk, and so are fully expanded only once.  That is done when the
+ * block is first shown, not when it's read, so that the blocks before
+ * it have run, and any syntax they define or import is in place by
+ * the time the block gets expanded.  Blocks that define things at
+ * the top level can't be wrapped (the defines would become local to
+ * the thunk), so those are kept as a list of forms, and evaluated one
+ * at a time.  Code that can't even be read is kept as a string, so
+ * that the error gets reported when the template is shown.
+ *
+ * Parsed templates are cached by path, and re-parsed if the file's
+ * modification time or size changes.
+ *
+ * Each report is evaluated in a module of its own, which sees all
+ * that gtt.scm and the gtt-* procedures define, so that the top-level
+ * variables of one report don't trample those of another being shown
+ * on another thread.  The modules are pooled: a report takes one that
+ * no other report is using, or makes a new one, and gives it back
+ * when it's done; so there are only ever as many as there have been
+ * reports shown at once.  An included template is part of the report
+ * that includes it, and is evaluated in the same module.  A thunk
+ * belongs to the module that it was made in, so each segment keeps
+ * one per module.  Only looking up and adding thunks is done under a
+ * lock; expanding and evaluating the code isn't.
+ */
+
+typedef enum
+{
+  GHTML_SEG_TEXT,
+  GHTML_SEG_SCM
+} GhtmlSegType;
+
+typedef struct
+{
+  GhtmlSegType type;
+  const char *text; /* literal text, or the scheme source */
+  size_t len;
+  SCM forms; /* list of forms to eval, or SCM_BOOL_F */
+  gboolean wrap; /* the forms can be made into a thunk */
+  GHashTable *thunks; /* module -> thunk, or SCM_BOOL_F if it failed */
+} GhtmlSegment;
+
+typedef struct
+{
+  int refcount;
+  char *path;
+  time_t mtime;
+  off_t size;
+  char *buf; /* the file contents; segments point into this */
+  GArray *segs;
+} GhtmlTemplate;
+
+/* The cache, and the template reference counts, are shared by all
+ * of the rendering threads. */
+static GHashTable *template_cache = NULL;
+static GMutex template_cache_mutex;
+
+/* The module that gtt.scm was loaded into */
+static SCM gtt_module = SCM_BOOL_F;
 
-  value = (time_t) (lround (((double)task_secs) / bill_unit) * bill_unit);
+/* The modules that aren't being used by any report right now */
+static GSList *free_modules = NULL;
+static GMutex free_modules_mutex;
 
-  xxxqof_print_hours_elapsed_buff (buff, 100, value, TRUE);
-  // return scm_mem2string (buff, strlen (buff));
-  return scm_from_locale_string (buff);
+/* Guards the segments' thunk tables */
+static GMutex thunk_mutex;
+
+static void
+unprotect_thunk (gpointer key, gpointer value, gpointer data)
+{
+  scm_gc_unprotect_object (SCM_PACK ((scm_t_bits)value));
 }
 
-static SCM
-task_get_earliest_str_scm (GttGhtml *ghtml, GttTask *tsk)
+static void
+ghtml_template_unref (GhtmlTemplate *tmpl)
 {
-  char buff[100];
+  guint i;
 
-  time_t task_date = gtt_task_get_secs_earliest (tsk);
-  // size_t len;
+  if (!g_atomic_int_dec_and_test (&tmpl->refcount))
+    return;
 
-  if (task_date > 0)
-    {
-      // len = xxxqof_print_date_time_buff (buff, 100, task_date);
-      xxxqof_print_date_time_buff (buff, 100, task_date);
-    }
-  else
+  for (i = 0; i < tmpl->segs->len; i++)
     {
-      // len = g_snprintf(buff, 100, "%s", _("No activity"));
-      g_snprintf (buff, 100, "%s", _ ("No activity"));
+      GhtmlSegment *seg = &g_array_index (tmpl->segs, GhtmlSegment, i);
+      if (GHTML_SEG_SCM != seg->type)
+        continue;
+      scm_gc_unprotect_object (seg->forms);
+      if (seg->thunks)
+        {
+          g_hash_table_foreach (seg->thunks, unprotect_thunk, NULL);
+          g_hash_table_destroy (seg->thunks);
+        }
     }
-  return scm_from_locale_string (buff);
+  g_array_free (tmpl->segs, TRUE);
+  g_free (tmpl->buf);
+  g_free (tmpl->path);
+  g_free (tmpl);
 }
 
-static SCM
-task_get_latest_str_scm (GttGhtml *ghtml, GttTask *tsk)
+static void
+ghtml_add_text (GhtmlTemplate *tmpl, const char *text, size_t len)
 {
-  char buff[100];
+  GhtmlSegment seg;
 
-  time_t task_date = gtt_task_get_secs_latest (tsk);
-  // size_t len;
+  if (0 == len)
+    return;
 
-  if (task_date > 0)
-    {
-      // len = xxxqof_print_date_time_buff (buff, 100, task_date);
-      xxxqof_print_date_time_buff (buff, 100, task_date);
-    }
-  else
+  /* Merge with the previous span, if they're adjacent */
+  if (tmpl->segs->len)
     {
-      // len = g_snprintf(buff, 100, "%s", _("No activity"));
-      g_snprintf (buff, 100, "%s", _ ("No activity"));
+      GhtmlSegment *prev = &g_array_index (tmpl->segs, GhtmlSegment,
+                                           tmpl->segs->len - 1);
+      if (GHTML_SEG_TEXT == prev->type && prev->text + prev->len == text)
+        {
+          prev->len += len;
+          return;
+        }
     }
-  return scm_from_locale_string (buff);
+
+  seg.type = GHTML_SEG_TEXT;
+  seg.text = text;
+  seg.len = len;
+  seg.forms = SCM_BOOL_F;
+  seg.wrap = FALSE;
+  seg.thunks = NULL;
+  g_array_append_val (tmpl->segs, seg);
 }
 
 static SCM
-task_get_value_str_scm (GttGhtml *ghtml, GttTask *tsk)
+read_forms (void *data)
 {
-  time_t task_secs;
-  char buff[100];
-  double value;
-  GttProject *prj;
-
-  task_secs = gtt_task_get_secs_ever (tsk);
-  value = ((double)task_secs) / 3600.0;
-
-  prj = gtt_task_get_parent (tsk);
-
-  switch (gtt_task_get_billrate (tsk))
-    {
-    case GTT_REGULAR:
-      value *= gtt_project_get_billrate (prj);
-      break;
-    case GTT_OVERTIME:
-      value *= gtt_project_get_overtime_rate (prj);
-      break;
-    case GTT_OVEROVER:
-      value *= gtt_project_get_overover_rate (prj);
-      break;
-    case GTT_FLAT_FEE:
-      value = gtt_project_get_flat_fee (prj);
-      break;
-    default:
-      value = 0.0;
-    }
+  SCM port = scm_open_input_string (scm_from_locale_string (data));
+  SCM forms = SCM_EOL;
 
-  if (!config_currency_use_locale)
-    {
-      setlocale (LC_MONETARY, "C");
-      setlocale (LC_NUMERIC, "C");
-      snprintf (buff, 100, "%s %.2f", config_currency_symbol, value + 0.0049);
-    }
-  else
+  while (1)
     {
-      setlocale (LC_ALL, "");
-      strfmon (buff, 100, "%n", value);
+      SCM form = scm_read (port);
+      if (SCM_EOF_OBJECT_P (form))
+        break;
+      forms = scm_cons (form, forms);
     }
-
-  return scm_from_locale_string (buff);
+  return scm_reverse (forms);
 }
 
 static SCM
-task_get_blockvalue_str_scm (GttGhtml *ghtml, GttTask *tsk)
+read_error_handler (void *data, SCM tag, SCM throw_args)
 {
-  time_t task_secs;
-  char buff[100];
-  double value;
-  GttProject *prj;
-  int bill_unit;
-
-  task_secs = gtt_task_get_secs_ever (tsk);
-  bill_unit = gtt_task_get_bill_unit (tsk);
+  return SCM_BOOL_F;
+}
 
-  value = (round (((double)task_secs) / bill_unit) * bill_unit) / 3600.0;
+/* Does this form have to be evaluated at the top level? */
+static gboolean
+is_toplevel_form (SCM form)
+{
+  const char *const toplevel[]
+      = { "begin", "load", "use-modules", "export", "eval-when", NULL };
+  char *name;
+  gboolean rc = FALSE;
+  int i;
 
-  prj = gtt_task_get_parent (tsk);
+  if (!scm_is_pair (form) || !scm_is_symbol (SCM_CAR (form)))
+    return FALSE;
 
-  switch (gtt_task_get_billrate (tsk))
+  name = scm_to_locale_string (scm_symbol_to_string (SCM_CAR (form)));
+  if (!strncmp (name, "define", 6))
+    rc = TRUE;
+  for (i = 0; !rc && toplevel[i]; i++)
     {
-    case GTT_REGULAR:
-      value *= gtt_project_get_billrate (prj);
-      break;
-    case GTT_OVERTIME:
-      value *= gtt_project_get_overtime_rate (prj);
-      break;
-    case GTT_OVEROVER:
-      value *= gtt_project_get_overover_rate (prj);
-      break;
-    case GTT_FLAT_FEE:
-      value = gtt_project_get_flat_fee (prj);
-      break;
-    default:
-      value = 0.0;
+      if (!strcmp (name, toplevel[i]))
+        rc = TRUE;
     }
+  free (name);
+  return rc;
+}
 
-  if (!config_currency_use_locale)
+static void
+ghtml_add_scm (GhtmlTemplate *tmpl, const char *code)
+{
+  GhtmlSegment seg;
+  SCM forms, node;
+  gboolean toplevel = FALSE;
+
+  seg.type = GHTML_SEG_SCM;
+  seg.text = code;
+  seg.len = strlen (code);
+  seg.forms = SCM_BOOL_F;
+  seg.wrap = FALSE;
+  seg.thunks = NULL;
+
+  forms = scm_c_catch (SCM_BOOL_T, read_forms, (void *)code,
+                       read_error_handler, NULL, NULL, NULL);
+  if (scm_is_false (forms))
     {
-      setlocale (LC_MONETARY, "C");
-      setlocale (LC_NUMERIC, "C");
-      snprintf (buff, 100, "%s %.2f", config_currency_symbol, value + 0.0049);
+      /* Leave it to the evaluator to complain */
+    }
+  else if (scm_is_null (forms))
+    {
+      return;
     }
   else
     {
-      setlocale (LC_ALL, "");
-      strfmon (buff, 100, "%n", value);
+      for (node = forms; scm_is_pair (node); node = SCM_CDR (node))
+        {
+          if (is_toplevel_form (SCM_CAR (node)))
+            toplevel = TRUE;
+        }
+      seg.forms = forms;
+      seg.wrap = !toplevel;
+      if (seg.wrap)
+        seg.thunks = g_hash_table_new (g_direct_hash, g_direct_equal);
     }
 
-  // return scm_mem2string (buff, strlen (buff));
-  return scm_from_locale_string (buff);
+  scm_gc_protect_object (seg.forms);
+  g_array_append_val (tmpl->segs, seg);
 }
 
-RET_TASK_STR (ret_task_billstatus, task_get_billstatus)
-RET_TASK_STR (ret_task_billable, task_get_billable)
-RET_TASK_STR (ret_task_billrate, task_get_billrate)
-RET_TASK_SIMPLE (ret_task_time_str, task_get_time_str)
-RET_TASK_SIMPLE (ret_task_blocktime_str, task_get_blocktime_str)
-RET_TASK_SIMPLE (ret_task_earliest_str, task_get_earliest_str)
-RET_TASK_SIMPLE (ret_task_latest_str, task_get_latest_str)
-RET_TASK_SIMPLE (ret_task_value_str, task_get_value_str)
-RET_TASK_SIMPLE (ret_task_blockvalue_str, task_get_blockvalue_str)
-
-/* ============================================================== */
-
-#define RET_IVL_SIMPLE(RET_FUNC, GTT_GETTER)                                  \
-  static SCM RET_FUNC (SCM ivl_list)                                          \
-  {                                                                           \
-    GttGhtml *ghtml = ghtml_guile_global_hack;                                \
-    return do_apply_on_interval (ghtml, ivl_list, GTT_GETTER##_scm);          \
-  }
-
-#define RET_IVL_STR(RET_FUNC, GTT_GETTER)                                     \
-  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttInterval *ivl)             \
-  {                                                                           \
-    const char *str = GTT_GETTER (ivl);                                       \
-    return scm_from_locale_string (str);                                      \
-  }                                                                           \
-  RET_IVL_SIMPLE (RET_FUNC, GTT_GETTER)
-
-#define RET_IVL_ULONG(RET_FUNC, GTT_GETTER)                                   \
-  static SCM GTT_GETTER##_scm (GttGhtml *ghtml, GttInterval *ivl)             \
-  {                                                                           \
-    unsigned long i = GTT_GETTER (ivl);                                       \
-    return scm_from_ulong (i);                                                \
-  }                                                                           \
-  RET_IVL_SIMPLE (RET_FUNC, GTT_GETTER)
-
-RET_IVL_ULONG (ret_ivl_start, gtt_interval_get_start)
-RET_IVL_ULONG (ret_ivl_stop, gtt_interval_get_stop)
-RET_IVL_ULONG (ret_ivl_fuzz, gtt_interval_get_fuzz)
-
-static SCM
-get_ivl_elapsed_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+/* Break the template up into segments.  Note that this terminates
+ * the scheme code and the <link> text in place.  Comments are
+ * dropped, <link>s are copied through as they are. */
+static void
+ghtml_parse (GhtmlTemplate *tmpl)
 {
-  char buff[100];
-  time_t elapsed;
-  elapsed = gtt_interval_get_stop (ivl);
-  elapsed -= gtt_interval_get_start (ivl);
-  xxxqof_print_hours_elapsed_buff (buff, 100, elapsed, TRUE);
-  return scm_from_locale_string (buff);
-}
-
-RET_IVL_SIMPLE (ret_ivl_elapsed_str, get_ivl_elapsed_str);
+  char *start, *end, *scmstart, *comstart, *linkstart;
 
-static SCM
-get_ivl_start_stop_common_str_scm (GttGhtml *ghtml, GttInterval *ivl,
-                                   time_t starp, gboolean prt_date)
-{
-  char buff[100];
+  /* The next occurance of each kind of markup.  These are only
+   * searched for again once we've gone past them, so that the whole
+   * parse is a single pass over the text. */
+  scmstart = strstr (tmpl->buf, "<?scm");
+  comstart = strstr (tmpl->buf, "<!--");
+  linkstart = strstr (tmpl->buf, "<link");
 
-  if (prt_date)
-    {
-      xxxqof_print_date_buff (buff, 100, starp);
-    }
-  else
+  start = tmpl->buf;
+  while (start)
     {
-      switch (config_time_format)
+      if (scmstart && scmstart < start)
+        scmstart = strstr (start, "<?scm");
+      if (comstart && comstart < start)
+        comstart = strstr (start, "<!--");
+      if (linkstart && linkstart < start)
+        linkstart = strstr (start, "<link");
+
+      /* which comes first ?  Note that comments and links are only
+       * handled if there is scheme markup somewhere after them. */
+      end = 0;
+      if (scmstart)
+        end = scmstart;
+      if (comstart && comstart < end)
+        end = comstart;
+      if (linkstart && linkstart < end)
+        end = linkstart;
+
+      /* Look for comments, and blow past them. */
+      if (comstart && comstart == end)
         {
-        case TIME_FORMAT_AM_PM:
-          {
-            strftime (buff, 100, "%r", localtime (&starp));
-            break;
-          }
-        case TIME_FORMAT_24_HS:
-          {
-            strftime (buff, 100, "%T", localtime (&starp));
-            break;
-          }
-        case TIME_FORMAT_LOCALE:
-          {
-            xxxqof_print_time_buff (buff, 100, starp);
-            break;
-          }
+          ghtml_add_text (tmpl, start, comstart - start);
+          end = strstr (comstart, "-->");
+          start = end ? end + 3 : NULL;
+          continue;
         }
-    }
 
-  GString *str;
-  str = g_string_new (NULL);
-
-  if (ghtml->show_links)
-    {
+      /* Look for <link>, and copy it. */
+      if (linkstart && linkstart == end)
+        {
+          ghtml_add_text (tmpl, start, linkstart - start);
+          end = strchr (linkstart, '>');
+          if (end)
+            {
+              ghtml_add_text (tmpl, linkstart, end + 1 - linkstart);
+              start = end + 1;
+              continue;
+            }
+          ghtml_add_text (tmpl, linkstart, strlen (linkstart));
+          ghtml_add_text (tmpl, ">", 1);
+          break;
+        }
 
-      g_string_append_printf (str, "<a href=\"gtt:interval:0x%lx\">",
-                              (long)ivl);
-    }
-  g_string_append (str, buff);
+      /* Look for  termination of scm markup */
+      if (scmstart && scmstart == end)
+        {
+          ghtml_add_text (tmpl, start, scmstart - start);
+          end = strstr (scmstart, "?>");
+          if (end)
+            {
+              *end = 0;
+              end += 2;
+            }
+          ghtml_add_scm (tmpl, scmstart + 5);
+          start = end;
+          continue;
+        }
 
-  if (ghtml->show_links)
-    {
-      g_string_append (str, "</a>");
+      /* If we got to here, we didn't find any tags. Just output */
+      ghtml_add_text (tmpl, start, strlen (start));
+      break;
     }
-
-  return scm_from_locale_string (str->str);
 }
 
-static SCM
-get_ivl_same_day_start_scm (GttGhtml *ghtml, GttInterval *ivl)
+/* Return the parsed template, reading it in if needed.  The caller
+ * must ghtml_template_unref() it when done. */
+static GhtmlTemplate *
+ghtml_template_lookup (const char *filepath)
 {
-  gboolean prt_date = TRUE;
-  time_t start, prev_stop;
+  GhtmlTemplate *tmpl;
+  GError *error = NULL;
+  struct stat sb;
+  gsize len;
 
-  /* Caution! use of the last_ivl_time thing makes this
-   * stateful in a way that may be surprising !
-   */
-  start = gtt_interval_get_start (ivl);
-  prev_stop = ghtml->last_ivl_time;
-  ghtml->last_ivl_time = start;
+  if (0 > g_stat (filepath, &sb))
+    return NULL;
 
-  if (0 != prev_stop)
+  g_mutex_lock (&template_cache_mutex);
+  if (!template_cache)
     {
-      prt_date = xxxqof_is_same_day (start, prev_stop);
+      template_cache = g_hash_table_new_full (
+          g_str_hash, g_str_equal, NULL,
+          (GDestroyNotify)ghtml_template_unref);
     }
-  return scm_from_bool (prt_date);
-}
-RET_IVL_SIMPLE (ret_ivl_same_day_start, get_ivl_same_day_start);
-
-static SCM
-get_ivl_same_day_stop_scm (GttGhtml *ghtml, GttInterval *ivl)
-{
-  gboolean prt_date = TRUE;
-  time_t stop, prev_start;
 
-  /* Caution! use of the last_ivl_time thing makes this
-   * stateful in a way that may be surprising !
-   */
-  stop = gtt_interval_get_stop (ivl);
-  prev_start = ghtml->last_ivl_time;
-  ghtml->last_ivl_time = stop;
-  if (0 != prev_start)
+  tmpl = g_hash_table_lookup (template_cache, filepath);
+  if (tmpl && tmpl->mtime == sb.st_mtime && tmpl->size == sb.st_size)
     {
-      prt_date = xxxqof_is_same_day (prev_start, stop);
+      g_atomic_int_inc (&tmpl->refcount);
+      g_mutex_unlock (&template_cache_mutex);
+      return tmpl;
     }
-  return scm_from_bool (prt_date);
-}
-RET_IVL_SIMPLE (ret_ivl_same_day_stop, get_ivl_same_day_stop);
-
-static SCM
-get_ivl_start_date_str_scm (GttGhtml *ghtml, GttInterval *ivl)
-{
-  time_t start = gtt_interval_get_start (ivl);
-  return get_ivl_start_stop_common_str_scm (ghtml, ivl, start, 1);
-}
-RET_IVL_SIMPLE (ret_ivl_start_date_str, get_ivl_start_date_str);
+  g_mutex_unlock (&template_cache_mutex);
 
-static SCM
-get_ivl_start_time_str_scm (GttGhtml *ghtml, GttInterval *ivl)
-{
-  time_t start = gtt_interval_get_start (ivl);
-  return get_ivl_start_stop_common_str_scm (ghtml, ivl, start, 0);
-}
-RET_IVL_SIMPLE (ret_ivl_start_time_str, get_ivl_start_time_str);
+  /* Parse without holding the lock; reading the scheme code can take
+   * a while, and can collect garbage.  If two threads miss at once,
+   * both parse, and the second one into the cache wins. */
 
-static SCM
-get_ivl_stop_date_str_scm (GttGhtml *ghtml, GttInterval *ivl)
-{
-  time_t stop = gtt_interval_get_stop (ivl);
-  return get_ivl_start_stop_common_str_scm (ghtml, ivl, stop, 1);
+  tmpl = g_new0 (GhtmlTemplate, 1);
+  if (!g_file_get_contents (filepath, &tmpl->buf, &len, &error))
+    {
+      g_warning ("Failed to read HTML file: %s", error->message);
+      g_error_free (error);
+      g_free (tmpl);
+      return NULL;
+    }
+  tmpl->path = g_strdup (filepath);
+  tmpl->mtime = sb.st_mtime;
+  tmpl->size = sb.st_size;
+  tmpl->segs = g_array_new (FALSE, FALSE, sizeof (GhtmlSegment));
+  ghtml_parse (tmpl);
+
+  /* The cache holds one reference, the caller the other */
+  tmpl->refcount = 2;
+  g_mutex_lock (&template_cache_mutex);
+  g_hash_table_replace (template_cache, tmpl->path, tmpl);
+  g_mutex_unlock (&template_cache_mutex);
+  return tmpl;
 }
-RET_IVL_SIMPLE (ret_ivl_stop_date_str, get_ivl_stop_date_str);
 
 static SCM
-get_ivl_stop_time_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+eval_forms (void *data)
 {
-  time_t stop = gtt_interval_get_stop (ivl);
-  return get_ivl_start_stop_common_str_scm (ghtml, ivl, stop, 0);
+  SCM node, rc = SCM_UNSPECIFIED;
+
+  for (node = data; scm_is_pair (node); node = SCM_CDR (node))
+    {
+      rc = scm_primitive_eval (SCM_CAR (node));
+    }
+  return rc;
 }
-RET_IVL_SIMPLE (ret_ivl_stop_time_str, get_ivl_stop_time_str);
 
+/* The block's thunk for the current module.  It's made the first time
+ * that the block is shown in that module; if it can't be expanded,
+ * the block stays a list of forms, and the error gets reported when
+ * they're evaluated.  Only the one thread that's using the module can
+ * be making its thunk, so the lock need not be held while it's done. */
 static SCM
-get_ivl_fuzz_str_scm (GttGhtml *ghtml, GttInterval *ivl)
+ghtml_segment_thunk (GhtmlSegment *seg)
+{
+  SCM module = scm_current_module ();
+  gpointer key = (gpointer)SCM_UNPACK (module);
+  gpointer value;
+  gboolean found;
+  SCM lambda, thunk;
+
+  g_mutex_lock (&thunk_mutex);
+  found = g_hash_table_lookup_extended (seg->thunks, key, NULL, &value);
+  g_mutex_unlock (&thunk_mutex);
+  if (found)
+    return SCM_PACK ((scm_t_bits)value);
+
+  lambda = scm_cons (scm_from_locale_symbol ("lambda"),
+                     scm_cons (SCM_EOL, seg->forms));
+  thunk = scm_c_catch (SCM_BOOL_T, (scm_t_catch_body)scm_primitive_eval,
+                       (void *)lambda, read_error_handler, NULL, NULL, NULL);
+  scm_gc_protect_object (thunk);
+
+  g_mutex_lock (&thunk_mutex);
+  g_hash_table_insert (seg->thunks, key, (gpointer)SCM_UNPACK (thunk));
+  g_mutex_unlock (&thunk_mutex);
+  return thunk;
+}
+
+/* Take a module from the pool, or make a new one that uses the one
+ * gtt.scm is in */
+static SCM
+ghtml_module_get (void)
 {
-  char buff[100];
-
-  xxxqof_print_hours_elapsed_buff (buff, 100, gtt_interval_get_fuzz (ivl),
-                                   TRUE);
-  return scm_from_locale_string (buff);
-}
-RET_IVL_SIMPLE (ret_ivl_fuzz_str, get_ivl_fuzz_str);
+  SCM module = SCM_BOOL_F;
 
-/* ============================================================== */
+  g_mutex_lock (&free_modules_mutex);
+  if (free_modules)
+    {
+      module = SCM_PACK ((scm_t_bits)free_modules->data);
+      free_modules = g_slist_delete_link (free_modules, free_modules);
+    }
+  g_mutex_unlock (&free_modules_mutex);
+  if (scm_is_true (module))
+    return module;
 
-SCM captured_stack = SCM_BOOL_F;
+  module = scm_call_0 (scm_c_public_ref ("guile", "make-module"));
+  scm_call_2 (scm_c_public_ref ("guile", "module-use!"), module, gtt_module);
+  return scm_gc_protect_object (module);
+}
 
-static SCM
-my_preunwind_handler (void *data, SCM tag, SCM throw_args)
+static void
+ghtml_module_put (SCM module)
 {
-  // We can only record the stack before it is unwound.
-  // The normal catch handler body runs only *after* the stack
-  // has been unwound.
-  captured_stack = scm_make_stack (SCM_BOOL_T, SCM_EOL);
-  return SCM_EOL;
+  g_mutex_lock (&free_modules_mutex);
+  free_modules
+      = g_slist_prepend (free_modules, (gpointer)SCM_UNPACK (module));
+  g_mutex_unlock (&free_modules_mutex);
 }
 
-static SCM
-my_catch_handler (void *data, SCM tag, SCM throw_args)
+static void
+ghtml_eval_segment (GhtmlSegment *seg)
 {
+  SCM stack = SCM_BOOL_F;
+  SCM thunk = SCM_BOOL_F;
 
-  printf ("Error: GnoTime caught an error during scheme parse\n");
+  if (seg->wrap)
+    thunk = ghtml_segment_thunk (seg);
 
-  /* create string port into which we write the error message and
-     stack. */
-  SCM port = scm_current_output_port ();
-  /* throw args seem to be: (FN FORMAT ARGS #f). split the pieces into
-     local vars. */
-  if (scm_is_true (scm_list_p (throw_args)) && (scm_ilength (throw_args) >= 1))
+  if (scm_is_true (thunk))
     {
-      long nargs = scm_ilength (throw_args);
-      SCM fn = scm_car (throw_args);
-      SCM format = SCM_EOL;
-      if (nargs >= 2)
-        format = scm_cadr (throw_args);
+      scm_c_catch (SCM_BOOL_T, (scm_t_catch_body)scm_call_0, (void *)thunk,
+                   my_catch_handler, &stack, my_preunwind_handler, &stack);
+    }
+  else if (scm_is_true (seg->forms))
+    {
+      scm_c_catch (SCM_BOOL_T, eval_forms, (void *)seg->forms,
+                   my_catch_handler, &stack, my_preunwind_handler, &stack);
+    }
+  else
+    {
+      scm_c_catch (SCM_BOOL_T, (scm_t_catch_body)scm_c_eval_string,
+                   (void *)seg->text, my_catch_handler, &stack,
+                   my_preunwind_handler, &stack);
+    }
+}
 
-      SCM parts = SCM_EOL;
-      if (nargs >= 3)
-        parts = scm_caddr (throw_args);
+/* ============================================================== */
+/* The report cache */
 
-      SCM rest = SCM_EOL;
-      if (nargs >= 4)
-        rest = scm_car (scm_cdddr (throw_args));
+/* Everything, other than the project data, that the output of a
+ * report depends on.  The project goes in by GUID, not by address,
+ * since a deleted project's address can be handed out again. */
+static char *
+report_cache_key (GttGhtml *ghtml, GhtmlTemplate *tmpl)
+{
+  char guid[GUID_ENCODING_LENGTH + 1] = "";
+  char *kvp, *key;
 
-#if OLD_GUILE_18_STUFF
-      /* This is some old code that mostly(?) worked under guile-1.8,
-       * but uses a deprecated API's.  The new guile code below is
-       * better, and it works with guile-2.0 */
-      if (fn != SCM_BOOL_F)
-        { /* display the function name and tag */
-          scm_puts ("Function: ", port);
-          scm_display (fn, port);
-          scm_puts (", ", port);
-          scm_display (tag, port);
-          scm_newline (port);
-        }
+  if (ghtml->prj)
+    guid_to_string_buff (gtt_project_get_guid (ghtml->prj), guid);
+  kvp = ghtml->kvp ? kvp_frame_to_string (ghtml->kvp) : NULL;
 
-      if (scm_string_p (format))
-        { /* conditionally display the error message using format */
-          scm_puts ("Error: ", port);
-          scm_display_error_message (format, parts, port);
-        }
-      if (rest != SCM_EOL)
-        {
-          scm_puts ("Other Data: ", port);
-          scm_display (rest, port);
-          scm_newline (port);
-          scm_newline (port);
-        }
-    }
+  key = g_strdup_printf ("%s\n%ld %ld\n%s\n%d %d %d %d %d\n%s",
+                         tmpl->path, (long)tmpl->mtime, (long)tmpl->size,
+                         guid, ghtml->show_links, ghtml->really_hide_links,
+                         qof_date_format_get_current (), config_time_format,
+                         ghtml->did_query, kvp ? kvp : "");
+  g_free (kvp);
+  return key;
+}
 
-  /* find the stack, and conditionally display it */
-  SCM the_stack = scm_fluid_ref (SCM_CDR (scm_the_last_stack_fluid_var));
-  if (the_stack != SCM_BOOL_F)
+/* The running interval's stop time keeps up with the clock without
+ * changing any generations; so a report that can see it can only be
+ * kept until the next timer tick. */
+static gboolean
+report_sees_timer (GttGhtml *ghtml)
+{
+  GttProject *prj;
+
+  if (!cur_proj || !timer_is_running ())
+    return FALSE;
+  if (ghtml->deps.wide)
+    return TRUE;
+  for (prj = cur_proj; prj; prj = gtt_project_get_parent (prj))
     {
-      scm_display_backtrace (the_stack, port, SCM_UNDEFINED, SCM_UNDEFINED);
+      if (prj == ghtml->prj)
+        return TRUE;
     }
+  return FALSE;
+}
 
-  return SCM_EOL;
-#else /* OLD_GUILE_18_STUFF */
-      if (scm_is_true (captured_stack))
-        {
-          SCM highlights;
-
-          if (scm_is_eq (tag, scm_arg_type_key)
-              || scm_is_eq (tag, scm_out_of_range_key))
-            highlights = rest;
-          else
-            highlights = SCM_EOL;
+static void
+report_cache_save (GttGhtml *ghtml, const char *key)
+{
+  GBytes *text;
+  gsize len = ghtml->capture->len;
 
-          scm_puts ("Backtrace:\n", port);
-          scm_display_backtrace_with_highlights (
-              captured_stack, port, SCM_BOOL_F, SCM_BOOL_F, highlights);
-          scm_newline (port);
-        }
-      scm_display_error (captured_stack, port, fn, format, parts, rest);
-    }
-  else
+  if (report_sees_timer (ghtml))
     {
-      scm_puts ("ERROR: throw args are unexpectedly short!\n", port);
+      time_t tick = time (0) + (config_show_secs ? 1 : 60);
+      ghtml->deps.expires = MIN (ghtml->deps.expires, tick);
     }
-  scm_puts ("ABORT: ", port);
-  SCM re = scm_symbol_to_string (tag);
-  char *restr = scm_to_locale_string (re);
-  scm_puts (restr, port);
-  free (restr);
 
-  return SCM_BOOL_F;
-#endif
+  text = g_bytes_new_take (g_string_free (ghtml->capture, FALSE), len);
+  ghtml->capture = NULL;
+  gtt_report_cache_store (key, &ghtml->deps, text);
+  g_bytes_unref (text);
 }
 
-/* ============================================================== */
-/* Parse style-sheet type links:  links that look like
- * <link rel="stylesheet" href="some_kind_of.css" type="text/css">
- */
-
+/* Write out a report straight from the cache */
 static void
-process_link (GttGhtml *ghtml, const gchar *str)
+report_cache_replay (GttGhtml *ghtml, GBytes *text)
 {
-  /* no-op for now, just copy it into the window  */
-  if (ghtml->write_stream)
-    {
-      (ghtml->write_stream) (ghtml, "<link", 5, ghtml->user_data);
-      size_t nr = strlen (str);
-      (ghtml->write_stream) (ghtml, str, nr, ghtml->user_data);
-      (ghtml->write_stream) (ghtml, ">", 1, ghtml->user_data);
-    }
+  gsize len;
+  const char *str = g_bytes_get_data (text, &len);
+
+  if (ghtml->open_stream)
+    (ghtml->open_stream) (ghtml, ghtml->user_data);
+  if (ghtml->write_stream && 0 < len)
+    (ghtml->write_stream) (ghtml, str, len, ghtml->user_data);
+  if (ghtml->close_stream)
+    (ghtml->close_stream) (ghtml, ghtml->user_data);
 }
 
 /* ============================================================== */
@@ -1598,9 +2838,12 @@ process_link (GttGhtml *ghtml, const gchar *str)
 void
 gtt_ghtml_display (GttGhtml *ghtml, const char *filepath, GttProject *prj)
 {
-  GString *template;
-  char *start, *end, *scmstart, *comstart, *linkstart;
-  size_t nr;
+  GhtmlTemplate *tmpl;
+  GttGhtml *prev;
+  char *cache_key = NULL;
+  SCM module = SCM_BOOL_F;
+  SCM prev_module = SCM_BOOL_F;
+  guint i;
 
   if (!ghtml)
     return;
@@ -1617,67 +2860,40 @@ gtt_ghtml_display (GttGhtml *ghtml, const char *filepath, GttProject *prj)
     }
 
   /* Try to get the ghtml file ... */
-  GFile *ifile = g_file_new_for_path (filepath);
-
-  GError *error = NULL;
-  GFileInputStream *istream = g_file_read (ifile, NULL, &error);
-  if ((NULL == istream) && (0 == ghtml->open_count))
+  tmpl = filepath ? ghtml_template_lookup (filepath) : NULL;
+  if (!tmpl)
     {
-      if (ghtml->error)
+      if ((0 == ghtml->open_count) && ghtml->error)
         {
           (ghtml->error) (ghtml, 404, filepath, ghtml->user_data);
         }
-
-      g_object_unref (ifile);
-      ifile = NULL;
-
-      g_error_free (error);
-      error = NULL;
-
       return;
     }
   ghtml->ref_path = filepath;
 
-  /* Read in the whole file.  Hopefully its not huge */
-  template = g_string_new (NULL);
-  while (1)
+  if (ghtml->use_cache && !ghtml->plist && (0 == ghtml->open_count))
     {
-#define BUFF_SIZE 4000
-      char buff[BUFF_SIZE + 1];
-      const gssize bytes_read = g_input_stream_read (
-          G_INPUT_STREAM (istream), buff, BUFF_SIZE, NULL, &error);
-      if (0 > bytes_read)
-        {
-          g_warning ("Failed to read HTML file: %s", error->message);
+      GBytes *text;
 
-          g_error_free (error);
-          error = NULL;
-
-          break;
-        }
-      if (0 == bytes_read)
+      cache_key = report_cache_key (ghtml, tmpl);
+      text = gtt_report_cache_lookup (cache_key, ghtml->prj);
+      if (text)
         {
-          break; // EOF
+          report_cache_replay (ghtml, text);
+          g_bytes_unref (text);
+          g_free (cache_key);
+          ghtml_template_unref (tmpl);
+          return;
         }
 
-      buff[bytes_read] = 0x0;
-      g_string_append (template, buff);
-    }
-  if (FALSE == g_input_stream_close (G_INPUT_STREAM (istream), NULL, &error))
-    {
-      g_warning ("Failed to close HTML file: %s", error->message);
-
-      g_error_free (error);
-      error = NULL;
+      /* Not there; render it, and keep a copy */
+      gtt_report_deps_init (&ghtml->deps, ghtml->prj);
+      ghtml->uncacheable = FALSE;
+      ghtml->capture = g_string_new (NULL);
     }
 
-  g_object_unref (istream);
-  istream = NULL;
-  g_object_unref (ifile);
-  ifile = NULL;
-
-  /* ugh. gag. choke. puke. */
-  ghtml_guile_global_hack = ghtml;
+  prev = g_private_get (&current_ghtml);
+  g_private_set (&current_ghtml, ghtml);
 
 #ifdef DEBUG
   /* Load predefined scheme forms. We do this here only when debugging,
@@ -1691,115 +2907,59 @@ gtt_ghtml_display (GttGhtml *ghtml, const char *filepath, GttProject *prj)
       (ghtml->open_stream) (ghtml, ghtml->user_data);
     }
 
-  ghtml->open_count++;
-
-  /* Loop over input text, looking for scheme markup and
-   * sgml comments. */
-  start = template->str;
-  while (start)
+  /* The preferences, or the time zone, may have changed since the
+   * last time. */
+  if (0 == ghtml->open_count)
     {
-      /* Look for scheme markup */
-      scmstart = strstr (start, "<?scm");
-
-      /* Look for comments, and blow past them. */
-      comstart = strstr (start, "<!--");
-
-      /* Look for <link>, and try to handle stylesheets. */
-      linkstart = strstr (start, "<link");
-
-      /* which comes first ? */
-      end = 0;
-      if (scmstart)
-        end = scmstart;
-      if (comstart && comstart < end)
-        end = comstart;
-      if (linkstart && linkstart < end)
-        end = linkstart;
-
-      /* Look for comments, and blow past them. */
-      if (comstart && comstart == end)
-        {
-          end = strstr (comstart, "-->");
-          if (end)
-            {
-              end += 3;
-            }
-
-          /* write everything that we got before the markup */
-          if (ghtml->write_stream)
-            {
-              nr = comstart - start;
-              (ghtml->write_stream) (ghtml, start, nr, ghtml->user_data);
-            }
-          start = end;
-          continue;
-        }
+      gtt_date_cache_clear (ghtml->dates);
+      ghtml->query_done = FALSE;
 
-      /* Look for <link>, and try to handle stylesheets. */
-      if (linkstart && linkstart == end)
-        {
-          end = strstr (linkstart, ">");
-          if (end)
-            {
-              *end = 0;
-              end += 1;
-            }
+      /* Included templates share the report's module */
+      module = ghtml_module_get ();
+      prev_module = scm_set_current_module (module);
+    }
 
-          /* write everything that we got before the markup */
-          if (ghtml->write_stream)
-            {
-              nr = linkstart - start;
-              (ghtml->write_stream) (ghtml, start, nr, ghtml->user_data);
-            }
+  ghtml->open_count++;
 
-          /* dispatch and handle */
-          process_link (ghtml, linkstart + 5);
-          start = end;
-          continue;
-        }
+  for (i = 0; i < tmpl->segs->len; i++)
+    {
+      GhtmlSegment *seg = &g_array_index (tmpl->segs, GhtmlSegment, i);
 
-      /* Look for  termination of scm markup */
-      if (scmstart && scmstart == end)
+      if (GHTML_SEG_SCM == seg->type)
         {
-          end = strstr (scmstart, "?>");
-          if (end)
-            {
-              *end = 0;
-              end += 2;
-            }
-
-          /* write everything that we got before the markup */
-          if (ghtml->write_stream)
-            {
-              nr = scmstart - start;
-              (ghtml->write_stream) (ghtml, start, nr, ghtml->user_data);
-            }
-
-          /* dispatch and handle */
-          scmstart += 5;
-          captured_stack = SCM_BOOL_F;
-          scm_c_catch (SCM_BOOL_T, (scm_t_catch_body)scm_c_eval_string,
-                       scmstart, my_catch_handler, NULL, my_preunwind_handler,
-                       NULL);
-
-          start = end;
-          continue;
+          ghtml_eval_segment (seg);
         }
-
-      /* If we got to here, we didn't find any tags. Just output */
-      if (ghtml->write_stream)
+      else
         {
-          nr = strlen (start);
-          (ghtml->write_stream) (ghtml, start, nr, ghtml->user_data);
+          gtt_ghtml_write (ghtml, seg->text, seg->len);
         }
-      break;
     }
 
   ghtml->open_count--;
-  if (ghtml->close_stream && (0 == ghtml->open_count))
+  if (scm_is_true (module))
+    {
+      scm_set_current_module (prev_module);
+      ghtml_module_put (module);
+    }
+  if (0 == ghtml->open_count)
+    {
+      gtt_ghtml_flush (ghtml);
+      if (ghtml->close_stream)
+        (ghtml->close_stream) (ghtml, ghtml->user_data);
+    }
+
+  if (cache_key)
     {
-      (ghtml->close_stream) (ghtml, ghtml->user_data);
+      if (ghtml->uncacheable)
+        g_string_free (ghtml->capture, TRUE);
+      else
+        report_cache_save (ghtml, cache_key);
+      ghtml->capture = NULL;
+      g_free (cache_key);
     }
+
+  g_private_set (&current_ghtml, prev);
+  ghtml_template_unref (tmpl);
 }
 
 /* ============================================================== */
@@ -1807,23 +2967,49 @@ gtt_ghtml_display (GttGhtml *ghtml, const char *filepath, GttProject *prj)
  * scheme forms.
  */
 
-static int is_inited = 0;
+static gsize is_inited = 0;
 
 static void
 register_procs (void)
 {
+  register_handle_type ();
+
   scm_c_define_gsubr ("gtt-show", 1, 0, 0, show_scm);
   scm_c_define_gsubr ("gtt-include", 1, 0, 0, include_file_scm);
   scm_c_define_gsubr ("gtt-kvp-str", 1, 0, 0, ret_kvp_str);
   scm_c_define_gsubr ("gtt-linked-project", 0, 0, 0, ret_linked_project);
   scm_c_define_gsubr ("gtt-selected-project", 0, 0, 0, ret_selected_project);
   scm_c_define_gsubr ("gtt-projects", 0, 0, 0, ret_projects);
-  scm_c_define_gsubr ("gtt-query-results", 0, 0, 0, ret_query_projects);
+  scm_c_define_gsubr ("gtt-query-results", 0, 0, 0, ret_query_results);
+  scm_c_define_gsubr ("gtt-query-projects", 0, 0, 0, ret_query_projects);
+  scm_c_define_gsubr ("gtt-query-tasks", 0, 0, 0, ret_query_tasks);
+  scm_c_define_gsubr ("gtt-query-intervals", 0, 0, 0, ret_query_intervals);
+  scm_c_define_gsubr ("gtt-search", 1, 0, 0, ret_search);
+  scm_c_define_gsubr ("gtt-search-projects", 1, 0, 0, ret_search_projects);
   scm_c_define_gsubr ("gtt-did-query", 0, 0, 0, ret_did_query);
 
   scm_c_define_gsubr ("gtt-tasks", 1, 0, 0, ret_tasks);
   scm_c_define_gsubr ("gtt-intervals", 1, 0, 0, ret_intervals);
   scm_c_define_gsubr ("gtt-daily-totals", 1, 0, 0, ret_daily_totals);
+  scm_c_define_gsubr ("gtt-daily-buckets", 1, 0, 0, ret_daily_buckets);
+  scm_c_define_gsubr ("gtt-aggregate", 2, 3, 0, ret_aggregate);
+  scm_c_define_gsubr ("gtt-intervals-between", 2, 1, 0,
+                      ret_intervals_between);
+  scm_c_define_gsubr ("gtt-unfinished-projects", 1, 1, 0,
+                      ret_unfinished_projects);
+  scm_c_define_gsubr ("gtt-invoice", 1, 3, 0, ret_invoice);
+  scm_c_define_gsubr ("gtt-currency-str", 1, 0, 0, ret_currency_str);
+  scm_c_define_gsubr ("gtt-hours-str", 1, 0, 0, ret_hours_str);
+
+  scm_c_define_gsubr ("gtt-fold-projects", 3, 0, 0, fold_projects);
+  scm_c_define_gsubr ("gtt-fold-tasks", 3, 0, 0, fold_tasks);
+  scm_c_define_gsubr ("gtt-fold-intervals", 3, 0, 0, fold_intervals);
+  scm_c_define_gsubr ("gtt-for-each-project", 2, 0, 0, for_each_project);
+  scm_c_define_gsubr ("gtt-for-each-task", 2, 0, 0, for_each_task);
+  scm_c_define_gsubr ("gtt-for-each-interval", 2, 0, 0, for_each_interval);
+  scm_c_define_gsubr ("gtt-project?", 1, 0, 0, is_project_scm);
+  scm_c_define_gsubr ("gtt-task?", 1, 0, 0, is_task_scm);
+  scm_c_define_gsubr ("gtt-interval?", 1, 0, 0, is_interval_scm);
 
   scm_c_define_gsubr ("gtt-links-on", 0, 0, 0, set_links_on);
   scm_c_define_gsubr ("gtt-links-off", 0, 0, 0, set_links_off);
@@ -1890,9 +3076,8 @@ gtt_ghtml_new (void)
 {
   GttGhtml *p;
 
-  if (!is_inited)
+  if (g_once_init_enter (&is_inited))
     {
-      is_inited = 1;
       register_procs ();
 
       /* Initialize guile interpreter */
@@ -1900,6 +3085,8 @@ gtt_ghtml_new (void)
 
       /* Load predefined scheme forms */
       scm_c_primitive_load (gtt_ghtml_resolve_path ("gtt.scm", NULL));
+      gtt_module = scm_gc_protect_object (scm_current_module ());
+      g_once_init_leave (&is_inited, 1);
     }
 
   p = g_new0 (GttGhtml, 1);
@@ -1907,11 +3094,19 @@ gtt_ghtml_new (void)
   p->open_count = 0;
   p->kvp = NULL;
   p->prj = NULL;
+  p->plist = NULL;
+  p->query = NULL;
   p->query_result = NULL;
+  p->query_done = FALSE;
   p->did_query = FALSE;
   p->show_links = TRUE;
   p->really_hide_links = FALSE;
   p->last_ivl_time = 0;
+  p->dates = gtt_date_cache_new ();
+  p->use_cache = FALSE;
+  p->capture = NULL;
+  p->outbuf = g_string_sized_new (GTT_GHTML_FLUSH_SIZE);
+  p->flush_size = GTT_GHTML_FLUSH_SIZE;
 
   gtt_ghtml_deprecated_init (p);
 
@@ -1926,6 +3121,9 @@ gtt_ghtml_destroy (GttGhtml *p)
 
   if (p->query_result)
     g_list_free (p->query_result);
+  gtt_query_unref (p->query);
+  g_string_free (p->outbuf, TRUE);
+  gtt_date_cache_destroy (p->dates);
   g_free (p);
 }
 
@@ -1936,6 +3134,7 @@ gtt_ghtml_set_stream (GttGhtml *p, gpointer ud, GttGhtmlOpenStream op,
 {
   if (!p)
     return;
+  gtt_ghtml_flush (p);
   p->user_data = ud;
   p->open_stream = op;
   p->write_stream = wr;
@@ -1943,6 +3142,74 @@ gtt_ghtml_set_stream (GttGhtml *p, gpointer ud, GttGhtmlOpenStream op,
   p->error = er;
 }
 
+void
+gtt_ghtml_write (GttGhtml *p, const char *str, size_t len)
+{
+  if (!p || !p->write_stream || 0 == len)
+    return;
+  if (p->capture)
+    g_string_append_len (p->capture, str, len);
+
+  /* Big chunks (like most of the literal text in a template) aren't
+   * worth copying; pass them straight through. */
+  if (len >= p->flush_size / 4)
+    {
+      gtt_ghtml_flush (p);
+      (p->write_stream) (p, str, len, p->user_data);
+      return;
+    }
+
+  if (p->outbuf->len + len > p->flush_size)
+    gtt_ghtml_flush (p);
+  g_string_append_len (p->outbuf, str, len);
+}
+
+void
+gtt_ghtml_flush (GttGhtml *p)
+{
+  if (!p || 0 == p->outbuf->len)
+    return;
+  if (p->write_stream)
+    (p->write_stream) (p, p->outbuf->str, p->outbuf->len, p->user_data);
+  g_string_truncate (p->outbuf, 0);
+}
+
+void
+gtt_ghtml_set_flush_size (GttGhtml *p, size_t flush_size)
+{
+  if (!p)
+    return;
+  gtt_ghtml_flush (p);
+  p->flush_size = flush_size;
+}
+
+void
+gtt_ghtml_set_query (GttGhtml *p, GttQuery *query)
+{
+  if (!p)
+    return;
+  gtt_query_ref (query);
+  gtt_query_unref (p->query);
+  p->query = query;
+  p->query_done = FALSE;
+}
+
+void
+gtt_ghtml_set_cache (GttGhtml *p, gboolean use_cache)
+{
+  if (!p)
+    return;
+  p->use_cache = use_cache;
+}
+
+void
+gtt_ghtml_set_project_list (GttGhtml *p, GttProjectList *plist)
+{
+  if (!p)
+    return;
+  p->plist = plist;
+}
+
 /* This sets the over-ride flag, so that no internal links are shown,
  * really really for real, when printing out to file.
  */
@@ -21,7 +21,10 @@
 
 #include <qof.h>
 
+#include "gtt_date_cache.h"
 #include "gtt_project.h"
+#include "gtt_query.h"
+#include "gtt_report_cache.h"
 
 /* GHTML == guile-parsed html.  These routines will read in html
  * files with embedded scheme code, evaluate the scheme, and output
@@ -48,6 +51,11 @@ struct gtt_ghtml_s
   void (*error) (GttGhtml *, int errcode, const char *msg, gpointer);
   gpointer user_data;
 
+  /* Output is collected here, and handed to write_stream in chunks
+   * of about flush_size bytes. */
+  GString *outbuf;
+  size_t flush_size;
+
   /* open_count and ref_path used for recursive file includes */
   int open_count;
   const char *ref_path;
@@ -58,14 +66,28 @@ struct gtt_ghtml_s
   /* The 'linked' project */
   GttProject *prj;
 
-  /* List of projects, returned as query result */
+  /* The projects that the report can see; NULL for the live ones */
+  GttProjectList *plist;
+
+  /* The query that the report was asked for by, if any, and its
+   * results, of the type that it selects; see gtt_ghtml_set_query() */
+  GttQuery *query;
   GList *query_result;
-  gboolean did_query; /* TRUE if query was run */
+  gboolean query_done; /* query_result is up to date */
+  gboolean did_query;  /* TRUE if query was run */
 
   gboolean show_links;        /* Flag -- show internal <a href> links */
   gboolean really_hide_links; /* Flag -- show internal <a href> links */
 
   time_t last_ivl_time; /* hack for pretty-printing interval dates */
+  GttDateCache *dates;  /* dates and times already worked out */
+
+  /* While a cacheable report is rendered, its output is copied into
+   * 'capture', and 'deps' records what data it looked at. */
+  gboolean use_cache;
+  gboolean uncacheable; /* it looked at something deps can't track */
+  GString *capture;
+  GttReportDeps deps;
 
   /* ------------------------------------------------------ */
   /* Deprecated portion of this struct -- will go away someday. */
@@ -89,8 +111,6 @@ struct gtt_ghtml_s
   char **tp;
 };
 
-extern GttGhtml *ghtml_guile_global_hack;
-
 GttGhtml *gtt_ghtml_new (void);
 void gtt_ghtml_destroy (GttGhtml *p);
 
@@ -105,11 +125,66 @@ void gtt_ghtml_set_stream (GttGhtml *, gpointer user_data, GttGhtmlOpenStream,
                            GttGhtmlWriteStream, GttGhtmlCloseStream,
                            GttGhtmlError);
 
+/** The gtt_ghtml_write() routine queues text for output to the
+ *     stream.  Small writes are copied into a buffer, which is passed to
+ *     the stream's write routine whenever it fills up; writes that are
+ *     large compared to the buffer go straight to the stream, uncopied.
+ *     The gtt_ghtml_flush() routine passes on whatever is buffered.
+ *     The buffer is flushed when the stream is closed.
+ *
+ * The gtt_ghtml_set_flush_size() routine sets the size of the buffer;
+ *     a size of zero turns buffering off.  The default is
+ *     GTT_GHTML_FLUSH_SIZE.
+ */
+#define GTT_GHTML_FLUSH_SIZE 8192
+
+void gtt_ghtml_write (GttGhtml *, const char *str, size_t len);
+void gtt_ghtml_flush (GttGhtml *);
+void gtt_ghtml_set_flush_size (GttGhtml *, size_t);
+
 /** The gtt_ghtml_display() routine will parse the indicated gtt file,
  *     and output standard HTML to the indicated stream.
  */
 void gtt_ghtml_display (GttGhtml *, const char *path_frag, GttProject *prj);
 
+/** The gtt_ghtml_set_query() routine sets the query that the report
+ *     shows the results of.  It is run again each time the report is
+ *     displayed, with the form inputs in the kvp, the first time the
+ *     report asks for them: gtt-query-results returns what the query
+ *     selects, and gtt-query-projects, gtt-query-tasks and
+ *     gtt-query-intervals return the projects or tasks those are in,
+ *     or the tasks or intervals they have.  The GttGhtml takes its own
+ *     reference to the query.
+ */
+void gtt_ghtml_set_query (GttGhtml *, GttQuery *);
+
+/** The gtt_ghtml_set_cache() routine turns the report cache on or off
+ *     for this GttGhtml (it's off by default).  With it on, a report
+ *     shown again with the same template, linked project, form inputs
+ *     and preferences is written out from the cache, instead of being
+ *     rendered again, unless the project data it looked at has changed
+ *     since; see gtt_report_cache.h.  Reports that show the project
+ *     selected in the main window are never cached, and neither are
+ *     those rendered from a snapshot.  A report that includes other
+ *     files is not told when only they have changed.
+ */
+void gtt_ghtml_set_cache (GttGhtml *, gboolean);
+
+/** The gtt_ghtml_set_project_list() routine sets the list of projects
+ *     that the report gets from gtt-projects.  By default (and if plist
+ *     is NULL), that's the live project list, which may only be used
+ *     on the main thread.  To render a report on any other thread,
+ *     hand it a snapshot from gtt_project_list_snapshot(), and link it
+ *     to projects from that same snapshot.  The snapshot must outlive
+ *     the rendering.
+ *
+ * The gtt_ghtml_current() routine returns the GttGhtml being displayed
+ *     by the calling thread, or NULL.  It's for the C routines that
+ *     implement the scheme procedures, which aren't otherwise told.
+ */
+void gtt_ghtml_set_project_list (GttGhtml *, GttProjectList *plist);
+GttGhtml *gtt_ghtml_current (void);
+
 /** The gtt_gthml_show_links() routine will set a flag indicating whether
  *     the output html should include internal <a href> links.  Normally,
  *     this should be set to TRUE when displaying in the internal browser,
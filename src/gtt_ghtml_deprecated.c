@@ -30,6 +30,7 @@
 
 #include "gtt.h"
 #include "gtt_application_window.h"
+#include "gtt_date_cache.h"
 #include "gtt_ghtml.h"
 #include "gtt_project.h"
 #include "gtt_util.h"
@@ -90,7 +91,7 @@ do_show_journal (GttGhtml *ghtml, GttProject *prj)
       "<tr><th> &nbsp; </th><th>%s</th><th>%s</th><th>%s</th></tr>\n",
       _ ("Diary Entry"), _ ("Start"), _ ("Stop"), _ ("Elapsed"));
 
-  (ghtml->write_stream) (ghtml, p->str, p->len, ghtml->user_data);
+  gtt_ghtml_write (ghtml, p->str, p->len);
 
   for (node = gtt_project_get_tasks (prj); node; node = node->next)
     {
@@ -115,7 +116,7 @@ do_show_journal (GttGhtml *ghtml, GttProject *prj)
         p = g_string_append (p, "</a>");
       p = g_string_append (p, "</td>\n</tr>\n");
 
-      (ghtml->write_stream) (ghtml, p->str, p->len, ghtml->user_data);
+      gtt_ghtml_write (ghtml, p->str, p->len);
 
       for (in = gtt_task_get_intervals (tsk); in; in = in->next)
         {
@@ -137,21 +138,22 @@ do_show_journal (GttGhtml *ghtml, GttProject *prj)
           /* print hour only or date too? */
           if (0 != prev_stop)
             {
-              prt_date = xxxqof_is_same_day (start, prev_stop);
+              prt_date
+                  = !gtt_date_cache_same_day (ghtml->dates, start, prev_stop);
             }
           if (prt_date)
             {
-              xxxqof_print_date_time_buff (buff, 100, start);
+              gtt_date_cache_date_time_buff (ghtml->dates, buff, 100, start);
               p = g_string_append (p, buff);
             }
           else
             {
-              xxxqof_print_time_buff (buff, 100, start);
+              gtt_date_cache_clock_buff (ghtml->dates, buff, 100, start);
               p = g_string_append (p, buff);
             }
 
           /* print hour only or date too? */
-          prt_date = xxxqof_is_same_day (start, stop);
+          prt_date = !gtt_date_cache_same_day (ghtml->dates, start, stop);
           if (show_links)
             p = g_string_append (p, "</a>");
           p = g_string_append (p, " &nbsp; &nbsp; </td>\n"
@@ -163,12 +165,12 @@ do_show_journal (GttGhtml *ghtml, GttProject *prj)
             }
           if (prt_date)
             {
-              xxxqof_print_date_time_buff (buff, 100, stop);
+              gtt_date_cache_date_time_buff (ghtml->dates, buff, 100, stop);
               p = g_string_append (p, buff);
             }
           else
             {
-              xxxqof_print_time_buff (buff, 100, stop);
+              gtt_date_cache_clock_buff (ghtml->dates, buff, 100, stop);
               p = g_string_append (p, buff);
             }
 
@@ -180,12 +182,12 @@ do_show_journal (GttGhtml *ghtml, GttProject *prj)
           xxxqof_print_hours_elapsed_buff (buff, 100, elapsed, TRUE);
           p = g_string_append (p, buff);
           p = g_string_append (p, " &nbsp; &nbsp; </td></tr>\n");
-          (ghtml->write_stream) (ghtml, p->str, p->len, ghtml->user_data);
+          gtt_ghtml_write (ghtml, p->str, p->len);
         }
     }
 
   ps = "</table>\n";
-  (ghtml->write_stream) (ghtml, ps, strlen (ps), ghtml->user_data);
+  gtt_ghtml_write (ghtml, ps, strlen (ps));
 
   /* should the free-segment be false or true ??? */
   g_string_free (p, FALSE);
@@ -338,7 +340,7 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
     }
   p = g_string_append (p, "\n");
 
-  (ghtml->write_stream) (ghtml, p->str, p->len, ghtml->user_data);
+  gtt_ghtml_write (ghtml, p->str, p->len);
 
   for (node = gtt_project_get_tasks (prj); node; node = node->next)
     {
@@ -530,7 +532,7 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
           if (output_html)
             p = g_string_append (p, "</tr>");
           p = g_string_append (p, "\n");
-          (ghtml->write_stream) (ghtml, p->str, p->len, ghtml->user_data);
+          gtt_ghtml_write (ghtml, p->str, p->len);
         }
 
       /* write out intervals */
@@ -547,10 +549,11 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
           elapsed = stop - start;
 
           /* print hour only or date too? */
-          prt_stop_date = xxxqof_is_same_day (start, stop);
+          prt_stop_date = !gtt_date_cache_same_day (ghtml->dates, start, stop);
           if (0 != prev_stop)
             {
-              prt_start_date = xxxqof_is_same_day (start, prev_stop);
+              prt_start_date
+                  = !gtt_date_cache_same_day (ghtml->dates, start, prev_stop);
             }
           prev_stop = stop;
 
@@ -574,12 +577,14 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
                       }
                     if (prt_start_date)
                       {
-                        xxxqof_print_date_time_buff (buff, 100, start);
+                        gtt_date_cache_date_time_buff (ghtml->dates, buff, 100,
+                                                       start);
                         p = g_string_append (p, buff);
                       }
                     else
                       {
-                        xxxqof_print_time_buff (buff, 100, start);
+                        gtt_date_cache_clock_buff (ghtml->dates, buff, 100,
+                                                   start);
                         p = g_string_append (p, buff);
                       }
                     if (show_links)
@@ -598,12 +603,14 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
                       }
                     if (prt_stop_date)
                       {
-                        xxxqof_print_date_time_buff (buff, 100, stop);
+                        gtt_date_cache_date_time_buff (ghtml->dates, buff, 100,
+                                                       stop);
                         p = g_string_append (p, buff);
                       }
                     else
                       {
-                        xxxqof_print_time_buff (buff, 100, stop);
+                        gtt_date_cache_clock_buff (ghtml->dates, buff, 100,
+                                                   stop);
                         p = g_string_append (p, buff);
                       }
                     if (show_links)
@@ -646,7 +653,7 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
           p = g_string_append (p, ghtml->delim);
           if (0 < p->len)
             {
-              (ghtml->write_stream) (ghtml, p->str, p->len, ghtml->user_data);
+              gtt_ghtml_write (ghtml, p->str, p->len);
             }
         }
 
@@ -658,7 +665,7 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
   if (output_html)
     {
       char *ps = "</table>\n";
-      (ghtml->write_stream) (ghtml, ps, strlen (ps), ghtml->user_data);
+      gtt_ghtml_write (ghtml, ps, strlen (ps));
     }
 }
 
@@ -667,14 +674,14 @@ do_show_table (GttGhtml *ghtml, GttProject *prj, int invoice)
 static SCM
 gtt_hello (void)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   char *p;
   if (NULL == ghtml->write_stream)
     return SCM_UNSPECIFIED;
 
   p = "Hello World!";
 
-  (ghtml->write_stream) (ghtml, p, strlen (p), ghtml->user_data);
+  gtt_ghtml_write (ghtml, p, strlen (p));
 
   /* maybe we should return something meaningful, like the string? */
   return SCM_UNSPECIFIED;
@@ -768,11 +775,11 @@ decode_column (GttGhtml *ghtml, const char *tok)
     {
       const char *str;
       str = _ ("unknown token: >>>>");
-      (ghtml->write_stream) (ghtml, str, strlen (str), ghtml->user_data);
+      gtt_ghtml_write (ghtml, str, strlen (str));
       str = tok;
-      (ghtml->write_stream) (ghtml, str, strlen (str), ghtml->user_data);
+      gtt_ghtml_write (ghtml, str, strlen (str));
       str = "<<<<";
-      (ghtml->write_stream) (ghtml, str, strlen (str), ghtml->user_data);
+      gtt_ghtml_write (ghtml, str, strlen (str));
     }
 }
 
@@ -811,7 +818,7 @@ decode_scm_col_list (GttGhtml *ghtml, SCM col_list)
 static SCM
 show_journal (SCM junk)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   do_show_journal (ghtml, ghtml->prj);
   return SCM_UNSPECIFIED;
 }
@@ -819,7 +826,7 @@ show_journal (SCM junk)
 static SCM
 show_table (SCM col_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   SCM rc;
   SCM_ASSERT (scm_is_pair (col_list), col_list, SCM_ARG1, "gtt-show-table");
   rc = decode_scm_col_list (ghtml, col_list);
@@ -830,7 +837,7 @@ show_table (SCM col_list)
 static SCM
 show_invoice (SCM col_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
   SCM rc;
   SCM_ASSERT (scm_is_pair (col_list), col_list, SCM_ARG1, "gtt-show-invoice");
   rc = decode_scm_col_list (ghtml, col_list);
@@ -841,7 +848,7 @@ show_invoice (SCM col_list)
 static SCM
 show_export (SCM col_list)
 {
-  GttGhtml *ghtml = ghtml_guile_global_hack;
+  GttGhtml *ghtml = gtt_ghtml_current ();
 
   SCM rc;
   SCM_ASSERT (scm_is_pair (col_list), col_list, SCM_ARG1, "gtt-show-export");
@@ -627,6 +627,46 @@ gtt_gsettings_load (void)
     }
 }
 
+/* ======================================================= */
+
+void
+gtt_gsettings_load_report_config (void)
+{
+  gtt_init_settings ();
+
+  {
+    GSettings *misc = g_settings_get_child (settings, "misc");
+
+    config_daystart_offset = g_settings_get_int (misc, "day-start-offset");
+    config_weekstart_offset = g_settings_get_int (misc, "week-start-offset");
+
+    g_object_unref (misc);
+    misc = NULL;
+  }
+
+  config_time_format = g_settings_get_int (settings, "time-format");
+
+  {
+    GSettings *report = g_settings_get_child (settings, "report");
+
+    gtt_settings_get_str (report, "currency-symbol", &config_currency_symbol);
+    config_currency_use_locale
+        = g_settings_get_boolean (report, "currency-use-locale");
+
+    g_object_unref (report);
+    report = NULL;
+  }
+
+  {
+    GSettings *data = g_settings_get_child (settings, "data");
+
+    gtt_settings_get_str (data, "url", &config_data_url);
+
+    g_object_unref (data);
+    data = NULL;
+  }
+}
+
 gchar *
 gtt_gsettings_get_expander (void)
 {
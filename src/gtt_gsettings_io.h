@@ -34,6 +34,14 @@ void gtt_gsettings_save (void);
  */
 void gtt_gsettings_load (void);
 
+/**
+ * The gtt_gsettings_load_report_config() routine fetches only the
+ * attributes needed to load the data file and print reports: the
+ * data file location, day and week start, time format and currency.
+ * It doesn't touch the GUI, and so can be used without a display.
+ */
+void gtt_gsettings_load_report_config (void);
+
 /**
  * The gtt_save_reports_menu() routine saves only the reports menu
  * attributes to the GSettings settings system.
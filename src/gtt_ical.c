@@ -0,0 +1,1017 @@
+/*   iCalendar export and import, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_ical.h"
+
+#include <errno.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <qof.h>
+
+/* ============================================================== */
+/* Writing, a component at a time */
+
+typedef struct
+{
+  FILE *fh;
+  GString *out; /* written to instead of fh, if not NULL */
+  gboolean failed;
+  char stamp[20]; /* DTSTAMP, the same for the whole calendar */
+  GString *line;
+} IcalWriter;
+
+static void
+ical_time (time_t when, char *buf)
+{
+  struct tm tm;
+
+  gmtime_r (&when, &tm);
+  strftime (buf, 20, "%Y%m%dT%H%M%SZ", &tm);
+}
+
+static void
+ical_writer_init (IcalWriter *w, FILE *fh)
+{
+  w->fh = fh;
+  w->out = NULL;
+  w->failed = FALSE;
+  w->line = g_string_sized_new (128);
+  ical_time (time (NULL), w->stamp);
+}
+
+static void
+ical_put (IcalWriter *w, const char *p, gsize n, const char *end)
+{
+  if (w->out)
+    {
+      g_string_append_len (w->out, p, n);
+      g_string_append (w->out, end);
+    }
+  else if (n != fwrite (p, 1, n, w->fh) || 0 > fputs (end, w->fh))
+    w->failed = TRUE;
+}
+
+/* Write out a content line, folded after every 75 bytes, but never
+ * in the middle of a UTF-8 character. */
+static void
+ical_flush_line (IcalWriter *w)
+{
+  const char *p = w->line->str;
+  gsize left = w->line->len;
+  gsize room = 75;
+
+  while (left > room)
+    {
+      gsize n = room;
+      while (0 < n && 0x80 == (p[n] & 0xc0))
+        n--;
+      ical_put (w, p, n, "\r\n ");
+      p += n;
+      left -= n;
+      room = 74;
+    }
+  ical_put (w, p, left, "\r\n");
+}
+
+/* A property with a TEXT value, escaped */
+static void
+ical_text (IcalWriter *w, const char *name, const char *value)
+{
+  const char *p;
+
+  if (!value || !value[0])
+    return;
+  g_string_assign (w->line, name);
+  g_string_append_c (w->line, ':');
+  for (p = value; *p; p++)
+    {
+      switch (*p)
+        {
+        case '\\':
+        case ';':
+        case ',':
+          g_string_append_c (w->line, '\\');
+          g_string_append_c (w->line, *p);
+          break;
+        case '\n':
+          g_string_append (w->line, "\\n");
+          break;
+        case '\r':
+          break;
+        default:
+          g_string_append_c (w->line, *p);
+        }
+    }
+  ical_flush_line (w);
+}
+
+/* A property written as it is */
+static void
+ical_prop (IcalWriter *w, const char *name, const char *value)
+{
+  g_string_assign (w->line, name);
+  g_string_append_c (w->line, ':');
+  g_string_append (w->line, value);
+  ical_flush_line (w);
+}
+
+static void
+ical_date_prop (IcalWriter *w, const char *name, time_t when)
+{
+  char buf[20];
+
+  ical_time (when, buf);
+  ical_prop (w, name, buf);
+}
+
+static const char *
+ical_status (GttProjectStatus status)
+{
+  switch (status)
+    {
+    case GTT_NOT_STARTED:
+      return "NEEDS-ACTION";
+    case GTT_IN_PROGRESS:
+    case GTT_ON_HOLD:
+      return "IN-PROCESS";
+    case GTT_CANCELLED:
+      return "CANCELLED";
+    case GTT_COMPLETED:
+      return "COMPLETED";
+    default:
+      return NULL;
+    }
+}
+
+static void
+write_todo (IcalWriter *w, GttProject *prj, const char *uid)
+{
+  GttProject *parent = gtt_project_get_parent (prj);
+  time_t start = gtt_project_get_estimated_start (prj);
+  time_t due = gtt_project_get_due_date (prj);
+  const char *status;
+  char buf[GUID_ENCODING_LENGTH + 16];
+
+  ical_prop (w, "BEGIN", "VTODO");
+  ical_prop (w, "UID", uid);
+  ical_prop (w, "DTSTAMP", w->stamp);
+  ical_text (w, "SUMMARY", gtt_project_get_title (prj));
+  ical_text (w, "DESCRIPTION", gtt_project_get_desc (prj));
+  if (-1 != start)
+    ical_date_prop (w, "DTSTART", start);
+  if (-1 != due)
+    ical_date_prop (w, "DUE", due);
+
+  status = ical_status (gtt_project_get_status (prj));
+  if (status)
+    ical_prop (w, "STATUS", status);
+  if (0 < gtt_project_get_percent_complete (prj))
+    {
+      g_snprintf (buf, sizeof (buf), "%d",
+                  MIN (gtt_project_get_percent_complete (prj), 100));
+      ical_prop (w, "PERCENT-COMPLETE", buf);
+    }
+  /* 1 is the highest priority, and 9 the lowest */
+  switch (gtt_project_get_importance (prj))
+    {
+    case GTT_HIGH:
+      ical_prop (w, "PRIORITY", "1");
+      break;
+    case GTT_MEDIUM:
+      ical_prop (w, "PRIORITY", "5");
+      break;
+    case GTT_LOW:
+      ical_prop (w, "PRIORITY", "9");
+      break;
+    default:
+      break;
+    }
+  if (parent)
+    {
+      guid_to_string_buff (gtt_project_get_guid (parent), buf);
+      strcat (buf, "@gnotime");
+      ical_prop (w, "RELATED-TO", buf);
+    }
+  ical_prop (w, "END", "VTODO");
+}
+
+static void
+write_event (IcalWriter *w, GttProject *prj, GttTask *tsk, GttInterval *ivl,
+             const char *prj_uid)
+{
+  const char *memo = gtt_task_get_memo (tsk);
+  char uid[GUID_ENCODING_LENGTH + 48];
+  char *p;
+
+  guid_to_string_buff (gtt_task_get_guid (tsk), uid);
+  p = uid + strlen (uid);
+  g_snprintf (p, sizeof (uid) - (p - uid), "-%" G_GINT64_FORMAT "@gnotime",
+              (gint64)gtt_interval_get_start (ivl));
+
+  ical_prop (w, "BEGIN", "VEVENT");
+  ical_prop (w, "UID", uid);
+  ical_prop (w, "DTSTAMP", w->stamp);
+  ical_date_prop (w, "DTSTART", gtt_interval_get_start (ivl));
+  ical_date_prop (w, "DTEND", gtt_interval_get_stop (ivl));
+  ical_text (w, "SUMMARY",
+             (memo && memo[0]) ? memo : gtt_project_get_title (prj));
+  ical_text (w, "DESCRIPTION", gtt_task_get_notes (tsk));
+  ical_text (w, "CATEGORIES", gtt_project_get_title (prj));
+  ical_prop (w, "RELATED-TO", prj_uid);
+  ical_prop (w, "TRANSP", "TRANSPARENT");
+  ical_text (w, "X-GNOTIME-PROJECT", gtt_project_get_title (prj));
+  ical_text (w, "X-GNOTIME-TASK", memo);
+  ical_prop (w, "END", "VEVENT");
+}
+
+/* The components of the one project, not of its subprojects */
+static void
+write_project (IcalWriter *w, GttProject *prj)
+{
+  char uid[GUID_ENCODING_LENGTH + 16];
+  GList *tn, *in;
+
+  guid_to_string_buff (gtt_project_get_guid (prj), uid);
+  strcat (uid, "@gnotime");
+
+  if (-1 != gtt_project_get_estimated_start (prj)
+      || -1 != gtt_project_get_due_date (prj))
+    write_todo (w, prj, uid);
+
+  for (tn = gtt_project_get_tasks (prj); tn; tn = tn->next)
+    {
+      for (in = gtt_task_get_intervals (tn->data); in; in = in->next)
+        write_event (w, prj, tn->data, in->data, uid);
+    }
+}
+
+static void
+write_projects (IcalWriter *w, GList *prjs, gboolean include_subprojects)
+{
+  for (; prjs && !w->failed; prjs = prjs->next)
+    {
+      write_project (w, prjs->data);
+      if (include_subprojects)
+        write_projects (w, gtt_project_get_children (prjs->data), TRUE);
+    }
+}
+
+static void
+write_begin (IcalWriter *w)
+{
+  ical_prop (w, "BEGIN", "VCALENDAR");
+  ical_prop (w, "VERSION", "2.0");
+  ical_prop (w, "PRODID", "-//GnoTime//GnoTime " VERSION "//EN");
+}
+
+static gboolean
+write_end (IcalWriter *w)
+{
+  ical_prop (w, "END", "VCALENDAR");
+  g_string_free (w->line, TRUE);
+  return !w->failed;
+}
+
+gboolean
+gtt_ical_write (GList *prjs, gboolean include_subprojects, FILE *fh)
+{
+  IcalWriter w;
+
+  g_return_val_if_fail (fh, FALSE);
+
+  ical_writer_init (&w, fh);
+  write_begin (&w);
+  write_projects (&w, prjs, include_subprojects);
+  return write_end (&w);
+}
+
+/* ============================================================== */
+/* Syncing into a directory, a file per project */
+
+struct gtt_ical_sync_s
+{
+  char *dir;
+  GHashTable *generations; /* GUID string -> generation last written */
+};
+
+GttIcalSync *
+gtt_ical_sync_new (const char *dir)
+{
+  GttIcalSync *sync;
+
+  g_return_val_if_fail (dir, NULL);
+
+  sync = g_new0 (GttIcalSync, 1);
+  sync->dir = g_strdup (dir);
+  sync->generations = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, NULL);
+  return sync;
+}
+
+void
+gtt_ical_sync_free (GttIcalSync *sync)
+{
+  if (!sync)
+    return;
+  g_hash_table_destroy (sync->generations);
+  g_free (sync->dir);
+  g_free (sync);
+}
+
+/* The text, less its DTSTAMP lines, which change on every write */
+static char *
+strip_stamps (const char *text)
+{
+  GString *str = g_string_new (NULL);
+  const char *end;
+
+  for (; *text; text = end)
+    {
+      end = strchr (text, '\n');
+      end = end ? end + 1 : text + strlen (text);
+      if (strncmp (text, "DTSTAMP:", 8))
+        g_string_append_len (str, text, end - text);
+    }
+  return g_string_free (str, FALSE);
+}
+
+static gboolean
+same_calendar (const char *a, const char *b)
+{
+  char *sa = strip_stamps (a);
+  char *sb = strip_stamps (b);
+  gboolean same = !strcmp (sa, sb);
+
+  g_free (sa);
+  g_free (sb);
+  return same;
+}
+
+/* Write the file, unless it already says the same thing; then it's
+ * left alone, so that the calendar doesn't reload it for nothing.
+ * Sync state isn't kept anywhere else, so this is what keeps a sync
+ * that's run from cron from rewriting everything, every time.  It
+ * returns 1 if the file was written, 0 if it was already up to date,
+ * and -1 on error.
+ *
+ * Write it to a temporary file first, so that a calendar reading the
+ * directory never sees half of one. */
+static int
+sync_write_file (GttIcalSync *sync, GttProject *prj, const char *guid,
+                 char **errmsg)
+{
+  IcalWriter w;
+  char *name, *path, *tmp, *old;
+  int rc = 1;
+  FILE *fh;
+
+  name = g_strconcat (guid, ".ics", NULL);
+  path = g_build_filename (sync->dir, name, NULL);
+  g_free (name);
+
+  ical_writer_init (&w, NULL);
+  w.out = g_string_new (NULL);
+  write_begin (&w);
+  write_project (&w, prj);
+  write_end (&w);
+
+  if (g_file_get_contents (path, &old, NULL, NULL))
+    {
+      if (same_calendar (old, w.out->str))
+        rc = 0;
+      g_free (old);
+    }
+
+  if (1 == rc)
+    {
+      tmp = g_strconcat (path, ".tmp", NULL);
+      fh = g_fopen (tmp, "wb");
+      if (!fh || w.out->len != fwrite (w.out->str, 1, w.out->len, fh))
+        rc = -1;
+      if (fh && fclose (fh))
+        rc = -1;
+      if (1 == rc && g_rename (tmp, path))
+        rc = -1;
+      if (0 > rc)
+        {
+          if (errmsg)
+            *errmsg = g_strdup_printf (_ ("Failed to write %s: %s"), path,
+                                       g_strerror (errno));
+          g_unlink (tmp);
+        }
+      g_free (tmp);
+    }
+  g_string_free (w.out, TRUE);
+  g_free (path);
+  return rc;
+}
+
+static int
+sync_projects (GttIcalSync *sync, GList *prjs, GHashTable *seen,
+               char **errmsg)
+{
+  int n = 0;
+
+  for (; prjs; prjs = prjs->next)
+    {
+      GttProject *prj = prjs->data;
+      guint gen = gtt_project_get_generation (prj);
+      char guid[GUID_ENCODING_LENGTH + 1];
+      gpointer old;
+      int m;
+
+      guid_to_string_buff (gtt_project_get_guid (prj), guid);
+      g_hash_table_add (seen, g_strdup (guid));
+
+      if (!g_hash_table_lookup_extended (sync->generations, guid, NULL,
+                                         &old)
+          || GPOINTER_TO_UINT (old) != gen)
+        {
+          m = sync_write_file (sync, prj, guid, errmsg);
+          if (0 > m)
+            return -1;
+          g_hash_table_replace (sync->generations, g_strdup (guid),
+                                GUINT_TO_POINTER (gen));
+          n += m;
+        }
+
+      m = sync_projects (sync, gtt_project_get_children (prj), seen,
+                         errmsg);
+      if (0 > m)
+        return -1;
+      n += m;
+    }
+  return n;
+}
+
+/* Our files are named with just the 32 hex digits of a GUID */
+static gboolean
+is_guid_file (const char *name)
+{
+  int i;
+
+  for (i = 0; i < GUID_ENCODING_LENGTH; i++)
+    {
+      if (!g_ascii_isxdigit (name[i]))
+        return FALSE;
+    }
+  return !strcmp (name + GUID_ENCODING_LENGTH, ".ics");
+}
+
+int
+gtt_ical_sync (GttIcalSync *sync, GList *prjs, char **errmsg)
+{
+  GHashTable *seen;
+  GError *error = NULL;
+  const char *name;
+  GDir *dir;
+  int n;
+
+  g_return_val_if_fail (sync, -1);
+
+  if (g_mkdir_with_parents (sync->dir, 0755))
+    {
+      if (errmsg)
+        *errmsg = g_strdup_printf (_ ("Failed to create %s: %s"), sync->dir,
+                                   g_strerror (errno));
+      return -1;
+    }
+
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  n = sync_projects (sync, prjs, seen, errmsg);
+  if (0 > n)
+    {
+      g_hash_table_destroy (seen);
+      return -1;
+    }
+
+  /* Then get rid of the projects that are gone */
+  dir = g_dir_open (sync->dir, 0, &error);
+  if (!dir)
+    {
+      if (errmsg)
+        *errmsg = g_strdup (error->message);
+      g_error_free (error);
+      g_hash_table_destroy (seen);
+      return -1;
+    }
+  while ((name = g_dir_read_name (dir)))
+    {
+      char guid[GUID_ENCODING_LENGTH + 1];
+      char *path;
+
+      if (!is_guid_file (name))
+        continue;
+      g_strlcpy (guid, name, sizeof (guid));
+      if (g_hash_table_contains (seen, guid))
+        continue;
+      path = g_build_filename (sync->dir, name, NULL);
+      g_unlink (path);
+      g_free (path);
+      g_hash_table_remove (sync->generations, guid);
+    }
+  g_dir_close (dir);
+  g_hash_table_destroy (seen);
+  return n;
+}
+
+/* ============================================================== */
+/* Reading, a line at a time */
+
+typedef struct
+{
+  FILE *fh;
+  GString *next; /* the physical line after this one */
+  gboolean have_next;
+} IcalReader;
+
+/* A physical line, without its line end */
+static gboolean
+ical_read_line (FILE *fh, GString *line)
+{
+  int c;
+
+  g_string_truncate (line, 0);
+  while (EOF != (c = getc (fh)))
+    {
+      if ('\n' == c)
+        break;
+      g_string_append_c (line, c);
+    }
+  if (EOF == c && 0 == line->len)
+    return FALSE;
+  if (line->len && '\r' == line->str[line->len - 1])
+    g_string_truncate (line, line->len - 1);
+  return TRUE;
+}
+
+/* A content line, unfolded */
+static gboolean
+ical_next (IcalReader *rd, GString *line)
+{
+  if (rd->have_next)
+    g_string_assign (line, rd->next->str);
+  else if (!ical_read_line (rd->fh, line))
+    return FALSE;
+
+  for (;;)
+    {
+      rd->have_next = ical_read_line (rd->fh, rd->next);
+      if (!rd->have_next)
+        break;
+      if (' ' != rd->next->str[0] && '\t' != rd->next->str[0])
+        break;
+      g_string_append (line, rd->next->str + 1);
+    }
+  return TRUE;
+}
+
+static char *
+ical_unescape (const char *value)
+{
+  GString *str = g_string_sized_new (strlen (value));
+  const char *p;
+
+  for (p = value; *p; p++)
+    {
+      if ('\\' == *p && p[1])
+        {
+          p++;
+          g_string_append_c (str, ('n' == *p || 'N' == *p) ? '\n' : *p);
+        }
+      else
+        g_string_append_c (str, *p);
+    }
+  return g_string_free (str, FALSE);
+}
+
+/* The first of a list of TEXT values */
+static char *
+ical_first_text (const char *value)
+{
+  char *first, *text;
+  const char *p;
+
+  for (p = value; *p && ',' != *p; p++)
+    {
+      if ('\\' == *p && p[1])
+        p++;
+    }
+  first = g_strndup (value, p - value);
+  text = ical_unescape (first);
+  g_free (first);
+  return text;
+}
+
+/* The value of the parameter 'name', or NULL */
+static char *
+ical_param (const char *params, const char *name)
+{
+  gsize len = strlen (name);
+  const char *p = params;
+
+  while (p && *p)
+    {
+      const char *end;
+
+      if (';' == *p)
+        p++;
+      if (!g_ascii_strncasecmp (p, name, len) && '=' == p[len])
+        {
+          p += len + 1;
+          if ('"' == *p)
+            {
+              end = strchr (++p, '"');
+              return end ? g_strndup (p, end - p) : NULL;
+            }
+          end = strchr (p, ';');
+          return end ? g_strndup (p, end - p) : g_strdup (p);
+        }
+      /* Skip to the next parameter, over any quoted values */
+      while (*p && ';' != *p)
+        {
+          if ('"' == *p)
+            {
+              p = strchr (p + 1, '"');
+              if (!p)
+                return NULL;
+            }
+          p++;
+        }
+    }
+  return NULL;
+}
+
+/* DATE or DATE-TIME, in UTC, in the zone named by TZID, or floating.
+ * 'is_date' is set if it is a plain DATE (VALUE=DATE, or no time of
+ * day), which is taken as local midnight. */
+static gboolean
+ical_parse_time (const char *params, const char *value, time_t *when,
+                 gboolean *is_date)
+{
+  int y, mo, d, h = 0, mi = 0, s = 0, n = 0;
+  GTimeZone *tz = NULL;
+  GDateTime *dt;
+  char *tzid, *type;
+  struct tm tm;
+
+  if (3 != sscanf (value, "%4d%2d%2d%n", &y, &mo, &d, &n) || 8 != n)
+    return FALSE;
+  type = ical_param (params, "VALUE");
+  *is_date = ('T' != value[8]) || (type && !g_ascii_strcasecmp (type, "DATE"));
+  g_free (type);
+  if (!*is_date)
+    {
+      if (3 != sscanf (value + 9, "%2d%2d%2d", &h, &mi, &s))
+        return FALSE;
+      if ('Z' == value[15])
+        tz = g_time_zone_new_utc ();
+    }
+
+  tzid = tz ? NULL : ical_param (params, "TZID");
+  if (tzid)
+    {
+#if GLIB_CHECK_VERSION(2, 68, 0)
+      tz = g_time_zone_new_identifier ('/' == tzid[0] ? tzid + 1 : tzid);
+#else
+      tz = g_time_zone_new ('/' == tzid[0] ? tzid + 1 : tzid);
+#endif
+      g_free (tzid);
+    }
+
+  if (tz)
+    {
+      dt = g_date_time_new (tz, y, mo, d, h, mi, s);
+      g_time_zone_unref (tz);
+      if (!dt)
+        return FALSE;
+      *when = g_date_time_to_unix (dt);
+      g_date_time_unref (dt);
+      return TRUE;
+    }
+
+  /* Floating time, or a zone we don't know: take it as local */
+  memset (&tm, 0, sizeof (tm));
+  tm.tm_year = y - 1900;
+  tm.tm_mon = mo - 1;
+  tm.tm_mday = d;
+  tm.tm_hour = h;
+  tm.tm_min = mi;
+  tm.tm_sec = s;
+  tm.tm_isdst = -1;
+  *when = mktime (&tm);
+  return (-1 != *when);
+}
+
+/* [+]P[nW][nD][T[nH][nM][nS]] */
+static gboolean
+ical_parse_duration (const char *value, long *secs)
+{
+  const char *p = value;
+  gboolean in_time = FALSE;
+  long total = 0;
+
+  if ('+' == *p)
+    p++;
+  if ('P' != *p++)
+    return FALSE;
+  while (*p)
+    {
+      char *end;
+      long n;
+
+      if ('T' == *p)
+        {
+          in_time = TRUE;
+          p++;
+          continue;
+        }
+      n = strtol (p, &end, 10);
+      if (end == p || 0 > n)
+        return FALSE;
+      switch (*end)
+        {
+        case 'W':
+          total += n * 7 * 86400;
+          break;
+        case 'D':
+          total += n * 86400;
+          break;
+        case 'H':
+          total += n * 3600;
+          break;
+        case 'M':
+          total += n * (in_time ? 60 : 30 * 86400);
+          break;
+        case 'S':
+          total += n;
+          break;
+        default:
+          return FALSE;
+        }
+      p = end + 1;
+    }
+  *secs = total;
+  return TRUE;
+}
+
+typedef struct
+{
+  gboolean is_todo;
+  gboolean repeats;
+  gboolean all_day;
+  char *summary;
+  char *description;
+  char *category;
+  char *project;
+  char *task;
+  char *status;
+  int percent;
+  int priority;
+  gboolean has_start, has_end, has_due, has_duration;
+  time_t start, end, due;
+  long duration;
+} IcalComponent;
+
+static void
+component_clear (IcalComponent *c)
+{
+  g_free (c->summary);
+  g_free (c->description);
+  g_free (c->category);
+  g_free (c->project);
+  g_free (c->task);
+  g_free (c->status);
+  memset (c, 0, sizeof (*c));
+  c->percent = -1;
+}
+
+static void
+component_prop (IcalComponent *c, const char *name, const char *params,
+                const char *value)
+{
+  char **text = NULL;
+  gboolean is_date = FALSE;
+
+  if (!g_ascii_strcasecmp (name, "SUMMARY"))
+    text = &c->summary;
+  else if (!g_ascii_strcasecmp (name, "DESCRIPTION"))
+    text = &c->description;
+  else if (!g_ascii_strcasecmp (name, "X-GNOTIME-PROJECT"))
+    text = &c->project;
+  else if (!g_ascii_strcasecmp (name, "X-GNOTIME-TASK"))
+    text = &c->task;
+  else if (!g_ascii_strcasecmp (name, "STATUS"))
+    text = &c->status;
+  else if (!g_ascii_strcasecmp (name, "CATEGORIES"))
+    {
+      if (!c->category)
+        c->category = ical_first_text (value);
+    }
+  else if (!g_ascii_strcasecmp (name, "DTSTART"))
+    c->has_start = ical_parse_time (params, value, &c->start, &is_date);
+  else if (!g_ascii_strcasecmp (name, "DTEND"))
+    c->has_end = ical_parse_time (params, value, &c->end, &is_date);
+  else if (!g_ascii_strcasecmp (name, "DUE"))
+    c->has_due = ical_parse_time (params, value, &c->due, &is_date);
+  else if (!g_ascii_strcasecmp (name, "DURATION"))
+    c->has_duration = ical_parse_duration (value, &c->duration);
+  else if (!g_ascii_strcasecmp (name, "PERCENT-COMPLETE"))
+    c->percent = atoi (value);
+  else if (!g_ascii_strcasecmp (name, "PRIORITY"))
+    c->priority = atoi (value);
+  else if (!g_ascii_strcasecmp (name, "RRULE")
+           || !g_ascii_strcasecmp (name, "RDATE"))
+    c->repeats = TRUE;
+
+  if (is_date && g_ascii_strcasecmp (name, "DUE"))
+    c->all_day = TRUE;
+
+  if (text)
+    {
+      g_free (*text);
+      *text = ical_unescape (value);
+    }
+}
+
+static GttProjectStatus
+component_status (const char *status)
+{
+  if (!g_ascii_strcasecmp (status, "NEEDS-ACTION"))
+    return GTT_NOT_STARTED;
+  if (!g_ascii_strcasecmp (status, "IN-PROCESS"))
+    return GTT_IN_PROGRESS;
+  if (!g_ascii_strcasecmp (status, "CANCELLED"))
+    return GTT_CANCELLED;
+  if (!g_ascii_strcasecmp (status, "COMPLETED"))
+    return GTT_COMPLETED;
+  return GTT_NO_STATUS;
+}
+
+/* Returns FALSE if the component was skipped */
+static gboolean
+component_import (GttImport *imp, IcalComponent *c)
+{
+  GttProject *prj;
+  GttTask *tsk;
+  const char *title, *notes;
+  time_t stop;
+
+  if (c->is_todo)
+    {
+      if (!c->summary || !c->summary[0])
+        return FALSE;
+      prj = gtt_import_project (imp, NULL, c->summary);
+      if (c->description)
+        gtt_project_set_desc (prj, c->description);
+      if (c->has_start)
+        gtt_project_set_estimated_start (prj, c->start);
+      if (c->has_due)
+        gtt_project_set_due_date (prj, c->due);
+      if (c->status && GTT_NO_STATUS != component_status (c->status))
+        gtt_project_set_status (prj, component_status (c->status));
+      if (0 <= c->percent)
+        gtt_project_set_percent_complete (prj, MIN (c->percent, 100));
+      if (1 <= c->priority && c->priority <= 9)
+        gtt_project_set_importance (prj, (c->priority <= 4)   ? GTT_HIGH
+                                         : (c->priority == 5) ? GTT_MEDIUM
+                                                              : GTT_LOW);
+      return TRUE;
+    }
+
+  /* An all-day event says nothing about the hours worked: a holiday
+   * or a deadline, not a day-long interval. */
+  if (c->repeats || c->all_day || !c->has_start)
+    return FALSE;
+  if (c->has_end)
+    stop = c->end;
+  else if (c->has_duration)
+    stop = c->start + c->duration;
+  else
+    return FALSE;
+
+  title = c->project ? c->project : c->category ? c->category : c->summary;
+  if (!title || !title[0])
+    return FALSE;
+  prj = gtt_import_project (imp, NULL, title);
+
+  if (c->task)
+    tsk = gtt_import_task (imp, prj, c->task);
+  else if (c->project || c->category)
+    tsk = gtt_import_task (imp, prj, c->summary ? c->summary : "");
+  else
+    tsk = gtt_import_task (imp, prj, "");
+  notes = gtt_task_get_notes (tsk);
+  if (c->description && (!notes || !notes[0]))
+    gtt_task_set_notes (tsk, c->description);
+
+  return gtt_import_interval (imp, tsk, c->start, stop, 0);
+}
+
+gboolean
+gtt_ical_read (GttImport *imp, FILE *fh, int *skipped, char **errmsg)
+{
+  IcalReader rd;
+  IcalComponent comp;
+  GString *line;
+  gboolean in_calendar = FALSE, in_comp = FALSE;
+  int nested = 0, nskipped = 0;
+
+  g_return_val_if_fail (imp && fh, FALSE);
+
+  rd.fh = fh;
+  rd.next = g_string_new (NULL);
+  rd.have_next = FALSE;
+  line = g_string_new (NULL);
+  memset (&comp, 0, sizeof (comp));
+  component_clear (&comp);
+
+  while (ical_next (&rd, line))
+    {
+      char *name, *params, *value, *p;
+
+      /* NAME[;PARAM=...]:VALUE; the colon may be in a quoted
+       * parameter value */
+      name = line->str;
+      for (p = name; *p && ':' != *p; p++)
+        {
+          if ('"' == *p && !(p = strchr (p + 1, '"')))
+            break;
+        }
+      if (!p || !*p)
+        continue;
+      *p = 0;
+      value = p + 1;
+      params = strchr (name, ';');
+      if (params)
+        *params++ = 0;
+      else
+        params = "";
+
+      if (!g_ascii_strcasecmp (name, "BEGIN"))
+        {
+          if (!g_ascii_strcasecmp (value, "VCALENDAR"))
+            in_calendar = TRUE;
+          else if (in_comp)
+            nested++;
+          else if (!g_ascii_strcasecmp (value, "VEVENT")
+                   || !g_ascii_strcasecmp (value, "VTODO"))
+            {
+              in_comp = TRUE;
+              comp.is_todo = !g_ascii_strcasecmp (value, "VTODO");
+            }
+        }
+      else if (!g_ascii_strcasecmp (name, "END"))
+        {
+          if (in_comp && nested)
+            nested--;
+          else if (in_comp)
+            {
+              if (!component_import (imp, &comp))
+                nskipped++;
+              component_clear (&comp);
+              in_comp = FALSE;
+            }
+        }
+      else if (in_comp && !nested)
+        component_prop (&comp, name, params, value);
+    }
+
+  component_clear (&comp);
+  g_string_free (line, TRUE);
+  g_string_free (rd.next, TRUE);
+  if (skipped)
+    *skipped = nskipped;
+
+  if (ferror (fh) || !in_calendar)
+    {
+      if (errmsg)
+        *errmsg = g_strdup (ferror (fh) ? g_strerror (errno)
+                                        : _ ("This is not an iCalendar"));
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* ======================= END OF FILE =================== */
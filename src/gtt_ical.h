@@ -0,0 +1,82 @@
+/*   iCalendar export and import, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_ICAL_H
+#define GTT_ICAL_H
+
+#include <glib.h>
+#include <stdio.h>
+
+#include "gtt_import.h"
+#include "gtt_project.h"
+
+/* The iCalendar routines put the projects on a calendar, as in RFC
+ * 5545.  Each interval becomes a VEVENT, whose summary is the task's
+ * memo, with the project's title as its category; and each project
+ * that has an estimated start or a due date becomes a VTODO.  The
+ * components are written out one at a time as the projects are
+ * walked, and read in a line at a time, so neither end ever holds a
+ * whole calendar.  All times are written in UTC.
+ *
+ * Each component's UID is made from the GUID of its project, or of
+ * its task and its start time, so that a calendar that already has
+ * it replaces it.  The project title and task memo also go into
+ * X-GNOTIME-PROJECT and X-GNOTIME-TASK, so that they read back the
+ * same.
+ *
+ * The gtt_ical_write() routine writes a calendar of the projects in
+ *    'prjs', and their subprojects, if 'include_subprojects' is TRUE.
+ *    It returns FALSE if it couldn't write all of it.
+ *
+ * The gtt_ical_sync_new() routine sets up a sync of the project list
+ *    into the directory 'dir', which will hold one file per project,
+ *    named after its GUID, as for a local calendar collection.
+ *
+ * The gtt_ical_sync() routine writes the file of each project that
+ *    has changed since the last sync (going by
+ *    gtt_project_get_generation()), and deletes the files of projects
+ *    that are gone.  The first sync looks at them all, but a file is
+ *    only rewritten if what it says has changed (other than its
+ *    DTSTAMPs); so a sync run afresh from cron leaves alone the files
+ *    of projects that haven't changed.  It returns the number of files
+ *    written, or -1 and an error message (to be g_free()'d).
+ *
+ * The gtt_ical_read() routine reads a calendar, adding its events as
+ *    intervals, and its to-dos as projects, to the import 'imp' (see
+ *    gtt_import.h).  The project of an event is its X-GNOTIME-PROJECT,
+ *    or its first category, or, failing those, its summary.  Events
+ *    with no end or duration, repeating events, and all-day events
+ *    (those whose DTSTART or DTEND is a DATE, not a DATE-TIME) are
+ *    skipped, adding no intervals, and counted in 'skipped', if that
+ *    isn't NULL.  It returns FALSE, and an error message, if it can't
+ *    be read.
+ */
+
+typedef struct gtt_ical_sync_s GttIcalSync;
+
+gboolean gtt_ical_write (GList *prjs, gboolean include_subprojects,
+                         FILE *fh);
+
+GttIcalSync *gtt_ical_sync_new (const char *dir);
+int gtt_ical_sync (GttIcalSync *, GList *prjs, char **errmsg);
+void gtt_ical_sync_free (GttIcalSync *);
+
+gboolean gtt_ical_read (GttImport *imp, FILE *fh, int *skipped,
+                        char **errmsg);
+
+#endif // GTT_ICAL_H
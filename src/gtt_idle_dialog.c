@@ -21,19 +21,16 @@
 
 #include "gtt_idle_dialog.h"
 
-#include <gdk/gdkx.h>
 #include <glib.h>
 
 #include <string.h>
 
-#include <X11/Xlib.h>
-#include <X11/extensions/scrnsaver.h>
-
 #include <qof.h>
 
 #include "gtt_application_window.h"
 #include "gtt_current_project.h"
 #include "gtt_help_popup.h"
+#include "gtt_idle_timer.h"
 #include "gtt_project.h"
 #include "gtt_util.h"
 
@@ -50,10 +47,7 @@ struct GttIdleDialog_s
   GtkLabel *time_label;
   GtkRange *scale;
 
-  Display *display;
-  gboolean xss_extension_supported;
-  XScreenSaverInfo *xss_info;
-  guint timeout_event_source;
+  IdleTimeout *idle_timeout;
 
   gboolean visible;
 
@@ -62,61 +56,36 @@ struct GttIdleDialog_s
   time_t previous_credit;
 };
 
-static gboolean idle_timeout_func (gpointer data);
+/* The keyboard and mouse have been idle for config_idle_timeout
+ * seconds: stop the clock, and ask the user what to do with the time. */
 
 static void
-schedule_idle_timeout (gint timeout, GttIdleDialog *idle_dialog)
+user_idle_cb (IdleTimeout *si, gpointer data)
 {
-  if (idle_dialog->timeout_event_source != 0)
-    {
-      g_source_remove (idle_dialog->timeout_event_source);
-    }
-  if (timeout > 0 && idle_dialog->xss_extension_supported)
-    {
-      /* If we already have an idle timeout
-       * sceduled, cancel it.
-       */
-      idle_dialog->timeout_event_source
-          = g_timeout_add_seconds (timeout, idle_timeout_func, idle_dialog);
-    }
+  GttIdleDialog *idle_dialog = data;
+  time_t last_activity;
+
+  if (NULL == cur_proj)
+    return;
+
+  last_activity = poll_last_activity (si);
+  if ((time_t)-1 == last_activity)
+    return;
+  idle_dialog->last_activity = last_activity;
+  show_idle_dialog (idle_dialog);
 }
 
-static gboolean
-idle_timeout_func (gpointer data)
+/* The user is back; make sure they can see the dialog. */
+
+static void
+user_active_cb (IdleTimeout *si, gpointer data)
 {
-  GttIdleDialog *idle_dialog = (GttIdleDialog *)data;
-  GdkWindow *gdk_window = gtk_widget_get_root_window (app_window);
-  XID drawable = gdk_x11_drawable_get_xid (GDK_DRAWABLE (gdk_window));
-  Status xss_query_ok = XScreenSaverQueryInfo (idle_dialog->display, drawable,
-                                               idle_dialog->xss_info);
-  if (xss_query_ok)
+  GttIdleDialog *idle_dialog = data;
+
+  if (idle_dialog->visible && NULL == cur_proj)
     {
-      int idle_seconds = idle_dialog->xss_info->idle / 1000;
-      if (cur_proj != NULL && config_idle_timeout > 0
-          && idle_seconds >= config_idle_timeout)
-        {
-          time_t now = time (0);
-          idle_dialog->last_activity = now - idle_seconds;
-          show_idle_dialog (idle_dialog);
-          /* schedule a new timeout for one minute ahead to
-             update the dialog. */
-          schedule_idle_timeout (60, idle_dialog);
-        }
-      else
-        {
-          if (cur_proj != NULL)
-            {
-              schedule_idle_timeout (config_idle_timeout - idle_seconds,
-                                     idle_dialog);
-            }
-          else if (idle_dialog->visible)
-            {
-              raise_idle_dialog (idle_dialog);
-              schedule_idle_timeout (60, idle_dialog);
-            }
-        }
+      raise_idle_dialog (idle_dialog);
     }
-  return FALSE;
 }
 
 /* =========================================================== */
@@ -545,33 +514,16 @@ idle_dialog_new (void)
   id = g_new0 (GttIdleDialog, 1);
   id->prj = NULL;
 
-  gchar *display_name = gdk_get_display ();
-  id->display = XOpenDisplay (display_name);
-  if (id->display == NULL)
+  id->idle_timeout = idle_timeout_new ();
+  if (id->idle_timeout)
     {
-      g_warning ("Could not open display %s", display_name);
+      idle_dialog_activate_timer (id);
     }
   else
     {
-      int xss_events, xss_error;
-      id->xss_extension_supported
-          = XScreenSaverQueryExtension (id->display, &xss_events, &xss_error);
-      if (id->xss_extension_supported)
-        {
-          id->xss_info = XScreenSaverAllocInfo ();
-          if (config_idle_timeout > 0)
-            {
-              schedule_idle_timeout (config_idle_timeout, id);
-            }
-        }
-      else
-        {
-          g_warning (
-              _ ("The XScreenSaver is not supported on this display.\n"
-                 "The idle timeout functionality will not be available."));
-        }
+      g_warning (_ ("Can't tell when the keyboard and mouse are idle.\n"
+                    "The idle timeout functionality will not be available."));
     }
-  g_free (display_name);
 
   return id;
 }
@@ -649,17 +601,26 @@ raise_idle_dialog (GttIdleDialog *id)
 void
 idle_dialog_activate_timer (GttIdleDialog *idle_dialog)
 {
-  schedule_idle_timeout (config_idle_timeout, idle_dialog);
+  if (!idle_dialog->idle_timeout)
+    return;
+  idle_timeout_watch (idle_dialog->idle_timeout, config_idle_timeout,
+                      user_idle_cb, user_active_cb, idle_dialog);
 }
 
 void
 idle_dialog_deactivate_timer (GttIdleDialog *idle_dialog)
 {
-  if (idle_dialog->timeout_event_source != 0)
+  if (!idle_dialog->idle_timeout)
+    return;
+
+  /* Keep watching for the user's return while the dialog is up */
+  if (idle_dialog->visible)
     {
-      g_source_remove (idle_dialog->timeout_event_source);
-      idle_dialog->timeout_event_source = 0;
+      idle_timeout_watch (idle_dialog->idle_timeout, config_idle_timeout,
+                          NULL, user_active_cb, idle_dialog);
+      return;
     }
+  idle_timeout_unwatch (idle_dialog->idle_timeout);
 }
 
 gboolean
@@ -668,4 +629,12 @@ idle_dialog_is_visible (GttIdleDialog *idle_dialog)
   return idle_dialog->visible;
 }
 
+int
+idle_dialog_get_idle_secs (GttIdleDialog *idle_dialog)
+{
+  if (!idle_dialog)
+    return -1;
+  return idle_timeout_get_idle_secs (idle_dialog->idle_timeout);
+}
+
 /* =========================== END OF FILE ============================== */
@@ -71,4 +71,10 @@ void idle_dialog_deactivate_timer (GttIdleDialog *id);
 
 gboolean idle_dialog_is_visible (GttIdleDialog *id);
 
+/** This routine returns the number of seconds since the last
+ *  keyboard/mouse activity, or -1 if that can't be determined
+ *  (e.g. the XScreenSaver extension is not available).
+ */
+int idle_dialog_get_idle_secs (GttIdleDialog *id);
+
 #endif // GTT_IDLE_DIALOG_H
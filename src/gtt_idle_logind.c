@@ -0,0 +1,227 @@
+/* idle-logind.c -- learn about user inactivity from the IdleHint and
+ * IdleSinceHint properties that systemd-logind keeps for the session.
+ * Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* The desktop session (not the X server) decides when the user is
+ * idle, and tells logind; logind publishes this on the system bus,
+ * and announces changes with PropertiesChanged.  So this backend never
+ * has to poll: it caches the hint, and updates it when told to.
+ *
+ * Note that the desktop session applies its own idle delay (typically
+ * a few minutes) before it sets IdleHint, so idle timeouts shorter
+ * than that will trip late.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gtt_idle_timer_p.h"
+
+#if WITH_DBUS
+
+#include <unistd.h>
+
+#include <dbus/dbus-glib.h>
+
+#define LOGIND_NAME "org.freedesktop.login1"
+#define LOGIND_SESSION_IFACE "org.freedesktop.login1.Session"
+
+typedef struct
+{
+  DBusGConnection *bus;
+  DBusGProxy *props;
+  gboolean idle_hint;
+  time_t idle_since;
+} LogindIdle;
+
+/* Fetch IdleHint and IdleSinceHint; returns FALSE on failure */
+static gboolean
+logind_fetch_hints (LogindIdle *li)
+{
+  GError *error = NULL;
+  GValue hint = { 0 };
+  GValue since = { 0 };
+
+  if (!dbus_g_proxy_call (li->props, "Get", &error, G_TYPE_STRING,
+                          LOGIND_SESSION_IFACE, G_TYPE_STRING, "IdleHint",
+                          G_TYPE_INVALID, G_TYPE_VALUE, &hint,
+                          G_TYPE_INVALID))
+    {
+      g_message ("Couldn't get logind IdleHint: %s", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+  if (!dbus_g_proxy_call (li->props, "Get", &error, G_TYPE_STRING,
+                          LOGIND_SESSION_IFACE, G_TYPE_STRING,
+                          "IdleSinceHint", G_TYPE_INVALID, G_TYPE_VALUE,
+                          &since, G_TYPE_INVALID))
+    {
+      g_message ("Couldn't get logind IdleSinceHint: %s", error->message);
+      g_error_free (error);
+      g_value_unset (&hint);
+      return FALSE;
+    }
+
+  li->idle_hint = g_value_get_boolean (&hint);
+
+  /* IdleSinceHint is in microseconds since the epoch */
+  li->idle_since = g_value_get_uint64 (&since) / G_USEC_PER_SEC;
+
+  g_value_unset (&hint);
+  g_value_unset (&since);
+  return TRUE;
+}
+
+static void
+logind_props_changed_cb (DBusGProxy *proxy, const char *iface,
+                         GHashTable *changed, char **invalidated,
+                         gpointer data)
+{
+  IdleTimeout *si = data;
+
+  if (g_strcmp0 (iface, LOGIND_SESSION_IFACE))
+    return;
+  if (!logind_fetch_hints (si->backend_data))
+    return;
+  idle_timeout_notify (si);
+}
+
+/* The object path of the session we're running in */
+static char *
+logind_get_session_path (DBusGConnection *bus)
+{
+  DBusGProxy *manager;
+  GError *error = NULL;
+  char *path = NULL;
+
+  manager = dbus_g_proxy_new_for_name (bus, LOGIND_NAME,
+                                       "/org/freedesktop/login1",
+                                       "org.freedesktop.login1.Manager");
+  if (!dbus_g_proxy_call (manager, "GetSessionByPID", &error, G_TYPE_UINT,
+                          (guint)getpid (), G_TYPE_INVALID,
+                          DBUS_TYPE_G_OBJECT_PATH, &path, G_TYPE_INVALID))
+    {
+      g_message ("Couldn't find logind session: %s", error->message);
+      g_error_free (error);
+      path = NULL;
+    }
+  g_object_unref (manager);
+  return path;
+}
+
+static gboolean
+logind_open (IdleTimeout *si)
+{
+  LogindIdle *li;
+  DBusGConnection *bus;
+  GError *error = NULL;
+  char *path;
+
+  bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
+  if (!bus)
+    {
+      g_message ("Couldn't connect to system bus: %s", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  path = logind_get_session_path (bus);
+  if (!path)
+    {
+      dbus_g_connection_unref (bus);
+      return FALSE;
+    }
+
+  li = g_new0 (LogindIdle, 1);
+  li->bus = bus;
+  li->props = dbus_g_proxy_new_for_name (bus, LOGIND_NAME, path,
+                                         "org.freedesktop.DBus.Properties");
+  g_free (path);
+
+  if (!logind_fetch_hints (li))
+    {
+      g_object_unref (li->props);
+      dbus_g_connection_unref (li->bus);
+      g_free (li);
+      return FALSE;
+    }
+  si->backend_data = li;
+
+  dbus_g_proxy_add_signal (
+      li->props, "PropertiesChanged", G_TYPE_STRING,
+      dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE),
+      G_TYPE_STRV, G_TYPE_INVALID);
+  dbus_g_proxy_connect_signal (li->props, "PropertiesChanged",
+                               G_CALLBACK (logind_props_changed_cb), si,
+                               NULL);
+  return TRUE;
+}
+
+static void
+logind_close (IdleTimeout *si)
+{
+  LogindIdle *li = si->backend_data;
+
+  dbus_g_proxy_disconnect_signal (li->props, "PropertiesChanged",
+                                  G_CALLBACK (logind_props_changed_cb), si);
+  g_object_unref (li->props);
+  dbus_g_connection_unref (li->bus);
+  g_free (li);
+  si->backend_data = NULL;
+}
+
+static int
+logind_get_idle_secs (IdleTimeout *si)
+{
+  LogindIdle *li = si->backend_data;
+  time_t now;
+
+  if (!li->idle_hint)
+    return 0;
+  now = time (0);
+  if (now < li->idle_since)
+    return 0;
+  return now - li->idle_since;
+}
+
+#else /* !WITH_DBUS */
+
+static gboolean
+logind_open (IdleTimeout *si)
+{
+  return FALSE;
+}
+
+static void
+logind_close (IdleTimeout *si)
+{
+}
+
+static int
+logind_get_idle_secs (IdleTimeout *si)
+{
+  return -1;
+}
+
+#endif /* WITH_DBUS */
+
+const IdleBackend idle_backend_logind
+    = { "logind", logind_open, logind_close, logind_get_idle_secs };
+
+/* =================== END OF FILE ===================================== */
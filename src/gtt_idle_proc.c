@@ -0,0 +1,244 @@
+/* idle-proc.c -- guess at user inactivity by watching the keyboard
+ * interrupt count in /proc/interrupts.
+ * Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* This is the backend of last resort, for when there is no X server
+ * extension and no logind to ask.  It only works for a local keyboard
+ * on its own (unshared) interrupt line, e.g. a PS/2 keyboard on the
+ * i8042 controller.  USB keyboards share their interrupts with
+ * everything else on the bus, and so can't be told apart.
+ *
+ * The file is scanned for the keyboard line once; after that, each
+ * poll reads only a small window around the cached offset of that
+ * line, and sums the per-cpu counts on it.  The offset drifts as the
+ * counts on earlier lines grow digits, so the window is searched for
+ * the line's label, and the offset updated.  Only if the line wanders
+ * out of the window is the whole file rescanned.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "gtt_idle_timer_p.h"
+
+#define PROC_INTERRUPTS "/proc/interrupts"
+
+/* How far before and after the cached offset we look for the line */
+#define PROC_SLACK 256
+#define PROC_WINDOW 1024
+
+typedef struct
+{
+  int fd;
+  off_t offset;
+  char label[16]; /* e.g. "  1:" */
+  guint64 count;
+  time_t last_change;
+} ProcIdle;
+
+/* Sum the per-cpu counts following the label on the line */
+static guint64
+proc_line_count (const char *line)
+{
+  const char *p = strchr (line, ':');
+  guint64 sum = 0;
+  char *end;
+
+  if (!p)
+    return 0;
+  p++;
+  while (1)
+    {
+      guint64 n = g_ascii_strtoull (p, &end, 10);
+      if (end == p)
+        break;
+      sum += n;
+      p = end;
+    }
+  return sum;
+}
+
+/* Is this the line of an unshared keyboard interrupt?  Lines with
+ * a comma list more than one device on the interrupt, e.g.
+ *
+ *      12:      930935        XT-PIC  usb-uhci, PS/2 Mouse
+ *
+ * and any USB activity at all would look like typing. */
+static gboolean
+proc_is_keyboard_line (const char *line, const char *eol)
+{
+  char *str = g_strndup (line, eol - line);
+  gboolean rc = FALSE;
+
+  if (!strchr (str, ','))
+    {
+      if (strstr (str, "keyboard"))
+        rc = TRUE;
+      else if (strstr (str, "i8042") && !strncmp (str, "  1:", 4))
+        rc = TRUE;
+    }
+  g_free (str);
+  return rc;
+}
+
+/* Read the whole file, and remember where the keyboard line is */
+static gboolean
+proc_scan (ProcIdle *pi)
+{
+  GString *buf = g_string_new (NULL);
+  char chunk[4096];
+  const char *line, *eol, *colon;
+  ssize_t len;
+  off_t offset = 0;
+  gboolean found = FALSE;
+
+  while (0 < (len = pread (pi->fd, chunk, sizeof (chunk), offset)))
+    {
+      g_string_append_len (buf, chunk, len);
+      offset += len;
+    }
+
+  for (line = buf->str; *line; line = eol + 1)
+    {
+      eol = strchr (line, '\n');
+      if (!eol)
+        break;
+      if (!proc_is_keyboard_line (line, eol))
+        continue;
+
+      colon = memchr (line, ':', eol - line);
+      if (!colon || (gsize)(colon - line) >= sizeof (pi->label) - 1)
+        continue;
+      memcpy (pi->label, line, colon - line + 1);
+      pi->label[colon - line + 1] = 0;
+      pi->offset = line - buf->str;
+      pi->count = proc_line_count (line);
+      found = TRUE;
+      break;
+    }
+  g_string_free (buf, TRUE);
+  return found;
+}
+
+/* Re-read the keyboard line; returns FALSE if it wasn't near where
+ * we left it. */
+static gboolean
+proc_poll (ProcIdle *pi, guint64 *count)
+{
+  char buf[PROC_WINDOW + 1];
+  off_t start;
+  ssize_t len;
+  char *line;
+  size_t llen = strlen (pi->label);
+
+  start = MAX (pi->offset - PROC_SLACK, 0);
+  len = pread (pi->fd, buf, PROC_WINDOW, start);
+  if (0 >= len)
+    return FALSE;
+  buf[len] = 0;
+
+  /* The label is always at the start of a line */
+  line = buf;
+  if (0 != start || strncmp (line, pi->label, llen))
+    {
+      line = buf;
+      while ((line = strchr (line, '\n')))
+        {
+          line++;
+          if (!strncmp (line, pi->label, llen))
+            break;
+        }
+      if (!line)
+        return FALSE;
+    }
+
+  /* Make sure we have the whole line */
+  if (!strchr (line, '\n'))
+    return FALSE;
+
+  pi->offset = start + (line - buf);
+  *count = proc_line_count (line);
+  return TRUE;
+}
+
+static gboolean
+proc_open (IdleTimeout *si)
+{
+  ProcIdle *pi;
+
+  pi = g_new0 (ProcIdle, 1);
+  pi->fd = open (PROC_INTERRUPTS, O_RDONLY);
+  if (0 > pi->fd || !proc_scan (pi))
+    {
+      if (0 <= pi->fd)
+        close (pi->fd);
+      g_free (pi);
+      return FALSE;
+    }
+  pi->last_change = time (0);
+  si->backend_data = pi;
+  return TRUE;
+}
+
+static void
+proc_close (IdleTimeout *si)
+{
+  ProcIdle *pi = si->backend_data;
+
+  close (pi->fd);
+  g_free (pi);
+  si->backend_data = NULL;
+}
+
+static int
+proc_get_idle_secs (IdleTimeout *si)
+{
+  ProcIdle *pi = si->backend_data;
+  guint64 count;
+  time_t now;
+
+  now = time (0);
+  if (!proc_poll (pi, &count))
+    {
+      /* Lost track of the line; look for it again.  Its count may
+       * have been reset (e.g. the keyboard was unplugged), so
+       * assume activity. */
+      if (!proc_scan (pi))
+        return -1;
+      pi->last_change = now;
+      return 0;
+    }
+
+  if (count != pi->count || now < pi->last_change)
+    {
+      pi->count = count;
+      pi->last_change = now;
+    }
+  return now - pi->last_change;
+}
+
+const IdleBackend idle_backend_proc
+    = { "proc", proc_open, proc_close, proc_get_idle_secs };
+
+/* =================== END OF FILE ===================================== */
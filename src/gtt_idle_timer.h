@@ -17,17 +17,57 @@
 
 #include <glib.h>
 #include <sys/time.h>
+#include <time.h>
 
 typedef struct IdleTimeout_s IdleTimeout;
 
+typedef void (*IdleTimeoutCB) (IdleTimeout *, gpointer);
+
+/* The idle_timeout_new() routine returns a handle on whatever keeps
+ * track of how long the user has been idle, or NULL if nothing on this
+ * system does.  The backend named by the GNOTIME_IDLE_BACKEND
+ * environment variable is tried first; after that, in order:
+ *    "xss"    -- the X server's MIT-SCREEN-SAVER extension
+ *    "logind" -- the IdleHint that systemd-logind keeps for the session
+ *    "proc"   -- the keyboard interrupt count in /proc/interrupts
+ * There is also a "fake" backend, used only when asked for by name,
+ * that is idle only when idle_timeout_fake_set_idle() says so.
+ *
+ * The idle_timeout_new_for_backend() routine uses only the named
+ * backend, returning NULL if it's not available.
+ */
 IdleTimeout *idle_timeout_new (void);
+IdleTimeout *idle_timeout_new_for_backend (const char *name);
+void idle_timeout_destroy (IdleTimeout *);
+const char *idle_timeout_get_backend_name (IdleTimeout *);
 
 /* The poll_last_activity() routine returns the wall-clock-time of the last
  * user activity on this X server.  i.e. the number of seconds since
  * last activity is given by (time(0) - poll_last_activity())
+ *
+ * The idle_timeout_get_idle_secs() routine returns that number of
+ * seconds directly.  Both return -1 if the server can't be queried.
  */
 time_t poll_last_activity (IdleTimeout *);
+int idle_timeout_get_idle_secs (IdleTimeout *);
 
-/* XXX There should be an idle_timeout_destroy() func, but there isn't. */
+/* The idle_timeout_watch() routine arranges for idle_cb to be called
+ *    once the keyboard and mouse have been idle for 'threshold' seconds,
+ *    and then for active_cb to be called when the user comes back.
+ *    This repeats until idle_timeout_unwatch() is called.  Only one
+ *    watch may be set at a time; setting a new one replaces the old.
+ *    Either callback may be NULL.
+ */
+void idle_timeout_watch (IdleTimeout *, int threshold, IdleTimeoutCB idle_cb,
+                         IdleTimeoutCB active_cb, gpointer user_data);
+void idle_timeout_unwatch (IdleTimeout *);
+
+/* The idle_timeout_fake_set_idle() routine tells the fake backend
+ *    that the user was last active 'secs' seconds ago.  From then on,
+ *    the idle time grows with the clock, as it would for a real user
+ *    who stays away, until it's called again.  Any watch is
+ *    re-evaluated right away.
+ */
+void idle_timeout_fake_set_idle (IdleTimeout *, int secs);
 
 #endif // GTT_IDLE_TIMER_H
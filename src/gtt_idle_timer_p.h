@@ -0,0 +1,71 @@
+/* idle-timer_p.h -- private interface between the idle timer and the
+ * backends that know how to measure user inactivity.
+ * Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_IDLE_TIMER_P_H
+#define GTT_IDLE_TIMER_P_H
+
+#include "gtt_idle_timer.h"
+
+/* An idle backend measures how long the user has been idle.
+ *
+ * The open() method sets up whatever the backend needs, stashing it
+ *    in si->backend_data; it returns FALSE if the backend can't work
+ *    on this system.  The close() method undoes open().
+ *
+ * The get_idle_secs() method returns the number of seconds since the
+ *    last keyboard/mouse activity, or -1 if it can't tell right now.
+ *    It is called once per idle threshold while the user is busy, so
+ *    it need not be free, but it should be cheap.
+ *
+ * Backends that get told about changes (rather than having to ask)
+ * should call idle_timeout_notify() so the watch is re-evaluated
+ * right away, instead of when its timer next goes off.
+ */
+typedef struct IdleBackend_s
+{
+  const char *name;
+  gboolean (*open) (IdleTimeout *si);
+  void (*close) (IdleTimeout *si);
+  int (*get_idle_secs) (IdleTimeout *si);
+} IdleBackend;
+
+struct IdleTimeout_s
+{
+  const IdleBackend *backend;
+  gpointer backend_data;
+
+  /* The watch, if any */
+  int threshold;
+  IdleTimeoutCB idle_cb;
+  IdleTimeoutCB active_cb;
+  gpointer user_data;
+
+  gboolean is_idle;
+  time_t idle_since;
+  guint timer;
+};
+
+void idle_timeout_notify (IdleTimeout *si);
+
+extern const IdleBackend idle_backend_xss;
+extern const IdleBackend idle_backend_logind;
+extern const IdleBackend idle_backend_proc;
+extern const IdleBackend idle_backend_fake;
+
+#endif // GTT_IDLE_TIMER_P_H
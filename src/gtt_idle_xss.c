@@ -0,0 +1,107 @@
+/* idle-xss.c -- measure user inactivity with the MIT-SCREEN-SAVER
+ * X server extension.
+ * Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* The X server keeps track of idleness for us: the extension reports
+ * how long the keyboard and mouse have been idle, and sends a
+ * ScreenSaverNotify event when the screen saver comes on or goes off.
+ * The latter is a good hint that the user has gone away, or come back.
+ */
+
+#include "config.h"
+
+#include <gdk/gdk.h>
+#include <gdk/gdkx.h>
+#include <glib.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/scrnsaver.h>
+
+#include "gtt_idle_timer_p.h"
+
+typedef struct
+{
+  Display *dpy;
+  Window root;
+  XScreenSaverInfo *info;
+  int event_base;
+} XssIdle;
+
+static GdkFilterReturn
+xss_event_filter (GdkXEvent *xevent, GdkEvent *event, gpointer data)
+{
+  IdleTimeout *si = data;
+  XssIdle *xss = si->backend_data;
+  XEvent *ev = xevent;
+
+  if (ev->type == xss->event_base + ScreenSaverNotify)
+    {
+      idle_timeout_notify (si);
+    }
+  return GDK_FILTER_CONTINUE;
+}
+
+static gboolean
+xss_open (IdleTimeout *si)
+{
+  XssIdle *xss;
+  Display *dpy;
+  int event_base, error_base;
+
+  dpy = GDK_DISPLAY ();
+  if (!dpy || !XScreenSaverQueryExtension (dpy, &event_base, &error_base))
+    return FALSE;
+
+  xss = g_new0 (XssIdle, 1);
+  xss->dpy = dpy;
+  xss->root = DefaultRootWindow (dpy);
+  xss->info = XScreenSaverAllocInfo ();
+  xss->event_base = event_base;
+  si->backend_data = xss;
+
+  XScreenSaverSelectInput (dpy, xss->root, ScreenSaverNotifyMask);
+  gdk_window_add_filter (NULL, xss_event_filter, si);
+  return TRUE;
+}
+
+static void
+xss_close (IdleTimeout *si)
+{
+  XssIdle *xss = si->backend_data;
+
+  gdk_window_remove_filter (NULL, xss_event_filter, si);
+  XScreenSaverSelectInput (xss->dpy, xss->root, 0);
+  XFree (xss->info);
+  g_free (xss);
+  si->backend_data = NULL;
+}
+
+static int
+xss_get_idle_secs (IdleTimeout *si)
+{
+  XssIdle *xss = si->backend_data;
+
+  if (!XScreenSaverQueryInfo (xss->dpy, xss->root, xss->info))
+    return -1;
+  return xss->info->idle / 1000;
+}
+
+const IdleBackend idle_backend_xss
+    = { "xss", xss_open, xss_close, xss_get_idle_secs };
+
+/* =================== END OF FILE ===================================== */
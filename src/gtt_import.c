@@ -0,0 +1,1033 @@
+/*   Bulk import of time data, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_import.h"
+
+#include <errno.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gtt_ical.h"
+
+struct gtt_import_s
+{
+  GHashTable *projects; /* parent, or &top -> (title -> project) */
+  GHashTable *tasks;    /* project -> (memo -> task) */
+  GHashTable *pending;  /* task -> list of new intervals */
+  GList *frozen;        /* projects to thaw, the last touched first */
+  int nintervals;
+  int top; /* just a key */
+};
+
+/* ============================================================== */
+
+GttImport *
+gtt_import_new (void)
+{
+  GttImport *imp = g_new0 (GttImport, 1);
+
+  imp->projects = g_hash_table_new_full (
+      g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify)g_hash_table_destroy);
+  imp->tasks = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                      (GDestroyNotify)g_hash_table_destroy);
+  imp->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+  return imp;
+}
+
+static GHashTable *
+title_index (GttImport *imp, GttProject *parent)
+{
+  gpointer key = parent ? (gpointer)parent : (gpointer)&imp->top;
+  GHashTable *idx;
+  GList *node;
+
+  idx = g_hash_table_lookup (imp->projects, key);
+  if (idx)
+    return idx;
+
+  /* The first time under this parent: learn what's there already.
+   * If two have the same title, the first one wins. */
+  idx = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  node = parent ? gtt_project_get_children (parent)
+                : gtt_project_list_get_list (global_plist);
+  for (; node; node = node->next)
+    {
+      const char *title = gtt_project_get_title (node->data);
+      if (title && !g_hash_table_lookup (idx, title))
+        g_hash_table_insert (idx, g_strdup (title), node->data);
+    }
+  g_hash_table_insert (imp->projects, key, idx);
+  return idx;
+}
+
+static void
+import_freeze (GttImport *imp, GttProject *prj)
+{
+  if (g_list_find (imp->frozen, prj))
+    return;
+  gtt_project_freeze (prj);
+  imp->frozen = g_list_prepend (imp->frozen, prj);
+}
+
+GttProject *
+gtt_import_project (GttImport *imp, GttProject *parent, const char *title)
+{
+  GHashTable *idx;
+  GttProject *prj;
+
+  g_return_val_if_fail (imp && title, NULL);
+
+  idx = title_index (imp, parent);
+  prj = g_hash_table_lookup (idx, title);
+  if (prj)
+    {
+      import_freeze (imp, prj);
+      return prj;
+    }
+
+  prj = gtt_project_new ();
+  gtt_project_set_title (prj, title);
+  import_freeze (imp, prj);
+  if (parent)
+    gtt_project_append_project (parent, prj);
+  else
+    gtt_project_list_append (global_plist, prj);
+  g_hash_table_insert (idx, g_strdup (title), prj);
+  return prj;
+}
+
+GttTask *
+gtt_import_task (GttImport *imp, GttProject *prj, const char *memo)
+{
+  GHashTable *idx;
+  GttTask *tsk;
+
+  g_return_val_if_fail (imp && prj && memo, NULL);
+
+  idx = g_hash_table_lookup (imp->tasks, prj);
+  if (!idx)
+    {
+      GList *node;
+
+      idx = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      for (node = gtt_project_get_tasks (prj); node; node = node->next)
+        {
+          const char *m = gtt_task_get_memo (node->data);
+          if (m && !g_hash_table_lookup (idx, m))
+            g_hash_table_insert (idx, g_strdup (m), node->data);
+        }
+      g_hash_table_insert (imp->tasks, prj, idx);
+    }
+
+  tsk = g_hash_table_lookup (idx, memo);
+  if (tsk)
+    return tsk;
+
+  import_freeze (imp, prj);
+  tsk = gtt_task_new ();
+  gtt_task_set_memo (tsk, memo);
+  gtt_project_append_task (prj, tsk);
+  g_hash_table_insert (idx, g_strdup (memo), tsk);
+  return tsk;
+}
+
+gboolean
+gtt_import_interval (GttImport *imp, GttTask *tsk, time_t start,
+                     time_t stop, int fuzz)
+{
+  GttInterval *ivl;
+  GList *ivls;
+
+  g_return_val_if_fail (imp && tsk, FALSE);
+  if (stop < start)
+    return FALSE;
+
+  /* Not on the task yet, so setting it up costs nothing */
+  ivl = gtt_interval_new ();
+  gtt_interval_set_start (ivl, start);
+  gtt_interval_set_stop (ivl, stop);
+  gtt_interval_set_fuzz (ivl, fuzz);
+
+  ivls = g_hash_table_lookup (imp->pending, tsk);
+  g_hash_table_insert (imp->pending, tsk, g_list_prepend (ivls, ivl));
+  imp->nintervals++;
+  return TRUE;
+}
+
+int
+gtt_import_finish (GttImport *imp)
+{
+  GHashTableIter iter;
+  gpointer tsk, ivls;
+  GList *node;
+  int n;
+
+  g_return_val_if_fail (imp, 0);
+
+  g_hash_table_iter_init (&iter, imp->pending);
+  while (g_hash_table_iter_next (&iter, &tsk, &ivls))
+    gtt_task_add_intervals (tsk, ivls);
+
+  /* Subprojects were touched after their parents, so they're thawed
+   * first, and the parents' totals then count them. */
+  for (node = imp->frozen; node; node = node->next)
+    gtt_project_thaw (node->data);
+
+  n = imp->nintervals;
+  g_hash_table_destroy (imp->projects);
+  g_hash_table_destroy (imp->tasks);
+  g_hash_table_destroy (imp->pending);
+  g_list_free (imp->frozen);
+  g_free (imp);
+  return n;
+}
+
+/* ============================================================== */
+/* Rows, whether from CSV or JSON */
+
+typedef enum
+{
+  F_TITLE,
+  F_DESC,
+  F_CUSTID,
+  F_STATUS,
+  F_IMPORTANCE,
+  F_URGENCY,
+  F_DUE,
+  F_MEMO,
+  F_NOTES,
+  F_BILLSTATUS,
+  F_BILLABLE,
+  F_BILLRATE,
+  F_START,
+  F_STOP,
+  F_ELAPSED,
+  F_FUZZ,
+  F_START_DATE,
+  F_START_TIME,
+  F_STOP_DATE,
+  F_STOP_TIME,
+  F_NFIELDS,
+  F_UNKNOWN = F_NFIELDS
+} Field;
+
+static const struct
+{
+  const char *name;
+  Field field;
+} field_names[] = {
+  { "title", F_TITLE },
+  { "project", F_TITLE },
+  { "desc", F_DESC },
+  { "description", F_DESC },
+  { "custid", F_CUSTID },
+  { "customer id", F_CUSTID },
+  { "client", F_CUSTID },
+  { "status", F_STATUS },
+  { "importance", F_IMPORTANCE },
+  { "urgency", F_URGENCY },
+  { "due", F_DUE },
+  { "due date", F_DUE },
+  { "memo", F_MEMO },
+  { "task", F_MEMO },
+  { "diary entry", F_MEMO },
+  { "notes", F_NOTES },
+  { "billstatus", F_BILLSTATUS },
+  { "bill status", F_BILLSTATUS },
+  { "billable", F_BILLABLE },
+  { "billrate", F_BILLRATE },
+  { "bill rate", F_BILLRATE },
+  { "start_datime", F_START },
+  { "start", F_START },
+  { "stop_datime", F_STOP },
+  { "stop", F_STOP },
+  { "end", F_STOP },
+  { "elapsed", F_ELAPSED },
+  { "duration", F_ELAPSED },
+  { "fuzz", F_FUZZ },
+  { "start time fuzziness", F_FUZZ },
+  { "start date", F_START_DATE },
+  { "start time", F_START_TIME },
+  { "stop date", F_STOP_DATE },
+  { "end date", F_STOP_DATE },
+  { "stop time", F_STOP_TIME },
+  { "end time", F_STOP_TIME },
+};
+
+static Field
+field_lookup (const char *name)
+{
+  char *key;
+  guint i;
+
+  if (!name)
+    return F_UNKNOWN;
+  key = g_strstrip (g_strdup (name + ('$' == name[0])));
+  for (i = 0; i < G_N_ELEMENTS (field_names); i++)
+    {
+      if (!g_ascii_strcasecmp (key, field_names[i].name))
+        {
+          g_free (key);
+          return field_names[i].field;
+        }
+    }
+  g_free (key);
+  return F_UNKNOWN;
+}
+
+/* Enums, by name, in words, or by number */
+static int
+parse_enum (const char *str, const char *const *names, int first, int count)
+{
+  char *key, *p;
+  int i, rc = -1;
+
+  key = g_ascii_strup (str, -1);
+  g_strstrip (key);
+  for (p = key; *p; p++)
+    {
+      if (' ' == *p || '-' == *p)
+        *p = '_';
+    }
+  for (i = 0; i < count; i++)
+    {
+      if (!strcmp (key, names[i]))
+        rc = first + i;
+    }
+  if (0 > rc && g_ascii_isdigit (key[0]))
+    {
+      i = atoi (key);
+      if (first <= i && i < first + count)
+        rc = i;
+    }
+  g_free (key);
+  return rc;
+}
+
+static const char *const status_names[]
+    = { "NO_STATUS", "NOT_STARTED", "IN_PROGRESS",
+        "ON_HOLD",   "CANCELLED",   "COMPLETED" };
+static const char *const rank_names[]
+    = { "UNDEFINED", "LOW", "MEDIUM", "HIGH" };
+static const char *const billstatus_names[] = { "HOLD", "BILL", "PAID" };
+static const char *const billable_names[]
+    = { "BILLABLE", "NOT_BILLABLE", "NO_CHARGE" };
+static const char *const billrate_names[]
+    = { "REGULAR", "OVERTIME", "OVEROVER", "FLAT_FEE" };
+
+static int
+parse_billable (const char *str)
+{
+  int rc = parse_enum (str, billable_names, GTT_BILLABLE, 3);
+
+  if (0 <= rc)
+    return rc;
+  if (!g_ascii_strcasecmp (str, "yes") || !g_ascii_strcasecmp (str, "true"))
+    return GTT_BILLABLE;
+  if (!g_ascii_strcasecmp (str, "no") || !g_ascii_strcasecmp (str, "false"))
+    return GTT_NOT_BILLABLE;
+  return -1;
+}
+
+/* Days since 1970-01-01 of a date in the proleptic Gregorian
+ * calendar; from Howard Hinnant's days_from_civil(). */
+static gint64
+days_from_civil (int y, int m, int d)
+{
+  int era, yoe, doy, doe;
+
+  y -= (m <= 2);
+  era = ((y >= 0) ? y : y - 399) / 400;
+  yoe = y - era * 400;
+  doy = (153 * (m + ((m > 2) ? -3 : 9)) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (gint64)era * 146097 + doe - 719468;
+}
+
+/* YYYY-MM-DD[ HH:MM[:SS[.frac]]][Z|+HH[:MM]|-HH[:MM]], or seconds
+ * since the epoch */
+static gboolean
+parse_time (const char *str, time_t *when)
+{
+  int y, mo, d, h = 0, mi = 0, s = 0, n = 0;
+  const char *p;
+  char *end;
+  struct tm tm;
+
+  while (g_ascii_isspace (*str))
+    str++;
+  if (g_ascii_isdigit (*str) && !strchr (str, '-') && !strchr (str, ':'))
+    {
+      gint64 secs = g_ascii_strtoll (str, &end, 10);
+      while (g_ascii_isspace (*end))
+        end++;
+      if (*end)
+        return FALSE;
+      *when = secs;
+      return TRUE;
+    }
+
+  if (3 != sscanf (str, "%4d-%2d-%2d%n", &y, &mo, &d, &n))
+    return FALSE;
+  if (1 > mo || 12 < mo || 1 > d || 31 < d)
+    return FALSE;
+  p = str + n;
+  if ('T' == *p || ' ' == *p)
+    {
+      while (' ' == *p)
+        p++;
+      if ('T' == *p)
+        p++;
+      if (*p)
+        {
+          if (2 != sscanf (p, "%2d:%2d%n", &h, &mi, &n))
+            return FALSE;
+          p += n;
+          if (':' == *p)
+            {
+              if (1 != sscanf (p + 1, "%2d%n", &s, &n))
+                return FALSE;
+              p += 1 + n;
+              if ('.' == *p)
+                {
+                  p++;
+                  while (g_ascii_isdigit (*p))
+                    p++;
+                }
+            }
+        }
+    }
+  while (' ' == *p)
+    p++;
+
+  if ('Z' == *p || '+' == *p || '-' == *p)
+    {
+      int oh = 0, om = 0, sign = ('-' == *p) ? -1 : 1;
+
+      if ('Z' != *p)
+        {
+          if (1 > sscanf (p + 1, "%2d%n", &oh, &n))
+            return FALSE;
+          p += n;
+          if (':' == p[1])
+            p++;
+          if (g_ascii_isdigit (p[1]) && 1 == sscanf (p + 1, "%2d%n", &om, &n))
+            p += n;
+        }
+      if (p[1])
+        return FALSE;
+      *when = days_from_civil (y, mo, d) * 86400 + h * 3600 + mi * 60 + s
+              - sign * (oh * 3600 + om * 60);
+      return TRUE;
+    }
+  if (*p)
+    return FALSE;
+
+  memset (&tm, 0, sizeof (tm));
+  tm.tm_year = y - 1900;
+  tm.tm_mon = mo - 1;
+  tm.tm_mday = d;
+  tm.tm_hour = h;
+  tm.tm_min = mi;
+  tm.tm_sec = s;
+  tm.tm_isdst = -1;
+  *when = mktime (&tm);
+  return TRUE;
+}
+
+/* H:MM:SS, H:MM, seconds, or hours with a decimal point */
+static gboolean
+parse_secs (const char *str, long *secs)
+{
+  long h, m, s = 0;
+  char *end;
+  int n = 0;
+
+  while (g_ascii_isspace (*str))
+    str++;
+  if (strchr (str, ':'))
+    {
+      if (2 > sscanf (str, "%ld:%ld%n", &h, &m, &n))
+        return FALSE;
+      if (':' == str[n] && 1 != sscanf (str + n, ":%ld%n", &s, &n))
+        return FALSE;
+      if (0 > h || 0 > m || 0 > s)
+        return FALSE;
+      *secs = h * 3600 + m * 60 + s;
+      return TRUE;
+    }
+  if (strchr (str, '.'))
+    {
+      double hours = g_ascii_strtod (str, &end);
+      if (end == str || 0.0 > hours)
+        return FALSE;
+      *secs = (long)(hours * 3600.0 + 0.5);
+      return TRUE;
+    }
+  *secs = strtol (str, &end, 10);
+  return (end != str && 0 <= *secs);
+}
+
+/* A time that may be in one column, or split across two */
+static gboolean
+row_time (const char **vals, Field whole, Field date, Field clock,
+          time_t *when)
+{
+  char *str;
+  gboolean ok;
+
+  if (vals[whole])
+    return parse_time (vals[whole], when);
+  if (!vals[date])
+    return FALSE;
+  str = g_strconcat (vals[date], " ", vals[clock] ? vals[clock] : "",
+                     NULL);
+  ok = parse_time (str, when);
+  g_free (str);
+  return ok;
+}
+
+/* Returns FALSE if the row was skipped */
+static gboolean
+import_row (GttImport *imp, const char **vals)
+{
+  GttProject *prj;
+  GttTask *tsk = NULL;
+  gboolean has_ivl;
+  time_t start, stop, due;
+  long secs;
+  int e;
+
+  if (!vals[F_TITLE])
+    return FALSE;
+
+  has_ivl = vals[F_START] || vals[F_START_DATE];
+  if (has_ivl)
+    {
+      if (!row_time (vals, F_START, F_START_DATE, F_START_TIME, &start))
+        return FALSE;
+      if (vals[F_STOP] || vals[F_STOP_DATE])
+        {
+          if (!row_time (vals, F_STOP, F_STOP_DATE, F_STOP_TIME, &stop))
+            return FALSE;
+        }
+      else if (vals[F_ELAPSED] && parse_secs (vals[F_ELAPSED], &secs))
+        stop = start + secs;
+      else
+        return FALSE;
+      if (stop < start)
+        return FALSE;
+    }
+
+  prj = gtt_import_project (imp, NULL, vals[F_TITLE]);
+  if (vals[F_DESC])
+    gtt_project_set_desc (prj, vals[F_DESC]);
+  if (vals[F_CUSTID])
+    gtt_project_set_custid (prj, vals[F_CUSTID]);
+  if (vals[F_STATUS]
+      && 0 <= (e = parse_enum (vals[F_STATUS], status_names, 0, 6)))
+    gtt_project_set_status (prj, e);
+  if (vals[F_IMPORTANCE]
+      && 0 <= (e = parse_enum (vals[F_IMPORTANCE], rank_names, 0, 4)))
+    gtt_project_set_importance (prj, e);
+  if (vals[F_URGENCY]
+      && 0 <= (e = parse_enum (vals[F_URGENCY], rank_names, 0, 4)))
+    gtt_project_set_urgency (prj, e);
+  if (vals[F_DUE] && parse_time (vals[F_DUE], &due))
+    gtt_project_set_due_date (prj, due);
+
+  if (vals[F_MEMO] || has_ivl)
+    tsk = gtt_import_task (imp, prj, vals[F_MEMO] ? vals[F_MEMO] : "");
+  if (!tsk)
+    return TRUE;
+
+  if (vals[F_NOTES])
+    gtt_task_set_notes (tsk, vals[F_NOTES]);
+  if (vals[F_BILLSTATUS]
+      && 0 <= (e = parse_enum (vals[F_BILLSTATUS], billstatus_names, 0, 3)))
+    gtt_task_set_billstatus (tsk, e);
+  if (vals[F_BILLABLE] && 0 <= (e = parse_billable (vals[F_BILLABLE])))
+    gtt_task_set_billable (tsk, e);
+  if (vals[F_BILLRATE]
+      && 0 <= (e = parse_enum (vals[F_BILLRATE], billrate_names, 0, 4)))
+    gtt_task_set_billrate (tsk, e);
+
+  if (!has_ivl)
+    return TRUE;
+  secs = 0;
+  if (vals[F_FUZZ])
+    parse_secs (vals[F_FUZZ], &secs);
+  return gtt_import_interval (imp, tsk, start, stop, secs);
+}
+
+/* ============================================================== */
+/* CSV, as RFC 4180 has it, or tab-separated text */
+
+typedef struct
+{
+  const char *p;
+  const char *end;
+  char delim;
+  GString *field;
+} CsvReader;
+
+/* Read the next row into 'row'; FALSE at the end of the text */
+static gboolean
+csv_next_row (CsvReader *rd, GPtrArray *row)
+{
+  const char *p = rd->p, *end = rd->end;
+
+  if (p >= end)
+    return FALSE;
+
+  g_ptr_array_set_size (row, 0);
+  for (;;)
+    {
+      g_string_truncate (rd->field, 0);
+      if (',' == rd->delim && p < end && '"' == *p)
+        {
+          for (p++; p < end; p++)
+            {
+              if ('"' == *p)
+                {
+                  if (p + 1 < end && '"' == p[1])
+                    p++;
+                  else
+                    {
+                      p++;
+                      break;
+                    }
+                }
+              g_string_append_c (rd->field, *p);
+            }
+        }
+      while (p < end && *p != rd->delim && '\n' != *p && '\r' != *p)
+        g_string_append_c (rd->field, *p++);
+      g_ptr_array_add (row, g_strdup (rd->field->str));
+
+      if (p >= end)
+        break;
+      if (*p == rd->delim)
+        {
+          p++;
+          continue;
+        }
+      if ('\r' == *p)
+        p++;
+      if (p < end && '\n' == *p)
+        p++;
+      break;
+    }
+  rd->p = p;
+  return TRUE;
+}
+
+gboolean
+gtt_import_csv (GttImport *imp, const char *text, gsize len, int *skipped,
+                char **errmsg)
+{
+  CsvReader rd;
+  GPtrArray *row;
+  Field *fields;
+  const char *eol;
+  guint ncols, i;
+  int nskipped = 0;
+
+  g_return_val_if_fail (imp && text, FALSE);
+
+  rd.p = text;
+  rd.end = text + len;
+  if (3 <= len && !memcmp (text, "\xEF\xBB\xBF", 3))
+    rd.p += 3;
+
+  /* Tabs and no commas in the header: it's tab-separated */
+  eol = memchr (rd.p, '\n', rd.end - rd.p);
+  if (!eol)
+    eol = rd.end;
+  rd.delim = ',';
+  if (memchr (rd.p, '\t', eol - rd.p) && !memchr (rd.p, ',', eol - rd.p))
+    rd.delim = '\t';
+  rd.field = g_string_new (NULL);
+
+  row = g_ptr_array_new_with_free_func (g_free);
+  if (!csv_next_row (&rd, row))
+    {
+      if (errmsg)
+        *errmsg = g_strdup (_ ("There is nothing to import"));
+      g_ptr_array_free (row, TRUE);
+      g_string_free (rd.field, TRUE);
+      return FALSE;
+    }
+  ncols = row->len;
+  fields = g_new (Field, ncols);
+  for (i = 0; i < ncols; i++)
+    fields[i] = field_lookup (g_ptr_array_index (row, i));
+
+  while (csv_next_row (&rd, row))
+    {
+      const char *vals[F_NFIELDS + 1];
+      gboolean empty = TRUE;
+
+      memset (vals, 0, sizeof (vals));
+      for (i = 0; i < row->len && i < ncols; i++)
+        {
+          const char *val = g_ptr_array_index (row, i);
+          if (!val[0])
+            continue;
+          empty = FALSE;
+          vals[fields[i]] = val;
+        }
+      if (!empty && !import_row (imp, vals))
+        nskipped++;
+    }
+
+  g_free (fields);
+  g_ptr_array_free (row, TRUE);
+  g_string_free (rd.field, TRUE);
+  if (skipped)
+    *skipped = nskipped;
+  return TRUE;
+}
+
+/* ============================================================== */
+/* JSON: just enough of it for an array of flat objects */
+
+typedef struct
+{
+  const char *start;
+  const char *p;
+  const char *end;
+} JsonReader;
+
+static void
+json_skip_ws (JsonReader *rd)
+{
+  while (rd->p < rd->end && g_ascii_isspace (*rd->p))
+    rd->p++;
+}
+
+static gboolean
+json_expect (JsonReader *rd, char c)
+{
+  json_skip_ws (rd);
+  if (rd->p >= rd->end || *rd->p != c)
+    return FALSE;
+  rd->p++;
+  return TRUE;
+}
+
+static gboolean
+json_hex4 (JsonReader *rd, gunichar *ch)
+{
+  int i;
+
+  *ch = 0;
+  if (rd->end - rd->p < 4)
+    return FALSE;
+  for (i = 0; i < 4; i++)
+    {
+      int v = g_ascii_xdigit_value (rd->p[i]);
+      if (0 > v)
+        return FALSE;
+      *ch = (*ch << 4) | v;
+    }
+  rd->p += 4;
+  return TRUE;
+}
+
+/* The string at rd->p, which is at its opening quote */
+static gboolean
+json_string (JsonReader *rd, GString *str)
+{
+  g_string_truncate (str, 0);
+  if (!json_expect (rd, '"'))
+    return FALSE;
+  while (rd->p < rd->end)
+    {
+      char c = *rd->p++;
+      gunichar ch, lo;
+
+      if ('"' == c)
+        return TRUE;
+      if ('\\' != c)
+        {
+          g_string_append_c (str, c);
+          continue;
+        }
+      if (rd->p >= rd->end)
+        return FALSE;
+      c = *rd->p++;
+      switch (c)
+        {
+        case 'b':
+          g_string_append_c (str, '\b');
+          break;
+        case 'f':
+          g_string_append_c (str, '\f');
+          break;
+        case 'n':
+          g_string_append_c (str, '\n');
+          break;
+        case 'r':
+          g_string_append_c (str, '\r');
+          break;
+        case 't':
+          g_string_append_c (str, '\t');
+          break;
+        case 'u':
+          if (!json_hex4 (rd, &ch))
+            return FALSE;
+          if (0xd800 <= ch && ch < 0xdc00 && rd->end - rd->p >= 6
+              && '\\' == rd->p[0] && 'u' == rd->p[1])
+            {
+              rd->p += 2;
+              if (!json_hex4 (rd, &lo))
+                return FALSE;
+              ch = 0x10000 + ((ch - 0xd800) << 10) + (lo - 0xdc00);
+            }
+          g_string_append_unichar (str, ch);
+          break;
+        default:
+          g_string_append_c (str, c);
+        }
+    }
+  return FALSE;
+}
+
+/* Skip over any value, nested or not */
+static gboolean
+json_skip_value (JsonReader *rd, GString *scratch)
+{
+  int depth = 0;
+
+  json_skip_ws (rd);
+  do
+    {
+      if (rd->p >= rd->end)
+        return FALSE;
+      if ('"' == *rd->p)
+        {
+          if (!json_string (rd, scratch))
+            return FALSE;
+          continue;
+        }
+      if ('{' == *rd->p || '[' == *rd->p)
+        depth++;
+      else if ('}' == *rd->p || ']' == *rd->p)
+        depth--;
+      else if (0 == depth && (',' == *rd->p))
+        break;
+      if (0 > depth)
+        return FALSE;
+      rd->p++;
+    }
+  while (0 < depth || (rd->p < rd->end && ',' != *rd->p && '}' != *rd->p
+                       && ']' != *rd->p && !g_ascii_isspace (*rd->p)));
+  return TRUE;
+}
+
+/* Numbers, true and false are kept as their text; null as nothing */
+static gboolean
+json_scalar (JsonReader *rd, GString *str, gboolean *is_null)
+{
+  const char *tok;
+
+  json_skip_ws (rd);
+  *is_null = FALSE;
+  if (rd->p < rd->end && '"' == *rd->p)
+    return json_string (rd, str);
+
+  tok = rd->p;
+  while (rd->p < rd->end
+         && (g_ascii_isalnum (*rd->p) || strchr ("+-.", *rd->p)))
+    rd->p++;
+  if (tok == rd->p)
+    return FALSE;
+  g_string_assign (str, "");
+  g_string_append_len (str, tok, rd->p - tok);
+  *is_null = !strcmp (str->str, "null");
+  return TRUE;
+}
+
+static gboolean
+json_record (GttImport *imp, JsonReader *rd, int *nskipped)
+{
+  char *vals[F_NFIELDS + 1];
+  GString *key = g_string_new (NULL);
+  GString *val = g_string_new (NULL);
+  gboolean ok = FALSE;
+  int i;
+
+  memset (vals, 0, sizeof (vals));
+  if (!json_expect (rd, '{'))
+    goto done;
+  json_skip_ws (rd);
+  if (rd->p < rd->end && '}' == *rd->p)
+    {
+      rd->p++;
+      ok = TRUE;
+      goto done;
+    }
+
+  for (;;)
+    {
+      Field field;
+      gboolean is_null;
+
+      json_skip_ws (rd);
+      if (!json_string (rd, key) || !json_expect (rd, ':'))
+        goto done;
+      field = field_lookup (key->str);
+      json_skip_ws (rd);
+      if (rd->p < rd->end && ('{' == *rd->p || '[' == *rd->p))
+        {
+          if (!json_skip_value (rd, val))
+            goto done;
+        }
+      else
+        {
+          if (!json_scalar (rd, val, &is_null))
+            goto done;
+          if (!is_null && val->len && F_UNKNOWN != field)
+            {
+              g_free (vals[field]);
+              vals[field] = g_strdup (val->str);
+            }
+        }
+      if (json_expect (rd, '}'))
+        break;
+      if (!json_expect (rd, ','))
+        goto done;
+    }
+
+  if (!import_row (imp, (const char **)vals))
+    (*nskipped)++;
+  ok = TRUE;
+
+done:
+  for (i = 0; i < F_NFIELDS; i++)
+    g_free (vals[i]);
+  g_string_free (key, TRUE);
+  g_string_free (val, TRUE);
+  return ok;
+}
+
+gboolean
+gtt_import_json (GttImport *imp, const char *text, gsize len, int *skipped,
+                 char **errmsg)
+{
+  JsonReader rd;
+  int nskipped = 0;
+  gboolean ok = FALSE;
+
+  g_return_val_if_fail (imp && text, FALSE);
+
+  rd.start = text;
+  rd.p = text;
+  rd.end = text + len;
+  if (3 <= len && !memcmp (text, "\xEF\xBB\xBF", 3))
+    rd.p += 3;
+
+  if (json_expect (&rd, '['))
+    {
+      if (json_expect (&rd, ']'))
+        ok = TRUE;
+      else
+        {
+          while (json_record (imp, &rd, &nskipped))
+            {
+              if (json_expect (&rd, ']'))
+                {
+                  ok = TRUE;
+                  break;
+                }
+              if (!json_expect (&rd, ','))
+                break;
+            }
+        }
+    }
+
+  if (skipped)
+    *skipped = nskipped;
+  if (!ok && errmsg)
+    *errmsg = g_strdup_printf (
+        _ ("Expected an array of objects; JSON error at byte %ld"),
+        (long)(rd.p - rd.start));
+  return ok;
+}
+
+/* ============================================================== */
+
+int
+gtt_import_file (const char *filename, char **errmsg)
+{
+  GError *error = NULL;
+  GttImport *imp;
+  const char *dot;
+  char *contents;
+  gsize len;
+  gboolean ok;
+  int n;
+
+  g_return_val_if_fail (filename, -1);
+
+  /* Calendars are read as they go, a line at a time */
+  dot = strrchr (filename, '.');
+  if (dot && !g_ascii_strcasecmp (dot, ".ics"))
+    {
+      FILE *fh = g_fopen (filename, "rb");
+
+      if (!fh)
+        {
+          if (errmsg)
+            *errmsg = g_strdup (g_strerror (errno));
+          return -1;
+        }
+      imp = gtt_import_new ();
+      ok = gtt_ical_read (imp, fh, NULL, errmsg);
+      fclose (fh);
+      n = gtt_import_finish (imp);
+      return ok ? n : -1;
+    }
+
+  if (!g_file_get_contents (filename, &contents, &len, &error))
+    {
+      if (errmsg)
+        *errmsg = g_strdup (error->message);
+      g_error_free (error);
+      return -1;
+    }
+
+  imp = gtt_import_new ();
+  if (dot && !g_ascii_strcasecmp (dot, ".json"))
+    ok = gtt_import_json (imp, contents, len, NULL, errmsg);
+  else
+    ok = gtt_import_csv (imp, contents, len, NULL, errmsg);
+  n = gtt_import_finish (imp);
+  g_free (contents);
+  return ok ? n : -1;
+}
+
+/* ======================= END OF FILE =================== */
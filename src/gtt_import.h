@@ -0,0 +1,110 @@
+/*   Bulk import of time data, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_IMPORT_H
+#define GTT_IMPORT_H
+
+#include <glib.h>
+
+#include "gtt_project.h"
+
+/* An import adds a lot of projects, tasks and intervals to the
+ * project list at once.  Adding them one at a time, with the usual
+ * routines, recomputes the project's times, tells the listeners and
+ * scrubs the intervals after every one; an import holds all of that
+ * off until the end, and then does it once.
+ *
+ * The gtt_import_new() routine starts an import into the global
+ *    project list.
+ *
+ * The gtt_import_project() routine returns the project titled
+ *    'title' under 'parent' (or at the top level, if 'parent' is
+ *    NULL), creating it if there is none.  The project is frozen
+ *    until the import is finished.
+ *
+ * The gtt_import_task() routine returns the task of the project 'prj'
+ *    whose memo is 'memo', creating it if there is none.
+ *
+ * The gtt_import_interval() routine adds an interval to the task,
+ *    from 'start' to 'stop'.  It isn't put on the task until the
+ *    import is finished: see gtt_task_add_intervals().  It returns
+ *    FALSE, and adds nothing, if 'stop' is before 'start'.
+ *
+ * The gtt_import_finish() routine puts the intervals on their tasks,
+ *    scrubs them, thaws the projects, and recomputes their times.  It
+ *    frees the import, and returns the number of intervals added.
+ *
+ * The gtt_import_csv() routine imports comma- or tab-separated text,
+ *    as the column exporter writes it (see gtt_columns.h), or as other
+ *    time trackers do.  The first row names the columns; they are
+ *    found by the $words of gtt_columns.h, with or without the $, or
+ *    by their usual titles, in any case.  Also understood are
+ *    'project' for the title, 'task' for the memo, 'client' for the
+ *    custid, 'due' for the due date, 'end' for the stop, 'duration'
+ *    for the elapsed time, and 'start date', 'start time', 'end date'
+ *    and 'end time', for times split in two.  Unknown columns are
+ *    skipped.  The text is taken to be tab-separated if the first row
+ *    has tabs in it and no commas.
+ *
+ *    Each row adds to the project it names, creating it if need be;
+ *    and, if it has a memo, to that task; and, if it has a start, an
+ *    interval, which ends at the stop, or after the elapsed time.  So
+ *    rows with only project columns, such as those of a to-do list,
+ *    add projects.  The other columns set the project's or task's
+ *    fields, where given.  Enums are written as in gtt_columns.h, or
+ *    in words ('in progress'), or as numbers; billable may also be yes
+ *    or no.  Times of day are 'YYYY-MM-DD HH:MM[:SS]', in local time,
+ *    optionally followed by Z or an offset from UTC, as +HH:MM; or a
+ *    number of seconds since the epoch.  Lengths of time are H:MM:SS
+ *    or H:MM, a number of seconds, or, with a decimal point, of hours.
+ *
+ * The gtt_import_json() routine imports a JSON array of objects, each
+ *    one a row, with the same names and values as for CSV; numbers
+ *    may be numbers or strings.  Nested arrays and objects are
+ *    skipped.
+ *
+ *    Both return FALSE, and an error message (to be g_free()'d), if
+ *    the text can't be read at all; what was read before the error is
+ *    still imported.  Rows that make no sense are skipped, and
+ *    counted in 'skipped', if that isn't NULL.
+ *
+ * The gtt_import_file() routine does a whole import from the file
+ *    'filename': JSON if the name ends in .json, iCalendar if it ends
+ *    in .ics (see gtt_ical.h), and CSV otherwise.
+ *    It returns the number of intervals added, or -1 and an error
+ *    message.
+ */
+
+typedef struct gtt_import_s GttImport;
+
+GttImport *gtt_import_new (void);
+GttProject *gtt_import_project (GttImport *, GttProject *parent,
+                                const char *title);
+GttTask *gtt_import_task (GttImport *, GttProject *prj, const char *memo);
+gboolean gtt_import_interval (GttImport *, GttTask *tsk, time_t start,
+                              time_t stop, int fuzz);
+int gtt_import_finish (GttImport *);
+
+gboolean gtt_import_csv (GttImport *, const char *text, gsize len,
+                         int *skipped, char **errmsg);
+gboolean gtt_import_json (GttImport *, const char *text, gsize len,
+                          int *skipped, char **errmsg);
+
+int gtt_import_file (const char *filename, char **errmsg);
+
+#endif // GTT_IMPORT_H
@@ -0,0 +1,325 @@
+/*   Time range index of the intervals, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "config.h"
+
+#include "gtt_interval_index.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "gtt_project_p.h"
+
+/* The running interval's stop keeps moving; as far as the tree is
+ * concerned, it runs forever. */
+#define RUNNING_STOP INT_MAX
+
+typedef struct
+{
+  time_t start;
+  time_t stop; /* or RUNNING_STOP */
+  GttInterval *ivl;
+} Entry;
+
+struct gtt_interval_index_s
+{
+  gint refcount;
+  guint generation;
+
+  guint len;
+  Entry *entries;  /* sorted by start */
+  time_t *maxstop; /* the latest stop under each entry of the tree */
+  time_t latest;   /* the latest stop, not counting running intervals */
+  GPtrArray *running;
+};
+
+/* The indexes are built when they're first asked for, perhaps by
+ * several report threads at once. */
+static GMutex index_mutex;
+
+/* ============================================================== */
+
+static int
+add_entry (GttInterval *ivl, gpointer data)
+{
+  GArray *entries = data;
+  Entry e;
+
+  e.start = gtt_interval_get_start (ivl);
+  e.stop = gtt_interval_is_running (ivl) ? RUNNING_STOP
+                                         : gtt_interval_get_stop (ivl);
+  e.ivl = ivl;
+  g_array_append_val (entries, e);
+  return 1;
+}
+
+static int
+entry_cmp (gconstpointer a, gconstpointer b)
+{
+  const Entry *ea = a, *eb = b;
+
+  if (ea->start != eb->start)
+    return (ea->start < eb->start) ? -1 : 1;
+  return 0;
+}
+
+/* The middle entry of entries[lo..hi) is the root of that part of the
+ * tree; the halves on either side of it are its subtrees. */
+static time_t
+build_tree (GttIntervalIndex *idx, guint lo, guint hi)
+{
+  guint mid;
+  time_t max;
+
+  if (lo >= hi)
+    return 0;
+  mid = lo + (hi - lo) / 2;
+  max = idx->entries[mid].stop;
+  max = MAX (max, build_tree (idx, lo, mid));
+  max = MAX (max, build_tree (idx, mid + 1, hi));
+  idx->maxstop[mid] = max;
+  return max;
+}
+
+static GttIntervalIndex *
+index_new (GArray *entries, guint generation)
+{
+  GttIntervalIndex *idx = g_new0 (GttIntervalIndex, 1);
+  guint i;
+
+  idx->refcount = 1;
+  idx->generation = generation;
+  g_array_sort (entries, entry_cmp);
+  idx->len = entries->len;
+  idx->entries = (Entry *)g_array_free (entries, FALSE);
+  idx->maxstop = g_new (time_t, MAX (idx->len, 1));
+  build_tree (idx, 0, idx->len);
+
+  idx->running = g_ptr_array_new ();
+  for (i = 0; i < idx->len; i++)
+    {
+      if (RUNNING_STOP == idx->entries[i].stop)
+        g_ptr_array_add (idx->running, idx->entries[i].ivl);
+      else
+        idx->latest = MAX (idx->latest, idx->entries[i].stop);
+    }
+  return idx;
+}
+
+static GttIntervalIndex *
+index_ref (GttIntervalIndex *idx)
+{
+  g_atomic_int_inc (&idx->refcount);
+  return idx;
+}
+
+void
+gtt_interval_index_unref (GttIntervalIndex *idx)
+{
+  if (!idx)
+    return;
+  if (!g_atomic_int_dec_and_test (&idx->refcount))
+    return;
+  g_free (idx->entries);
+  g_free (idx->maxstop);
+  g_ptr_array_free (idx->running, TRUE);
+  g_free (idx);
+}
+
+/* ============================================================== */
+
+/* Swap in a new index if the cached one is out of date */
+static GttIntervalIndex *
+index_refresh (GttIntervalIndex **cache, guint generation,
+               GttProject *prj, GList *prjs)
+{
+  GttIntervalIndex *idx;
+  GArray *entries;
+  GList *node;
+
+  g_mutex_lock (&index_mutex);
+  if (!*cache || (*cache)->generation != generation)
+    {
+      entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+      if (prj)
+        gtt_project_foreach_interval (prj, add_entry, entries);
+      for (node = prjs; node; node = node->next)
+        gtt_project_foreach_subproject_interval (node->data, add_entry,
+                                                 entries);
+      gtt_interval_index_unref (*cache);
+      *cache = index_new (entries, generation);
+    }
+  idx = index_ref (*cache);
+  g_mutex_unlock (&index_mutex);
+  return idx;
+}
+
+GttIntervalIndex *
+gtt_interval_index_get (GttProject *prj, gboolean subtree)
+{
+  g_return_val_if_fail (prj, NULL);
+
+  if (!subtree)
+    return index_refresh (&prj->ivl_index, prj->generation, prj, NULL);
+  return index_refresh (&prj->subtree_ivl_index, prj->subtree_generation,
+                        prj, prj->sub_projects);
+}
+
+GttIntervalIndex *
+gtt_interval_index_get_list (GttProjectList *gpl)
+{
+  g_return_val_if_fail (gpl, NULL);
+
+  return index_refresh (&gpl->ivl_index, gtt_project_list_get_generation (),
+                        NULL, gpl->prj_list);
+}
+
+/* ============================================================== */
+
+typedef struct
+{
+  GttIntervalIndex *idx;
+  time_t start;
+  time_t end;
+  GttIntervalCB cb;
+  gpointer data;
+} Walk;
+
+/* Visit the overlapping intervals in entries[lo..hi), in order;
+ * returns zero if the callback asked to stop. */
+static int
+walk_tree (Walk *w, guint lo, guint hi)
+{
+  Entry *e;
+  guint mid;
+  time_t stop;
+
+  if (lo >= hi)
+    return 1;
+  mid = lo + (hi - lo) / 2;
+
+  /* Everything under here stopped before the range */
+  if (w->idx->maxstop[mid] <= w->start)
+    return 1;
+  if (0 == walk_tree (w, lo, mid))
+    return 0;
+
+  /* This, and everything after it, starts after the range */
+  e = &w->idx->entries[mid];
+  if (e->start >= w->end)
+    return 1;
+
+  stop = e->stop;
+  if (RUNNING_STOP == stop)
+    stop = gtt_interval_get_stop (e->ivl);
+  if (stop > w->start)
+    {
+      if (0 == w->cb (e->ivl, w->data))
+        return 0;
+    }
+  return walk_tree (w, mid + 1, hi);
+}
+
+int
+gtt_interval_index_foreach (GttIntervalIndex *idx, time_t start, time_t end,
+                            GttIntervalCB cb, gpointer data)
+{
+  Walk w;
+
+  g_return_val_if_fail (idx && cb, 1);
+
+  w.idx = idx;
+  w.start = start;
+  w.end = end;
+  w.cb = cb;
+  w.data = data;
+  return walk_tree (&w, 0, idx->len);
+}
+
+time_t
+gtt_interval_index_earliest_start (GttIntervalIndex *idx)
+{
+  g_return_val_if_fail (idx, INT_MAX);
+
+  if (0 == idx->len)
+    return INT_MAX;
+  return idx->entries[0].start;
+}
+
+time_t
+gtt_interval_index_latest_stop (GttIntervalIndex *idx)
+{
+  time_t latest;
+  guint i;
+
+  g_return_val_if_fail (idx, 0);
+
+  latest = idx->latest;
+  for (i = 0; i < idx->running->len; i++)
+    {
+      GttInterval *ivl = g_ptr_array_index (idx->running, i);
+      latest = MAX (latest, gtt_interval_get_stop (ivl));
+    }
+  return latest;
+}
+
+/* ============================================================== */
+
+static int
+foreach_in_range (GttIntervalIndex *idx, time_t start, time_t end,
+                  GttIntervalCB cb, gpointer data)
+{
+  int rc;
+
+  if (!idx)
+    return 1;
+  rc = gtt_interval_index_foreach (idx, start, end, cb, data);
+  gtt_interval_index_unref (idx);
+  return rc;
+}
+
+int
+gtt_project_foreach_interval_in_range (GttProject *prj, time_t start,
+                                       time_t end, GttIntervalCB cb,
+                                       gpointer data)
+{
+  return foreach_in_range (gtt_interval_index_get (prj, FALSE), start, end,
+                           cb, data);
+}
+
+int
+gtt_project_foreach_subproject_interval_in_range (GttProject *prj,
+                                                  time_t start, time_t end,
+                                                  GttIntervalCB cb,
+                                                  gpointer data)
+{
+  return foreach_in_range (gtt_interval_index_get (prj, TRUE), start, end,
+                           cb, data);
+}
+
+int
+gtt_project_list_foreach_interval_in_range (GttProjectList *gpl,
+                                            time_t start, time_t end,
+                                            GttIntervalCB cb, gpointer data)
+{
+  return foreach_in_range (gtt_interval_index_get_list (gpl), start, end,
+                           cb, data);
+}
+
+/* ======================= END OF FILE =================== */
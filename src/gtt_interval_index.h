@@ -0,0 +1,72 @@
+/*   Time range index of the intervals, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef GTT_INTERVAL_INDEX_H
+#define GTT_INTERVAL_INDEX_H
+
+#include <glib.h>
+
+#include "gtt_project.h"
+
+/* An interval index holds a set of intervals, sorted by their start
+ * times, as an implicit interval tree: each entry in the sorted array
+ * also remembers the latest stop time in the part of the array that
+ * it is the middle of.  So the intervals that overlap a range of time
+ * are found in logarithmic time, and the earliest start and latest
+ * stop are known at once.
+ *
+ * There is one index for each project, one for each project together
+ * with its subprojects, and one for the whole project list.  Each is
+ * built the first time that it's asked for, and is kept until the
+ * project's generation (or subtree generation, or the list's) moves
+ * on; see gtt_project_get_generation().  The running interval's stop
+ * time moves on with the clock without that, and so is always looked
+ * up afresh.
+ *
+ * The gtt_interval_index_get() routine returns a reference to the
+ *    index for the project, and its subprojects too if 'subtree' is
+ *    TRUE.  The gtt_interval_index_get_list() routine does the same
+ *    for all of the projects on the list.  Release the reference with
+ *    gtt_interval_index_unref().
+ *
+ * The gtt_interval_index_foreach() routine calls 'cb' on each of the
+ *    intervals that overlap the time from 'start' to 'end', in order
+ *    of their start times; it works as gtt_project_foreach_interval()
+ *    does.
+ *
+ * The gtt_interval_index_earliest_start() routine returns the earliest
+ *    start, or INT_MAX if there are no intervals; and the
+ *    gtt_interval_index_latest_stop() routine the latest stop, or zero.
+ *
+ * All of these may be called from any thread, so long as the projects
+ * aren't changed meanwhile.
+ */
+
+typedef struct gtt_interval_index_s GttIntervalIndex;
+
+GttIntervalIndex *gtt_interval_index_get (GttProject *, gboolean subtree);
+GttIntervalIndex *gtt_interval_index_get_list (GttProjectList *);
+void gtt_interval_index_unref (GttIntervalIndex *);
+
+int gtt_interval_index_foreach (GttIntervalIndex *, time_t start, time_t end,
+                                GttIntervalCB cb, gpointer data);
+time_t gtt_interval_index_earliest_start (GttIntervalIndex *);
+time_t gtt_interval_index_latest_stop (GttIntervalIndex *);
+
+#endif // GTT_INTERVAL_INDEX_H
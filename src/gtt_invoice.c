@@ -0,0 +1,252 @@
+/*   Invoice computation, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "config.h"
+
+#include "gtt_invoice.h"
+
+#include <string.h>
+
+/* ============================================================== */
+
+static double
+task_rate (GttTask *tsk, GttProject *prj)
+{
+  switch (gtt_task_get_billrate (tsk))
+    {
+    case GTT_REGULAR:
+      return gtt_project_get_billrate (prj);
+    case GTT_OVERTIME:
+      return gtt_project_get_overtime_rate (prj);
+    case GTT_OVEROVER:
+      return gtt_project_get_overover_rate (prj);
+    case GTT_FLAT_FEE:
+      return gtt_project_get_flat_fee (prj);
+    }
+  return 0.0;
+}
+
+/* The time worked on the task, or just that between start and end */
+static time_t
+task_secs (GttTask *tsk, time_t start, time_t end)
+{
+  GList *node;
+  time_t total = 0;
+
+  if (0 >= start || 0 >= end)
+    return gtt_task_get_secs_ever (tsk);
+
+  for (node = gtt_task_get_intervals (tsk); node; node = node->next)
+    {
+      time_t from = MAX (gtt_interval_get_start (node->data), start);
+      time_t to = MIN (gtt_interval_get_stop (node->data), end);
+      if (to > from)
+        total += to - from;
+    }
+  return total;
+}
+
+static void
+fill_line (GttTask *tsk, time_t secs, GttInvoiceLine *line)
+{
+  int bill_unit = gtt_task_get_bill_unit (tsk);
+
+  memset (line, 0, sizeof (*line));
+  line->task = tsk;
+  line->project = gtt_task_get_parent (tsk);
+  line->billstatus = gtt_task_get_billstatus (tsk);
+  line->billrate = gtt_task_get_billrate (tsk);
+  line->billable = gtt_task_get_billable (tsk);
+  line->secs = secs;
+  line->billed_secs = secs;
+  if (0 < bill_unit)
+    line->billed_secs = ((secs + bill_unit - 1) / bill_unit) * bill_unit;
+  line->rate = task_rate (tsk, line->project);
+
+  if (GTT_FLAT_FEE == line->billrate)
+    {
+      line->value = line->rate;
+      line->billed_value = line->rate;
+    }
+  else
+    {
+      line->value = line->secs * line->rate / 3600.0;
+      line->billed_value = line->billed_secs * line->rate / 3600.0;
+    }
+}
+
+void
+gtt_invoice_task_line (GttTask *tsk, GttInvoiceLine *line)
+{
+  g_return_if_fail (tsk && line);
+  fill_line (tsk, gtt_task_get_secs_ever (tsk), line);
+}
+
+/* ============================================================== */
+
+static void
+total_add (GttInvoiceTotal *tot, const GttInvoiceLine *line)
+{
+  tot->secs += line->secs;
+  tot->billed_secs += line->billed_secs;
+  if (GTT_BILLABLE == line->billable)
+    tot->amount += line->billed_value;
+}
+
+static void
+invoice_project (GttInvoice *inv, GttProject *prj, gboolean subprojects,
+                 time_t start, time_t end)
+{
+  gboolean ranged = (0 < start && 0 < end);
+  GList *node;
+
+  for (node = gtt_project_get_tasks (prj); node; node = node->next)
+    {
+      GttInvoiceLine line;
+      time_t secs = task_secs (node->data, start, end);
+
+      if (ranged && 0 == secs)
+        continue;
+      fill_line (node->data, secs, &line);
+      g_array_append_val (inv->lines, line);
+
+      if (line.billstatus <= GTT_PAID)
+        total_add (&inv->subtotal[line.billstatus], &line);
+      if (GTT_BILL == line.billstatus && line.billrate <= GTT_FLAT_FEE)
+        total_add (&inv->rate_total[line.billrate], &line);
+      total_add (&inv->total, &line);
+    }
+
+  if (!subprojects)
+    return;
+  for (node = gtt_project_get_children (prj); node; node = node->next)
+    invoice_project (inv, node->data, TRUE, start, end);
+}
+
+GttInvoice *
+gtt_invoice_new (GList *prjs, gboolean include_subprojects, time_t start,
+                 time_t end)
+{
+  GttInvoice *inv = g_new0 (GttInvoice, 1);
+  GList *node;
+
+  inv->lines = g_array_new (FALSE, FALSE, sizeof (GttInvoiceLine));
+  for (node = prjs; node; node = node->next)
+    invoice_project (inv, node->data, include_subprojects, start, end);
+  return inv;
+}
+
+void
+gtt_invoice_free (GttInvoice *inv)
+{
+  if (!inv)
+    return;
+  g_array_free (inv->lines, TRUE);
+  g_free (inv);
+}
+
+/* ============================================================== */
+/* Tab-separated output.  The names are the ones the data file and
+ * the query language use, rather than translated ones, so that other
+ * programs can read it. */
+
+static const char *status_names[] = { "HOLD", "BILL", "PAID" };
+static const char *rate_names[]
+    = { "REGULAR", "OVERTIME", "OVEROVER", "FLAT_FEE" };
+static const char *billable_names[]
+    = { "", "BILLABLE", "NOT_BILLABLE", "NO_CHARGE" };
+
+#define NAME(names, i)                                                        \
+  (((guint)(i) < G_N_ELEMENTS (names)) ? names[i] : "")
+
+/* Tabs and newlines would break up the columns */
+static void
+write_text (GString *out, const char *text)
+{
+  for (; text && *text; text++)
+    {
+      if ('\t' == *text || '\n' == *text || '\r' == *text)
+        g_string_append_c (out, ' ');
+      else
+        g_string_append_c (out, *text);
+    }
+}
+
+static void
+write_money (GString *out, double value)
+{
+  char buff[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_string_append (out, g_ascii_formatd (buff, sizeof (buff), "%.2f", value));
+}
+
+static void
+write_total (GString *out, const char *kind, const char *key,
+             const GttInvoiceTotal *tot)
+{
+  g_string_append_printf (out, "%s\t%s\t%ld\t%ld\t", kind, key,
+                          (long)tot->secs, (long)tot->billed_secs);
+  write_money (out, tot->amount);
+  g_string_append_c (out, '\n');
+}
+
+gboolean
+gtt_invoice_write (GttInvoice *inv, FILE *fh)
+{
+  GString *out;
+  gboolean ok;
+  guint i;
+
+  g_return_val_if_fail (inv && fh, FALSE);
+
+  out = g_string_new ("project\tmemo\tbillstatus\tbillable\tbillrate\t"
+                      "secs\tbilled_secs\trate\tvalue\tbilled_value\n");
+  for (i = 0; i < inv->lines->len; i++)
+    {
+      GttInvoiceLine *line = &g_array_index (inv->lines, GttInvoiceLine, i);
+
+      write_text (out, gtt_project_get_title (line->project));
+      g_string_append_c (out, '\t');
+      write_text (out, gtt_task_get_memo (line->task));
+      g_string_append_printf (out, "\t%s\t%s\t%s\t%ld\t%ld\t",
+                              NAME (status_names, line->billstatus),
+                              NAME (billable_names, line->billable),
+                              NAME (rate_names, line->billrate),
+                              (long)line->secs, (long)line->billed_secs);
+      write_money (out, line->rate);
+      g_string_append_c (out, '\t');
+      write_money (out, line->value);
+      g_string_append_c (out, '\t');
+      write_money (out, line->billed_value);
+      g_string_append_c (out, '\n');
+    }
+
+  g_string_append (out, "\nkind\tkey\tsecs\tbilled_secs\tamount\n");
+  for (i = 0; i < G_N_ELEMENTS (inv->subtotal); i++)
+    write_total (out, "subtotal", status_names[i], &inv->subtotal[i]);
+  for (i = 0; i < G_N_ELEMENTS (inv->rate_total); i++)
+    write_total (out, "rate_total", rate_names[i], &inv->rate_total[i]);
+  write_total (out, "total", "", &inv->total);
+
+  ok = (out->len == fwrite (out->str, 1, out->len, fh));
+  g_string_free (out, TRUE);
+  return ok;
+}
+
+/* ======================= END OF FILE =================== */
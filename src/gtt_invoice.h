@@ -0,0 +1,97 @@
+/*   Invoice computation, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef GTT_INVOICE_H
+#define GTT_INVOICE_H
+
+#include <glib.h>
+#include <stdio.h>
+
+#include "gtt_project.h"
+
+/* The invoice engine works out what each task is worth, and what is
+ * owed in all, in one pass over the projects.
+ *
+ * Each task becomes a line item.  Its time is rounded up to a whole
+ * multiple of the task's bill_unit (see gtt_task_get_bill_unit()), so
+ * the bill unit is the least that any work gets billed for; the same
+ * goes for gtt-task-blocktime-str.  A bill_unit of zero or less means
+ * no rounding.  The time is worth the project's regular,
+ * overtime or over-overtime rate, per hour, as the task's billrate
+ * says; a flat-fee task is worth the project's flat fee, however long
+ * it took.  Only GTT_BILLABLE tasks count towards the amounts owed.
+ *
+ * The gtt_invoice_new() routine computes the invoice for the projects
+ *    on the list 'prjs' (and their subprojects, if 'include_subprojects'
+ *    is TRUE).  If 'start' and 'end' are greater than zero, only the
+ *    time worked between them is counted, and tasks with no time in
+ *    that range are left out, flat fee or not.  Free the invoice with
+ *    gtt_invoice_free().
+ *
+ *    The line items are in the order of the projects and their tasks.
+ *    The subtotals are by bill status (GTT_HOLD, GTT_BILL, GTT_PAID),
+ *    and the rate totals by billrate, for the lines marked GTT_BILL
+ *    alone: the work that is to be invoiced now.  The total is for
+ *    all of the lines.
+ *
+ * The gtt_invoice_task_line() routine fills in the line item for one
+ *    task, in the same way, counting all of its time.
+ *
+ * The gtt_invoice_write() routine writes the line items, and then the
+ *    totals, to 'fh' as tab-separated text, for use without the GUI.
+ *    It returns FALSE if the writing failed.
+ */
+
+typedef struct
+{
+  GttTask *task;
+  GttProject *project;
+  GttBillStatus billstatus;
+  GttBillRate billrate;
+  GttBillable billable;
+  time_t secs;         /* time worked */
+  time_t billed_secs;  /* time worked, rounded to the bill unit */
+  double rate;         /* per hour; or the fee, for GTT_FLAT_FEE */
+  double value;        /* what the time worked is worth */
+  double billed_value; /* what the rounded time is worth */
+} GttInvoiceLine;
+
+typedef struct
+{
+  time_t secs;
+  time_t billed_secs;
+  double amount; /* the billed value of the GTT_BILLABLE lines */
+} GttInvoiceTotal;
+
+typedef struct
+{
+  GArray *lines; /* of GttInvoiceLine */
+  GttInvoiceTotal subtotal[GTT_PAID + 1];    /* by GttBillStatus */
+  GttInvoiceTotal rate_total[GTT_FLAT_FEE + 1]; /* by GttBillRate */
+  GttInvoiceTotal total;
+} GttInvoice;
+
+GttInvoice *gtt_invoice_new (GList *prjs, gboolean include_subprojects,
+                             time_t start, time_t end);
+void gtt_invoice_free (GttInvoice *);
+
+void gtt_invoice_task_line (GttTask *, GttInvoiceLine *);
+gboolean gtt_invoice_write (GttInvoice *, FILE *fh);
+
+#endif // GTT_INVOICE_H
@@ -32,6 +32,7 @@
 #include <qof.h>
 
 #include "gtt_application_window.h"
+#include "gtt_current_project.h"
 #include "gtt_ghtml.h"
 #include "gtt_help_popup.h"
 #include "gtt_menus.h"
@@ -39,6 +40,7 @@
 #include "gtt_project.h"
 #include "gtt_props_dlg_interval.h"
 #include "gtt_props_dlg_task.h"
+#include "gtt_query.h"
 #include "gtt_util.h"
 
 #include <gio/gio.h>
@@ -56,6 +58,11 @@ typedef struct wiggy_s
   GttProject *prj;
   char *filepath; /* file containing report template */
 
+  /* Redraws are put off for a moment, and skipped if nothing was
+   * edited since the last one; see redraw() below. */
+  guint redraw_id;
+  guint drawn_generation;
+
   /* Interval edit menu widgets */
   GttInterval *interval;
   GtkWidget *interval_popup;
@@ -88,7 +95,7 @@ typedef struct wiggy_s
 } Wiggy;
 
 static void do_show_report (const char *, GttPlugin *, KvpFrame *,
-                            GttProject *, gboolean, GList *);
+                            GttProject *, gboolean, GttQuery *);
 
 /* ============================================================== */
 /* Routines that take html and mash it into browser. */
@@ -300,12 +307,46 @@ save_to_file (Wiggy *wig, const char *uri)
 /* ============================================================== */
 /* engine callbacks */
 
+/* Notifications come in bursts: one per keystroke in the notes area,
+ * one per thaw, one for each project touched by a cut or paste.  So
+ * the redraw waits this long, and is done once for the lot. */
+#define REDRAW_DELAY 250 /* milliseconds */
+
+static void
+journal_display (Wiggy *wig)
+{
+  if (wig->redraw_id)
+    {
+      g_source_remove (wig->redraw_id);
+      wig->redraw_id = 0;
+    }
+  wig->drawn_generation = gtt_project_get_generation (wig->prj);
+  gtt_ghtml_display (wig->gh, wig->filepath, wig->prj);
+}
+
+static gboolean
+redraw_timeout (gpointer data)
+{
+  Wiggy *wig = (Wiggy *)data;
+
+  wig->redraw_id = 0;
+
+  /* If all that happened was the timer ticking, or a thaw, there's
+   * nothing new to show. */
+  if (gtt_project_get_generation (wig->prj) == wig->drawn_generation)
+    return FALSE;
+
+  journal_display (wig);
+  return FALSE;
+}
+
 static void
 redraw (GttProject *prj, gpointer data)
 {
   Wiggy *wig = (Wiggy *)data;
 
-  gtt_ghtml_display (wig->gh, wig->filepath, wig->prj);
+  if (0 == wig->redraw_id)
+    wig->redraw_id = g_timeout_add (REDRAW_DELAY, redraw_timeout, wig);
 }
 
 /* ============================================================== */
@@ -782,6 +823,11 @@ on_close_clicked_cb (GtkWidget *w, gpointer data)
   /* close the main journal window ... everything */
   if (wig->prj)
     gtt_project_remove_notifier (wig->prj, redraw, wig);
+  if (wig->redraw_id)
+    {
+      g_source_remove (wig->redraw_id);
+      wig->redraw_id = 0;
+    }
   edit_interval_dialog_destroy (wig->edit_ivl);
   wig->prj = NULL;
 
@@ -802,7 +848,7 @@ static void
 on_refresh_clicked_cb (GtkWidget *w, gpointer data)
 {
   Wiggy *wig = (Wiggy *)data;
-  redraw (wig->prj, data);
+  journal_display (wig);
 }
 
 /* ============================================================== */
@@ -1102,22 +1148,15 @@ html_on_url_cb (GtkHTML *doc, const gchar *url, gpointer data)
 /* ============================================================== */
 /* HTML form (method=GET, POST) events */
 
-static QofBook *book = NULL;
-
-/* Obtain an SQL query string from the HTML page, and submit
- * it to the query engnine, returning a list of projects.
- *
- * XXX right now, the only kind of queries that are allowed
- * are those that return lists of projects.  This should be fixed.
- * Part of the problem is that we can't currently identify the type
- * of the returned list.  I think we can fix this by returning
- * lists of qof entities, and using that to figure out the returned
- * type.  Need to change GttProject to derive from QofEntity.
+/* Obtain a query string from the HTML page, and compile it; see
+ * gtt_query.h for what queries look like.  The report runs the query
+ * itself, each time that it is displayed.
  */
-static GList *
+static GttQuery *
 perform_form_query (KvpFrame *kvpf)
 {
-  GList *results, *n;
+  GttQuery *q;
+  char *errmsg = NULL;
 
   if (!kvpf)
     return NULL;
@@ -1128,16 +1167,11 @@ perform_form_query (KvpFrame *kvpf)
   char *user_debug = kvp_frame_get_string (kvpf, "debug");
   if (user_debug)
     {
-      printf ("Debug: HTML Form Input=%s\n", kvp_frame_to_string (kvpf));
+      char *str = kvp_frame_to_string (kvpf);
+      printf ("Debug: HTML Form Input=%s\n", str);
+      g_free (str);
     }
 
-  QofSqlQuery *q = qof_sql_query_new ();
-
-  if (!book)
-    book = qof_book_new ();
-  qof_sql_query_set_book (q, book);
-  qof_sql_query_set_kvp (q, kvpf);
-
   char *query_string = kvp_frame_get_string (kvpf, "query");
   if (!query_string)
     return NULL;
@@ -1146,30 +1180,43 @@ perform_form_query (KvpFrame *kvpf)
 
   if (user_debug)
     {
-      printf ("earliest-end-date = %s\n",
-              kvp_frame_get_string (kvpf, "earliest-end-date"));
-      printf ("latest-start-date = %s\n",
-              kvp_frame_get_string (kvpf, "latest-start-date"));
       printf ("Debug: Will run the query %s\n", query_string);
     }
 
-  /* Run the query */
-  results = qof_sql_query_run (q, query_string);
-
-  /* XXX free q after using it */
+  q = gtt_query_compile (query_string, &errmsg);
+  if (!q)
+    {
+      g_warning ("Bad query: %s", errmsg);
+      g_free (errmsg);
+      return NULL;
+    }
 
   if (user_debug)
     {
-      printf ("Debug: Query returned the following matching projects:\n");
-      /* Print out the results */
+      GList *results, *n;
+
+      printf ("Debug: Query returned the following matches:\n");
+      results = gtt_query_run (q, gtt_project_list_get_list (master_list),
+                               kvpf);
       for (n = results; n; n = n->next)
         {
-          GttProject *prj = n->data;
-          printf ("\t%s\n", gtt_project_get_title (prj));
+          switch (gtt_query_get_target (q))
+            {
+            case GTT_QUERY_PROJECTS:
+              printf ("\t%s\n", gtt_project_get_title (n->data));
+              break;
+            case GTT_QUERY_TASKS:
+              printf ("\t%s\n", gtt_task_get_memo (n->data));
+              break;
+            case GTT_QUERY_INTERVALS:
+              printf ("\t%ld\n", (long)gtt_interval_get_start (n->data));
+              break;
+            }
         }
+      g_list_free (results);
     }
 
-  return results;
+  return q;
 }
 
 static void
@@ -1180,7 +1227,7 @@ submit_clicked_cb (GtkHTML *doc, const gchar *method, const gchar *url,
   const char *path;
   KvpFrame *kvpf;
   KvpValue *val;
-  GList *qresults;
+  GttQuery *query;
 
   if (!wig->prj)
     wig->prj = gtt_projects_tree_get_selected_project (projects_tree);
@@ -1197,10 +1244,11 @@ submit_clicked_cb (GtkHTML *doc, const gchar *method, const gchar *url,
   path = gtt_ghtml_resolve_path (path, wig->filepath);
 
   /* Build an ad-hoc query */
-  qresults = perform_form_query (kvpf);
+  query = perform_form_query (kvpf);
 
   /* Open a new window */
-  do_show_report (path, NULL, kvpf, wig->prj, TRUE, qresults);
+  do_show_report (path, NULL, kvpf, wig->prj, TRUE, query);
+  gtt_query_unref (query);
 
   /* XXX We cannnot reuse the same window from this callback, we
    * have to let the callback return first, else we get a nasty error.
@@ -1218,7 +1266,7 @@ submit_clicked_cb (GtkHTML *doc, const gchar *method, const gchar *url,
 
 static void
 do_show_report (const char *report, GttPlugin *plg, KvpFrame *kvpf,
-                GttProject *prj, gboolean did_query, GList *prjlist)
+                GttProject *prj, gboolean did_query, GttQuery *query)
 {
   GtkWidget *jnl_top, *jnl_viewport;
   Wiggy *wig;
@@ -1332,6 +1380,7 @@ do_show_report (const char *report, GttPlugin *plg, KvpFrame *kvpf,
   wig->gh = gtt_ghtml_new ();
   gtt_ghtml_set_stream (wig->gh, wig, wiggy_open, wiggy_write, wiggy_close,
                         wiggy_error);
+  gtt_ghtml_set_cache (wig->gh, TRUE);
 
   /* ---------------------------------------------------- */
   /* Signals for the browser, and the Journal window */
@@ -1817,12 +1866,14 @@ do_show_report (const char *report, GttPlugin *plg, KvpFrame *kvpf,
       wig->gh->kvp = kvpf;
     }
   wig->gh->did_query = did_query;
-  wig->gh->query_result = prjlist;
+  gtt_ghtml_set_query (wig->gh, query);
 
-  /* XXX should add notifiers for prjlist too ?? Yes we should */
+  /* XXX the query results can change when any project does; we
+   * should listen to all of them. */
   if (prj)
     gtt_project_add_notifier (prj, redraw, wig);
-  gtt_ghtml_display (wig->gh, report, prj);
+  wig->redraw_id = 0;
+  journal_display (wig);
 
   /* Can only set editable *after* there's content in the window */
   // gtk_html_set_editable (wig->html, TRUE);
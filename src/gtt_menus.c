@@ -39,6 +39,18 @@ static GnomeUIInfo menu_main_file[]
         { GNOME_APP_UI_ITEM, N_ ("Export _Projects"), NULL, export_file_picker,
           TODO_EXPORT, NULL, GNOME_APP_PIXMAP_STOCK, GTK_STOCK_SAVE, 'P',
           GDK_CONTROL_MASK, NULL },
+        { GNOME_APP_UI_ITEM, N_ ("_Import..."),
+          N_ ("Import time data from a CSV, JSON or iCalendar file"),
+          import_file_picker, NULL, NULL, GNOME_APP_PIXMAP_STOCK,
+          GTK_STOCK_OPEN, 'I', GDK_CONTROL_MASK, NULL },
+        { GNOME_APP_UI_ITEM, N_ ("_Merge..."),
+          N_ ("Merge in the data file of another machine"),
+          merge_file_picker, NULL, NULL, GNOME_APP_PIXMAP_STOCK,
+          GTK_STOCK_OPEN, 0, 0, NULL },
+        { GNOME_APP_UI_ITEM, N_ ("Sync to _Calendar..."),
+          N_ ("Write the intervals and to-dos to a calendar directory"),
+          ical_sync_picker, NULL, NULL, GNOME_APP_PIXMAP_STOCK,
+          GTK_STOCK_SAVE, 0, 0, NULL },
         GNOMEUIINFO_SEPARATOR,
         GNOMEUIINFO_MENU_EXIT_ITEM (app_quit, NULL),
         GNOMEUIINFO_END };
@@ -31,8 +31,11 @@
 #define STATUS_REPORT "status.ghtml"
 #define TODO_REPORT "todo.ghtml"
 
-#define TAB_DELIM_EXPORT "tab-delim.ghtml"
-#define TODO_EXPORT "todo-export.ghtml"
+/* column specs for the exports; see gtt_columns.h */
+#define TAB_DELIM_EXPORT                                                      \
+  "$memo $notes $billstatus $billable $billrate $task_time $value "          \
+  "$bill_value"
+#define TODO_EXPORT "$importance $urgency $title $desc $status"
 
 GtkMenuShell *menus_get_popup (void);
 void menus_create (GnomeApp *app);
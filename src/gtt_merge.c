@@ -0,0 +1,432 @@
+/*   Merge data files by GUID, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_merge.h"
+
+#include <glib/gi18n.h>
+#include <qof.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gtt_err_throw.h"
+#include "gtt_project_p.h"
+#include "gtt_xml.h"
+
+typedef struct
+{
+  GHashTable *projects; /* GUID -> our project */
+  GHashTable *tasks;    /* GUID -> our task */
+  GHashTable *original; /* our project -> its last-modified time */
+  GHashTable *modified; /* project -> the last-modified time it'll get */
+  GList *leftovers;     /* their projects that matched, to be freed */
+  GList *rekey_projects;
+  GList *rekey_tasks;
+  int next_id;
+  GttMergeStats *stats;
+} Merge;
+
+static guint
+merge_guid_hash (gconstpointer key)
+{
+  return guid_hash_to_guint (key);
+}
+
+static gboolean
+merge_guid_equal (gconstpointer a, gconstpointer b)
+{
+  return guid_equal (a, b);
+}
+
+/* Learn what we have, before anything is moved in */
+static void
+index_ours (Merge *m, GList *prjs)
+{
+  GList *node;
+
+  for (; prjs; prjs = prjs->next)
+    {
+      GttProject *prj = prjs->data;
+
+      g_hash_table_insert (m->projects, (gpointer)gtt_project_get_guid (prj),
+                           prj);
+      g_hash_table_insert (
+          m->original, prj,
+          GSIZE_TO_POINTER (gtt_project_get_last_modified (prj)));
+      m->next_id = MAX (m->next_id, gtt_project_get_id (prj) + 1);
+
+      for (node = gtt_project_get_tasks (prj); node; node = node->next)
+        g_hash_table_insert (m->tasks,
+                             (gpointer)gtt_task_get_guid (node->data),
+                             node->data);
+      index_ours (m, gtt_project_get_children (prj));
+    }
+}
+
+static time_t
+original_modified (Merge *m, GttProject *prj)
+{
+  return (time_t)GPOINTER_TO_SIZE (g_hash_table_lookup (m->original, prj));
+}
+
+/* The project is about to be changed, with what was last modified at
+ * 'when'; hold off its recomputes until the end, and then give it the
+ * later of the two times. */
+static void
+merge_touch (Merge *m, GttProject *prj, time_t when)
+{
+  gpointer old;
+
+  if (g_hash_table_lookup_extended (m->modified, prj, NULL, &old))
+    when = MAX (when, (time_t)GPOINTER_TO_SIZE (old));
+  else
+    {
+      gtt_project_freeze (prj);
+      when = MAX (when, original_modified (m, prj));
+    }
+  g_hash_table_replace (m->modified, prj, GSIZE_TO_POINTER (when));
+}
+
+/* ============================================================== */
+
+static void
+merge_project_fields (GttProject *ours, GttProject *theirs)
+{
+  gtt_project_set_title (ours, gtt_project_get_title (theirs));
+  gtt_project_set_desc (ours, gtt_project_get_desc (theirs));
+  gtt_project_set_notes (ours, gtt_project_get_notes (theirs));
+  gtt_project_set_custid (ours, gtt_project_get_custid (theirs));
+
+  gtt_project_set_billrate (ours, gtt_project_get_billrate (theirs));
+  gtt_project_set_overtime_rate (ours,
+                                 gtt_project_get_overtime_rate (theirs));
+  gtt_project_set_overover_rate (ours,
+                                 gtt_project_get_overover_rate (theirs));
+  gtt_project_set_flat_fee (ours, gtt_project_get_flat_fee (theirs));
+
+  gtt_project_set_min_interval (ours, gtt_project_get_min_interval (theirs));
+  gtt_project_set_auto_merge_interval (
+      ours, gtt_project_get_auto_merge_interval (theirs));
+  gtt_project_set_auto_merge_gap (ours,
+                                  gtt_project_get_auto_merge_gap (theirs));
+
+  gtt_project_set_estimated_start (ours,
+                                   gtt_project_get_estimated_start (theirs));
+  gtt_project_set_estimated_end (ours,
+                                 gtt_project_get_estimated_end (theirs));
+  gtt_project_set_due_date (ours, gtt_project_get_due_date (theirs));
+  gtt_project_set_sizing (ours, gtt_project_get_sizing (theirs));
+  gtt_project_set_percent_complete (
+      ours, gtt_project_get_percent_complete (theirs));
+  gtt_project_set_urgency (ours, gtt_project_get_urgency (theirs));
+  gtt_project_set_importance (ours, gtt_project_get_importance (theirs));
+  gtt_project_set_status (ours, gtt_project_get_status (theirs));
+}
+
+static gboolean
+same_str (const char *a, const char *b)
+{
+  return !g_strcmp0 (a ? a : "", b ? b : "");
+}
+
+static gboolean
+merge_task_fields (GttTask *ours, GttTask *theirs)
+{
+  if (same_str (gtt_task_get_memo (ours), gtt_task_get_memo (theirs))
+      && same_str (gtt_task_get_notes (ours), gtt_task_get_notes (theirs))
+      && gtt_task_get_billable (ours) == gtt_task_get_billable (theirs)
+      && gtt_task_get_billrate (ours) == gtt_task_get_billrate (theirs)
+      && gtt_task_get_billstatus (ours) == gtt_task_get_billstatus (theirs)
+      && gtt_task_get_bill_unit (ours) == gtt_task_get_bill_unit (theirs))
+    return FALSE;
+
+  gtt_task_set_memo (ours, gtt_task_get_memo (theirs));
+  gtt_task_set_notes (ours, gtt_task_get_notes (theirs));
+  gtt_task_set_billable (ours, gtt_task_get_billable (theirs));
+  gtt_task_set_billrate (ours, gtt_task_get_billrate (theirs));
+  gtt_task_set_billstatus (ours, gtt_task_get_billstatus (theirs));
+  gtt_task_set_bill_unit (ours, gtt_task_get_bill_unit (theirs));
+  return TRUE;
+}
+
+/* ============================================================== */
+
+static int
+cmp_start (const void *a, const void *b)
+{
+  time_t sa = gtt_interval_get_start (*(GttInterval **)a);
+  time_t sb = gtt_interval_get_start (*(GttInterval **)b);
+
+  return (sa > sb) - (sa < sb);
+}
+
+static GPtrArray *
+sorted_intervals (GttTask *tsk)
+{
+  GPtrArray *arr = g_ptr_array_new ();
+  GList *node;
+
+  for (node = gtt_task_get_intervals (tsk); node; node = node->next)
+    g_ptr_array_add (arr, node->data);
+  qsort (arr->pdata, arr->len, sizeof (gpointer), cmp_start);
+  return arr;
+}
+
+/* Walk the two sorted arrays side by side.  An interval is the same
+ * one if it starts at the same time; if we both have it, the later
+ * stop time wins (the timer ran on longer on that side), unless ours
+ * is running.  The last-modified times don't come into it, since
+ * tracking time doesn't change them. */
+static void
+merge_intervals (Merge *m, GttTask *ours, GttTask *theirs)
+{
+  GPtrArray *a = sorted_intervals (ours);
+  GPtrArray *b = sorted_intervals (theirs);
+  GList *added = NULL;
+  guint i = 0, j;
+
+  for (j = 0; j < b->len; j++)
+    {
+      GttInterval *ivl = g_ptr_array_index (b, j);
+      time_t start = gtt_interval_get_start (ivl);
+
+      while (i < a->len
+             && gtt_interval_get_start (g_ptr_array_index (a, i)) < start)
+        i++;
+
+      if (i < a->len
+          && gtt_interval_get_start (g_ptr_array_index (a, i)) == start)
+        {
+          GttInterval *match = g_ptr_array_index (a, i++);
+
+          if (!gtt_interval_is_running (match)
+              && gtt_interval_get_stop (match) < gtt_interval_get_stop (ivl))
+            {
+              gtt_interval_set_stop (match, gtt_interval_get_stop (ivl));
+              gtt_interval_set_fuzz (match, gtt_interval_get_fuzz (ivl));
+              m->stats->intervals_updated++;
+            }
+          continue;
+        }
+
+      /* A copy, so that theirs can be freed with their task */
+      {
+        GttInterval *copy = gtt_interval_new ();
+        gtt_interval_set_start (copy, start);
+        gtt_interval_set_stop (copy, gtt_interval_get_stop (ivl));
+        gtt_interval_set_fuzz (copy, gtt_interval_get_fuzz (ivl));
+        added = g_list_prepend (added, copy);
+        m->stats->intervals_added++;
+      }
+    }
+
+  if (added)
+    gtt_task_add_intervals (ours, added);
+  g_ptr_array_free (a, TRUE);
+  g_ptr_array_free (b, TRUE);
+}
+
+/* Their clock can't be running here; and if it were, moving the task
+ * would restart it. */
+static void
+stop_intervals (GttTask *tsk)
+{
+  GList *node;
+
+  for (node = gtt_task_get_intervals (tsk); node; node = node->next)
+    {
+      if (gtt_interval_is_running (node->data))
+        gtt_interval_set_running (node->data, FALSE);
+    }
+}
+
+static void
+merge_task (Merge *m, GttTask *ours, GttTask *theirs, time_t when)
+{
+  GttProject *prj = gtt_task_get_parent (ours);
+  gboolean newer = (when > original_modified (m, prj));
+
+  merge_touch (m, prj, when);
+  if (newer && merge_task_fields (ours, theirs))
+    m->stats->tasks_updated++;
+  merge_intervals (m, ours, theirs);
+  m->rekey_tasks = g_list_prepend (m->rekey_tasks, ours);
+}
+
+/* ============================================================== */
+
+static void
+merge_project (Merge *m, GttProject *theirs, GttProject *parent)
+{
+  GttProject *ours, *target;
+  GList *kids, *tasks, *node;
+  time_t when = gtt_project_get_last_modified (theirs);
+
+  ours = g_hash_table_lookup (m->projects, gtt_project_get_guid (theirs));
+  kids = g_list_copy (gtt_project_get_children (theirs));
+  tasks = g_list_copy (gtt_project_get_tasks (theirs));
+
+  if (ours)
+    {
+      merge_touch (m, ours, when);
+      if (when > original_modified (m, ours))
+        {
+          merge_project_fields (ours, theirs);
+          m->stats->projects_updated++;
+        }
+      gtt_project_remove (theirs);
+      m->leftovers = g_list_prepend (m->leftovers, theirs);
+      m->rekey_projects = g_list_prepend (m->rekey_projects, ours);
+      target = ours;
+    }
+  else
+    {
+      /* Move it in, but not its subprojects; we may have those
+       * already, elsewhere in the tree. */
+      for (node = kids; node; node = node->next)
+        gtt_project_remove (node->data);
+      if (gtt_project_locate_from_id (gtt_project_get_id (theirs)))
+        gtt_project_set_id (theirs, m->next_id++);
+      merge_touch (m, theirs, when);
+      gtt_project_append_project (parent, theirs);
+      m->stats->projects_added++;
+      target = theirs;
+    }
+
+  for (node = tasks; node; node = node->next)
+    {
+      GttTask *tsk = node->data;
+      GttTask *match = g_hash_table_lookup (m->tasks, gtt_task_get_guid (tsk));
+
+      stop_intervals (tsk);
+      if (match)
+        {
+          merge_task (m, match, tsk, when);
+          if (!ours)
+            {
+              gtt_task_remove (tsk);
+              gtt_task_destroy (tsk);
+            }
+        }
+      else
+        {
+          if (ours)
+            {
+              gtt_task_remove (tsk);
+              gtt_project_append_task (ours, tsk);
+            }
+          m->stats->tasks_added++;
+        }
+    }
+
+  for (node = kids; node; node = node->next)
+    merge_project (m, node->data, target);
+
+  g_list_free (kids);
+  g_list_free (tasks);
+}
+
+void
+gtt_merge_projects (GList *prjs, GttMergeStats *stats)
+{
+  GttMergeStats dummy;
+  GHashTableIter iter;
+  gpointer key, value;
+  GList *node;
+  Merge m;
+
+  memset (&dummy, 0, sizeof (dummy));
+  m.stats = stats ? stats : &dummy;
+  m.projects = g_hash_table_new (merge_guid_hash, merge_guid_equal);
+  m.tasks = g_hash_table_new (merge_guid_hash, merge_guid_equal);
+  m.original = g_hash_table_new (g_direct_hash, g_direct_equal);
+  m.modified = g_hash_table_new (g_direct_hash, g_direct_equal);
+  m.leftovers = NULL;
+  m.rekey_projects = NULL;
+  m.rekey_tasks = NULL;
+  m.next_id = 1;
+
+  index_ours (&m, gtt_project_list_get_list (global_plist));
+
+  prjs = g_list_copy (prjs);
+  for (node = prjs; node; node = node->next)
+    merge_project (&m, node->data, NULL);
+  g_list_free (prjs);
+
+  for (node = m.leftovers; node; node = node->next)
+    gtt_project_destroy (node->data);
+
+  /* Reading theirs in registered their GUIDs in place of ours; get
+   * ours back. */
+  for (node = m.rekey_projects; node; node = node->next)
+    gtt_project_set_guid (node->data, gtt_project_get_guid (node->data));
+  for (node = m.rekey_tasks; node; node = node->next)
+    gtt_task_set_guid (node->data, gtt_task_get_guid (node->data));
+
+  g_hash_table_iter_init (&iter, m.modified);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    gtt_project_thaw (key);
+  gtt_project_list_compute_secs ();
+
+  /* A merge isn't an edit: what changed was last modified when the
+   * other side modified it. */
+  g_hash_table_iter_init (&iter, m.modified);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    gtt_project_set_last_modified (key, (time_t)GPOINTER_TO_SIZE (value));
+
+  g_list_free (m.leftovers);
+  g_list_free (m.rekey_projects);
+  g_list_free (m.rekey_tasks);
+  g_hash_table_destroy (m.projects);
+  g_hash_table_destroy (m.tasks);
+  g_hash_table_destroy (m.original);
+  g_hash_table_destroy (m.modified);
+}
+
+/* ============================================================== */
+
+gboolean
+gtt_merge_file (const char *filename, GttMergeStats *stats, char **errmsg)
+{
+  GttErrCode errcode;
+  GList *prjs, *node;
+
+  g_return_val_if_fail (filename, FALSE);
+
+  gtt_err_set_code (GTT_NO_ERR);
+  prjs = gtt_xml_read_projects (filename);
+  errcode = gtt_err_get_code ();
+
+  /* Merging half a file would be worse than merging none of it */
+  if (GTT_NO_ERR != errcode)
+    {
+      for (node = prjs; node; node = node->next)
+        gtt_project_destroy (node->data);
+      g_list_free (prjs);
+      if (errmsg)
+        *errmsg = gtt_err_to_string (errcode, filename);
+      return FALSE;
+    }
+
+  gtt_merge_projects (prjs, stats);
+  g_list_free (prjs);
+  return TRUE;
+}
+
+/* ======================= END OF FILE =================== */
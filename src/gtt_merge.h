@@ -0,0 +1,78 @@
+/*   Merge data files by GUID, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_MERGE_H
+#define GTT_MERGE_H
+
+#include <glib.h>
+
+#include "gtt_project.h"
+
+/* A merge brings another copy of the data into the project list, such
+ * as the data file of a laptop into that of a desktop, so that time
+ * can be tracked on both, and reconciled every so often.  Nothing is
+ * asked of the user, so it can be run in batch mode (see
+ * gtt_batch_report.h) from cron.
+ *
+ * Projects and tasks are matched by their GUIDs, wherever they are in
+ * the tree.  Their intervals are matched by start time, and unioned:
+ * intervals that only one side has are kept, and of those that both
+ * have, the one that stops later wins.  Where both sides have a
+ * project, the fields of whichever side edited a field last (see
+ * gtt_project_get_last_modified()) win, and so do those of its tasks.
+ * Tracking time doesn't count as an edit, so a machine that was only
+ * used to run the timer doesn't undo edits made elsewhere.  Projects
+ * and tasks that only the other side has are added; a project goes
+ * under its parent's match, or at the top level.  Our copy's place in
+ * the tree is kept.
+ *
+ * The last-modified time is kept per project, not per field: if one
+ * side edited a project's title, and the other its notes, then all of
+ * the fields of the later edit win, and the earlier edit is lost.
+ * Likewise, an edit to any task of a project carries all of its other
+ * tasks' fields along with it.
+ *
+ * Nothing is ever deleted: something deleted on one side, but still
+ * on the other, comes back.  The intervals are sorted and merged, so
+ * a merge takes O(n log n) time in the number of intervals.
+ *
+ * The gtt_merge_projects() routine merges 'prjs', as read by
+ *    gtt_xml_read_projects(), into the global project list, and takes
+ *    them over; they are either moved in, or freed.  What was added
+ *    and changed is counted up in 'stats', if it isn't NULL.
+ *
+ * The gtt_merge_file() routine reads the data file 'filename', and
+ *    merges it.  It returns FALSE, and an error message (to be
+ *    g_free()'d) if the file can't be read.
+ */
+
+typedef struct
+{
+  int projects_added;
+  int projects_updated;
+  int tasks_added;
+  int tasks_updated;
+  int intervals_added;
+  int intervals_updated;
+} GttMergeStats;
+
+void gtt_merge_projects (GList *prjs, GttMergeStats *stats);
+gboolean gtt_merge_file (const char *filename, GttMergeStats *stats,
+                         char **errmsg);
+
+#endif // GTT_MERGE_H
@@ -28,6 +28,7 @@
 #include "gtt_help_popup.h"
 #include "gtt_preferences.h"
 #include "gtt_property_box.h"
+#include "gtt_report_cache.h"
 #include "gtt_timer.h"
 #include "gtt_toolbar.h"
 #include "gtt_util.h"
@@ -528,6 +529,7 @@ prefs_set (GttPropertyBox *pb, gint page, PrefsDialog *odlg)
           /* Need to recompute everything, including the bining */
           gtt_project_list_compute_secs ();
           gtt_projects_tree_update_all_rows (projects_tree);
+          schedule_day_rollover ();
         }
     }
 
@@ -557,6 +559,9 @@ prefs_set (GttPropertyBox *pb, gint page, PrefsDialog *odlg)
         }
     }
 
+  /* Reports rendered with the old settings would look wrong */
+  gtt_report_cache_clear ();
+
   /* Also save them the to file at this point */
   save_properties ();
 }
@@ -29,11 +29,14 @@
 
 #include <qof.h>
 
+#include "gtt_clock_monitor.h"
 #include "gtt_err_throw.h"
+#include "gtt_interval_index.h"
 #include "gtt_log.h"
 #include "gtt_preferences.h" /* XXX tmp hack for config_* */
 #include "gtt_project_p.h"
-#include "gtt_queries.h" /* temp hack for query */
+#include "gtt_project_queries.h"
+#include "gtt_text_index.h"
 
 #define _(X) gettext (X)
 
@@ -53,13 +56,35 @@ GttProjectList *global_plist = NULL;
 
 QofBook *global_book = NULL;
 
+/* Running tally of changes, and its value at the last save */
+static guint change_tally = 0;
+static guint saved_tally = 0;
+
+/* Bumped on every edit anywhere, and on every structural change */
+static guint list_generation = 0;
+
 static void proj_refresh_time (GttProject *proj);
+static void proj_recompute (GttProject *proj);
 static void proj_modified (GttProject *proj);
+static void proj_fields_modified (GttProject *proj);
 static int task_suspend (GttTask *tsk);
 static void gtt_interval_unhook (GttInterval *ivl);
 
 /* ============================================================= */
 
+/* Something in, or under, prj has changed; so have all of the
+ * subtrees that it is in, and the project list as a whole.  The prj
+ * may be NULL, for a change to the top level of the list. */
+static void
+subtree_changed (GttProject *prj)
+{
+  for (; prj; prj = prj->parent)
+    prj->subtree_generation++;
+  list_generation++;
+}
+
+/* ============================================================= */
+
 static int next_free_id = 1;
 
 GttProject *
@@ -100,6 +125,7 @@ gtt_project_new (void)
   proj->being_destroyed = FALSE;
   proj->frozen = FALSE;
   proj->dirty_time = FALSE;
+  proj->last_modified = 0;
 
   proj->secs_ever = 0;
   proj->secs_day = 0;
@@ -111,6 +137,7 @@ gtt_project_new (void)
 
   proj->id = next_free_id;
   next_free_id++;
+  gtt_project_index_update (proj);
 
   qof_instance_init (&proj->inst, GTT_PROJECT_ID, global_book);
   return proj;
@@ -152,6 +179,7 @@ gtt_project_dup (GttProject *proj)
   p->title = g_strdup (proj->title);
   p->desc = g_strdup (proj->desc);
   p->notes = g_strdup (proj->notes);
+  gtt_text_index_set (p, GTT_TEXT_PROJECT_NOTES, p->notes);
   if (proj->custid)
     p->custid = g_strdup (proj->custid);
 
@@ -172,6 +200,7 @@ gtt_project_dup (GttProject *proj)
   p->urgency = proj->urgency;
   p->importance = proj->importance;
   p->status = proj->status;
+  gtt_project_index_update (p);
 
   /* Don't copy the tasks.  Do copy the sub-projects */
   for (node = proj->sub_projects; node; node = node->next)
@@ -189,6 +218,9 @@ gtt_project_dup (GttProject *proj)
 void
 gtt_project_remove (GttProject *p)
 {
+  change_tally += GTT_CHANGE_EDIT;
+  subtree_changed (p->parent);
+
   /* if we are in someone elses list, remove */
   if (p->parent)
     {
@@ -222,6 +254,7 @@ gtt_project_destroy (GttProject *proj)
   if (proj->notes)
     g_free (proj->desc);
   proj->notes = NULL;
+  gtt_text_index_remove (proj);
 
   if (proj->custid)
     g_free (proj->custid);
@@ -246,6 +279,10 @@ gtt_project_destroy (GttProject *proj)
         }
     }
 
+  gtt_interval_index_unref (proj->ivl_index);
+  gtt_interval_index_unref (proj->subtree_ivl_index);
+  gtt_project_index_remove (proj);
+
   /* remove notifiers as well */
   {
     Notifier *ntf;
@@ -291,7 +328,7 @@ gtt_project_set_title (GttProject *proj, const char *t)
       return;
     }
   proj->title = g_strdup (t);
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 void
@@ -307,7 +344,7 @@ gtt_project_set_desc (GttProject *proj, const char *d)
       return;
     }
   proj->desc = g_strdup (d);
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 void
@@ -320,10 +357,12 @@ gtt_project_set_notes (GttProject *proj, const char *d)
   if (!d)
     {
       proj->notes = g_strdup ("");
+      gtt_text_index_set (proj, GTT_TEXT_PROJECT_NOTES, NULL);
       return;
     }
   proj->notes = g_strdup (d);
-  proj_modified (proj);
+  gtt_text_index_set (proj, GTT_TEXT_PROJECT_NOTES, proj->notes);
+  proj_fields_modified (proj);
 }
 
 void
@@ -339,7 +378,7 @@ gtt_project_set_custid (GttProject *proj, const char *d)
       return;
     }
   proj->custid = g_strdup (d);
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 const char *
@@ -380,7 +419,7 @@ gtt_project_set_billrate (GttProject *proj, double r)
   if (!proj)
     return;
   proj->billrate = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 double
@@ -397,7 +436,7 @@ gtt_project_set_overtime_rate (GttProject *proj, double r)
   if (!proj)
     return;
   proj->overtime_rate = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 double
@@ -414,7 +453,7 @@ gtt_project_set_overover_rate (GttProject *proj, double r)
   if (!proj)
     return;
   proj->overover_rate = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 double
@@ -431,7 +470,7 @@ gtt_project_set_flat_fee (GttProject *proj, double r)
   if (!proj)
     return;
   proj->flat_fee = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 double
@@ -448,7 +487,7 @@ gtt_project_set_min_interval (GttProject *proj, int r)
   if (!proj)
     return;
   proj->min_interval = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 int
@@ -465,7 +504,7 @@ gtt_project_set_auto_merge_interval (GttProject *proj, int r)
   if (!proj)
     return;
   proj->auto_merge_interval = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 int
@@ -482,7 +521,7 @@ gtt_project_set_auto_merge_gap (GttProject *proj, int r)
   if (!proj)
     return;
   proj->auto_merge_gap = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 int
@@ -515,7 +554,7 @@ gtt_project_set_estimated_start (GttProject *proj, time_t r)
   if (!proj)
     return;
   proj->estimated_start = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 time_t
@@ -532,7 +571,7 @@ gtt_project_set_estimated_end (GttProject *proj, time_t r)
   if (!proj)
     return;
   proj->estimated_end = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 time_t
@@ -549,7 +588,8 @@ gtt_project_set_due_date (GttProject *proj, time_t r)
   if (!proj)
     return;
   proj->due_date = r;
-  proj_modified (proj);
+  gtt_project_index_update (proj);
+  proj_fields_modified (proj);
 }
 
 time_t
@@ -566,7 +606,7 @@ gtt_project_set_sizing (GttProject *proj, int r)
   if (!proj)
     return;
   proj->sizing = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 int
@@ -587,7 +627,7 @@ gtt_project_set_percent_complete (GttProject *proj, int r)
   if (100 < r)
     r = 100;
   proj->percent_complete = r;
-  proj_modified (proj);
+  proj_fields_modified (proj);
 }
 
 int
@@ -604,7 +644,8 @@ gtt_project_set_urgency (GttProject *proj, GttRank r)
   if (!proj)
     return;
   proj->urgency = r;
-  proj_modified (proj);
+  gtt_project_index_update (proj);
+  proj_fields_modified (proj);
 }
 
 GttRank
@@ -621,7 +662,8 @@ gtt_project_set_importance (GttProject *proj, GttRank r)
   if (!proj)
     return;
   proj->importance = r;
-  proj_modified (proj);
+  gtt_project_index_update (proj);
+  proj_fields_modified (proj);
 }
 
 GttRank
@@ -638,7 +680,8 @@ gtt_project_set_status (GttProject *proj, GttProjectStatus r)
   if (!proj)
     return;
   proj->status = r;
-  proj_modified (proj);
+  gtt_project_index_update (proj);
+  proj_fields_modified (proj);
 }
 
 GttProjectStatus
@@ -681,6 +724,44 @@ gtt_project_get_id (GttProject *proj)
   return proj->id;
 }
 
+guint
+gtt_project_get_generation (GttProject *proj)
+{
+  if (!proj)
+    return 0;
+  return proj->generation;
+}
+
+guint
+gtt_project_get_subtree_generation (GttProject *proj)
+{
+  if (!proj)
+    return 0;
+  return proj->subtree_generation;
+}
+
+guint
+gtt_project_list_get_generation (void)
+{
+  return list_generation;
+}
+
+time_t
+gtt_project_get_last_modified (GttProject *proj)
+{
+  if (!proj)
+    return 0;
+  return proj->last_modified;
+}
+
+void
+gtt_project_set_last_modified (GttProject *proj, time_t when)
+{
+  if (!proj)
+    return;
+  proj->last_modified = when;
+}
+
 /* =========================================================== */
 /* compatibility interface */
 
@@ -836,10 +917,11 @@ gtt_project_append_project (GttProject *proj, GttProject *child)
 
   proj->sub_projects = g_list_append (proj->sub_projects, child);
   child->parent = proj;
+  subtree_changed (proj);
 }
 
-void
-gtt_project_insert_before (GttProject *p, GttProject *before_me)
+static void
+project_insert_before (GttProject *p, GttProject *before_me)
 {
   gint pos;
 
@@ -898,7 +980,16 @@ gtt_project_insert_before (GttProject *p, GttProject *before_me)
 }
 
 void
-gtt_project_insert_after (GttProject *p, GttProject *after_me)
+gtt_project_insert_before (GttProject *p, GttProject *before_me)
+{
+  if (!p)
+    return;
+  project_insert_before (p, before_me);
+  subtree_changed (p->parent);
+}
+
+static void
+project_insert_after (GttProject *p, GttProject *after_me)
 {
   gint pos;
 
@@ -958,6 +1049,15 @@ gtt_project_insert_after (GttProject *p, GttProject *after_me)
     }
 }
 
+void
+gtt_project_insert_after (GttProject *p, GttProject *after_me)
+{
+  if (!p)
+    return;
+  project_insert_after (p, after_me);
+  subtree_changed (p->parent);
+}
+
 void
 gtt_project_reparent (GttProject *proj, GttProject *parent, int position)
 {
@@ -981,9 +1081,12 @@ gtt_project_reparent (GttProject *proj, GttProject *parent, int position)
       old_list = &global_plist->prj_list;
     }
 
+  subtree_changed (proj->parent);
   *old_list = g_list_remove (*old_list, proj);
   *new_list = g_list_insert (*new_list, proj, position);
   proj->parent = parent;
+  subtree_changed (parent);
+  change_tally += GTT_CHANGE_EDIT;
 }
 
 void
@@ -1573,8 +1676,56 @@ scrub_intervals (GttTask *tsk, GttInterval *handle)
   return handle;
 }
 
+/* The start of the next day, cached so that the timer tick can
+ * notice a day rollover without having to call mktime(). */
+static time_t next_day_start = 0;
+
+/* The boundaries of the reporting periods, computed once per pass
+ * rather than once per project. */
+typedef struct
+{
+  time_t midnight;
+  time_t sunday;
+  time_t month;
+  time_t newyear;
+} PeriodBounds;
+
 static void
-project_compute_secs (GttProject *proj)
+period_bounds_init (PeriodBounds *pb)
+{
+  pb->midnight = get_midnight (-1);
+  pb->sunday = get_sunday (-1);
+  pb->month = get_month (-1);
+  pb->newyear = get_newyear (-1);
+}
+
+/* Return the number of seconds of the interval that fall between
+ * 'from' and 'to'. */
+static int
+ivl_secs_between (GttInterval *ivl, time_t from, time_t to)
+{
+  time_t start = MAX (ivl->start, from);
+  time_t stop = MIN (ivl->stop, to);
+  if (stop <= start)
+    return 0;
+  return stop - start;
+}
+
+static int
+ivl_secs_since (GttInterval *ivl, time_t from)
+{
+  if (ivl->start >= from)
+    return ivl->stop - ivl->start;
+  if (ivl->stop > from)
+    return ivl->stop - from;
+  return 0;
+}
+
+/* Recompute the period totals named in the mask.  The other totals
+ * are left alone. */
+static void
+project_compute_period_secs (GttProject *proj, GttPeriodMask mask,
+                             const PeriodBounds *pb, gboolean scrub)
 {
   int total_ever = 0;
   int total_day = 0;
@@ -1583,140 +1734,93 @@ project_compute_secs (GttProject *proj)
   int total_lastweek = 0;
   int total_month = 0;
   int total_year = 0;
-  time_t midnight, sunday, month, newyear;
+  time_t midnight = pb->midnight;
+  time_t sunday = pb->sunday;
   GList *tsk_node, *ivl_node, *prj_node;
 
-  if (!proj)
-    return;
-
   /* Total up the subprojects first */
   for (prj_node = proj->sub_projects; prj_node; prj_node = prj_node->next)
     {
       GttProject *prj = prj_node->data;
-      project_compute_secs (prj);
+      project_compute_period_secs (prj, mask, pb, scrub);
     }
 
-  midnight = get_midnight (-1);
-  sunday = get_sunday (-1);
-  month = get_month (-1);
-  newyear = get_newyear (-1);
-
   /* Total up time spent in various tasks.
-   * XXX None of these total handle daylight savings correctly.
+   * XXX Yesterday and last week don't handle daylight savings correctly.
    */
   for (tsk_node = proj->task_list; tsk_node; tsk_node = tsk_node->next)
     {
       GttTask *task = tsk_node->data;
-      scrub_intervals (task, NULL);
+      if (scrub)
+        scrub_intervals (task, NULL);
       for (ivl_node = task->interval_list; ivl_node; ivl_node = ivl_node->next)
         {
           GttInterval *ivl = ivl_node->data;
-          total_ever += ivl->stop - ivl->start;
-
-          /* Accum time today. */
-          if (ivl->start >= midnight)
+          if (mask & GTT_PERIOD_EVER)
             {
-              total_day += ivl->stop - ivl->start;
+              total_ever += ivl->stop - ivl->start;
             }
-          else if (ivl->stop > midnight)
+          if (mask & GTT_PERIOD_DAY)
             {
-              total_day += ivl->stop - midnight;
+              total_day += ivl_secs_since (ivl, midnight);
+              total_yesterday
+                  += ivl_secs_between (ivl, midnight - 24 * 3600, midnight);
             }
-
-          /* Accum time yesterday. */
-          if (ivl->start < midnight)
+          if (mask & GTT_PERIOD_WEEK)
             {
-              if (ivl->start >= midnight - 24 * 3600)
-                {
-                  if (ivl->stop <= midnight)
-                    {
-                      total_yesterday += ivl->stop - ivl->start;
-                    }
-                  else
-                    {
-                      total_yesterday += midnight - ivl->start;
-                    }
-                }
-              else /* else .. it started before midnight yesterday */
-                  if (ivl->stop > midnight - 24 * 3600)
-                {
-                  if (ivl->stop <= midnight)
-                    {
-                      total_yesterday += ivl->stop - (midnight - 24 * 3600);
-                    }
-                  else
-                    {
-                      total_yesterday += 24 * 3600;
-                    }
-                }
-            }
-
-          /* Accum time this week. */
-          if (ivl->start >= sunday)
-            {
-              total_week += ivl->stop - ivl->start;
-            }
-          else if (ivl->stop > sunday)
-            {
-              total_week += ivl->stop - sunday;
-            }
-
-          /* Accum time last week. */
-          if (ivl->start < sunday)
-            {
-              if (ivl->start >= sunday - 7 * 24 * 3600)
-                {
-                  if (ivl->stop <= sunday)
-                    {
-                      total_lastweek += ivl->stop - ivl->start;
-                    }
-                  else
-                    {
-                      total_lastweek += sunday - ivl->start;
-                    }
-                }
-              else /* else .. it started before sunday last week */
-                  if (ivl->stop > sunday - 7 * 24 * 3600)
-                {
-                  if (ivl->stop <= sunday)
-                    {
-                      total_lastweek += ivl->stop - (sunday - 7 * 24 * 3600);
-                    }
-                  else
-                    {
-                      total_lastweek += 7 * 24 * 3600;
-                    }
-                }
-            }
-
-          /* Accum time this month */
-          if (ivl->start >= month)
-            {
-              total_month += ivl->stop - ivl->start;
-            }
-          else if (ivl->stop > month)
-            {
-              total_month += ivl->stop - month;
+              total_week += ivl_secs_since (ivl, sunday);
+              total_lastweek += ivl_secs_between (
+                  ivl, sunday - 7 * 24 * 3600, sunday);
             }
-          if (ivl->start >= newyear)
+          if (mask & GTT_PERIOD_MONTH)
             {
-              total_year += ivl->stop - ivl->start;
+              total_month += ivl_secs_since (ivl, pb->month);
             }
-          else if (ivl->stop > newyear)
+          if (mask & GTT_PERIOD_YEAR)
             {
-              total_year += ivl->stop - newyear;
+              total_year += ivl_secs_since (ivl, pb->newyear);
             }
         }
     }
 
-  proj->secs_ever = total_ever;
-  proj->secs_day = total_day;
-  proj->secs_yesterday = total_yesterday;
-  proj->secs_week = total_week;
-  proj->secs_lastweek = total_lastweek;
-  proj->secs_month = total_month;
-  proj->secs_year = total_year;
-  proj->dirty_time = FALSE;
+  if (mask & GTT_PERIOD_EVER)
+    {
+      proj->secs_ever = total_ever;
+    }
+  if (mask & GTT_PERIOD_DAY)
+    {
+      proj->secs_day = total_day;
+      proj->secs_yesterday = total_yesterday;
+    }
+  if (mask & GTT_PERIOD_WEEK)
+    {
+      proj->secs_week = total_week;
+      proj->secs_lastweek = total_lastweek;
+    }
+  if (mask & GTT_PERIOD_MONTH)
+    {
+      proj->secs_month = total_month;
+    }
+  if (mask & GTT_PERIOD_YEAR)
+    {
+      proj->secs_year = total_year;
+    }
+  if (GTT_PERIOD_ALL == (mask & GTT_PERIOD_ALL))
+    {
+      proj->dirty_time = FALSE;
+    }
+}
+
+static void
+project_compute_secs (GttProject *proj)
+{
+  PeriodBounds pb;
+
+  if (!proj)
+    return;
+
+  period_bounds_init (&pb);
+  project_compute_period_secs (proj, GTT_PERIOD_ALL, &pb, TRUE);
 }
 
 static void
@@ -1737,6 +1841,7 @@ void
 gtt_project_list_compute_secs (void)
 {
   GList *node;
+  next_day_start = 0;
   for (node = global_plist->prj_list; node; node = node->next)
     {
       GttProject *prj = node->data;
@@ -1745,6 +1850,59 @@ gtt_project_list_compute_secs (void)
     }
 }
 
+time_t
+gtt_next_day_start (time_t now)
+{
+  struct tm lt;
+  time_t next;
+
+  /* Step forward by one calendar day, and let mktime() sort out
+   * the days that are 23 or 25 hours long. */
+  next = get_midnight (now) - config_daystart_offset;
+  memcpy (&lt, localtime (&next), sizeof (struct tm));
+  lt.tm_mday += 1;
+  lt.tm_isdst = -1;
+  next = mktime (&lt);
+
+  next += config_daystart_offset;
+  return next;
+}
+
+GttPeriodMask
+gtt_period_rollover_mask (time_t before, time_t after)
+{
+  GttPeriodMask mask = 0;
+
+  if (get_midnight (before) != get_midnight (after))
+    mask |= GTT_PERIOD_DAY;
+  if (get_sunday (before) != get_sunday (after))
+    mask |= GTT_PERIOD_WEEK;
+  if (get_month (before) != get_month (after))
+    mask |= GTT_PERIOD_MONTH;
+  if (get_newyear (before) != get_newyear (after))
+    mask |= GTT_PERIOD_YEAR;
+  return mask;
+}
+
+void
+gtt_project_list_rollover (GttPeriodMask mask)
+{
+  PeriodBounds pb;
+  GList *node;
+
+  next_day_start = 0;
+  if (0 == mask)
+    return;
+
+  period_bounds_init (&pb);
+  for (node = global_plist->prj_list; node; node = node->next)
+    {
+      GttProject *prj = node->data;
+      project_compute_period_secs (prj, mask, &pb, FALSE);
+      children_modified (prj);
+    }
+}
+
 /* =========================================================== */
 /* even notification subsystem */
 
@@ -1801,7 +1959,7 @@ gtt_project_thaw (GttProject *prj)
   if (!prj)
     return;
   prj->frozen = FALSE;
-  proj_refresh_time (prj);
+  proj_recompute (prj);
 }
 
 void
@@ -1818,7 +1976,7 @@ gtt_task_thaw (GttTask *tsk)
   if (!tsk || !tsk->parent)
     return;
   tsk->parent->frozen = FALSE;
-  proj_refresh_time (tsk->parent);
+  proj_recompute (tsk->parent);
 }
 
 void
@@ -1840,8 +1998,31 @@ gtt_interval_thaw (GttInterval *ivl)
   return ivl;
 }
 
+/* The project, and so every subtree that it is in, has changed */
+static void
+proj_bump_generation (GttProject *proj)
+{
+  proj->generation++;
+  subtree_changed (proj);
+}
+
 static void
 proj_refresh_time (GttProject *proj)
+{
+  if (!proj)
+    return;
+  if (proj->being_destroyed)
+    return;
+  change_tally += GTT_CHANGE_EDIT;
+  proj_bump_generation (proj);
+  proj_recompute (proj);
+}
+
+/* Recompute the time totals and tell the listeners, without counting
+ * it as an edit: for thaws, whose edits were counted as they were
+ * made, and for the running interval keeping up with the clock. */
+static void
+proj_recompute (GttProject *proj)
 {
   GList *node;
 
@@ -1871,6 +2052,8 @@ proj_modified (GttProject *proj)
     return;
   if (proj->being_destroyed)
     return;
+  change_tally += GTT_CHANGE_EDIT;
+  proj_bump_generation (proj);
   if (proj->frozen)
     return;
 
@@ -1882,6 +2065,40 @@ proj_modified (GttProject *proj)
     }
 }
 
+/* A field of the project, or of one of its tasks, was edited.  Only
+ * these count towards the last-modified time that merges go by;
+ * tracking time, and editing intervals, don't. */
+static void
+proj_fields_modified (GttProject *proj)
+{
+  if (!proj)
+    return;
+  if (proj->being_destroyed)
+    return;
+  proj->last_modified = time (0);
+  proj_modified (proj);
+}
+
+/* =========================================================== */
+
+guint
+gtt_project_list_get_changes (void)
+{
+  return change_tally;
+}
+
+void
+gtt_project_list_mark_saved (guint changes)
+{
+  saved_tally = changes;
+}
+
+guint
+gtt_project_list_unsaved_changes (void)
+{
+  return change_tally - saved_tally;
+}
+
 /* =========================================================== */
 
 void
@@ -1971,6 +2188,10 @@ gtt_project_timer_start (GttProject *proj)
     }
 
   now = time (0);
+  gtt_clock_monitor_reset ();
+
+  /* Not an edit as such, but the intervals are about to change */
+  proj_bump_generation (proj);
 
   /* only add a new interval if there's been a bit of a gap,
    * otherwise, reuse the most recent running interval.  */
@@ -2005,12 +2226,37 @@ gtt_project_timer_start (GttProject *proj)
     }
 }
 
+/* Close the running interval at 'stop', and start a new running
+ * interval at 'restart'. */
+static void
+proj_timer_split (GttProject *proj, GttTask *task, GttInterval *ival,
+                  time_t stop, time_t restart)
+{
+  GttInterval *nival;
+
+  /* Don't take back time that was already booked */
+  if (stop < ival->stop)
+    stop = ival->stop;
+  ival->stop = stop;
+  ival->running = FALSE;
+
+  nival = g_new0 (GttInterval, 1);
+  nival->start = restart;
+  nival->stop = restart;
+  nival->running = TRUE;
+  nival->parent = task;
+  task->interval_list = g_list_prepend (task->interval_list, nival);
+
+  proj_refresh_time (proj);
+}
+
 void
 gtt_project_timer_update (GttProject *proj)
 {
   GttTask *task;
   GttInterval *ival;
   time_t prev_update, now, diff;
+  time_t gap_start, gap_end;
 
   if (!proj)
     return;
@@ -2039,12 +2285,37 @@ gtt_project_timer_update (GttProject *proj)
   if (FALSE == ival->running)
     return;
 
-  /* compute the delta change, update cached data */
-  now = time (0);
+  /* If the machine was asleep, or the wall clock was set, don't book
+   * the gap.  Stop the interval where the gap started, and carry on
+   * with a new one where it ended. */
+  if (gtt_clock_monitor_check (&now, &gap_start, &gap_end))
+    {
+      proj_timer_split (proj, task, ival, gap_start, gap_end);
+      return;
+    }
 
-  /* hack alert -- why aren't we checking a midnight rollover? */
+  /* compute the delta change, update cached data.  The monitor's
+   * clock is whole seconds off the boot-time clock, so it can be a
+   * second behind a time(0) taken elsewhere; don't go backwards. */
   prev_update = ival->stop;
+  now = MAX (now, prev_update);
   ival->stop = now;
+
+  /* If a day start went by since the last update, the deltas below
+   * would book all of the elapsed time onto the new day.  Recompute
+   * the totals for this project instead. */
+  if (0 == next_day_start)
+    next_day_start = gtt_next_day_start (prev_update);
+  if (now >= next_day_start)
+    {
+      PeriodBounds pb;
+      next_day_start = gtt_next_day_start (now);
+      period_bounds_init (&pb);
+      project_compute_period_secs (proj, GTT_PERIOD_ALL, &pb, FALSE);
+      return;
+    }
+
+  change_tally += GTT_CHANGE_TICK;
   diff = now - prev_update;
   proj->secs_ever += diff;
   proj->secs_day += diff;
@@ -2129,42 +2400,14 @@ static QofObject prj_object_def = {
   printable : NULL,
 };
 
-/* =========================================================== */
-/* bogus wrappers */
-static QofTime *
-prj_obj_get_earliest (GttProject *prj, QofParam *qpm)
-{
-  // static time return, not thread safe, but a hack that will do for now.
-  static QofTime *qt = NULL;
-  if (NULL == qt)
-    qt = qof_time_new ();
-  time_t gt = gtt_project_get_earliest_start (prj, TRUE);
-  qof_time_set_secs (qt, gt);
-  return qt;
-}
-
-static QofTime *
-prj_obj_get_latest (GttProject *prj, QofParam *qpm)
-{
-  static QofTime *qt = NULL;
-  if (NULL == qt)
-    qt = qof_time_new ();
-  time_t gt = gtt_project_get_latest_stop (prj, TRUE);
-  qof_time_set_secs (qt, gt);
-  return qt;
-}
-
 gboolean
 gtt_project_obj_register (void)
 {
   global_book = qof_book_new ();
 
-  /* Associate an ASCII name to each getter, as well as the return type */
+  /* Queries are done by gtt_query.c now, not by QOF; so there are
+   * no getters to register. */
   static QofParam params[] = {
-    { GTT_PROJECT_EARLIEST, QOF_TYPE_TIME, (QofAccessFunc)prj_obj_get_earliest,
-      NULL },
-    { GTT_PROJECT_LATEST, QOF_TYPE_TIME, (QofAccessFunc)prj_obj_get_latest,
-      NULL },
     { NULL },
   };
 
@@ -2183,6 +2426,7 @@ gtt_task_new (void)
   task->parent = NULL;
   task->memo = g_strdup (_ ("New Diary Entry"));
   task->notes = g_strdup ("");
+  gtt_text_index_set (task, GTT_TEXT_MEMO, task->memo);
   task->billable = GTT_BILLABLE;
   task->billrate = GTT_REGULAR;
   task->billstatus = GTT_BILL, task->bill_unit = 900;
@@ -2204,6 +2448,8 @@ gtt_task_copy (GttTask *old)
   task->parent = NULL;
   task->memo = g_strdup (old->memo);
   task->notes = g_strdup (old->notes);
+  gtt_text_index_set (task, GTT_TEXT_MEMO, task->memo);
+  gtt_text_index_set (task, GTT_TEXT_NOTES, task->notes);
 
   /* inherit the properties ... important for user */
   task->billable = old->billable;
@@ -2260,6 +2506,7 @@ gtt_task_destroy (GttTask *task)
   if (task->notes)
     g_free (task->notes);
   task->notes = NULL;
+  gtt_text_index_remove (task);
   if (task->interval_list)
     {
       GList *node;
@@ -2395,6 +2642,62 @@ gtt_task_append_interval (GttTask *tsk, GttInterval *ival)
   proj_refresh_time (tsk->parent);
 }
 
+/* Newest first, as the interval list is kept */
+static gint
+cmp_newest_first (gconstpointer a, gconstpointer b)
+{
+  const GttInterval *ia = a, *ib = b;
+
+  if (ia->start != ib->start)
+    return (ia->start < ib->start) ? 1 : -1;
+  if (ia->stop != ib->stop)
+    return (ia->stop < ib->stop) ? 1 : -1;
+  return 0;
+}
+
+void
+gtt_task_add_intervals (GttTask *tsk, GList *ivls)
+{
+  GList *node, *next;
+
+  if (!tsk || !ivls)
+    return;
+  for (node = ivls; node; node = node->next)
+    {
+      GttInterval *ivl = node->data;
+      g_return_if_fail (NULL == ivl->parent);
+    }
+  for (node = ivls; node; node = node->next)
+    {
+      GttInterval *ivl = node->data;
+      ivl->parent = tsk;
+    }
+
+  tsk->interval_list
+      = g_list_sort (g_list_concat (ivls, tsk->interval_list),
+                     cmp_newest_first);
+
+  for (node = tsk->interval_list; node && node->next; node = next)
+    {
+      GttInterval *ivl = node->data;
+      GttInterval *dup = node->next->data;
+
+      next = node->next;
+      if (ivl->start != dup->start || ivl->stop != dup->stop
+          || dup->running)
+        continue;
+      tsk->interval_list = g_list_delete_link (tsk->interval_list, next);
+      dup->parent = NULL;
+      g_free (dup);
+      next = node;
+    }
+
+  if (!tsk->parent)
+    return;
+  scrub_intervals (tsk, NULL);
+  proj_refresh_time (tsk->parent);
+}
+
 void
 gtt_task_set_memo (GttTask *tsk, const char *m)
 {
@@ -2405,10 +2708,12 @@ gtt_task_set_memo (GttTask *tsk, const char *m)
   if (!m)
     {
       tsk->memo = g_strdup ("");
+      gtt_text_index_set (tsk, GTT_TEXT_MEMO, NULL);
       return;
     }
   tsk->memo = g_strdup (m);
-  proj_modified (tsk->parent);
+  gtt_text_index_set (tsk, GTT_TEXT_MEMO, tsk->memo);
+  proj_fields_modified (tsk->parent);
 }
 
 void
@@ -2421,10 +2726,12 @@ gtt_task_set_notes (GttTask *tsk, const char *m)
   if (!m)
     {
       tsk->notes = g_strdup ("");
+      gtt_text_index_set (tsk, GTT_TEXT_NOTES, NULL);
       return;
     }
   tsk->notes = g_strdup (m);
-  proj_modified (tsk->parent);
+  gtt_text_index_set (tsk, GTT_TEXT_NOTES, tsk->notes);
+  proj_fields_modified (tsk->parent);
 }
 
 const char *
@@ -2449,7 +2756,7 @@ gtt_task_set_billable (GttTask *tsk, GttBillable b)
   if (!tsk)
     return;
   tsk->billable = b;
-  proj_modified (tsk->parent);
+  proj_fields_modified (tsk->parent);
 }
 
 GttBillable
@@ -2466,7 +2773,7 @@ gtt_task_set_billrate (GttTask *tsk, GttBillRate b)
   if (!tsk)
     return;
   tsk->billrate = b;
-  proj_modified (tsk->parent);
+  proj_fields_modified (tsk->parent);
 }
 
 GttBillRate
@@ -2483,7 +2790,7 @@ gtt_task_set_billstatus (GttTask *tsk, GttBillStatus b)
   if (!tsk)
     return;
   tsk->billstatus = b;
-  proj_modified (tsk->parent);
+  proj_fields_modified (tsk->parent);
 }
 
 GttBillStatus
@@ -2500,7 +2807,7 @@ gtt_task_set_bill_unit (GttTask *tsk, int b)
   if (!tsk)
     return;
   tsk->bill_unit = b;
-  proj_modified (tsk->parent);
+  proj_fields_modified (tsk->parent);
 }
 
 int
@@ -2688,12 +2995,24 @@ gtt_interval_set_start (GttInterval *ivl, time_t st)
 void
 gtt_interval_set_stop (GttInterval *ivl, time_t st)
 {
+  gboolean tick;
+
   if (!ivl)
     return;
+  tick = ivl->running && (st >= ivl->stop);
   ivl->stop = st;
   if (st < ivl->start)
     ivl->start = st;
-  if (ivl->parent)
+  if (!ivl->parent)
+    return;
+
+  /* The running interval catching up with the clock isn't an edit */
+  if (tick)
+    {
+      change_tally += GTT_CHANGE_TICK;
+      proj_recompute (ivl->parent->parent);
+    }
+  else
     proj_refresh_time (ivl->parent->parent);
 }
 
@@ -3012,9 +3331,169 @@ gtt_project_list_destroy (GttProjectList *gpl)
       gtt_project_destroy (gpl->prj_list->data);
     }
 
+  gtt_interval_index_unref (gpl->ivl_index);
   g_free (gpl);
 }
 
+/* ============================================================= */
+/* Snapshots.  These copy everything by hand, rather than using
+ * gtt_project_dup() and friends, so as to keep the GUIDs, to land
+ * in the snapshot's book, and to not recompute or notify anything. */
+
+static GttTask *
+task_snapshot (GttTask *tsk, GttProject *parent, QofBook *book)
+{
+  GttTask *task;
+  GList *node;
+
+  task = g_new0 (GttTask, 1);
+  task->parent = parent;
+  task->memo = g_strdup (tsk->memo);
+  task->notes = g_strdup (tsk->notes);
+  task->billable = tsk->billable;
+  task->billrate = tsk->billrate;
+  task->billstatus = tsk->billstatus;
+  task->bill_unit = tsk->bill_unit;
+
+  qof_instance_init (&task->inst, GTT_TASK_ID, book);
+  gtt_task_set_guid (task, gtt_task_get_guid (tsk));
+
+  for (node = tsk->interval_list; node; node = node->next)
+    {
+      GttInterval *ivl = g_new (GttInterval, 1);
+      *ivl = *(GttInterval *)node->data;
+      ivl->parent = task;
+      task->interval_list = g_list_prepend (task->interval_list, ivl);
+    }
+  task->interval_list = g_list_reverse (task->interval_list);
+  return task;
+}
+
+static GttProject *
+project_snapshot (GttProject *proj, GttProject *parent, QofBook *book,
+                  GHashTable *map)
+{
+  GttProject *p;
+  GList *node;
+
+  /* Start from a plain copy, to get all the settings and the time
+   * totals, then fix up everything that points somewhere. */
+  p = g_new (GttProject, 1);
+  *p = *proj;
+  memset (&p->inst, 0, sizeof (p->inst));
+  qof_instance_init (&p->inst, GTT_PROJECT_ID, book);
+  gtt_project_set_guid (p, gtt_project_get_guid (proj));
+
+  p->title = g_strdup (proj->title);
+  p->desc = g_strdup (proj->desc);
+  p->notes = g_strdup (proj->notes);
+  p->custid = g_strdup (proj->custid);
+
+  p->parent = parent;
+  p->listeners = NULL;
+  p->private_data = NULL;
+  p->being_destroyed = FALSE;
+  p->frozen = TRUE;
+  p->ivl_index = NULL;
+  p->subtree_ivl_index = NULL;
+
+  p->task_list = NULL;
+  p->current_task = NULL;
+  for (node = proj->task_list; node; node = node->next)
+    {
+      GttTask *task = task_snapshot (node->data, p, book);
+      if (node->data == proj->current_task)
+        p->current_task = task;
+      p->task_list = g_list_prepend (p->task_list, task);
+    }
+  p->task_list = g_list_reverse (p->task_list);
+
+  p->sub_projects = NULL;
+  for (node = proj->sub_projects; node; node = node->next)
+    {
+      GttProject *sub = project_snapshot (node->data, p, book, map);
+      p->sub_projects = g_list_prepend (p->sub_projects, sub);
+    }
+  p->sub_projects = g_list_reverse (p->sub_projects);
+
+  /* A frozen original may have stale totals; the copy won't. */
+  if (p->dirty_time)
+    project_compute_secs (p);
+
+  if (map)
+    g_hash_table_insert (map, proj, p);
+  return p;
+}
+
+static void
+project_snapshot_free (GttProject *p)
+{
+  GList *node, *in;
+
+  for (node = p->task_list; node; node = node->next)
+    {
+      GttTask *task = node->data;
+      for (in = task->interval_list; in; in = in->next)
+        g_free (in->data);
+      g_list_free (task->interval_list);
+      g_free (task->memo);
+      g_free (task->notes);
+      qof_instance_release (&task->inst);
+      g_free (task);
+    }
+  g_list_free (p->task_list);
+
+  for (node = p->sub_projects; node; node = node->next)
+    project_snapshot_free (node->data);
+  g_list_free (p->sub_projects);
+
+  g_free (p->title);
+  g_free (p->desc);
+  g_free (p->notes);
+  g_free (p->custid);
+  gtt_interval_index_unref (p->ivl_index);
+  gtt_interval_index_unref (p->subtree_ivl_index);
+  qof_instance_release (&p->inst);
+  g_free (p);
+}
+
+GttProjectList *
+gtt_project_list_snapshot (GttProjectList *gpl, GHashTable *map)
+{
+  GttProjectList *snap;
+  GList *node;
+
+  g_return_val_if_fail (gpl, NULL);
+
+  /* Not gtt_project_list_new(); that would make it the global list */
+  snap = g_new0 (GttProjectList, 1);
+  snap->book = qof_book_new ();
+  for (node = gpl->prj_list; node; node = node->next)
+    {
+      GttProject *p = project_snapshot (node->data, NULL, snap->book, map);
+      snap->prj_list = g_list_prepend (snap->prj_list, p);
+    }
+  snap->prj_list = g_list_reverse (snap->prj_list);
+  return snap;
+}
+
+void
+gtt_project_list_snapshot_destroy (GttProjectList *snap)
+{
+  GList *node;
+
+  if (!snap)
+    return;
+  g_return_if_fail (snap->book);
+
+  for (node = snap->prj_list; node; node = node->next)
+    project_snapshot_free (node->data);
+  g_list_free (snap->prj_list);
+  gtt_interval_index_unref (snap->ivl_index);
+  qof_book_destroy (snap->book);
+  g_free (snap);
+}
+
 static GList *
 project_list_sort (GList *prjs, int (cmp) (const void *, const void *))
 {
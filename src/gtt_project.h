@@ -268,6 +268,43 @@ GttInterval *gtt_interval_thaw (GttInterval *ivl);
 void gtt_project_add_notifier (GttProject *, GttProjectChanged, gpointer);
 void gtt_project_remove_notifier (GttProject *, GttProjectChanged, gpointer);
 
+/* The gtt_project_get_generation() routine returns a number that goes
+ *    up whenever the project, or one of its tasks or intervals, is
+ *    edited.  The stop time of the running interval keeping up with
+ *    the clock doesn't count, and neither does a thaw by itself.  A
+ *    listener can compare it with the number it last drew with, to
+ *    tell whether a notification needs a redraw at all.
+ */
+guint gtt_project_get_generation (GttProject *);
+
+/* The gtt_project_get_subtree_generation() routine is the same, but
+ *    also goes up when any of the subprojects, at any depth, is edited,
+ *    or when subprojects are added, moved or removed.
+ *
+ * The gtt_project_list_get_generation() routine goes up whenever
+ *    anything at all changes: an edit to any project, or a change to
+ *    the shape of the project tree.
+ *
+ * Caches of things computed from the project data, such as rendered
+ *    reports, can be kept for as long as these numbers stay the same.
+ */
+guint gtt_project_get_subtree_generation (GttProject *);
+guint gtt_project_list_get_generation (void);
+
+/* The gtt_project_get_last_modified() routine returns the time that
+ *    a field of the project (its title, notes, status, rates and so
+ *    on), or of one of its tasks, was last edited.  Starting and
+ *    stopping the timer, and adding or editing intervals, don't count.
+ *    It is saved with the project, so that copies of the data file
+ *    kept on different machines can be merged (see gtt_merge.h).  Zero
+ *    means never.
+ *
+ * The gtt_project_set_last_modified() routine sets it, without
+ *    counting as an edit; it's for reading the time back in.
+ */
+time_t gtt_project_get_last_modified (GttProject *);
+void gtt_project_set_last_modified (GttProject *, time_t);
+
 /* These functions provide a generic place to hang arbitrary data
  *     on the project (used by the GUI).
  */
@@ -291,11 +328,34 @@ void gtt_project_set_private_data (GttProject *, gpointer);
  *    like gtt_project_foreach_interval(), except that it also
  *    visits the subprojects of the project.
  *
+ * The gtt_project_foreach_interval_in_range() routine works like
+ *    gtt_project_foreach_interval(), but only visits the intervals
+ *    that overlap the time from 'start' to 'end': those that start
+ *    before 'end' and stop after 'start'.  They're visited in order
+ *    of their start times.  It doesn't read through all of the
+ *    intervals to find them; see gtt_interval_index.h.  The callback
+ *    must not change any intervals.
+ *
+ * The gtt_project_foreach_subproject_interval_in_range() routine is
+ *    the same, but also visits the subprojects; and the
+ *    gtt_project_list_foreach_interval_in_range() routine visits all
+ *    of the projects on the list, and their subprojects.
  */
 int gtt_project_foreach (GttProject *, GttProjectCB, gpointer);
 int gtt_project_foreach_interval (GttProject *, GttIntervalCB, gpointer);
 int gtt_project_foreach_subproject_interval (GttProject *, GttIntervalCB,
                                              gpointer);
+int gtt_project_foreach_interval_in_range (GttProject *, time_t start,
+                                           time_t end, GttIntervalCB,
+                                           gpointer);
+int gtt_project_foreach_subproject_interval_in_range (GttProject *,
+                                                      time_t start,
+                                                      time_t end,
+                                                      GttIntervalCB,
+                                                      gpointer);
+int gtt_project_list_foreach_interval_in_range (GttProjectList *,
+                                                time_t start, time_t end,
+                                                GttIntervalCB, gpointer);
 
 /* -------------------------------------------------------- */
 /* Project Manipulation */
@@ -349,6 +409,37 @@ int gtt_project_total_secs_ever (GttProject *proj);
 
 void gtt_project_list_compute_secs (void);
 
+/* The period totals (secs_day, secs_week, etc.) go stale whenever a
+ * day, week, month or year boundary is crossed.  The GttPeriodMask
+ * flags name the groups of totals that need to be recomputed:
+ * GTT_PERIOD_DAY covers today and yesterday, GTT_PERIOD_WEEK covers
+ * this week and last week.
+ *
+ * The gtt_period_rollover_mask() routine returns the set of periods
+ *    whose boundaries lie between the times 'before' and 'after'.
+ *
+ * The gtt_next_day_start() routine returns the time at which the
+ *    day following 'now' starts, honouring config_daystart_offset
+ *    and daylight savings.
+ *
+ * The gtt_project_list_rollover() routine recomputes only the
+ *    indicated period totals for all projects (without scrubbing
+ *    the intervals), and notifies the listeners.
+ */
+typedef enum
+{
+  GTT_PERIOD_DAY = 1 << 0,
+  GTT_PERIOD_WEEK = 1 << 1,
+  GTT_PERIOD_MONTH = 1 << 2,
+  GTT_PERIOD_YEAR = 1 << 3,
+  GTT_PERIOD_EVER = 1 << 4,
+  GTT_PERIOD_ALL = 0x1f
+} GttPeriodMask;
+
+GttPeriodMask gtt_period_rollover_mask (time_t before, time_t after);
+time_t gtt_next_day_start (time_t now);
+void gtt_project_list_rollover (GttPeriodMask mask);
+
 /* The gtt_project_total() routine returns the total
  *   number of projects, including subprojects.
  */
@@ -436,6 +527,21 @@ void gtt_project_list_destroy (GttProjectList *);
 /* Return a list of all top-level projects */
 GList *gtt_project_list_get_list (GttProjectList *);
 
+/* The gtt_project_list_snapshot() routine returns a deep copy of the
+ *    list: all of the projects, sub-projects, tasks and intervals, with
+ *    the same GUIDs and time totals, in a book of their own.  Nothing
+ *    done to the originals afterwards shows up in the copy, and the
+ *    copy has no listeners; it is never modified, so any number of
+ *    threads can read it at once.  If 'map' is not NULL, each
+ *    original project is inserted into it, as a key for its copy.
+ *    Take the snapshot on the main thread.
+ *
+ * The gtt_project_list_snapshot_destroy() routine frees a snapshot.
+ *    Don't use gtt_project_list_destroy() on one.
+ */
+GttProjectList *gtt_project_list_snapshot (GttProjectList *, GHashTable *map);
+void gtt_project_list_snapshot_destroy (GttProjectList *);
+
 /* Append project to the project list */
 void gtt_project_list_append (GttProjectList *, GttProject *p);
 
@@ -482,6 +588,25 @@ int gtt_project_list_total_secs_ever (void);
  */
 int gtt_project_list_total (void);
 
+/* The gtt_project_list_get_changes() routine returns a running tally
+ *    of the changes made to the project data, weighted by kind:
+ *    edits and structural changes count GTT_CHANGE_EDIT each, while
+ *    timer updates count GTT_CHANGE_TICK.
+ *
+ * The gtt_project_list_mark_saved() routine records the tally at
+ *    which the data was last written out (or read in).
+ *
+ * The gtt_project_list_unsaved_changes() routine returns the weight
+ *    of the changes made since then.  The autosave timer uses it to
+ *    decide how soon the data should be saved.
+ */
+#define GTT_CHANGE_TICK 1
+#define GTT_CHANGE_EDIT 10
+
+guint gtt_project_list_get_changes (void);
+void gtt_project_list_mark_saved (guint changes);
+guint gtt_project_list_unsaved_changes (void);
+
 /* -------------------------------------------------------- */
 /* Tasks */
 /* Taks may be a bit misnamed -- they should ave been called
@@ -550,6 +675,18 @@ GList *gtt_task_get_intervals (GttTask *);
 void gtt_task_add_interval (GttTask *, GttInterval *);
 void gtt_task_append_interval (GttTask *, GttInterval *);
 
+/* The gtt_task_add_intervals() routine adds all of the intervals on
+ *    the list 'ivls' to the task at once, for importing a lot of them;
+ *    it takes over the list.  None of the intervals may be on a task
+ *    already; if any is, nothing is added and the list is left to the
+ *    caller.  The task's intervals are then sorted, newest first;
+ *    any with the same start and stop as the one before are dropped,
+ *    so that importing the same data twice doesn't count it twice;
+ *    and they are scrubbed, once.  If the project is frozen, nothing
+ *    is recomputed until it is thawed.
+ */
+void gtt_task_add_intervals (GttTask *, GList *ivls);
+
 /* gtt_task_get_secs_ever() adds up and returns the total number of
  * seconds in the intervals in this task. */
 int gtt_task_get_secs_ever (GttTask *tsk);
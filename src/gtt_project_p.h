@@ -31,6 +31,8 @@ struct gtt_project_list_s
 {
   // XXX this should belong to a QOF book
   GList *prj_list;
+  QofBook *book; /* snapshots only: the book the copies live in */
+  struct gtt_interval_index_s *ivl_index; /* see gtt_interval_index.h */
 };
 
 struct gtt_project_s
@@ -86,6 +88,15 @@ struct gtt_project_s
 
   int id; /* simple id number */
 
+  guint generation; /* bumped on every edit; see gtt_project.h */
+  guint subtree_generation; /* same, but for the subprojects too */
+  time_t last_modified;     /* when a field was last edited */
+
+  /* the intervals by time, for the project, and with its subprojects;
+   * see gtt_interval_index.h */
+  struct gtt_interval_index_s *ivl_index;
+  struct gtt_interval_index_s *subtree_ivl_index;
+
   int being_destroyed : 1; /* project is being destroyed */
   int frozen : 1;          /* defer recomputes of time totals */
   int dirty_time : 1;      /* the time totals are wrong */
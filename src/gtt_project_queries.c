@@ -26,16 +26,235 @@
 #include "gtt_project.h"
 
 /* =========================================================== */
+/* The index: for each order, a sequence of the unfinished projects */
+
+typedef struct
+{
+  GSequenceIter *iter[GTT_ORDER_COUNT];
+} Entry;
+
+static GHashTable *entries = NULL; /* project -> Entry */
+static GSequence *sorted[GTT_ORDER_COUNT];
+
+static gboolean
+is_finished (GttProject *prj)
+{
+  GttProjectStatus status = gtt_project_get_status (prj);
+  return (GTT_COMPLETED == status) || (GTT_CANCELLED == status);
+}
+
+static int
+status_rank (GttProject *prj)
+{
+  switch (gtt_project_get_status (prj))
+    {
+    case GTT_IN_PROGRESS:
+      return 0;
+    case GTT_NOT_STARTED:
+      return 1;
+    case GTT_ON_HOLD:
+      return 2;
+    default:
+      return 3;
+    }
+}
+
+static int
+due_cmp (GttProject *a, GttProject *b)
+{
+  time_t da = gtt_project_get_due_date (a);
+  time_t db = gtt_project_get_due_date (b);
+
+  /* No due date sorts last */
+  if (0 >= da || 0 >= db)
+    return (0 >= da) - (0 >= db);
+  if (da != db)
+    return (da < db) ? -1 : 1;
+  return 0;
+}
+
+static int
+project_cmp (gconstpointer pa, gconstpointer pb, gpointer data)
+{
+  GttProject *a = (GttProject *)pa, *b = (GttProject *)pb;
+  int rc = 0;
+
+  switch (GPOINTER_TO_INT (data))
+    {
+    case GTT_ORDER_IMPORTANCE:
+      rc = gtt_project_get_importance (b) - gtt_project_get_importance (a);
+      break;
+    case GTT_ORDER_URGENCY:
+      rc = gtt_project_get_urgency (b) - gtt_project_get_urgency (a);
+      break;
+    case GTT_ORDER_STATUS:
+      rc = status_rank (a) - status_rank (b);
+      break;
+    default:
+      break;
+    }
+  if (rc)
+    return rc;
+
+  rc = due_cmp (a, b);
+  if (rc)
+    return rc;
+  rc = gtt_project_get_importance (b) - gtt_project_get_importance (a);
+  if (rc)
+    return rc;
+  rc = gtt_project_get_urgency (b) - gtt_project_get_urgency (a);
+  if (rc)
+    return rc;
+
+  /* Something that doesn't change, for a consistent order */
+  if (a != b)
+    return (a < b) ? -1 : 1;
+  return 0;
+}
+
+void
+gtt_project_index_update (GttProject *prj)
+{
+  Entry *ent;
+  int i;
+
+  if (!prj)
+    return;
+  if (is_finished (prj))
+    {
+      gtt_project_index_remove (prj);
+      return;
+    }
+
+  if (!entries)
+    {
+      entries = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                       g_free);
+      for (i = 0; i < GTT_ORDER_COUNT; i++)
+        sorted[i] = g_sequence_new (NULL);
+    }
+
+  ent = g_hash_table_lookup (entries, prj);
+  if (ent)
+    {
+      for (i = 0; i < GTT_ORDER_COUNT; i++)
+        g_sequence_sort_changed (ent->iter[i], project_cmp,
+                                 GINT_TO_POINTER (i));
+      return;
+    }
+
+  ent = g_new (Entry, 1);
+  for (i = 0; i < GTT_ORDER_COUNT; i++)
+    ent->iter[i] = g_sequence_insert_sorted (sorted[i], prj, project_cmp,
+                                             GINT_TO_POINTER (i));
+  g_hash_table_insert (entries, prj, ent);
+}
+
+void
+gtt_project_index_remove (GttProject *prj)
+{
+  Entry *ent;
+  int i;
+
+  if (!prj || !entries)
+    return;
+  ent = g_hash_table_lookup (entries, prj);
+  if (!ent)
+    return;
+  for (i = 0; i < GTT_ORDER_COUNT; i++)
+    g_sequence_remove (ent->iter[i]);
+  g_hash_table_remove (entries, prj);
+}
+
+/* =========================================================== */
+
+/* Is prj under 'under', or on the list, if 'under' is NULL? */
+static gboolean
+is_under (GttProject *prj, GttProject *under, GHashTable *tops)
+{
+  GttProject *parent;
+
+  if (under)
+    {
+      for (parent = gtt_project_get_parent (prj); parent;
+           parent = gtt_project_get_parent (parent))
+        {
+          if (parent == under)
+            return TRUE;
+        }
+      return FALSE;
+    }
+
+  /* Leave out the projects that have been cut, but not pasted */
+  while ((parent = gtt_project_get_parent (prj)))
+    prj = parent;
+  return (NULL != g_hash_table_lookup (tops, prj));
+}
+
+static GList *
+unfinished_from_index (GList *prjs, GttProject *under, GttProjectOrder order)
+{
+  GHashTable *tops = g_hash_table_new (g_direct_hash, g_direct_equal);
+  GSequenceIter *iter;
+  GList *node, *list = NULL;
+
+  for (node = prjs; node; node = node->next)
+    g_hash_table_insert (tops, node->data, node->data);
+
+  if (entries)
+    {
+      iter = g_sequence_get_begin_iter (sorted[order]);
+      for (; !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
+        {
+          GttProject *prj = g_sequence_get (iter);
+          if (is_under (prj, under, tops))
+            list = g_list_prepend (list, prj);
+        }
+    }
+  g_hash_table_destroy (tops);
+  return g_list_reverse (list);
+}
+
+/* For snapshots, which aren't in the index */
+static void
+collect_unfinished (GList *prjs, GList **list)
+{
+  GList *node;
+
+  for (node = prjs; node; node = node->next)
+    {
+      if (!is_finished (node->data))
+        *list = g_list_prepend (*list, node->data);
+      collect_unfinished (gtt_project_get_children (node->data), list);
+    }
+}
 
 GList *
-gtt_project_get_unfinished (void)
+gtt_project_list_get_unfinished (GttProjectList *plist, GttProject *under,
+                                 GttProjectOrder order)
 {
-  GList *prjlist;
+  GList *list = NULL;
 
-  /* XXX under construction */
-  prjlist = gtt_project_list_get_list (master_list);
+  g_return_val_if_fail (plist, NULL);
+  g_return_val_if_fail (0 <= order && order < GTT_ORDER_COUNT, NULL);
 
-  return prjlist;
+  if (plist == global_plist)
+    return unfinished_from_index (gtt_project_list_get_list (plist), under,
+                                  order);
+
+  if (under)
+    collect_unfinished (gtt_project_get_children (under), &list);
+  else
+    collect_unfinished (gtt_project_list_get_list (plist), &list);
+  return g_list_sort_with_data (list, project_cmp, GINT_TO_POINTER (order));
+}
+
+GList *
+gtt_project_get_unfinished (void)
+{
+  return gtt_project_list_get_unfinished (master_list, NULL,
+                                          GTT_ORDER_DUE_DATE);
 }
 
 /* =========================== END OF FILE ========================= */
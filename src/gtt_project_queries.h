@@ -32,12 +32,45 @@
  * future.)
  */
 
-/* The gtt_project_get_unfinished() routine returns a list
- *    of projects that are not marked as 'completed' or
- *    'cancelled'.  The returned list is a flat list, not
- *    a heirarchical list.
+/* The unfinished projects are those not marked as 'completed' or
+ * 'cancelled'.  They're kept in an index, sorted each of the ways
+ * below, which the project setters keep up to date; so the open work
+ * can be listed without walking, or sorting, the whole project tree.
+ * Only live projects are indexed; snapshots of them are walked.
+ *
+ * The gtt_project_get_unfinished() routine returns a list
+ *    of the unfinished projects on the master list, soonest due first.
+ *    The returned list is a flat list, not a heirarchical list.  The
+ *    caller must g_list_free() it.
+ *
+ * The gtt_project_list_get_unfinished() routine returns a flat list
+ *    of the unfinished projects under 'under' (its subprojects, their
+ *    subprojects, and so on, but not 'under' itself), or of all of
+ *    those on 'plist' if 'under' is NULL, in the given order.  Ties
+ *    are broken by the due date, then the importance, then the
+ *    urgency.  The caller must g_list_free() it.
+ *
+ * The gtt_project_index_update() routine puts the project in the index,
+ *    or moves it, or takes it out if it's finished; the project setters
+ *    call it.  The gtt_project_index_remove() routine takes it out, and
+ *    must be called before the project is freed.
  */
 
+typedef enum
+{
+  GTT_ORDER_DUE_DATE = 0, /* soonest due first; no due date last */
+  GTT_ORDER_IMPORTANCE,   /* most important first */
+  GTT_ORDER_URGENCY,      /* most urgent first */
+  GTT_ORDER_STATUS,       /* in progress, not started, on hold, other */
+  GTT_ORDER_COUNT
+} GttProjectOrder;
+
 GList *gtt_project_get_unfinished (void);
+GList *gtt_project_list_get_unfinished (GttProjectList *plist,
+                                        GttProject *under,
+                                        GttProjectOrder order);
+
+void gtt_project_index_update (GttProject *);
+void gtt_project_index_remove (GttProject *);
 
 #endif // GTT_PROJECT_QUERIES_H
@@ -22,29 +22,73 @@
 
 #include <glib.h>
 #include <limits.h>
+#include <string.h>
 
+#include "gtt_interval_index.h"
 #include "gtt_preferences.h" /* XXX tmp hack for global config_daystart */
 #include "gtt_project.h"
 #include "gtt_project_p.h"
 
 /* ========================================================== */
+/* The day boundaries are computed once, up front, with mktime(), so
+ * that daylight-savings days come out 23 or 25 hours long.  After
+ * that, finding an interval's day is a binary search, and each day it
+ * crosses is just the next boundary over.
+ *
+ * Intervals are collected into per-day arrays, and only turned into
+ * the bucket's GList at the end.  Tasks are kept unique per day with a
+ * generation stamp: the foreach routines visit all of a task's
+ * intervals one after another, so each new task gets a new generation
+ * number, and a day already stamped with it already has the task.
+ */
 
 typedef struct DayArray_s
 {
   int array_len;      /* same as number of days */
   GArray *buckets;    /* holds array of GttBucket */
-  int start_cday;     /* day since 1900 */
   struct tm start_tm; /* start time struct */
+  time_t *bounds;     /* day i runs from bounds[i] to bounds[i+1] */
+  GPtrArray **ivls;   /* intervals for each day, in order found */
+  guint *stamp;       /* generation of the last task added, per day */
+  guint gen;          /* generation of the current task */
+  GttTask *cur_task;  /* the task whose intervals are being binned */
 } DayArray;
 
-static inline int
-yearday_to_centuryday (int yday, int year)
+/* Return the day that the time falls into, or -1 if none */
+static int
+find_day (DayArray *da, time_t when)
 {
-  int cd;
-  cd = 365 * year + (year - 1) / 4 + yday;
-  cd -= (year - 1)
-        / 100; /* year that are multiple of 100 are not leap years */
-  return cd;
+  int lo = 0, hi = da->array_len;
+
+  if ((when < da->bounds[0]) || (when >= da->bounds[da->array_len]))
+    return -1;
+
+  /* bounds[lo] <= when < bounds[hi] */
+  while (hi - lo > 1)
+    {
+      int mid = (lo + hi) / 2;
+      if (when < da->bounds[mid])
+        hi = mid;
+      else
+        lo = mid;
+    }
+  return lo;
+}
+
+static inline void
+day_add (DayArray *da, int arr_day, GttTask *tsk, GttInterval *ivl)
+{
+  GttBucket *bu = &g_array_index (da->buckets, GttBucket, arr_day);
+
+  if (!da->ivls[arr_day])
+    da->ivls[arr_day] = g_ptr_array_new ();
+  g_ptr_array_add (da->ivls[arr_day], ivl);
+
+  if (da->stamp[arr_day] != da->gen)
+    {
+      da->stamp[arr_day] = da->gen;
+      bu->tasks = g_list_prepend (bu->tasks, tsk);
+    }
 }
 
 /* ========================================================== */
@@ -54,65 +98,39 @@ static int
 day_bin (GttInterval *ivl, gpointer data)
 {
   DayArray *da = data;
-  time_t start, start_off, stop, end_of_day;
-  struct tm stm;
-  int century_day, arr_day;
+  time_t start, stop, end_of_day;
+  int arr_day;
   GttTask *tsk;
 
   tsk = gtt_interval_get_parent (ivl);
+  if (tsk != da->cur_task)
+    {
+      da->cur_task = tsk;
+      da->gen++;
+    }
   start = gtt_interval_get_start (ivl);
   stop = gtt_interval_get_stop (ivl);
 
-  /* Get the starting point in array based on day-of-century */
-  start_off = start - config_daystart_offset;
-  localtime_r (&start_off, &stm);
-  century_day = yearday_to_centuryday (stm.tm_yday, stm.tm_year);
-  arr_day = century_day - da->start_cday;
+  /* Check error bounds, should never happen */
+  arr_day = find_day (da, start);
+  if (0 > arr_day)
+    return 1;
 
   /* Loop over days until last day in interval */
-  stm.tm_sec = 0;
-  stm.tm_min = 0;
-  stm.tm_hour = 0;
-
-  while (1)
+  for (; arr_day < da->array_len; arr_day++)
     {
-      /* Check error bounds, should never happen */
-      if ((0 > arr_day) || (arr_day >= da->array_len))
-        {
-          return 1;
-        }
       GttBucket *bu;
       bu = &g_array_index (da->buckets, GttBucket, arr_day);
-
-      stm.tm_mday++;
-      end_of_day = mktime (&stm);
-      /* config_daystart_offset==3*3600 means new day starts at 3AM */
-      end_of_day += config_daystart_offset;
+      end_of_day = da->bounds[arr_day + 1];
 
       if (stop < end_of_day)
         {
           bu->total += stop - start;
-          bu->intervals = g_list_append (bu->intervals, ivl);
-
-          /* Avoid duplicate tasks by checking if same as last */
-          if (!bu->tasks || (bu->tasks->data != tsk))
-            {
-              bu->tasks = g_list_prepend (bu->tasks, tsk);
-            }
+          day_add (da, arr_day, tsk, ivl);
           return 1;
         }
-      else
-        {
-          bu->total += end_of_day - start;
-          bu->intervals = g_list_append (bu->intervals, ivl);
-
-          /* Avoid duplicate tasks by checking if same as last */
-          if (!bu->tasks || (bu->tasks->data != tsk))
-            {
-              bu->tasks = g_list_prepend (bu->tasks, tsk);
-            }
-        }
-      arr_day++;
+      bu->total += end_of_day - start;
+      day_add (da, arr_day, tsk, ivl);
       start = end_of_day;
     }
 
@@ -137,10 +155,10 @@ count_days (DayArray *da, GttProject *proj, gboolean include_subprojects)
 
   da->array_len = num_days + 1;
 
+  /* Day 0 is the day that the earliest start falls in; if the day
+   * starts at 3AM, then 1AM belongs to the day before. */
+  start -= config_daystart_offset;
   localtime_r (&start, &da->start_tm);
-
-  da->start_cday
-      = yearday_to_centuryday (da->start_tm.tm_yday, da->start_tm.tm_year);
 }
 
 static void
@@ -148,6 +166,11 @@ run_daily_bins (DayArray *da, GttProject *proj, gboolean include_subprojects)
 {
   int i;
 
+  da->ivls = g_new0 (GPtrArray *, da->array_len);
+  da->stamp = g_new0 (guint, da->array_len);
+  da->gen = 0;
+  da->cur_task = NULL;
+
   /* apply recursively */
   if (include_subprojects)
     {
@@ -158,31 +181,27 @@ run_daily_bins (DayArray *da, GttProject *proj, gboolean include_subprojects)
       gtt_project_foreach_interval (proj, day_bin, da);
     }
 
-  /* Clean up the taks lists by removing duplicates */
   for (i = 0; i < da->array_len; i++)
     {
       GttBucket *bu;
-      GList *node;
+      GPtrArray *ivls = da->ivls[i];
+      int j;
       bu = &g_array_index (da->buckets, GttBucket, i);
 
       /* Reverse the list, since they went in backwards */
       bu->tasks = g_list_reverse (bu->tasks);
 
-      /* Scrub out duplicate task entries */
-      for (node = bu->tasks; node; node = node->next)
+      if (!ivls)
+        continue;
+      for (j = ivls->len - 1; j >= 0; j--)
         {
-          GList *sode;
-        rerun:
-          for (sode = node->next; sode; sode = sode->next)
-            {
-              if (sode->data == node->data)
-                {
-                  sode = g_list_delete_link (node, sode);
-                  goto rerun;
-                }
-            }
+          bu->intervals = g_list_prepend (bu->intervals,
+                                          g_ptr_array_index (ivls, j));
         }
+      g_ptr_array_free (ivls, TRUE);
     }
+  g_free (da->ivls);
+  g_free (da->stamp);
 }
 
 /* ========================================================== */
@@ -191,7 +210,6 @@ run_daily_bins (DayArray *da, GttProject *proj, gboolean include_subprojects)
 static void
 init_bins (DayArray *da)
 {
-  time_t start_of_day, end_of_day;
   struct tm stm;
   int i;
 
@@ -201,22 +219,24 @@ init_bins (DayArray *da)
   stm.tm_sec = 0;
   stm.tm_min = 0;
   stm.tm_hour = 0;
+  stm.tm_isdst = -1;
+
+  for (i = 0; i <= da->array_len; i++)
+    {
+      struct tm dtm = stm;
+
+      dtm.tm_mday += i;
+      /* config_daystart_offset==3*3600 means new day starts at 3AM */
+      da->bounds[i] = mktime (&dtm) + config_daystart_offset;
+    }
 
-  end_of_day = mktime (&stm);
-  /* config_daystart_offset==3*3600 means new day starts at 3AM */
-  end_of_day += config_daystart_offset;
   for (i = 0; i < da->array_len; i++)
     {
       GttBucket *bu;
       bu = &g_array_index (da->buckets, GttBucket, i);
 
-      start_of_day = end_of_day;
-      stm.tm_mday++;
-      end_of_day = mktime (&stm);
-      end_of_day += config_daystart_offset;
-
-      bu->start = start_of_day;
-      bu->end = end_of_day;
+      bu->start = da->bounds[i];
+      bu->end = da->bounds[i + 1];
       bu->total = 0;
       bu->tasks = NULL;
       bu->intervals = NULL;
@@ -244,12 +264,355 @@ gtt_project_get_daily_buckets (GttProject *proj, gboolean include_subprojects)
   g_array_set_size (arr, da.array_len);
 
   da.buckets = arr;
+  da.bounds = g_new (time_t, da.array_len + 1);
   init_bins (&da);
   run_daily_bins (&da, proj, include_subprojects);
+  g_free (da.bounds);
 
   return arr;
 }
 
+void
+gtt_bucket_array_free (GArray *arr)
+{
+  guint i;
+
+  if (!arr)
+    return;
+  for (i = 0; i < arr->len; i++)
+    {
+      GttBucket *bu = &g_array_index (arr, GttBucket, i);
+      g_list_free (bu->tasks);
+      g_list_free (bu->intervals);
+    }
+  g_array_free (arr, TRUE);
+}
+
+/* ========================================================== */
+/* Aggregates.  The calendar periods get the same treatment as the
+ * days above: boundaries up front, binary search, split at the
+ * edges.  The other groupings map straight to an array index. */
+
+typedef struct AggState_s
+{
+  GttGroupBy group;
+  time_t start, end; /* the range asked for */
+  GArray *aggs;      /* holds array of GttAggregate */
+  time_t *bounds;    /* period i runs from bounds[i] to bounds[i+1] */
+  GHashTable *index; /* custid -> index + 1 */
+  GArray *stamp;     /* per group: generation of the last task seen */
+  guint gen;         /* generation of the current task */
+  GttTask *cur_task; /* the task whose intervals are being binned */
+} AggState;
+
+/* The first day of the period that 'when' falls in, at midnight */
+static void
+period_tm (GttGroupBy group, time_t when, struct tm *tm)
+{
+  when -= config_daystart_offset;
+  localtime_r (&when, tm);
+  tm->tm_sec = 0;
+  tm->tm_min = 0;
+  tm->tm_hour = 0;
+  tm->tm_isdst = -1;
+
+  switch (group)
+    {
+    case GTT_GROUP_WEEK:
+      /* config_weekstart_offset == 1 means the week starts on monday */
+      tm->tm_mday -= (tm->tm_wday - config_weekstart_offset + 7) % 7;
+      break;
+    case GTT_GROUP_MONTH:
+      tm->tm_mday = 1;
+      break;
+    case GTT_GROUP_YEAR:
+      tm->tm_mday = 1;
+      tm->tm_mon = 0;
+      break;
+    default:
+      break;
+    }
+}
+
+/* The start of the n'th period after the one in 'base' */
+static time_t
+period_bound (GttGroupBy group, const struct tm *base, int n)
+{
+  struct tm tm = *base;
+
+  switch (group)
+    {
+    case GTT_GROUP_WEEK:
+      tm.tm_mday += 7 * n;
+      break;
+    case GTT_GROUP_MONTH:
+      tm.tm_mon += n;
+      break;
+    case GTT_GROUP_YEAR:
+      tm.tm_year += n;
+      break;
+    default:
+      break;
+    }
+  return mktime (&tm) + config_daystart_offset;
+}
+
+static void
+agg_init_periods (AggState *st)
+{
+  struct tm base;
+  GArray *bounds;
+  time_t bound;
+  int n;
+
+  period_tm (st->group, st->start, &base);
+  bounds = g_array_new (FALSE, FALSE, sizeof (time_t));
+  bound = period_bound (st->group, &base, 0);
+  for (n = 1; 1; n++)
+    {
+      GttAggregate ag = { 0 };
+
+      g_array_append_val (bounds, bound);
+      if (bound >= st->end)
+        break;
+      ag.start = bound;
+      bound = period_bound (st->group, &base, n);
+      ag.end = bound;
+      ag.key = -1;
+      g_array_append_val (st->aggs, ag);
+    }
+  st->bounds = (time_t *)g_array_free (bounds, FALSE);
+}
+
+static int
+agg_find_period (AggState *st, time_t when)
+{
+  int lo = 0, hi = st->aggs->len;
+
+  if ((when < st->bounds[0]) || (when >= st->bounds[st->aggs->len]))
+    return -1;
+
+  /* bounds[lo] <= when < bounds[hi] */
+  while (hi - lo > 1)
+    {
+      int mid = (lo + hi) / 2;
+      if (when < st->bounds[mid])
+        hi = mid;
+      else
+        lo = mid;
+    }
+  return lo;
+}
+
+/* Return the index of the group for the key, adding it if need be */
+static int
+agg_find_key (AggState *st, GttTask *tsk)
+{
+  GttAggregate ag = { 0 };
+  GttProject *prj;
+  const char *custid;
+  int idx;
+
+  switch (st->group)
+    {
+    case GTT_GROUP_TOTAL:
+      return 0;
+    case GTT_GROUP_BILLSTATUS:
+      return gtt_task_get_billstatus (tsk);
+    case GTT_GROUP_BILLRATE:
+      return gtt_task_get_billrate (tsk);
+    case GTT_GROUP_CUSTID:
+      break;
+    default:
+      return -1;
+    }
+
+  prj = gtt_task_get_parent (tsk);
+  custid = gtt_project_get_custid (prj);
+  idx = GPOINTER_TO_INT (
+      g_hash_table_lookup (st->index, custid ? custid : ""));
+  if (idx)
+    return idx - 1;
+
+  ag.custid = custid;
+  ag.key = -1;
+  g_array_append_val (st->aggs, ag);
+  g_hash_table_insert (st->index, (gpointer)(custid ? custid : ""),
+                       GINT_TO_POINTER (st->aggs->len));
+  return st->aggs->len - 1;
+}
+
+static void
+agg_add (AggState *st, int idx, GttTask *tsk, time_t start, time_t stop)
+{
+  GttAggregate *ag = &g_array_index (st->aggs, GttAggregate, idx);
+  GttProject *prj;
+  time_t secs = stop - start;
+  guint *stamp;
+
+  ag->total += secs;
+  /* The calendar periods have their own start and end */
+  if (!st->bounds)
+    {
+      if ((0 == ag->start) || (start < ag->start))
+        ag->start = start;
+      if (stop > ag->end)
+        ag->end = stop;
+    }
+
+  if (GTT_BILLABLE != gtt_task_get_billable (tsk))
+    return;
+  ag->billable += secs;
+
+  prj = gtt_task_get_parent (tsk);
+  switch (gtt_task_get_billrate (tsk))
+    {
+    case GTT_REGULAR:
+      ag->value += secs * gtt_project_get_billrate (prj) / 3600.0;
+      break;
+    case GTT_OVERTIME:
+      ag->value += secs * gtt_project_get_overtime_rate (prj) / 3600.0;
+      break;
+    case GTT_OVEROVER:
+      ag->value += secs * gtt_project_get_overover_rate (prj) / 3600.0;
+      break;
+    case GTT_FLAT_FEE:
+      /* Once per task per group; a task's intervals all come
+       * together, so the generation stamp tells us. */
+      if (st->stamp->len < st->aggs->len)
+        g_array_set_size (st->stamp, st->aggs->len);
+      stamp = &g_array_index (st->stamp, guint, idx);
+      if (*stamp != st->gen)
+        {
+          *stamp = st->gen;
+          ag->value += gtt_project_get_flat_fee (prj);
+        }
+      break;
+    }
+}
+
+static int
+agg_bin (GttInterval *ivl, gpointer data)
+{
+  AggState *st = data;
+  time_t start, stop;
+  GttTask *tsk;
+  int idx;
+
+  tsk = gtt_interval_get_parent (ivl);
+  if (tsk != st->cur_task)
+    {
+      st->cur_task = tsk;
+      st->gen++;
+    }
+
+  start = MAX (gtt_interval_get_start (ivl), st->start);
+  stop = MIN (gtt_interval_get_stop (ivl), st->end);
+  if (stop <= start)
+    return 1;
+
+  if (st->bounds)
+    {
+      idx = agg_find_period (st, start);
+      if (0 > idx)
+        return 1;
+      for (; (idx < (int)st->aggs->len) && (start < stop); idx++)
+        {
+          time_t end_of_period = MIN (st->bounds[idx + 1], stop);
+          agg_add (st, idx, tsk, start, end_of_period);
+          start = end_of_period;
+        }
+      return 1;
+    }
+
+  idx = agg_find_key (st, tsk);
+  if (0 > idx)
+    return 1;
+  if (idx >= (int)st->aggs->len)
+    g_array_set_size (st->aggs, idx + 1);
+  agg_add (st, idx, tsk, start, stop);
+  return 1;
+}
+
+GArray *
+gtt_projects_aggregate (GList *prjs, gboolean include_subprojects,
+                        GttGroupBy group, time_t start, time_t end)
+{
+  AggState st;
+  GList *node;
+  int i;
+
+  memset (&st, 0, sizeof (st));
+  st.group = group;
+  st.start = start;
+  st.end = end;
+  st.aggs = g_array_new (FALSE, TRUE, sizeof (GttAggregate));
+  st.stamp = g_array_new (FALSE, TRUE, sizeof (guint));
+
+  /* Open-ended ranges run to the first or last activity */
+  if ((0 >= st.start) || (0 >= st.end))
+    {
+      time_t earliest = INT_MAX, latest = 0;
+      for (node = prjs; node; node = node->next)
+        {
+          earliest = MIN (earliest, gtt_project_get_earliest_start (
+                                        node->data, include_subprojects));
+          latest = MAX (latest, gtt_project_get_latest_stop (
+                                    node->data, include_subprojects));
+        }
+      if (0 >= st.start)
+        st.start = earliest;
+      if (0 >= st.end)
+        st.end = latest;
+    }
+  if (st.end <= st.start)
+    {
+      g_array_free (st.stamp, TRUE);
+      return st.aggs;
+    }
+
+  switch (group)
+    {
+    case GTT_GROUP_WEEK:
+    case GTT_GROUP_MONTH:
+    case GTT_GROUP_YEAR:
+      agg_init_periods (&st);
+      break;
+    case GTT_GROUP_CUSTID:
+      st.index = g_hash_table_new (g_str_hash, g_str_equal);
+      break;
+    default:
+      break;
+    }
+
+  for (node = prjs; node; node = node->next)
+    {
+      if (include_subprojects)
+        gtt_project_foreach_subproject_interval (node->data, agg_bin, &st);
+      else
+        gtt_project_foreach_interval (node->data, agg_bin, &st);
+    }
+
+  /* Fill in the keys, and drop the enum values that weren't seen */
+  if ((GTT_GROUP_BILLSTATUS == group) || (GTT_GROUP_BILLRATE == group)
+      || (GTT_GROUP_TOTAL == group))
+    {
+      for (i = st.aggs->len - 1; i >= 0; i--)
+        {
+          GttAggregate *ag = &g_array_index (st.aggs, GttAggregate, i);
+          ag->key = (GTT_GROUP_TOTAL == group) ? -1 : i;
+          if (0 == ag->total)
+            g_array_remove_index (st.aggs, i);
+        }
+    }
+
+  g_free (st.bounds);
+  if (st.index)
+    g_hash_table_destroy (st.index);
+  g_array_free (st.stamp, TRUE);
+  return st.aggs;
+}
+
 /* ========================================================== */
 
 int
@@ -303,63 +666,35 @@ gtt_project_foreach_subproject_interval (GttProject *proj, GttIntervalCB cb,
 
 /* ========================================================== */
 
-static int
-cmp_earliest (GttInterval *ivl, gpointer data)
-{
-  time_t *earliest = data;
-  time_t s = gtt_interval_get_start (ivl);
-  if (s < *earliest)
-    *earliest = s;
-  return 1;
-}
-
-static int
-cmp_latest (GttInterval *ivl, gpointer data)
-{
-  time_t *latest = data;
-  time_t s = gtt_interval_get_stop (ivl);
-  if (s > *latest)
-    *latest = s;
-  return 1;
-}
+/* The interval index keeps these at hand */
 
 time_t
 gtt_project_get_earliest_start (GttProject *proj, gboolean include_subprojects)
 {
+  GttIntervalIndex *idx;
   time_t earliest;
 
-  earliest = INT_MAX;
   if (!proj)
-    return earliest;
+    return INT_MAX;
 
-  if (include_subprojects)
-    {
-      gtt_project_foreach_subproject_interval (proj, cmp_earliest, &earliest);
-    }
-  else
-    {
-      gtt_project_foreach_interval (proj, cmp_earliest, &earliest);
-    }
+  idx = gtt_interval_index_get (proj, include_subprojects);
+  earliest = gtt_interval_index_earliest_start (idx);
+  gtt_interval_index_unref (idx);
   return earliest;
 }
 
 time_t
 gtt_project_get_latest_stop (GttProject *proj, gboolean include_subprojects)
 {
+  GttIntervalIndex *idx;
   time_t latest;
 
-  latest = 0;
   if (!proj)
-    return latest;
+    return 0;
 
-  if (include_subprojects)
-    {
-      gtt_project_foreach_subproject_interval (proj, cmp_latest, &latest);
-    }
-  else
-    {
-      gtt_project_foreach_interval (proj, cmp_latest, &latest);
-    }
+  idx = gtt_interval_index_get (proj, include_subprojects);
+  latest = gtt_interval_index_latest_stop (idx);
+  gtt_interval_index_unref (idx);
   return latest;
 }
 
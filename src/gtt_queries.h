@@ -73,15 +73,79 @@ struct GttBucket_s
  *    corresponds to the earliest day for which there
  *    is data for this project.  The length of the array
  *    is sufficient to hold data for all non-zero days.
- *    The array should be freed when it is no longer needed.
+ *    Days begin config_daystart_offset seconds after midnight,
+ *    local time, and so are 23 or 25 hours long when daylight
+ *    savings time changes.  The tasks in a bucket are listed once
+ *    each, in the order in which they were first found, and the
+ *    intervals in the order found; an interval that spans several
+ *    days is listed in each of them.
  *    Use the gtt_project_get_earliest_start() routine to
  *    find out what day 0 correpinds to in calendar time.
  *    If 'include_subprojects' is TRUE, then subprojects are
  *    included in the day totals.
+ *
+ * The gtt_bucket_array_free() routine frees an array returned by
+ *    gtt_project_get_daily_buckets(), along with the task and
+ *    interval lists in its buckets.
  */
 
 GArray *gtt_project_get_daily_buckets (GttProject *proj,
                                        gboolean include_subprojects);
+void gtt_bucket_array_free (GArray *);
+
+/* The gtt_projects_aggregate() routine totals up the time spent on
+ *    the list of projects 'prjs' between 'start' and 'end', grouped
+ *    as asked, in one pass over the intervals.  Intervals that stick
+ *    out of the range, or across the edge of a week, month or year,
+ *    are cut at the edge.  If 'start' or 'end' is zero or less, the
+ *    range starts at the earliest activity, or ends at the latest.
+ *    If 'include_subprojects' is TRUE, the time spent on subprojects
+ *    is counted too.
+ *
+ *    It returns a GArray of GttAggregate, which the caller must free
+ *    with g_array_free().  For GTT_GROUP_WEEK, _MONTH and _YEAR,
+ *    there is one record for each period that overlaps the range, in
+ *    date order, including those with no time in them.  Weeks start
+ *    on the day set by config_weekstart_offset, and all periods start
+ *    config_daystart_offset seconds after midnight.  For the other
+ *    groupings, there is one record for each distinct value that has
+ *    time against it: ordered by the enum for GTT_GROUP_BILLSTATUS
+ *    and GTT_GROUP_BILLRATE, and in the order found for
+ *    GTT_GROUP_CUSTID.  GTT_GROUP_TOTAL makes just one record.
+ *
+ *    In each record, 'total' is the number of seconds, and 'billable'
+ *    is the part of that spent on billable (GTT_BILLABLE) tasks.  The
+ *    'value' is what the billable time is worth, at the project's
+ *    rates; a flat-fee task adds the project's flat fee once to each
+ *    period (or group) that it has time in.
+ */
+
+typedef enum
+{
+  GTT_GROUP_TOTAL = 0,
+  GTT_GROUP_WEEK,
+  GTT_GROUP_MONTH,
+  GTT_GROUP_YEAR,
+  GTT_GROUP_CUSTID,
+  GTT_GROUP_BILLSTATUS,
+  GTT_GROUP_BILLRATE
+} GttGroupBy;
+
+typedef struct GttAggregate_s GttAggregate;
+
+struct GttAggregate_s
+{
+  time_t start;       /* Start of the period, or of the first activity */
+  time_t end;         /* End of the period, or of the last activity */
+  const char *custid; /* GTT_GROUP_CUSTID: the project's own, or NULL */
+  int key;            /* GTT_GROUP_BILLSTATUS, _BILLRATE: the value */
+  time_t total;       /* Seconds spent */
+  time_t billable;    /* Seconds spent on billable tasks */
+  double value;       /* What the billable time is worth */
+};
+
+GArray *gtt_projects_aggregate (GList *prjs, gboolean include_subprojects,
+                                GttGroupBy group, time_t start, time_t end);
 
 time_t gtt_project_get_earliest_start (GttProject *proj,
                                        gboolean include_subprojects);
@@ -0,0 +1,1336 @@
+/*   Compiled queries over the project data, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_query.h"
+
+#include <glib.h>
+#include <qof.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "gtt_queries.h"
+#include "gtt_text_index.h"
+
+/* How a query is run: the WHERE clause is parsed into a tree, and its
+ * top-level AND is split up into conditions, each filed under the
+ * deepest level (project, task or interval) that it looks at.  Each
+ * level's conditions are checked in order of cost, so that text
+ * matching, and working out when a project was active, are only done
+ * for what is left after the cheaper tests.
+ *
+ * Text searches (MATCH) are looked up in the text index, once per
+ * run, when the query is run on the live projects.  If one of them
+ * must hold for anything to match, the query starts from what the
+ * index found, rather than from the top of the project tree. */
+
+typedef enum
+{
+  LEVEL_PROJECT = 0,
+  LEVEL_TASK,
+  LEVEL_INTERVAL,
+  NUM_LEVELS,
+  LEVEL_SELF /* whatever is being selected */
+} Level;
+
+typedef enum
+{
+  FIELD_TITLE,
+  FIELD_DESC,
+  FIELD_CUSTID,
+  FIELD_STATUS,
+  FIELD_URGENCY,
+  FIELD_IMPORTANCE,
+  FIELD_DUE,
+  FIELD_PROJECT_NOTES,
+  FIELD_MEMO,
+  FIELD_NOTES,
+  FIELD_TEXT,
+  FIELD_BILLSTATUS,
+  FIELD_BILLABLE,
+  FIELD_BILLRATE,
+  FIELD_START,
+  FIELD_STOP
+} FieldId;
+
+typedef enum
+{
+  TYPE_TEXT,
+  TYPE_ENUM,
+  TYPE_TIME
+} FieldType;
+
+typedef struct
+{
+  const char *name;
+  int value;
+} EnumName;
+
+typedef struct
+{
+  const char *name;
+  FieldId id;
+  FieldType type;
+  Level level;
+  const EnumName *enums;
+  guint search; /* the GttTextFields that MATCH searches, or 0 */
+} FieldDef;
+
+static const EnumName status_names[]
+    = { { "NO_STATUS", GTT_NO_STATUS },     { "NOT_STARTED", GTT_NOT_STARTED },
+        { "IN_PROGRESS", GTT_IN_PROGRESS }, { "ON_HOLD", GTT_ON_HOLD },
+        { "CANCELLED", GTT_CANCELLED },     { "COMPLETED", GTT_COMPLETED },
+        { NULL, 0 } };
+
+static const EnumName rank_names[]
+    = { { "UNDEFINED", GTT_UNDEFINED }, { "LOW", GTT_LOW },
+        { "MEDIUM", GTT_MEDIUM },       { "HIGH", GTT_HIGH },
+        { NULL, 0 } };
+
+static const EnumName billstatus_names[] = { { "HOLD", GTT_HOLD },
+                                             { "BILL", GTT_BILL },
+                                             { "PAID", GTT_PAID },
+                                             { NULL, 0 } };
+
+static const EnumName billable_names[]
+    = { { "BILLABLE", GTT_BILLABLE },
+        { "NOT_BILLABLE", GTT_NOT_BILLABLE },
+        { "NO_CHARGE", GTT_NO_CHARGE },
+        { NULL, 0 } };
+
+static const EnumName billrate_names[]
+    = { { "REGULAR", GTT_REGULAR },   { "OVERTIME", GTT_OVERTIME },
+        { "OVEROVER", GTT_OVEROVER }, { "FLAT_FEE", GTT_FLAT_FEE },
+        { NULL, 0 } };
+
+static const FieldDef fields[] = {
+  { "title", FIELD_TITLE, TYPE_TEXT, LEVEL_PROJECT, NULL, 0 },
+  { "desc", FIELD_DESC, TYPE_TEXT, LEVEL_PROJECT, NULL, 0 },
+  { "custid", FIELD_CUSTID, TYPE_TEXT, LEVEL_PROJECT, NULL, 0 },
+  { "project_notes", FIELD_PROJECT_NOTES, TYPE_TEXT, LEVEL_PROJECT, NULL,
+    GTT_TEXT_PROJECT_NOTES },
+  { "status", FIELD_STATUS, TYPE_ENUM, LEVEL_PROJECT, status_names, 0 },
+  { "urgency", FIELD_URGENCY, TYPE_ENUM, LEVEL_PROJECT, rank_names, 0 },
+  { "importance", FIELD_IMPORTANCE, TYPE_ENUM, LEVEL_PROJECT, rank_names,
+    0 },
+  { "due", FIELD_DUE, TYPE_TIME, LEVEL_PROJECT, NULL, 0 },
+  { "memo", FIELD_MEMO, TYPE_TEXT, LEVEL_TASK, NULL, GTT_TEXT_MEMO },
+  { "notes", FIELD_NOTES, TYPE_TEXT, LEVEL_TASK, NULL, GTT_TEXT_NOTES },
+  { "text", FIELD_TEXT, TYPE_TEXT, LEVEL_TASK, NULL,
+    GTT_TEXT_MEMO | GTT_TEXT_NOTES },
+  { "billstatus", FIELD_BILLSTATUS, TYPE_ENUM, LEVEL_TASK, billstatus_names,
+    0 },
+  { "billable", FIELD_BILLABLE, TYPE_ENUM, LEVEL_TASK, billable_names, 0 },
+  { "billrate", FIELD_BILLRATE, TYPE_ENUM, LEVEL_TASK, billrate_names, 0 },
+  { "start", FIELD_START, TYPE_TIME, LEVEL_SELF, NULL, 0 },
+  { "stop", FIELD_STOP, TYPE_TIME, LEVEL_SELF, NULL, 0 },
+  { GTT_PROJECT_EARLIEST, FIELD_START, TYPE_TIME, LEVEL_SELF, NULL, 0 },
+  { GTT_PROJECT_LATEST, FIELD_STOP, TYPE_TIME, LEVEL_SELF, NULL, 0 },
+  { NULL }
+};
+
+typedef enum
+{
+  OP_EQ,
+  OP_NE,
+  OP_LT,
+  OP_LE,
+  OP_GT,
+  OP_GE,
+  OP_LIKE,
+  OP_MATCH
+} CompareOp;
+
+typedef struct
+{
+  gboolean ok;  /* FALSE if missing; the condition counts as true */
+  char *str;    /* text; case-folded, for LIKE */
+  gint64 num;   /* enums and times */
+  GttTextSearch *search; /* for MATCH */
+} Value;
+
+typedef enum
+{
+  NODE_AND,
+  NODE_OR,
+  NODE_NOT,
+  NODE_COND
+} NodeType;
+
+typedef struct node_s Node;
+
+struct node_s
+{
+  NodeType type;
+  Level level; /* the deepest level that it looks at */
+  int cost;    /* rough cost of checking it */
+  Node *left;  /* AND, OR and NOT */
+  Node *right; /* AND and OR */
+
+  /* The rest is for NODE_COND */
+  const FieldDef *field;
+  CompareOp op;
+  Value val;     /* the value compared to ... */
+  int slot;      /* ... unless this is >= 0; then it's a form value */
+  char *kvp_key; /* ... found under this name */
+  int match;     /* for MATCH, the index into the query's matches */
+};
+
+struct gtt_query_s
+{
+  gint refcount;
+  char *text;
+  GttQueryTarget target;
+  Node *where;                /* the whole tree, or NULL */
+  GPtrArray *conds[NUM_LEVELS]; /* top-level conditions, cheapest first */
+  GPtrArray *slots;             /* conditions with form values */
+  GPtrArray *matches;           /* the MATCH conditions */
+  Node *driver; /* a top-level MATCH, to start from; or NULL */
+};
+
+static GMutex compiled_mutex;
+static GHashTable *compiled = NULL;
+
+/* ============================================================== */
+/* Values */
+
+static gboolean
+parse_time (const char *str, gint64 *when)
+{
+  struct tm tm;
+  int year, month, day, hour = 0, min = 0, sec = 0;
+  int n;
+  char *end;
+  gint64 secs;
+
+  /* Seconds since the epoch */
+  secs = g_ascii_strtoll (str, &end, 10);
+  if (end != str && 0 == *end)
+    {
+      *when = secs;
+      return TRUE;
+    }
+
+  n = sscanf (str, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &min,
+              &sec);
+  if (3 > n || 4 == n)
+    {
+      hour = min = sec = 0;
+      if (!qof_scan_date (str, &day, &month, &year))
+        return FALSE;
+    }
+
+  memset (&tm, 0, sizeof (tm));
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month - 1;
+  tm.tm_mday = day;
+  tm.tm_hour = hour;
+  tm.tm_min = min;
+  tm.tm_sec = sec;
+  tm.tm_isdst = -1;
+  *when = mktime (&tm);
+  return TRUE;
+}
+
+/* Work out the value to compare 'field' to, from the text given */
+static char *
+value_set (Value *val, const FieldDef *field, CompareOp op, const char *str)
+{
+  const EnumName *en;
+  char *end;
+
+  val->ok = TRUE;
+  switch (field->type)
+    {
+    case TYPE_TEXT:
+      if (OP_MATCH == op)
+        {
+          val->search = gtt_text_search_new (str);
+          if (val->search)
+            return NULL;
+          break;
+        }
+      if (OP_LIKE == op)
+        val->str = g_utf8_casefold (str, -1);
+      else
+        val->str = g_strdup (str);
+      return NULL;
+
+    case TYPE_ENUM:
+      for (en = field->enums; en->name; en++)
+        {
+          if (0 == g_ascii_strcasecmp (en->name, str))
+            {
+              val->num = en->value;
+              return NULL;
+            }
+        }
+      val->num = g_ascii_strtoll (str, &end, 10);
+      if (end != str && 0 == *end)
+        return NULL;
+      break;
+
+    case TYPE_TIME:
+      if (parse_time (str, &val->num))
+        return NULL;
+      break;
+    }
+
+  val->ok = FALSE;
+  return g_strdup_printf ("'%s' is not a valid value for %s", str,
+                          field->name);
+}
+
+static void
+value_clear (Value *val)
+{
+  g_free (val->str);
+  gtt_text_search_free (val->search);
+}
+
+static gboolean
+like_match (const char *str, const char *pat)
+{
+  while (*pat)
+    {
+      if ('%' == *pat)
+        {
+          pat++;
+          if (0 == *pat)
+            return TRUE;
+          for (; *str; str = g_utf8_next_char (str))
+            {
+              if (like_match (str, pat))
+                return TRUE;
+            }
+          return like_match (str, pat);
+        }
+      if (0 == *str)
+        return FALSE;
+      if ('_' == *pat)
+        {
+          str = g_utf8_next_char (str);
+          pat++;
+          continue;
+        }
+      if (*str != *pat)
+        return FALSE;
+      str++;
+      pat++;
+    }
+  return (0 == *str);
+}
+
+static gboolean
+compare_ok (CompareOp op, int cmp)
+{
+  switch (op)
+    {
+    case OP_EQ:
+      return (0 == cmp);
+    case OP_NE:
+      return (0 != cmp);
+    case OP_LT:
+      return (0 > cmp);
+    case OP_LE:
+      return (0 >= cmp);
+    case OP_GT:
+      return (0 < cmp);
+    case OP_GE:
+      return (0 <= cmp);
+    case OP_LIKE:
+    case OP_MATCH:
+      break;
+    }
+  return FALSE;
+}
+
+/* ============================================================== */
+/* The tree */
+
+static Node *
+node_new (NodeType type, Node *left, Node *right)
+{
+  Node *n = g_new0 (Node, 1);
+
+  n->type = type;
+  n->left = left;
+  n->right = right;
+  n->slot = -1;
+  n->level = left->level;
+  n->cost = left->cost;
+  if (right)
+    {
+      n->level = MAX (n->level, right->level);
+      n->cost += right->cost;
+    }
+  return n;
+}
+
+static void
+node_free (Node *n)
+{
+  if (!n)
+    return;
+  node_free (n->left);
+  node_free (n->right);
+  value_clear (&n->val);
+  g_free (n->kvp_key);
+  g_free (n);
+}
+
+/* ============================================================== */
+/* The parser */
+
+typedef enum
+{
+  TOK_END,
+  TOK_WORD,
+  TOK_STRING,
+  TOK_NUMBER,
+  TOK_PUNCT
+} TokenType;
+
+typedef struct
+{
+  const char *pos; /* the rest of the text */
+  TokenType type;  /* the current token */
+  char *token;
+  char *err;
+  GttQuery *q;
+} Parser;
+
+static void
+parse_error (Parser *ps, const char *msg)
+{
+  if (ps->err)
+    return;
+  if (TOK_END == ps->type)
+    ps->err = g_strdup_printf ("%s at the end of the query", msg);
+  else
+    ps->err = g_strdup_printf ("%s at '%s'", msg, ps->token);
+}
+
+static void
+next_token (Parser *ps)
+{
+  const char *p = ps->pos;
+  const char *start;
+
+  g_free (ps->token);
+  ps->token = NULL;
+
+  while (g_ascii_isspace (*p))
+    p++;
+  start = p;
+
+  if (0 == *p)
+    {
+      ps->type = TOK_END;
+    }
+  else if (g_ascii_isalpha (*p) || '_' == *p)
+    {
+      while (g_ascii_isalnum (*p) || '_' == *p)
+        p++;
+      ps->type = TOK_WORD;
+      ps->token = g_strndup (start, p - start);
+    }
+  else if (g_ascii_isdigit (*p) || ('-' == *p && g_ascii_isdigit (p[1])))
+    {
+      p++;
+      while (g_ascii_isdigit (*p))
+        p++;
+      ps->type = TOK_NUMBER;
+      ps->token = g_strndup (start, p - start);
+    }
+  else if ('\'' == *p)
+    {
+      GString *str = g_string_new (NULL);
+
+      for (p++; *p; p++)
+        {
+          if ('\'' == *p)
+            {
+              if ('\'' != p[1])
+                break;
+              p++;
+            }
+          g_string_append_c (str, *p);
+        }
+      ps->type = TOK_STRING;
+      ps->token = g_string_free (str, FALSE);
+      if (0 == *p)
+        parse_error (ps, "Unterminated quote");
+      else
+        p++;
+    }
+  else
+    {
+      if (('<' == p[0] && ('=' == p[1] || '>' == p[1]))
+          || (('>' == p[0] || '!' == p[0]) && '=' == p[1]))
+        p++;
+      p++;
+      ps->type = TOK_PUNCT;
+      ps->token = g_strndup (start, p - start);
+    }
+  ps->pos = p;
+}
+
+static gboolean
+is_word (Parser *ps, const char *word)
+{
+  return (TOK_WORD == ps->type && 0 == g_ascii_strcasecmp (ps->token, word));
+}
+
+static gboolean
+is_punct (Parser *ps, const char *punct)
+{
+  return (TOK_PUNCT == ps->type && 0 == strcmp (ps->token, punct));
+}
+
+static gboolean
+expect_word (Parser *ps, const char *word)
+{
+  if (!is_word (ps, word))
+    {
+      char *msg = g_strdup_printf ("Expected %s", word);
+      parse_error (ps, msg);
+      g_free (msg);
+      return FALSE;
+    }
+  next_token (ps);
+  return TRUE;
+}
+
+static const FieldDef *
+lookup_field (const char *name)
+{
+  const FieldDef *field;
+
+  for (field = fields; field->name; field++)
+    {
+      if (0 == g_ascii_strcasecmp (field->name, name))
+        return field;
+    }
+  return NULL;
+}
+
+static Node *parse_or (Parser *ps);
+
+static Node *
+parse_cond (Parser *ps)
+{
+  static const char *ops[] = { "=", "!=", "<", "<=", ">", ">=", NULL };
+  static const CompareOp op_ids[]
+      = { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE };
+  const FieldDef *field;
+  Level level;
+  Node *n;
+  int i;
+
+  if (TOK_WORD != ps->type || !(field = lookup_field (ps->token)))
+    {
+      parse_error (ps, "Expected a field name");
+      return NULL;
+    }
+  level = (LEVEL_SELF == field->level) ? (Level)ps->q->target : field->level;
+  if ((int)level > (int)ps->q->target)
+    {
+      ps->err = g_strdup_printf ("%s is a task field; it can't be used "
+                                 "to select projects",
+                                 field->name);
+      return NULL;
+    }
+  next_token (ps);
+
+  n = g_new0 (Node, 1);
+  n->type = NODE_COND;
+  n->field = field;
+  n->level = level;
+  n->slot = -1;
+
+  if (is_punct (ps, "<>"))
+    {
+      g_free (ps->token);
+      ps->token = g_strdup ("!=");
+    }
+  for (i = 0; ops[i]; i++)
+    {
+      if (is_punct (ps, ops[i]))
+        break;
+    }
+  if (ops[i])
+    n->op = op_ids[i];
+  else if (is_word (ps, "LIKE") && TYPE_TEXT == field->type)
+    n->op = OP_LIKE;
+  else if (is_word (ps, "MATCH") && field->search)
+    n->op = OP_MATCH;
+  else
+    {
+      parse_error (ps, "Expected a comparison");
+      node_free (n);
+      return NULL;
+    }
+  next_token (ps);
+
+  /* The value; enum names needn't be quoted */
+  if (TOK_STRING != ps->type && TOK_NUMBER != ps->type
+      && !(TOK_WORD == ps->type && TYPE_ENUM == field->type))
+    {
+      parse_error (ps, "Expected a value");
+      node_free (n);
+      return NULL;
+    }
+  if (TOK_STRING == ps->type && g_str_has_prefix (ps->token, "kvp://"))
+    {
+      n->kvp_key = g_strdup (ps->token + strlen ("kvp://"));
+      n->slot = ps->q->slots->len;
+      g_ptr_array_add (ps->q->slots, n);
+    }
+  else
+    {
+      char *err = value_set (&n->val, field, n->op, ps->token);
+      if (err)
+        {
+          parse_error (ps, err);
+          g_free (err);
+          node_free (n);
+          return NULL;
+        }
+    }
+  next_token (ps);
+
+  if (FIELD_TEXT == field->id && OP_MATCH != n->op)
+    {
+      ps->err = g_strdup ("The text field can only be used with MATCH");
+      node_free (n);
+      return NULL;
+    }
+  if (OP_MATCH == n->op)
+    {
+      n->match = ps->q->matches->len;
+      g_ptr_array_add (ps->q->matches, n);
+    }
+
+  /* Text is dearer to compare than numbers; and the start and stop
+   * of a task or project mean walking its intervals. */
+  n->cost = 1;
+  if (OP_MATCH == n->op)
+    n->cost = 3;
+  else if (TYPE_TEXT == field->type)
+    n->cost = (OP_LIKE == n->op) ? 4 : 2;
+  else if (LEVEL_SELF == field->level && LEVEL_INTERVAL != level)
+    n->cost = 8;
+  return n;
+}
+
+static Node *
+parse_not (Parser *ps)
+{
+  Node *n;
+
+  if (is_word (ps, "NOT"))
+    {
+      next_token (ps);
+      n = parse_not (ps);
+      return n ? node_new (NODE_NOT, n, NULL) : NULL;
+    }
+  if (is_punct (ps, "("))
+    {
+      next_token (ps);
+      n = parse_or (ps);
+      if (n && !is_punct (ps, ")"))
+        {
+          parse_error (ps, "Expected )");
+          node_free (n);
+          return NULL;
+        }
+      next_token (ps);
+      return n;
+    }
+  return parse_cond (ps);
+}
+
+static Node *
+parse_and (Parser *ps)
+{
+  Node *n, *right;
+
+  n = parse_not (ps);
+  while (n && is_word (ps, "AND"))
+    {
+      next_token (ps);
+      right = parse_not (ps);
+      if (!right)
+        {
+          node_free (n);
+          return NULL;
+        }
+      n = node_new (NODE_AND, n, right);
+    }
+  return n;
+}
+
+static Node *
+parse_or (Parser *ps)
+{
+  Node *n, *right;
+
+  n = parse_and (ps);
+  while (n && is_word (ps, "OR"))
+    {
+      next_token (ps);
+      right = parse_and (ps);
+      if (!right)
+        {
+          node_free (n);
+          return NULL;
+        }
+      n = node_new (NODE_OR, n, right);
+    }
+  return n;
+}
+
+static gboolean
+parse_table (Parser *ps)
+{
+  static const struct
+  {
+    const char *name;
+    GttQueryTarget target;
+  } tables[] = { { "projects", GTT_QUERY_PROJECTS },
+                 { GTT_PROJECT_ID, GTT_QUERY_PROJECTS },
+                 { "tasks", GTT_QUERY_TASKS },
+                 { GTT_TASK_ID, GTT_QUERY_TASKS },
+                 { "intervals", GTT_QUERY_INTERVALS },
+                 { "GttIntervalId", GTT_QUERY_INTERVALS },
+                 { NULL } };
+  int i;
+
+  for (i = 0; tables[i].name; i++)
+    {
+      if (is_word (ps, tables[i].name))
+        {
+          ps->q->target = tables[i].target;
+          next_token (ps);
+          return TRUE;
+        }
+    }
+  parse_error (ps, "Expected projects, tasks or intervals");
+  return FALSE;
+}
+
+/* ============================================================== */
+/* The planner */
+
+static void
+add_conds (GttQuery *q, Node *n)
+{
+  if (NODE_AND == n->type)
+    {
+      add_conds (q, n->left);
+      add_conds (q, n->right);
+      return;
+    }
+  g_ptr_array_add (q->conds[n->level], n);
+}
+
+static gint
+cond_cmp (gconstpointer a, gconstpointer b)
+{
+  const Node *na = *(const Node **)a;
+  const Node *nb = *(const Node **)b;
+
+  return na->cost - nb->cost;
+}
+
+/* A top-level MATCH that everything found must pass; the lower the
+ * level, the fewer things it's likely to let through. */
+static Node *
+find_driver (GttQuery *q)
+{
+  int level;
+  guint i;
+
+  for (level = LEVEL_TASK; level >= LEVEL_PROJECT; level--)
+    {
+      for (i = 0; i < q->conds[level]->len; i++)
+        {
+          Node *n = g_ptr_array_index (q->conds[level], i);
+          if (NODE_COND == n->type && OP_MATCH == n->op)
+            return n;
+        }
+    }
+  return NULL;
+}
+
+static GttQuery *
+query_new (const char *text)
+{
+  GttQuery *q = g_new0 (GttQuery, 1);
+  int i;
+
+  q->refcount = 1;
+  q->text = g_strdup (text);
+  for (i = 0; i < NUM_LEVELS; i++)
+    q->conds[i] = g_ptr_array_new ();
+  q->slots = g_ptr_array_new ();
+  q->matches = g_ptr_array_new ();
+  return q;
+}
+
+static GttQuery *
+query_parse (const char *text, char **errmsg)
+{
+  Parser ps;
+  int i;
+
+  memset (&ps, 0, sizeof (ps));
+  ps.pos = text;
+  ps.q = query_new (text);
+  next_token (&ps);
+
+  if (expect_word (&ps, "SELECT"))
+    {
+      if (!is_punct (&ps, "*"))
+        parse_error (&ps, "Expected *");
+      next_token (&ps);
+    }
+  if (!ps.err && expect_word (&ps, "FROM") && parse_table (&ps)
+      && is_word (&ps, "WHERE"))
+    {
+      next_token (&ps);
+      ps.q->where = parse_or (&ps);
+    }
+  if (!ps.err && is_punct (&ps, ";"))
+    next_token (&ps);
+  if (!ps.err && TOK_END != ps.type)
+    parse_error (&ps, "Expected the end of the query");
+  g_free (ps.token);
+
+  if (ps.err)
+    {
+      if (errmsg)
+        *errmsg = ps.err;
+      else
+        g_free (ps.err);
+      gtt_query_unref (ps.q);
+      return NULL;
+    }
+
+  if (ps.q->where)
+    add_conds (ps.q, ps.q->where);
+  for (i = 0; i < NUM_LEVELS; i++)
+    g_ptr_array_sort (ps.q->conds[i], cond_cmp);
+  ps.q->driver = find_driver (ps.q);
+  return ps.q;
+}
+
+/* ============================================================== */
+
+GttQuery *
+gtt_query_compile (const char *text, char **errmsg)
+{
+  GttQuery *q, *old;
+
+  if (!text)
+    return NULL;
+
+  g_mutex_lock (&compiled_mutex);
+  if (!compiled)
+    {
+      compiled = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                        (GDestroyNotify)gtt_query_unref);
+    }
+  q = g_hash_table_lookup (compiled, text);
+  if (q)
+    gtt_query_ref (q);
+  g_mutex_unlock (&compiled_mutex);
+  if (q)
+    return q;
+
+  q = query_parse (text, errmsg);
+  if (!q)
+    return NULL;
+
+  /* Someone else may have compiled it meanwhile */
+  g_mutex_lock (&compiled_mutex);
+  old = g_hash_table_lookup (compiled, text);
+  if (old)
+    {
+      gtt_query_unref (q);
+      q = gtt_query_ref (old);
+    }
+  else
+    {
+      g_hash_table_insert (compiled, q->text, gtt_query_ref (q));
+    }
+  g_mutex_unlock (&compiled_mutex);
+  return q;
+}
+
+GttQuery *
+gtt_query_ref (GttQuery *q)
+{
+  if (q)
+    g_atomic_int_inc (&q->refcount);
+  return q;
+}
+
+void
+gtt_query_unref (GttQuery *q)
+{
+  int i;
+
+  if (!q || !g_atomic_int_dec_and_test (&q->refcount))
+    return;
+
+  node_free (q->where);
+  for (i = 0; i < NUM_LEVELS; i++)
+    g_ptr_array_free (q->conds[i], TRUE);
+  g_ptr_array_free (q->slots, TRUE);
+  g_ptr_array_free (q->matches, TRUE);
+  g_free (q->text);
+  g_free (q);
+}
+
+GttQueryTarget
+gtt_query_get_target (GttQuery *q)
+{
+  g_return_val_if_fail (q, GTT_QUERY_PROJECTS);
+  return q->target;
+}
+
+/* ============================================================== */
+/* Running queries */
+
+typedef struct
+{
+  GttQuery *q;
+  Value *bound; /* the form values, by slot */
+  GList *result;
+
+  /* What the text index found for each MATCH, or NULL if it wasn't
+   * asked; then the text is searched directly. */
+  GList **found;
+  GHashTable **found_set;
+
+  GttProject *prj;
+  GttTask *tsk;
+  GttInterval *ivl;
+
+  /* The start and stop of the task or project being looked at */
+  gpointer span_of;
+  time_t span_start;
+  time_t span_stop;
+} RunState;
+
+static void
+find_span (RunState *rs)
+{
+  GList *node;
+
+  if (GTT_QUERY_PROJECTS == rs->q->target)
+    {
+      if (rs->span_of == rs->prj)
+        return;
+      rs->span_of = rs->prj;
+      rs->span_start = gtt_project_get_earliest_start (rs->prj, TRUE);
+      rs->span_stop = gtt_project_get_latest_stop (rs->prj, TRUE);
+      return;
+    }
+
+  if (rs->span_of == rs->tsk)
+    return;
+  rs->span_of = rs->tsk;
+  rs->span_start = 0;
+  rs->span_stop = 0;
+  for (node = gtt_task_get_intervals (rs->tsk); node; node = node->next)
+    {
+      time_t start = gtt_interval_get_start (node->data);
+      time_t stop = gtt_interval_get_stop (node->data);
+
+      if (0 == rs->span_start || start < rs->span_start)
+        rs->span_start = start;
+      if (stop > rs->span_stop)
+        rs->span_stop = stop;
+    }
+}
+
+static const char *
+get_text (RunState *rs, FieldId id)
+{
+  switch (id)
+    {
+    case FIELD_TITLE:
+      return gtt_project_get_title (rs->prj);
+    case FIELD_DESC:
+      return gtt_project_get_desc (rs->prj);
+    case FIELD_CUSTID:
+      return gtt_project_get_custid (rs->prj);
+    case FIELD_PROJECT_NOTES:
+      return gtt_project_get_notes (rs->prj);
+    case FIELD_MEMO:
+      return gtt_task_get_memo (rs->tsk);
+    case FIELD_NOTES:
+      return gtt_task_get_notes (rs->tsk);
+    default:
+      break;
+    }
+  return NULL;
+}
+
+static gint64
+get_num (RunState *rs, FieldId id)
+{
+  switch (id)
+    {
+    case FIELD_STATUS:
+      return gtt_project_get_status (rs->prj);
+    case FIELD_URGENCY:
+      return gtt_project_get_urgency (rs->prj);
+    case FIELD_IMPORTANCE:
+      return gtt_project_get_importance (rs->prj);
+    case FIELD_DUE:
+      return gtt_project_get_due_date (rs->prj);
+    case FIELD_BILLSTATUS:
+      return gtt_task_get_billstatus (rs->tsk);
+    case FIELD_BILLABLE:
+      return gtt_task_get_billable (rs->tsk);
+    case FIELD_BILLRATE:
+      return gtt_task_get_billrate (rs->tsk);
+    case FIELD_START:
+      if (GTT_QUERY_INTERVALS == rs->q->target)
+        return gtt_interval_get_start (rs->ivl);
+      find_span (rs);
+      return rs->span_start;
+    case FIELD_STOP:
+      if (GTT_QUERY_INTERVALS == rs->q->target)
+        return gtt_interval_get_stop (rs->ivl);
+      find_span (rs);
+      return rs->span_stop;
+    default:
+      break;
+    }
+  return 0;
+}
+
+static const Value *
+cond_value (RunState *rs, Node *n)
+{
+  return (0 <= n->slot) ? &rs->bound[n->slot] : &n->val;
+}
+
+static gboolean
+eval_match (RunState *rs, Node *n, const Value *val)
+{
+  GHashTable *set = rs->found_set[n->match];
+
+  if (set)
+    {
+      gpointer obj = (LEVEL_PROJECT == n->field->level) ? (gpointer)rs->prj
+                                                        : (gpointer)rs->tsk;
+      return (NULL != g_hash_table_lookup (set, obj));
+    }
+
+  if (FIELD_TEXT == n->field->id)
+    {
+      return gtt_text_search_match (val->search, gtt_task_get_memo (rs->tsk))
+             || gtt_text_search_match (val->search,
+                                       gtt_task_get_notes (rs->tsk));
+    }
+  return gtt_text_search_match (val->search, get_text (rs, n->field->id));
+}
+
+/* A condition whose form value is missing or blank is unknown.  It
+ * drops out of the AND, OR or NOT around it, which goes by the rest;
+ * and a whole condition that is unknown doesn't restrict anything.
+ * So 'NOT field = x', with x left blank, doesn't exclude everything. */
+typedef enum
+{
+  EVAL_FALSE = FALSE,
+  EVAL_TRUE = TRUE,
+  EVAL_UNKNOWN
+} EvalResult;
+
+static gboolean
+eval_compare (RunState *rs, Node *n, const Value *val)
+{
+  const char *str;
+  gint64 num;
+
+  if (OP_MATCH == n->op)
+    return eval_match (rs, n, val);
+
+  if (TYPE_TEXT == n->field->type)
+    {
+      str = get_text (rs, n->field->id);
+      if (!str)
+        str = "";
+      if (OP_LIKE == n->op)
+        {
+          char *folded = g_utf8_casefold (str, -1);
+          gboolean match = like_match (folded, val->str);
+          g_free (folded);
+          return match;
+        }
+      return compare_ok (n->op, strcmp (str, val->str));
+    }
+
+  num = get_num (rs, n->field->id);
+  return compare_ok (n->op, (num > val->num) - (num < val->num));
+}
+
+static EvalResult
+eval_cond (RunState *rs, Node *n)
+{
+  const Value *val = cond_value (rs, n);
+
+  if (!val->ok)
+    return EVAL_UNKNOWN;
+  return eval_compare (rs, n, val) ? EVAL_TRUE : EVAL_FALSE;
+}
+
+static EvalResult
+eval_node (RunState *rs, Node *n)
+{
+  EvalResult left, right;
+
+  switch (n->type)
+    {
+    case NODE_AND:
+      left = eval_node (rs, n->left);
+      if (EVAL_FALSE == left)
+        return EVAL_FALSE;
+      right = eval_node (rs, n->right);
+      return (EVAL_UNKNOWN == right) ? left : right;
+    case NODE_OR:
+      left = eval_node (rs, n->left);
+      if (EVAL_TRUE == left)
+        return EVAL_TRUE;
+      right = eval_node (rs, n->right);
+      return (EVAL_UNKNOWN == right) ? left : right;
+    case NODE_NOT:
+      left = eval_node (rs, n->left);
+      if (EVAL_UNKNOWN == left)
+        return EVAL_UNKNOWN;
+      return (EVAL_TRUE == left) ? EVAL_FALSE : EVAL_TRUE;
+    case NODE_COND:
+      return eval_cond (rs, n);
+    }
+  return EVAL_FALSE;
+}
+
+static gboolean
+eval_level (RunState *rs, Level level)
+{
+  GPtrArray *conds = rs->q->conds[level];
+  guint i;
+
+  for (i = 0; i < conds->len; i++)
+    {
+      if (EVAL_FALSE == eval_node (rs, g_ptr_array_index (conds, i)))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+static void
+run_task (RunState *rs)
+{
+  GList *node;
+
+  if (!eval_level (rs, LEVEL_TASK))
+    return;
+  if (GTT_QUERY_TASKS == rs->q->target)
+    {
+      rs->result = g_list_prepend (rs->result, rs->tsk);
+      return;
+    }
+
+  for (node = gtt_task_get_intervals (rs->tsk); node; node = node->next)
+    {
+      rs->ivl = node->data;
+      if (eval_level (rs, LEVEL_INTERVAL))
+        rs->result = g_list_prepend (rs->result, rs->ivl);
+    }
+  rs->ivl = NULL;
+}
+
+/* Check the project, and then its tasks and their intervals */
+static void
+run_project (RunState *rs)
+{
+  GList *node;
+
+  rs->tsk = NULL;
+  if (!eval_level (rs, LEVEL_PROJECT))
+    return;
+  if (GTT_QUERY_PROJECTS == rs->q->target)
+    {
+      rs->result = g_list_prepend (rs->result, rs->prj);
+      return;
+    }
+  for (node = gtt_project_get_tasks (rs->prj); node; node = node->next)
+    {
+      rs->tsk = node->data;
+      run_task (rs);
+    }
+}
+
+static void
+run_projects (RunState *rs, GList *prjs)
+{
+  GList *node;
+
+  for (node = prjs; node; node = node->next)
+    {
+      rs->prj = node->data;
+      run_project (rs);
+      run_projects (rs, gtt_project_get_children (node->data));
+    }
+}
+
+/* The index also knows about projects that aren't on the list, such
+ * as the ones that have been cut, but not yet pasted. */
+static gboolean
+on_list (GHashTable *tops, GttProject *prj)
+{
+  GttProject *parent;
+
+  if (!prj)
+    return FALSE;
+  while ((parent = gtt_project_get_parent (prj)))
+    prj = parent;
+  return (NULL != g_hash_table_lookup (tops, prj));
+}
+
+/* Start from what the text index found for the driver */
+static void
+run_found (RunState *rs, GList *prjs, GList *found)
+{
+  GHashTable *tops = g_hash_table_new (g_direct_hash, g_direct_equal);
+  GList *node;
+
+  for (node = prjs; node; node = node->next)
+    g_hash_table_insert (tops, node->data, node->data);
+
+  for (node = found; node; node = node->next)
+    {
+      if (LEVEL_PROJECT == rs->q->driver->field->level)
+        {
+          rs->prj = node->data;
+          if (on_list (tops, rs->prj))
+            run_project (rs);
+          continue;
+        }
+      rs->tsk = node->data;
+      rs->prj = gtt_task_get_parent (rs->tsk);
+      if (on_list (tops, rs->prj) && eval_level (rs, LEVEL_PROJECT))
+        run_task (rs);
+    }
+  g_hash_table_destroy (tops);
+}
+
+/* Work out the form values */
+static void
+bind_values (RunState *rs, KvpFrame *kvp)
+{
+  GttQuery *q = rs->q;
+  guint i;
+
+  for (i = 0; i < q->slots->len; i++)
+    {
+      Node *n = g_ptr_array_index (q->slots, i);
+      const char *str = kvp ? kvp_frame_get_string (kvp, n->kvp_key) : NULL;
+      char *err;
+
+      if (!str || 0 == str[0])
+        continue;
+      err = value_set (&rs->bound[i], n->field, n->op, str);
+      if (err)
+        {
+          g_warning ("%s", err);
+          g_free (err);
+        }
+    }
+}
+
+/* Look up the text searches in the index */
+static void
+find_matches (RunState *rs)
+{
+  GttQuery *q = rs->q;
+  guint i;
+
+  for (i = 0; i < q->matches->len; i++)
+    {
+      Node *n = g_ptr_array_index (q->matches, i);
+      const Value *val = cond_value (rs, n);
+      GList *node;
+
+      if (!val->ok)
+        continue;
+      rs->found[i] = gtt_text_index_find (val->search, n->field->search);
+      rs->found_set[i] = g_hash_table_new (g_direct_hash, g_direct_equal);
+      for (node = rs->found[i]; node; node = node->next)
+        g_hash_table_insert (rs->found_set[i], node->data, node->data);
+    }
+}
+
+GList *
+gtt_query_run (GttQuery *q, GList *prjs, KvpFrame *kvp)
+{
+  RunState rs;
+  guint i;
+
+  g_return_val_if_fail (q, NULL);
+
+  memset (&rs, 0, sizeof (rs));
+  rs.q = q;
+  rs.bound = g_new0 (Value, q->slots->len);
+  rs.found = g_new0 (GList *, q->matches->len);
+  rs.found_set = g_new0 (GHashTable *, q->matches->len);
+  bind_values (&rs, kvp);
+
+  /* Only the live projects are in the index */
+  if (prjs == gtt_project_list_get_list (global_plist))
+    find_matches (&rs);
+
+  if (q->driver && rs.found_set[q->driver->match])
+    run_found (&rs, prjs, rs.found[q->driver->match]);
+  else
+    run_projects (&rs, prjs);
+
+  for (i = 0; i < q->slots->len; i++)
+    value_clear (&rs.bound[i]);
+  for (i = 0; i < q->matches->len; i++)
+    {
+      g_list_free (rs.found[i]);
+      if (rs.found_set[i])
+        g_hash_table_destroy (rs.found_set[i]);
+    }
+  g_free (rs.bound);
+  g_free (rs.found);
+  g_free (rs.found_set);
+  return g_list_reverse (rs.result);
+}
+
+/* ======================= END OF FILE =================== */
@@ -0,0 +1,122 @@
+/*   Compiled queries over the project data, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_QUERY_H
+#define GTT_QUERY_H
+
+#include <glib.h>
+#include <qof.h>
+
+#include "gtt_project.h"
+
+/* A query picks out projects, tasks or intervals by their properties.
+ * Queries are written in a small subset of SQL:
+ *
+ *   SELECT * FROM tasks WHERE (custid = 'acme') AND (billstatus = 'BILL')
+ *          AND (memo LIKE '%meeting%') AND NOT (stop < '2026-01-01');
+ *
+ * The table is one of 'projects', 'tasks' or 'intervals' (or
+ * GttProjectId, GttTaskId or GttIntervalId).  Conditions compare a
+ * field to a value with =, != (or <>), <, <=, >, >= or LIKE, and are
+ * combined with AND, OR, NOT and parentheses.  The fields are:
+ *
+ *   title, desc, custid            the project's, as text
+ *   status                         NO_STATUS, NOT_STARTED, IN_PROGRESS,
+ *                                  ON_HOLD, CANCELLED or COMPLETED
+ *   urgency, importance            UNDEFINED, LOW, MEDIUM or HIGH
+ *   due                            the project's due date
+ *   memo, notes                    the task's, as text
+ *   project_notes                  the project's notes, as text
+ *   text                           the task's memo or its notes; only
+ *                                  for MATCH
+ *   billstatus                     HOLD, BILL or PAID
+ *   billable                       BILLABLE, NOT_BILLABLE or NO_CHARGE
+ *   billrate                       REGULAR, OVERTIME, OVEROVER or FLAT_FEE
+ *   start, stop                    when the interval started and stopped;
+ *                                  for a task, its first start and last
+ *                                  stop; for a project, the same, but
+ *                                  counting its subprojects too
+ *
+ * GttProjectEarliest and GttProjectLatest are other names for start
+ * and stop.  Task fields may only be used when selecting tasks or
+ * intervals, since a project has many tasks.  Field and table names,
+ * keywords and enum names are not case sensitive.  LIKE compares text
+ * without regard to case, with % matching any run of characters and _
+ * any one character; the other comparisons are by strcmp() for text,
+ * and by rank for the enums.
+ *
+ * The text fields may also be searched for words, as in
+ *
+ *   SELECT * FROM tasks WHERE text MATCH 'invoice review*';
+ *
+ * The search syntax is that of gtt_text_search_new(): all of the
+ * words must be in the same field, 'word*' matches any word starting
+ * with 'word', and '"two words"' must be found together.  Searches
+ * of the live project list use the text index (see gtt_text_index.h),
+ * and so don't have to read every task.
+ *
+ * Values are quoted with single quotes; a quote inside is doubled.
+ * Dates are written 'YYYY-MM-DD', optionally followed by 'HH:MM' or
+ * 'HH:MM:SS', in local time; as a number of seconds since the epoch;
+ * or in the user's date format.  A value of the form 'kvp://name' is
+ * looked up under 'name' in the form inputs each time the query is
+ * run.  A condition whose value is missing or empty is unknown, so
+ * that a form can leave fields blank: it drops out of the AND, OR or
+ * NOT around it, which goes by the rest, and if nothing is left, it
+ * doesn't restrict anything.  So NOT of a blank condition is still
+ * unknown, not false.
+ *
+ * The gtt_query_compile() routine parses the query text.  It returns
+ *    a new reference to the query, or NULL and an error message (to be
+ *    g_free()'d) if the text doesn't parse.  Queries are kept once
+ *    compiled, so compiling the same text again is cheap.
+ *
+ * The gtt_query_get_target() routine returns what the query selects.
+ *
+ * The gtt_query_run() routine returns the list of the matching
+ *    projects, tasks or intervals, as the target says, from under the
+ *    top-level projects 'prjs', in the order they're stored in (except
+ *    that when the text index is used to find them, the order isn't
+ *    defined).  The caller must g_list_free() it.  The 'kvp' holds the
+ *    form inputs, and may be NULL.  Conditions on a project are checked before
+ *    any of its tasks are looked at, and conditions on a task before
+ *    its intervals are, so a query that narrows things down by project
+ *    doesn't have to look at much else.
+ *
+ * A compiled query is never changed, so it may be run on any number
+ * of threads at once; of course, the projects it's run on mustn't be
+ * changed meanwhile.
+ */
+
+typedef enum
+{
+  GTT_QUERY_PROJECTS = 0,
+  GTT_QUERY_TASKS,
+  GTT_QUERY_INTERVALS
+} GttQueryTarget;
+
+typedef struct gtt_query_s GttQuery;
+
+GttQuery *gtt_query_compile (const char *text, char **errmsg);
+GttQuery *gtt_query_ref (GttQuery *);
+void gtt_query_unref (GttQuery *);
+
+GttQueryTarget gtt_query_get_target (GttQuery *);
+GList *gtt_query_run (GttQuery *, GList *prjs, KvpFrame *kvp);
+
+#endif // GTT_QUERY_H
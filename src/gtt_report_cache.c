@@ -0,0 +1,154 @@
+/*   Cache of rendered reports, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_report_cache.h"
+
+#include <glib.h>
+#include <time.h>
+
+/* Only a handful of reports are ever open at once */
+#define MAX_ENTRIES 32
+
+typedef struct
+{
+  char *key;
+  GBytes *text;
+  GttReportDeps deps;
+  guint64 last_used;
+} CacheEntry;
+
+static GMutex cache_mutex;
+static GHashTable *cache = NULL;
+static guint64 use_count = 0;
+
+/* ============================================================== */
+
+static void
+cache_entry_free (CacheEntry *ent)
+{
+  g_free (ent->key);
+  g_bytes_unref (ent->text);
+  g_free (ent);
+}
+
+static gboolean
+cache_entry_valid (CacheEntry *ent, GttProject *prj)
+{
+  if (time (0) >= ent->deps.expires)
+    return FALSE;
+  if (ent->deps.wide || !prj)
+    return (ent->deps.list_generation == gtt_project_list_get_generation ());
+  return (ent->deps.subtree_generation
+          == gtt_project_get_subtree_generation (prj));
+}
+
+/* Drop the entry that went longest without being used */
+static void
+cache_evict (void)
+{
+  GHashTableIter iter;
+  CacheEntry *ent, *oldest = NULL;
+
+  g_hash_table_iter_init (&iter, cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&ent))
+    {
+      if (!oldest || ent->last_used < oldest->last_used)
+        oldest = ent;
+    }
+  if (oldest)
+    g_hash_table_remove (cache, oldest->key);
+}
+
+/* ============================================================== */
+
+void
+gtt_report_deps_init (GttReportDeps *deps, GttProject *prj)
+{
+  if (!deps)
+    return;
+  deps->wide = (NULL == prj);
+  deps->subtree_generation = gtt_project_get_subtree_generation (prj);
+  deps->list_generation = gtt_project_list_get_generation ();
+  deps->expires = gtt_next_day_start (time (0));
+}
+
+GBytes *
+gtt_report_cache_lookup (const char *key, GttProject *prj)
+{
+  CacheEntry *ent;
+  GBytes *text = NULL;
+
+  if (!key)
+    return NULL;
+
+  g_mutex_lock (&cache_mutex);
+  ent = cache ? g_hash_table_lookup (cache, key) : NULL;
+  if (ent && !cache_entry_valid (ent, prj))
+    {
+      g_hash_table_remove (cache, key);
+      ent = NULL;
+    }
+  if (ent)
+    {
+      ent->last_used = ++use_count;
+      text = g_bytes_ref (ent->text);
+    }
+  g_mutex_unlock (&cache_mutex);
+  return text;
+}
+
+void
+gtt_report_cache_store (const char *key, const GttReportDeps *deps,
+                        GBytes *text)
+{
+  CacheEntry *ent;
+
+  if (!key || !deps || !text)
+    return;
+
+  ent = g_new0 (CacheEntry, 1);
+  ent->key = g_strdup (key);
+  ent->text = g_bytes_ref (text);
+  ent->deps = *deps;
+
+  g_mutex_lock (&cache_mutex);
+  if (!cache)
+    {
+      cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                     (GDestroyNotify)cache_entry_free);
+    }
+  g_hash_table_remove (cache, key);
+  if (MAX_ENTRIES <= g_hash_table_size (cache))
+    cache_evict ();
+  ent->last_used = ++use_count;
+  g_hash_table_insert (cache, ent->key, ent);
+  g_mutex_unlock (&cache_mutex);
+}
+
+void
+gtt_report_cache_clear (void)
+{
+  g_mutex_lock (&cache_mutex);
+  if (cache)
+    g_hash_table_remove_all (cache);
+  g_mutex_unlock (&cache_mutex);
+}
+
+/* ======================= END OF FILE =================== */
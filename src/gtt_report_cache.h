@@ -0,0 +1,82 @@
+/*   Cache of rendered reports, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_REPORT_CACHE_H
+#define GTT_REPORT_CACHE_H
+
+#include <glib.h>
+#include <time.h>
+
+#include "gtt_project.h"
+
+/* The report cache holds the output of recently rendered reports, so
+ * that showing a report again, when nothing it shows has changed,
+ * doesn't mean running all of its scheme code again.  Entries are
+ * looked up by a key string, which the caller builds out of
+ * everything other than the project data that the output depends on
+ * (the template, the linked project, the form inputs, and so on; see
+ * gtt_ghtml_display()).
+ *
+ * What an entry depends on in the project data is recorded in a
+ * GttReportDeps.  A report that only looked at its linked project
+ * (and so, at its tasks, intervals and subprojects) stays good for as
+ * long as that project's subtree generation stays the same; a 'wide'
+ * one, that looked at other projects too, only for as long as nothing
+ * at all changes (see gtt_project_get_subtree_generation()).  Every
+ * entry also goes bad at 'expires', since reports show things like
+ * "today" and "this week".
+ *
+ * The gtt_report_deps_init() routine fills in the deps for a report
+ *    about to be rendered for 'prj' (which may be NULL): the current
+ *    generations, and an expiry at the start of the next day.  It
+ *    must be called before the render starts, not after, so that
+ *    edits made during it count.
+ *
+ * The gtt_report_cache_lookup() routine returns a new reference to
+ *    the cached output for 'key', or NULL if there is none, or if it
+ *    is out of date.  The 'prj' is the linked project; the same one
+ *    that the deps were set up with.
+ *
+ * The gtt_report_cache_store() routine saves a copy of the output
+ *    for 'key', replacing any that was there.  The least recently used
+ *    entries are dropped to make room.
+ *
+ * The gtt_report_cache_clear() routine throws away everything; it is
+ *    called when the preferences change.
+ *
+ * These may be called from any thread.
+ */
+
+typedef struct gtt_report_deps_s GttReportDeps;
+
+struct gtt_report_deps_s
+{
+  gboolean wide;            /* looked at projects outside the subtree */
+  guint subtree_generation; /* of the linked project */
+  guint list_generation;    /* of the whole project list */
+  time_t expires;           /* good until then, at the latest */
+};
+
+void gtt_report_deps_init (GttReportDeps *, GttProject *prj);
+
+GBytes *gtt_report_cache_lookup (const char *key, GttProject *prj);
+void gtt_report_cache_store (const char *key, const GttReportDeps *,
+                             GBytes *text);
+void gtt_report_cache_clear (void);
+
+#endif // GTT_REPORT_CACHE_H
@@ -0,0 +1,236 @@
+/*   Render reports on worker threads, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_report_pool.h"
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <libguile.h>
+#include <stdio.h>
+
+#include "gtt_ghtml.h"
+
+typedef struct
+{
+  char *path;      /* full path to the template */
+  GttProject *prj; /* the snapshot's copy, or NULL */
+  char *output;    /* output file name */
+  GttProjectList *snapshot;
+} ReportJob;
+
+struct gtt_report_pool_s
+{
+  GThreadPool *threads;
+  GttProjectList *snapshot;
+  GHashTable *map; /* live project -> snapshot copy */
+
+  /* The rest is shared with the threads, under the mutex */
+  GMutex mutex;
+  int failures;
+  gboolean closed;
+};
+
+/* ============================================================== */
+/* These run on the worker threads */
+
+typedef struct
+{
+  FILE *fh;
+  gboolean failed;
+} ReportOutput;
+
+static void
+report_write (GttGhtml *ghtml, const char *str, size_t len, gpointer data)
+{
+  ReportOutput *out = data;
+
+  if (len != fwrite (str, 1, len, out->fh))
+    out->failed = TRUE;
+}
+
+static void
+report_error (GttGhtml *ghtml, int err, const char *msg, gpointer data)
+{
+  ReportOutput *out = data;
+
+  fprintf (stderr, _ ("Report template not found: %s\n"),
+           msg ? msg : "(null)");
+  out->failed = TRUE;
+}
+
+/* Called in guile mode; returns non-NULL on success */
+static void *
+report_render (void *data)
+{
+  ReportJob *job = data;
+  GttGhtml *ghtml;
+  ReportOutput out;
+
+  out.failed = FALSE;
+  out.fh = fopen (job->output, "w");
+  if (!out.fh)
+    {
+      perror (job->output);
+      return NULL;
+    }
+
+  ghtml = gtt_ghtml_new ();
+  gtt_ghtml_show_links (ghtml, FALSE);
+  gtt_ghtml_set_project_list (ghtml, job->snapshot);
+  gtt_ghtml_set_stream (ghtml, &out, NULL, report_write, NULL, report_error);
+  gtt_ghtml_display (ghtml, job->path, job->prj);
+  gtt_ghtml_destroy (ghtml);
+
+  if (fclose (out.fh))
+    out.failed = TRUE;
+  if (out.failed)
+    {
+      fprintf (stderr, _ ("Failed to write %s\n"), job->output);
+      return NULL;
+    }
+  return job;
+}
+
+static void
+report_job_free (ReportJob *job)
+{
+  g_free (job->path);
+  g_free (job->output);
+  g_free (job);
+}
+
+static void
+pool_thread_func (gpointer data, gpointer user_data)
+{
+  GttReportPool *pool = user_data;
+  ReportJob *job = data;
+  gboolean ok;
+
+  /* The thread stays known to guile between jobs, so entering
+   * guile mode again is cheap. */
+  ok = (NULL != scm_with_guile (report_render, job));
+  report_job_free (job);
+
+  g_mutex_lock (&pool->mutex);
+  if (!ok)
+    pool->failures++;
+  g_mutex_unlock (&pool->mutex);
+}
+
+/* ============================================================== */
+
+GttReportPool *
+gtt_report_pool_new (GttProjectList *plist, int nthreads)
+{
+  GttReportPool *pool;
+  GError *error = NULL;
+
+  g_return_val_if_fail (plist, NULL);
+
+  /* Get guile, and the scheme procs, set up before any thread
+   * needs them. */
+  gtt_ghtml_destroy (gtt_ghtml_new ());
+
+  pool = g_new0 (GttReportPool, 1);
+  pool->map = g_hash_table_new (g_direct_hash, g_direct_equal);
+  pool->snapshot = gtt_project_list_snapshot (plist, pool->map);
+  g_mutex_init (&pool->mutex);
+
+  pool->threads = g_thread_pool_new (pool_thread_func, pool,
+                                     MAX (nthreads, 1), FALSE, &error);
+  if (!pool->threads)
+    {
+      g_warning ("Couldn't start report threads: %s", error->message);
+      g_error_free (error);
+    }
+  return pool;
+}
+
+void
+gtt_report_pool_add (GttReportPool *pool, const char *path, GttProject *prj,
+                     const char *output)
+{
+  ReportJob *job;
+  GttProject *copy = NULL;
+
+  g_return_if_fail (pool && path && output);
+  g_return_if_fail (!pool->closed);
+  if (prj)
+    {
+      copy = g_hash_table_lookup (pool->map, prj);
+      g_return_if_fail (copy);
+    }
+
+  job = g_new0 (ReportJob, 1);
+  job->path = g_strdup (path);
+  job->prj = copy;
+  job->output = g_strdup (output);
+  job->snapshot = pool->snapshot;
+
+  /* Without threads, just do it here */
+  if (!pool->threads)
+    {
+      pool_thread_func (job, pool);
+      return;
+    }
+  g_thread_pool_push (pool->threads, job, NULL);
+}
+
+/* Wait for the threads to finish their jobs.  The caller may well be
+ * in guile mode; it mustn't hold up garbage collection while it waits
+ * for the threads, which will be allocating. */
+static void *
+pool_join (void *data)
+{
+  GttReportPool *pool = data;
+
+  if (pool->threads)
+    g_thread_pool_free (pool->threads, FALSE, TRUE);
+  pool->threads = NULL;
+  return NULL;
+}
+
+static void
+pool_free (GttReportPool *pool)
+{
+  gtt_project_list_snapshot_destroy (pool->snapshot);
+  g_hash_table_destroy (pool->map);
+  g_mutex_clear (&pool->mutex);
+  g_free (pool);
+}
+
+int
+gtt_report_pool_wait (GttReportPool *pool)
+{
+  int failures;
+
+  g_return_val_if_fail (pool, 0);
+
+  g_mutex_lock (&pool->mutex);
+  pool->closed = TRUE;
+  g_mutex_unlock (&pool->mutex);
+
+  scm_without_guile (pool_join, pool);
+  failures = pool->failures;
+  pool_free (pool);
+  return failures;
+}
+
+/* ======================= END OF FILE =================== */
@@ -0,0 +1,58 @@
+/*   Render reports on worker threads, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_REPORT_POOL_H
+#define GTT_REPORT_POOL_H
+
+#include <glib.h>
+
+#include "gtt_project.h"
+
+/* A report pool renders ghtml reports to files, several at a time, on
+ * a pool of threads.  When the pool is created, it takes a snapshot of
+ * the project list (see gtt_project_list_snapshot()), and all of its
+ * reports are rendered from that; each gets its own GttGhtml.  So the
+ * main thread is free to go on tracking time, and editing projects,
+ * while the reports are being written; none of that shows up in them.
+ * Each report keeps its scheme variables in a module of its own (see
+ * gtt_ghtml.c), so any number of reports, from the same template or
+ * not, can be rendered side by side.
+ *
+ * The gtt_report_pool_new() routine snapshots the project list, and
+ *    starts up to 'nthreads' threads (at least one) to render with.
+ *    Call it on the main thread.
+ *
+ * The gtt_report_pool_add() routine queues the report template at
+ *    'path' (a full path; see gtt_ghtml_resolve_path()) to be rendered
+ *    into the file 'output'.  The report is linked to the snapshot's
+ *    copy of 'prj', which must be on the snapshotted list, or NULL.
+ *
+ * The gtt_report_pool_wait() routine waits for all of the reports
+ *    to be written, frees the pool, and returns the number of reports
+ *    that failed.  Problems are printed on stderr.  No more reports
+ *    may be added afterwards.
+ */
+
+typedef struct gtt_report_pool_s GttReportPool;
+
+GttReportPool *gtt_report_pool_new (GttProjectList *plist, int nthreads);
+void gtt_report_pool_add (GttReportPool *, const char *path, GttProject *prj,
+                          const char *output);
+int gtt_report_pool_wait (GttReportPool *);
+
+#endif // GTT_REPORT_POOL_H
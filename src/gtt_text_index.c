@@ -0,0 +1,506 @@
+/*   Full-text index of the diary, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+
+#include "gtt_text_index.h"
+
+#include <glib.h>
+#include <string.h>
+
+#define NUM_FIELDS 3
+
+/* Each distinct word, with the set of the docs that use it */
+typedef struct
+{
+  char *text;
+  GHashTable *docs;
+} Word;
+
+/* One memo or set of notes */
+typedef struct
+{
+  gpointer obj;
+  int field;     /* index into docs[] */
+  GPtrArray *seq;  /* the words' text, in order, for phrases */
+  GPtrArray *uniq; /* the Words, once each */
+} Doc;
+
+typedef struct
+{
+  char **words;
+  guint nwords;
+  gboolean prefix; /* the last word is only a prefix */
+} Term;
+
+struct gtt_text_search_s
+{
+  GPtrArray *terms;
+};
+
+static GMutex index_mutex;
+static GHashTable *words = NULL; /* text -> Word */
+static GPtrArray *sorted = NULL; /* the Words in order, for prefixes */
+static GHashTable *docs[NUM_FIELDS]; /* obj -> Doc */
+
+/* ============================================================== */
+
+static int
+field_index (GttTextField field)
+{
+  switch (field)
+    {
+    case GTT_TEXT_MEMO:
+      return 0;
+    case GTT_TEXT_NOTES:
+      return 1;
+    case GTT_TEXT_PROJECT_NOTES:
+      return 2;
+    }
+  return -1;
+}
+
+/* Split the text up into words, in lower case */
+static GPtrArray *
+split_words (const char *text)
+{
+  GPtrArray *list = g_ptr_array_new_with_free_func (g_free);
+  GString *word = g_string_new (NULL);
+  gboolean utf8 = g_utf8_validate (text, -1, NULL);
+  const char *p = text;
+
+  while (*p)
+    {
+      gunichar c;
+
+      if (utf8)
+        {
+          c = g_utf8_get_char (p);
+          p = g_utf8_next_char (p);
+        }
+      else
+        c = (guchar)*p++;
+
+      if (g_unichar_isalnum (c))
+        {
+          g_string_append_unichar (word, g_unichar_tolower (c));
+          continue;
+        }
+      if (word->len)
+        {
+          g_ptr_array_add (list, g_strdup (word->str));
+          g_string_truncate (word, 0);
+        }
+    }
+  if (word->len)
+    g_ptr_array_add (list, g_strdup (word->str));
+  g_string_free (word, TRUE);
+  return list;
+}
+
+/* ============================================================== */
+/* The index itself; all of this is done holding the mutex */
+
+static void
+index_init (void)
+{
+  int f;
+
+  if (words)
+    return;
+  words = g_hash_table_new (g_str_hash, g_str_equal);
+  sorted = g_ptr_array_new ();
+  for (f = 0; f < NUM_FIELDS; f++)
+    docs[f] = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+/* The position of the first word not less than 'text' */
+static guint
+sorted_find (const char *text)
+{
+  guint lo = 0, hi = sorted->len;
+
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+      Word *w = g_ptr_array_index (sorted, mid);
+
+      if (0 > strcmp (w->text, text))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+static Word *
+word_get (const char *text)
+{
+  Word *w;
+  guint i;
+
+  w = g_hash_table_lookup (words, text);
+  if (w)
+    return w;
+
+  w = g_new0 (Word, 1);
+  w->text = g_strdup (text);
+  w->docs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  g_hash_table_insert (words, w->text, w);
+
+  i = sorted_find (text);
+  g_ptr_array_add (sorted, w);
+  memmove (&sorted->pdata[i + 1], &sorted->pdata[i],
+           (sorted->len - 1 - i) * sizeof (gpointer));
+  sorted->pdata[i] = w;
+  return w;
+}
+
+static void
+word_drop (Word *w)
+{
+  g_ptr_array_remove_index (sorted, sorted_find (w->text));
+  g_hash_table_remove (words, w->text);
+  g_hash_table_destroy (w->docs);
+  g_free (w->text);
+  g_free (w);
+}
+
+static void
+doc_drop (int f, gpointer obj)
+{
+  Doc *doc = g_hash_table_lookup (docs[f], obj);
+  guint i;
+
+  if (!doc)
+    return;
+  g_hash_table_remove (docs[f], obj);
+
+  for (i = 0; i < doc->uniq->len; i++)
+    {
+      Word *w = g_ptr_array_index (doc->uniq, i);
+
+      g_hash_table_remove (w->docs, doc);
+      if (0 == g_hash_table_size (w->docs))
+        word_drop (w);
+    }
+  g_ptr_array_free (doc->seq, TRUE);
+  g_ptr_array_free (doc->uniq, TRUE);
+  g_free (doc);
+}
+
+/* ============================================================== */
+
+void
+gtt_text_index_set (gpointer obj, GttTextField field, const char *text)
+{
+  int f = field_index (field);
+  GPtrArray *list = NULL;
+  Doc *doc;
+  guint i;
+
+  if (!obj || 0 > f)
+    return;
+
+  if (text && text[0])
+    list = split_words (text);
+
+  g_mutex_lock (&index_mutex);
+  index_init ();
+  doc_drop (f, obj);
+  if (list && list->len)
+    {
+      doc = g_new0 (Doc, 1);
+      doc->obj = obj;
+      doc->field = f;
+      doc->seq = g_ptr_array_sized_new (list->len);
+      doc->uniq = g_ptr_array_new ();
+
+      for (i = 0; i < list->len; i++)
+        {
+          Word *w = word_get (g_ptr_array_index (list, i));
+
+          g_ptr_array_add (doc->seq, w->text);
+          if (!g_hash_table_lookup (w->docs, doc))
+            {
+              g_hash_table_insert (w->docs, doc, doc);
+              g_ptr_array_add (doc->uniq, w);
+            }
+        }
+      g_hash_table_insert (docs[f], obj, doc);
+    }
+  g_mutex_unlock (&index_mutex);
+
+  if (list)
+    g_ptr_array_free (list, TRUE);
+}
+
+void
+gtt_text_index_remove (gpointer obj)
+{
+  int f;
+
+  if (!obj)
+    return;
+
+  g_mutex_lock (&index_mutex);
+  if (words)
+    {
+      for (f = 0; f < NUM_FIELDS; f++)
+        doc_drop (f, obj);
+    }
+  g_mutex_unlock (&index_mutex);
+}
+
+/* ============================================================== */
+/* Searches */
+
+static void
+add_term (GttTextSearch *ts, const char *text)
+{
+  GPtrArray *list = split_words (text);
+  size_t len = strlen (text);
+  Term *term;
+  guint i;
+
+  if (0 == list->len)
+    {
+      g_ptr_array_free (list, TRUE);
+      return;
+    }
+
+  term = g_new0 (Term, 1);
+  term->prefix = (0 < len && '*' == text[len - 1]);
+  term->nwords = list->len;
+  term->words = g_new0 (char *, list->len + 1);
+  for (i = 0; i < list->len; i++)
+    term->words[i] = g_strdup (g_ptr_array_index (list, i));
+  g_ptr_array_add (ts->terms, term);
+  g_ptr_array_free (list, TRUE);
+}
+
+GttTextSearch *
+gtt_text_search_new (const char *search)
+{
+  GttTextSearch *ts;
+  const char *p = search;
+
+  if (!search)
+    return NULL;
+
+  ts = g_new0 (GttTextSearch, 1);
+  ts->terms = g_ptr_array_new ();
+  while (*p)
+    {
+      const char *start;
+      char *text;
+
+      if (g_ascii_isspace (*p))
+        {
+          p++;
+          continue;
+        }
+      if ('"' == *p)
+        {
+          start = ++p;
+          while (*p && '"' != *p)
+            p++;
+          text = g_strndup (start, p - start);
+          if (*p)
+            p++;
+        }
+      else
+        {
+          start = p;
+          while (*p && !g_ascii_isspace (*p))
+            p++;
+          text = g_strndup (start, p - start);
+        }
+      add_term (ts, text);
+      g_free (text);
+    }
+
+  if (0 == ts->terms->len)
+    {
+      gtt_text_search_free (ts);
+      return NULL;
+    }
+  return ts;
+}
+
+void
+gtt_text_search_free (GttTextSearch *ts)
+{
+  guint i;
+
+  if (!ts)
+    return;
+  for (i = 0; i < ts->terms->len; i++)
+    {
+      Term *term = g_ptr_array_index (ts->terms, i);
+      g_strfreev (term->words);
+      g_free (term);
+    }
+  g_ptr_array_free (ts->terms, TRUE);
+  g_free (ts);
+}
+
+static gboolean
+term_matches (const Term *term, char **seq, guint n)
+{
+  guint i, j, last = term->nwords - 1;
+
+  for (i = 0; i + term->nwords <= n; i++)
+    {
+      for (j = 0; j < term->nwords; j++)
+        {
+          if (term->prefix && j == last)
+            {
+              if (!g_str_has_prefix (seq[i + j], term->words[j]))
+                break;
+            }
+          else if (strcmp (seq[i + j], term->words[j]))
+            break;
+        }
+      if (j == term->nwords)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static gboolean
+search_matches (GttTextSearch *ts, char **seq, guint n)
+{
+  guint i;
+
+  for (i = 0; i < ts->terms->len; i++)
+    {
+      if (!term_matches (g_ptr_array_index (ts->terms, i), seq, n))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+gboolean
+gtt_text_search_match (GttTextSearch *ts, const char *text)
+{
+  GPtrArray *list;
+  gboolean match;
+
+  if (!ts || !text)
+    return FALSE;
+
+  list = split_words (text);
+  match = search_matches (ts, (char **)list->pdata, list->len);
+  g_ptr_array_free (list, TRUE);
+  return match;
+}
+
+/* Find the smallest set of docs that every match must be in: those
+ * that have the rarest of the whole words searched for.  If there are
+ * only prefixes, it's the docs with words starting with the first.
+ * Returns NULL if nothing can match. */
+static GHashTable *
+find_candidates (GttTextSearch *ts, gboolean *owned)
+{
+  GHashTable *best = NULL;
+  Term *first;
+  guint i, j;
+
+  *owned = FALSE;
+  for (i = 0; i < ts->terms->len; i++)
+    {
+      Term *term = g_ptr_array_index (ts->terms, i);
+
+      for (j = 0; j < term->nwords; j++)
+        {
+          Word *w;
+
+          if (term->prefix && j == term->nwords - 1)
+            continue;
+          w = g_hash_table_lookup (words, term->words[j]);
+          if (!w)
+            return NULL;
+          if (!best || g_hash_table_size (w->docs) < g_hash_table_size (best))
+            best = w->docs;
+        }
+    }
+  if (best)
+    return best;
+
+  first = g_ptr_array_index (ts->terms, 0);
+  best = g_hash_table_new (g_direct_hash, g_direct_equal);
+  *owned = TRUE;
+  for (i = sorted_find (first->words[0]); i < sorted->len; i++)
+    {
+      Word *w = g_ptr_array_index (sorted, i);
+      GHashTableIter iter;
+      gpointer doc;
+
+      if (!g_str_has_prefix (w->text, first->words[0]))
+        break;
+      g_hash_table_iter_init (&iter, w->docs);
+      while (g_hash_table_iter_next (&iter, &doc, NULL))
+        g_hash_table_insert (best, doc, doc);
+    }
+  return best;
+}
+
+GList *
+gtt_text_index_find (GttTextSearch *ts, guint fields)
+{
+  GHashTable *cands, *found;
+  GHashTableIter iter;
+  GList *result = NULL;
+  gboolean owned;
+  Doc *doc;
+
+  if (!ts)
+    return NULL;
+
+  g_mutex_lock (&index_mutex);
+  index_init ();
+  cands = find_candidates (ts, &owned);
+  if (!cands)
+    {
+      g_mutex_unlock (&index_mutex);
+      return NULL;
+    }
+
+  found = g_hash_table_new (g_direct_hash, g_direct_equal);
+  g_hash_table_iter_init (&iter, cands);
+  while (g_hash_table_iter_next (&iter, (gpointer *)&doc, NULL))
+    {
+      if (!(fields & (1 << doc->field)))
+        continue;
+      if (g_hash_table_lookup (found, doc->obj))
+        continue;
+      if (!search_matches (ts, (char **)doc->seq->pdata, doc->seq->len))
+        continue;
+      g_hash_table_insert (found, doc->obj, doc->obj);
+      result = g_list_prepend (result, doc->obj);
+    }
+  if (owned)
+    g_hash_table_destroy (cands);
+  g_mutex_unlock (&index_mutex);
+
+  g_hash_table_destroy (found);
+  return result;
+}
+
+/* ======================= END OF FILE =================== */
@@ -0,0 +1,82 @@
+/*   Full-text index of the diary, for GnoTime - a time tracker
+ *   Copyright (C) 2026 GnoTime contributors
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GTT_TEXT_INDEX_H
+#define GTT_TEXT_INDEX_H
+
+#include <glib.h>
+
+/* The text index finds the tasks whose memo or notes, or the projects
+ * whose notes, mention some words, without reading through all of
+ * them.  It maps each word to the places where it is used, and is
+ * kept up to date by gtt_task_set_memo(), gtt_task_set_notes() and
+ * gtt_project_set_notes(), as well as when tasks and projects are
+ * created and destroyed.  Only the live projects are indexed; not
+ * snapshots of them.
+ *
+ * Words are runs of letters and digits, compared without regard to
+ * case.  A search is a list of terms, all of which must be found in
+ * the same memo or notes:
+ *
+ *   ticket 4711          both words, anywhere
+ *   invoic*              any word starting with 'invoic'
+ *   "code review"        the words, one right after the other
+ *   ticket-4711          the same as "ticket 4711"
+ *
+ * The gtt_text_index_set() routine indexes 'text' as the given field
+ *    of 'obj' (a GttTask for the memo and notes, a GttProject for the
+ *    project notes), replacing whatever was indexed for it before.
+ *
+ * The gtt_text_index_remove() routine drops everything indexed for
+ *    'obj'.  It must be called before the object is freed.
+ *
+ * The gtt_text_search_new() routine parses a search; it returns NULL
+ *    if there are no words in it.  The gtt_text_search_free() routine
+ *    frees it.
+ *
+ * The gtt_text_search_match() routine checks whether the text matches
+ *    the search, without using the index; for anything not indexed.
+ *
+ * The gtt_text_index_find() routine returns the list of objects
+ *    where the search matches in any of the 'fields', in no particular
+ *    order; the caller must g_list_free() it.  Task fields and project
+ *    fields should not be asked for at once.  Each object is listed
+ *    once.
+ *
+ * All of these may be called from any thread.
+ */
+
+typedef enum
+{
+  GTT_TEXT_MEMO = 1 << 0,         /* gtt_task_get_memo() */
+  GTT_TEXT_NOTES = 1 << 1,        /* gtt_task_get_notes() */
+  GTT_TEXT_PROJECT_NOTES = 1 << 2 /* gtt_project_get_notes() */
+} GttTextField;
+
+typedef struct gtt_text_search_s GttTextSearch;
+
+void gtt_text_index_set (gpointer obj, GttTextField field, const char *text);
+void gtt_text_index_remove (gpointer obj);
+
+GttTextSearch *gtt_text_search_new (const char *search);
+void gtt_text_search_free (GttTextSearch *);
+gboolean gtt_text_search_match (GttTextSearch *, const char *text);
+
+GList *gtt_text_index_find (GttTextSearch *, guint fields);
+
+#endif // GTT_TEXT_INDEX_H
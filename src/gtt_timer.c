@@ -21,7 +21,12 @@
 
 #include "gtt_timer.h"
 
+#include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
 
 #include "gtt.h"
 #include "gtt_activation_dialog.h"
@@ -45,56 +50,220 @@ static GttIdleDialog *idle_dialog = NULL;
 static GttActiveDialog *active_dialog = NULL;
 
 /* =========================================================== */
-/* zero out day counts if rolled past midnight */
-
-static int day_last_reset = -1;
-static int year_last_reset = -1;
+/* Recompute the period totals when a day, week, month or year
+ * boundary goes by.  Where available, a timerfd is armed for the
+ * exact start of the next day; the TFD_TIMER_CANCEL_ON_SET flag makes
+ * it fire early if the wall clock is set, or if the system resumes
+ * from suspend, so that we can catch up right away.  Elsewhere, we
+ * fall back to a plain timeout. */
+
+static time_t last_reset = -1;
+static guint rollover_timer = 0;
+#ifdef HAVE_SYS_TIMERFD_H
+static int rollover_fd = -1;
+#endif
 
 void
 set_last_reset (time_t last)
 {
-  struct tm *t0;
-  t0 = localtime (&last);
-  day_last_reset = t0->tm_yday;
-  year_last_reset = t0->tm_year;
+  last_reset = last;
 }
 
-static void schedule_zero_daily_counters_timer (void);
-
 gint
 zero_daily_counters (gpointer data)
 {
-  struct tm *t1;
+  GttPeriodMask mask;
   time_t now = time (0);
 
-  /* zero out day counts */
-  t1 = localtime (&now);
-  if ((year_last_reset != t1->tm_year) || (day_last_reset != t1->tm_yday))
+  /* Recompute only the totals whose period rolled over */
+  mask = gtt_period_rollover_mask (last_reset, now);
+  if (mask)
     {
-      gtt_project_list_compute_secs ();
+      gtt_project_list_rollover (mask);
       gtt_projects_tree_update_all_rows (projects_tree);
-      log_endofday ();
-      year_last_reset = t1->tm_year;
-      day_last_reset = t1->tm_yday;
+      if (mask & GTT_PERIOD_DAY)
+        log_endofday ();
     }
-  schedule_zero_daily_counters_timer ();
+  last_reset = now;
+  schedule_day_rollover ();
   return 0;
 }
 
+#ifdef HAVE_SYS_TIMERFD_H
+static gboolean
+rollover_fd_ready (GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+  guint64 expirations;
+
+  /* The read fails with ECANCELED if the clock was set; either way,
+   * we look at what rolled over and re-arm the timer. */
+  if (0 > read (rollover_fd, &expirations, sizeof (expirations))
+      && EAGAIN == errno)
+    return TRUE;
+
+  zero_daily_counters (NULL);
+  return TRUE;
+}
+
+static gboolean
+arm_rollover_fd (time_t when)
+{
+  struct itimerspec its;
+  int rc;
+
+  if (0 > rollover_fd)
+    {
+      GIOChannel *chan;
+
+      rollover_fd
+          = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+      if (0 > rollover_fd)
+        return FALSE;
+
+      chan = g_io_channel_unix_new (rollover_fd);
+      rollover_timer = g_io_add_watch (chan, G_IO_IN, rollover_fd_ready, NULL);
+      g_io_channel_unref (chan);
+    }
+
+  memset (&its, 0, sizeof (its));
+  its.it_value.tv_sec = when;
+  rc = timerfd_settime (rollover_fd,
+                        TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its,
+                        NULL);
+  if (0 > rc)
+    {
+      g_source_remove (rollover_timer);
+      rollover_timer = 0;
+      close (rollover_fd);
+      rollover_fd = -1;
+      return FALSE;
+    }
+  return TRUE;
+}
+#endif /* HAVE_SYS_TIMERFD_H */
+
+static gint
+rollover_timer_func (gpointer data)
+{
+  rollover_timer = 0;
+  return zero_daily_counters (NULL);
+}
+
+void
+schedule_day_rollover (void)
+{
+  time_t now = time (0);
+  time_t next = gtt_next_day_start (now);
+
+  if (0 >= last_reset)
+    last_reset = now;
+
+#ifdef HAVE_SYS_TIMERFD_H
+  if (arm_rollover_fd (next))
+    return;
+#endif
+
+  if (rollover_timer)
+    g_source_remove (rollover_timer);
+
+  /* Add a second, so that we don't wake up just short of it */
+  rollover_timer
+      = g_timeout_add_seconds (next - now + 1, rollover_timer_func, NULL);
+}
+
 /* =========================================================== */
 
+/* Rather than blindly writing the data file every autosave period,
+ * save it when it has actually changed, and preferably at a moment
+ * when the user isn't typing or clicking.  A burst of edits gets
+ * saved as soon as the user pauses, though not more often than a
+ * quarter of the autosave period (and never within half a minute of
+ * the last save); a trickle of timer updates waits for the autosave
+ * period.  No matter how busy the user is, unsaved changes are never
+ * held back for more than twice the autosave period.
+ *
+ * The GUI configuration gets no change notice (window sizes and such
+ * change behind our back), so it is still saved every period, but it
+ * too waits for a pause, for up to another period. */
+
+#define AUTOSAVE_CHECK_SECS 5
+#define AUTOSAVE_QUIET_SECS 3
+#define AUTOSAVE_BURST (20 * GTT_CHANGE_EDIT)
+#define AUTOSAVE_MIN_GAP_SECS 30
+
+static time_t dirty_since = 0;
+static time_t last_save = 0;
+static time_t config_due = 0;
+
+static gboolean
+user_is_busy (void)
+{
+  int idle;
+
+  /* If we can't tell whether the user is busy, assume not */
+  idle = idle_dialog_get_idle_secs (idle_dialog);
+  return (0 <= idle && AUTOSAVE_QUIET_SECS > idle);
+}
+
 static gint
 file_save_timer_func (gpointer data)
 {
+  guint unsaved;
+  time_t now, age;
+  int period, gap;
+  gboolean save;
+
+  unsaved = gtt_project_list_unsaved_changes ();
+  if (0 == unsaved)
+    {
+      dirty_since = 0;
+      return 1;
+    }
+
+  now = time (0);
+  if (0 == dirty_since || now < dirty_since)
+    dirty_since = now;
+  age = now - dirty_since;
+
+  period = MAX (config_autosave_period, AUTOSAVE_CHECK_SECS);
+  if (age >= 2 * period)
+    {
+      save = TRUE;
+    }
+  else
+    {
+      gap = MAX (period / 4, AUTOSAVE_MIN_GAP_SECS);
+      save = !user_is_busy ()
+             && ((AUTOSAVE_BURST <= unsaved && gap <= now - last_save)
+                 || period <= age);
+    }
+  if (!save)
+    return 1;
+
   save_projects ();
+  last_save = now;
+
+  /* If the save failed, don't retry until a full period goes by */
+  dirty_since = gtt_project_list_unsaved_changes () ? now : 0;
   return 1;
 }
 
+static void start_config_save_timer (void);
+
 static gint
 config_save_timer_func (gpointer data)
 {
+  config_save_timer = 0;
+  if (user_is_busy () && time (0) < config_due + config_autosave_props_period)
+    {
+      config_save_timer = g_timeout_add_seconds (AUTOSAVE_CHECK_SECS,
+                                                 config_save_timer_func, NULL);
+      return 0;
+    }
+
   save_properties ();
-  return 1;
+  start_config_save_timer ();
+  return 0;
 }
 
 static gint
@@ -143,7 +312,7 @@ static void
 start_file_save_timer (void)
 {
   g_return_if_fail (!file_save_timer);
-  file_save_timer = g_timeout_add_seconds (config_autosave_period,
+  file_save_timer = g_timeout_add_seconds (AUTOSAVE_CHECK_SECS,
                                            file_save_timer_func, NULL);
 }
 
@@ -151,6 +320,7 @@ static void
 start_config_save_timer (void)
 {
   g_return_if_fail (!config_save_timer);
+  config_due = time (0) + config_autosave_props_period;
   config_save_timer = g_timeout_add_seconds (config_autosave_props_period,
                                              config_save_timer_func, NULL);
 }
@@ -181,6 +351,7 @@ init_timer (void)
   start_main_timer ();
   start_file_save_timer ();
   start_config_save_timer ();
+  schedule_day_rollover ();
 }
 
 gboolean
@@ -218,14 +389,6 @@ start_no_project_timer (void)
     }
 }
 
-static void
-schedule_zero_daily_counters_timer (void)
-{
-  time_t now = time (0);
-  time_t timeout = 3600 - (now % 3600);
-  g_timeout_add_seconds (timeout, zero_daily_counters, NULL);
-}
-
 gboolean
 timer_project_is_running (GttProject *prj)
 {
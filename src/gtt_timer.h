@@ -39,12 +39,18 @@ gboolean timer_project_is_running (GttProject *prj);
 extern int config_idle_timeout;
 extern int config_no_project_timeout;
 
-/* The autosave period is how long, in seconds, we wait before doing a
- * periodic save-thyself. */
+/* The autosave period is how long, in seconds, unsaved changes may
+ * wait for a quiet moment before they get saved.  Changes are always
+ * saved within twice this period, even if the user never pauses. */
 extern int config_autosave_period;
 
+/* The zero_daily_counters() routine recomputes the day, week, month
+ * and year totals that rolled over since the last reset.  The
+ * schedule_day_rollover() routine (re-)arms it to run at the start
+ * of the next day; call it again if config_daystart_offset changes. */
 gint zero_daily_counters (gpointer data);
 void set_last_reset (time_t last);
+void schedule_day_rollover (void);
 
 void gen_start_timer (void);
 void gen_stop_timer (void);
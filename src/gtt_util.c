@@ -101,19 +101,30 @@ xxxqof_print_hours_elapsed_buff (char *buff, size_t len, int secs,
 
 size_t
 xxxqof_print_date_time_buff (char *buff, size_t len, time_t secs)
+{
+  struct tm ltm;
+
+  if (!buff)
+    return 0;
+  localtime_r (&secs, &ltm);
+  return xxxqof_print_date_time_tm_buff (buff, len, secs, &ltm);
+}
+
+size_t
+xxxqof_print_date_time_tm_buff (char *buff, size_t len, time_t secs,
+                                const struct tm *ltm)
 {
   int flen;
   int day, month, year, hour, min;
-  struct tm ltm, gtm;
+  struct tm gtm;
 
   if (!buff)
     return 0;
-  ltm = *localtime (&secs);
-  day = ltm.tm_mday;
-  month = ltm.tm_mon + 1;
-  year = ltm.tm_year + 1900;
-  hour = ltm.tm_hour;
-  min = ltm.tm_min;
+  day = ltm->tm_mday;
+  month = ltm->tm_mon + 1;
+  year = ltm->tm_year + 1900;
+  hour = ltm->tm_hour;
+  min = ltm->tm_min;
   // sec = ltm.tm_sec;
   switch (qof_date_format_get_current ())
     {
@@ -131,13 +142,13 @@ xxxqof_print_date_time_buff (char *buff, size_t len, time_t secs)
       break;
     case QOF_DATE_FORMAT_UTC:
       {
-        gtm = *gmtime (&secs);
+        gmtime_r (&secs, &gtm);
         flen = strftime (buff, len, QOF_UTC_DATE_FORMAT, &gtm);
         break;
       }
     case QOF_DATE_FORMAT_LOCALE:
       {
-        flen = strftime (buff, len, QOF_D_T_FMT, &ltm);
+        flen = strftime (buff, len, QOF_D_T_FMT, ltm);
       }
       break;
 
@@ -152,20 +163,31 @@ xxxqof_print_date_time_buff (char *buff, size_t len, time_t secs)
 
 size_t
 xxxqof_print_time_buff (gchar *buff, size_t len, time_t secs)
+{
+  struct tm ltm;
+
+  if (!buff)
+    return 0;
+  localtime_r (&secs, &ltm);
+  return xxxqof_print_time_tm_buff (buff, len, secs, &ltm);
+}
+
+size_t
+xxxqof_print_time_tm_buff (gchar *buff, size_t len, time_t secs,
+                           const struct tm *ltm)
 {
   gint flen;
-  struct tm ltm, gtm;
+  struct tm gtm;
 
   if (!buff)
     return 0;
   if (qof_date_format_get_current () == QOF_DATE_FORMAT_UTC)
     {
-      gtm = *gmtime (&secs);
+      gmtime_r (&secs, &gtm);
       flen = strftime (buff, len, QOF_UTC_DATE_FORMAT, &gtm);
       return flen;
     }
-  ltm = *localtime (&secs);
-  flen = strftime (buff, len, QOF_T_FMT, &ltm);
+  flen = strftime (buff, len, QOF_T_FMT, ltm);
 
   return flen;
 }
@@ -223,13 +245,13 @@ xxxqof_print_date_dmy_buff (char *buff, size_t len, int day, int month,
 size_t
 xxxqof_print_date_buff (char *buff, size_t len, time_t t)
 {
-  struct tm *theTime;
+  struct tm theTime;
   if (!buff)
     return 0;
-  theTime = localtime (&t);
-  return xxxqof_print_date_dmy_buff (buff, len, theTime->tm_mday,
-                                     theTime->tm_mon + 1,
-                                     theTime->tm_year + 1900);
+  localtime_r (&t, &theTime);
+  return xxxqof_print_date_dmy_buff (buff, len, theTime.tm_mday,
+                                     theTime.tm_mon + 1,
+                                     theTime.tm_year + 1900);
 }
 
 size_t
@@ -268,8 +290,8 @@ gboolean
 xxxqof_is_same_day (time_t ta, time_t tb)
 {
   struct tm lta, ltb;
-  lta = *localtime (&ta);
-  ltb = *localtime (&tb);
+  localtime_r (&ta, &lta);
+  localtime_r (&tb, &ltb);
   if (lta.tm_year == ltb.tm_year)
     {
       return (ltb.tm_yday - lta.tm_yday);
@@ -21,6 +21,7 @@
 #define GTT_UTIL_H
 
 #include <gtk/gtk.h>
+#include <time.h>
 
 /* ------------------------------------------------------------------ */
 /* some gtk-like utilities */
@@ -35,6 +36,13 @@ size_t xxxqof_print_hours_elapsed_buff (char *buff, size_t len, int secs,
 size_t xxxqof_print_date_time_buff (char *buff, size_t len, time_t secs);
 size_t xxxqof_print_date_buff (char *buff, size_t len, time_t t);
 size_t xxxqof_print_time_buff (gchar *buff, size_t len, time_t secs);
+
+/* The same, for callers that already have the local time broken
+ * down; 'secs' is still needed for the UTC format. */
+size_t xxxqof_print_date_time_tm_buff (char *buff, size_t len, time_t secs,
+                                       const struct tm *ltm);
+size_t xxxqof_print_time_tm_buff (gchar *buff, size_t len, time_t secs,
+                                  const struct tm *ltm);
 gboolean xxxqof_is_same_day (time_t ta, time_t tb);
 
 size_t xxxqof_print_minutes_elapsed_buff (char *buff, size_t len, int secs,
@@ -276,6 +276,7 @@ parse_project (xmlNodePtr project)
 {
   xmlNodePtr node;
   GttProject *prj = NULL;
+  time_t modified = 0;
 
   if (!project)
     {
@@ -326,7 +327,11 @@ parse_project (xmlNodePtr project)
       GET_ENUM_6 (prj, gtt_project_set_status, "status", NO_STATUS,
                   NOT_STARTED, IN_PROGRESS, ON_HOLD, CANCELLED, COMPLETED)
 
-      if (0 == strcmp ("task-list", (char *)node->name))
+      if (0 == strcmp ("last_modified", (char *)node->name))
+        {
+          modified = atol ((const char *)GET_TEXT (node));
+        }
+      else if (0 == strcmp ("task-list", (char *)node->name))
         {
           xmlNodePtr tn;
           for (tn = node->xmlChildrenNode; tn; tn = tn->next)
@@ -355,6 +360,9 @@ parse_project (xmlNodePtr project)
         }
     }
   gtt_project_thaw (prj);
+
+  /* Building it up counted as editing it; it wasn't */
+  gtt_project_set_last_modified (prj, modified);
   return prj;
 }
 
@@ -441,6 +449,9 @@ gtt_xml_read_file (const char *filename)
 
   /* recompute the cached counters */
   gtt_project_list_compute_secs ();
+
+  /* What we just read is, by definition, what's on disk */
+  gtt_project_list_mark_saved (gtt_project_list_get_changes ());
 }
 
 /* ====================== END OF FILE =============== */
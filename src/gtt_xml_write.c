@@ -315,6 +315,7 @@ gtt_xml_project_to_dom_tree (GttProject *prj)
   PUT_LONG ("estimated_start", gtt_project_get_estimated_start (prj));
   PUT_LONG ("estimated_end", gtt_project_get_estimated_end (prj));
   PUT_LONG ("due_date", gtt_project_get_due_date (prj));
+  PUT_LONG ("last_modified", gtt_project_get_last_modified (prj));
 
   PUT_INT ("sizing", gtt_project_get_sizing (prj));
   PUT_INT ("percent_complete", gtt_project_get_percent_complete (prj));
@@ -400,6 +401,10 @@ gtt_xml_write_file (const char *filename)
   xmlNodePtr topnode;
   FILE *fh;
   int rc;
+  guint changes;
+
+  /* Anything changed while we write will need another save */
+  changes = gtt_project_list_get_changes ();
 
   tmpfilename = g_strconcat (filename, ".tmp", NULL);
   fh = fopen (tmpfilename, "w");
@@ -458,6 +463,7 @@ gtt_xml_write_file (const char *filename)
       gtt_err_set_code (GTT_CANT_WRITE_FILE);
       return;
     }
+  gtt_project_list_mark_saved (changes);
 }
 
 /* ===================== END OF FILE ================== */
@@ -40,6 +40,7 @@
 
 #include "gtt.h"
 #include "gtt_application_window.h"
+#include "gtt_batch_report.h"
 #include "gtt_current_project.h"
 #include "gtt_err_throw.h"
 #include "gtt_file_io.h"
@@ -93,31 +94,39 @@ build_lock_fname (void)
   return fname;
 }
 
-static void
-lock_gtt (void)
+gboolean
+gtt_is_running (void)
 {
   FILE *f;
-  char *fname;
-  gboolean warn = FALSE;
-
-  fname = build_lock_fname ();
+  gboolean running = FALSE;
 
   /* if the pid file exists and such a process exists
    * and this process is owned by the current user,
    * else this pid file is very very stale and can be
    * ignored */
-  if (NULL != (f = fopen (fname, "rt")))
+  if (NULL != (f = fopen (build_lock_fname (), "rt")))
     {
       int pid;
 
-      if (fscanf (f, "%d", &pid) == 1 && pid > 0 && kill (pid, 0) == 0)
+      if (fscanf (f, "%d", &pid) == 1 && pid > 0 && pid != getpid ()
+          && kill (pid, 0) == 0)
         {
-          warn = TRUE;
+          running = TRUE;
         }
       fclose (f);
     }
+  return running;
+}
 
-  if (warn)
+static void
+lock_gtt (void)
+{
+  FILE *f;
+  char *fname;
+
+  fname = build_lock_fname ();
+
+  if (gtt_is_running ())
     {
       GtkWidget *warning;
       warning = gnome_message_box_new (
@@ -805,6 +814,10 @@ main (int argc, char *argv[])
             N_ ("Select a project on startup"), N_ ("PROJECT") },
           { NULL, '\0', 0, NULL, 0 } };
 
+  /* Reports can be run from the command line, without a display */
+  if (gtt_batch_report_wanted (argc, argv))
+    return gtt_batch_report_main (argc, argv);
+
   gnome_program_init (PACKAGE, VERSION, LIBGNOMEUI_MODULE, argc, argv,
                       GNOME_PARAM_POPT_TABLE, geo_options,
                       GNOME_PROGRAM_STANDARD_PROPERTIES, NULL);